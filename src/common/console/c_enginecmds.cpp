@@ -277,6 +277,36 @@ CCMD (wdir)
 	}
 }
 
+//==========================================================================
+//
+// CCMD fs_memstats
+//
+// Lists how much lump data each loaded resource file keeps in the heap
+// and how much of its file mapping is resident.
+//
+//==========================================================================
+
+CCMD (fs_memstats)
+{
+	FResourceMemoryInfo total;
+
+	Printf ("Heap KB   Shared KB  Mapped KB  Resident KB  File\n");
+	for (int i = 0; i < fileSystem.GetNumWads(); ++i)
+	{
+		FResourceMemoryInfo info;
+		fileSystem.GetMemoryInfo(i, info);
+		Printf ("%9zu %10zu %10zu %12zu  %s\n", info.HeapBytes >> 10, info.SharedBytes >> 10, info.MappedBytes >> 10,
+			info.ResidentBytes >> 10, fileSystem.GetResourceFileName(i));
+
+		total.HeapBytes += info.HeapBytes;
+		total.SharedBytes += info.SharedBytes;
+		total.MappedBytes += info.MappedBytes;
+		total.ResidentBytes += info.ResidentBytes;
+	}
+	Printf ("%9zu %10zu %10zu %12zu  total\n", total.HeapBytes >> 10, total.SharedBytes >> 10, total.MappedBytes >> 10,
+		total.ResidentBytes >> 10);
+}
+
 //==========================================================================
 //
 // CCMD md5sum
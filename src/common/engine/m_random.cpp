@@ -431,6 +431,23 @@ FRandom *FRandom::StaticFindRNG (const char *name)
 	return probe;
 }
 
+//==========================================================================
+//
+// FRandom :: StaticFindRNGByCRC
+//
+// Like StaticFindRNG but only looks for existing RNGs.
+//
+//==========================================================================
+
+FRandom *FRandom::StaticFindRNGByCRC(uint32_t namecrc)
+{
+	for (FRandom *probe = RNGList; probe != NULL && probe->NameCRC <= namecrc; probe = probe->Next)
+	{
+		if (probe->NameCRC == namecrc) return probe;
+	}
+	return NULL;
+}
+
 //==========================================================================
 //
 // FRandom :: StaticPrintSeeds
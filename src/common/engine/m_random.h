@@ -173,6 +173,7 @@ public:
 	static void StaticReadRNGState (FSerializer &arc);
 	static void StaticWriteRNGState (FSerializer &file);
 	static FRandom *StaticFindRNG(const char *name);
+	static FRandom *StaticFindRNGByCRC(uint32_t namecrc);
 
 #ifndef NDEBUG
 	static void StaticPrintSeeds ();
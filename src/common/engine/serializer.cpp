@@ -130,6 +130,23 @@ bool FSerializer::OpenWriter(bool pretty)
 	return true;
 }
 
+//==========================================================================
+//
+// Same structure as JSON output, but with interned keys and raw values.
+// OpenReader detects the format by itself.
+//
+//==========================================================================
+
+bool FSerializer::OpenBinaryWriter()
+{
+	if (w != nullptr || r != nullptr) return false;
+
+	mErrors = 0;
+	w = new FWriter(false, true);
+	BeginObject(nullptr);
+	return true;
+}
+
 //==========================================================================
 //
 //
@@ -705,11 +722,13 @@ const char *FSerializer::GetOutput(unsigned *len)
 	if (isReading()) return nullptr;
 	WriteObjects();
 	EndObject();
+	unsigned size;
+	auto output = w->GetOutput(&size);
 	if (len != nullptr)
 	{
-		*len = (unsigned)w->mOutString.GetSize();
+		*len = size;
 	}
-	return w->mOutString.GetString();
+	return output;
 }
 
 //==========================================================================
@@ -719,21 +738,53 @@ const char *FSerializer::GetOutput(unsigned *len)
 //==========================================================================
 
 FCompressedBuffer FSerializer::GetCompressedOutput()
+{
+	FCompressedBuffer buff = GetUncompressedOutput();
+	CompressOutput(buff);
+	return buff;
+}
+
+//==========================================================================
+//
+// Returns a stored copy of the output, so that it can be compressed
+// later, e.g. on another thread.
+//
+//==========================================================================
+
+FCompressedBuffer FSerializer::GetUncompressedOutput()
 {
 	if (isReading()) return{ 0,0,0,0,0,nullptr };
 	FCompressedBuffer buff;
 	WriteObjects();
 	EndObject();
-	buff.mSize = (unsigned)w->mOutString.GetSize();
+	auto output = w->GetOutput(&buff.mSize);
+	buff.mCompressedSize = buff.mSize;
+	buff.mMethod = METHOD_STORED;
 	buff.mZipFlags = 0;
-	buff.mCRC32 = crc32(0, (const Bytef*)w->mOutString.GetString(), buff.mSize);
+	buff.mCRC32 = crc32(0, (const Bytef*)output, buff.mSize);
+	buff.mBuffer = new char[buff.mSize + 1];
+	memcpy(buff.mBuffer, output, buff.mSize);
+	buff.mBuffer[buff.mSize] = 0;
+	return buff;
+}
+
+//==========================================================================
+//
+// Does not touch any serializer state and is safe to call from any thread.
+// The buffer stays stored if compression fails.
+//
+//==========================================================================
+
+void FSerializer::CompressOutput(FCompressedBuffer &buff)
+{
+	if (buff.mMethod != METHOD_STORED || buff.mBuffer == nullptr) return;
 
 	uint8_t *compressbuf = new uint8_t[buff.mSize+1];
 
 	z_stream stream;
 	int err;
 
-	stream.next_in = (Bytef *)w->mOutString.GetString();
+	stream.next_in = (Bytef *)buff.mBuffer;
 	stream.avail_in = buff.mSize;
 	stream.next_out = (Bytef*)compressbuf;
 	stream.avail_out = buff.mSize;
@@ -745,32 +796,28 @@ FCompressedBuffer FSerializer::GetCompressedOutput()
 	err = deflateInit2(&stream, 8, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
 	if (err != Z_OK)
 	{
-		goto error;
+		delete[] compressbuf;
+		return;
 	}
 
 	err = deflate(&stream, Z_FINISH);
 	if (err != Z_STREAM_END) 
 	{
 		deflateEnd(&stream);
-		goto error;
+		delete[] compressbuf;
+		return;
 	}
-	buff.mCompressedSize = stream.total_out;
 
 	err = deflateEnd(&stream);
 	if (err == Z_OK)
 	{
+		delete[] buff.mBuffer;
+		buff.mCompressedSize = stream.total_out;
 		buff.mBuffer = new char[buff.mCompressedSize];
 		buff.mMethod = METHOD_DEFLATE;
 		memcpy(buff.mBuffer, compressbuf, buff.mCompressedSize);
-		delete[] compressbuf;
-		return buff;
 	}
-
-error:
-	memcpy(compressbuf, w->mOutString.GetString(), buff.mSize + 1);
-	buff.mCompressedSize = buff.mSize;
-	buff.mMethod = METHOD_STORED;
-	return buff;
+	delete[] compressbuf;
 }
 
 //==========================================================================
@@ -79,6 +79,7 @@ public:
 	}
 	void SetUniqueSoundNames() { soundNamesAreUnique = true; }
 	bool OpenWriter(bool pretty = true);
+	bool OpenBinaryWriter();
 	bool OpenReader(const char *buffer, size_t length);
 	bool OpenReader(FCompressedBuffer *input);
 	void Close();
@@ -91,6 +92,8 @@ public:
 	const char *GetKey();
 	const char *GetOutput(unsigned *len = nullptr);
 	FCompressedBuffer GetCompressedOutput();
+	FCompressedBuffer GetUncompressedOutput();
+	static void CompressOutput(FCompressedBuffer &buff);	// deflates a buffer from GetUncompressedOutput in place
 	// The sprite serializer is a special case because it is needed by the VM to handle its 'spriteid' type.
 	virtual FSerializer &Sprite(const char *key, int32_t &spritenum, int32_t *def);
 	// This is only needed by the type system.
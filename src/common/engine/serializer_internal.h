@@ -24,6 +24,130 @@ struct FJSONObject
 	}
 };
 
+//==========================================================================
+//
+// Binary serializer format
+//
+// A stream of tagged values in the same structure the JSON would have.
+// Keys are interned: the first use of a key stores its name, later ones
+// only its index. Strings are stored with a terminating 0 so that the
+// reader can reference them in place. The data gets turned into the same
+// rapidjson document the JSON reader creates, so everything that reads
+// a savegame works with both formats.
+//
+//==========================================================================
+
+static const char BinarySerializerMagic[4] = { 'G', 'Z', 'B', 'S' };
+
+enum EBinarySerializer
+{
+	BINSER_VERSION = 1,
+
+	BIN_NULL = 0,
+	BIN_FALSE,
+	BIN_TRUE,
+	BIN_INT,		// zigzag encoded varint
+	BIN_UINT,		// varint
+	BIN_DOUBLE,		// 8 bytes, little endian
+	BIN_STRING,		// varint length, characters, 0
+	BIN_OBJECT,
+	BIN_ARRAY,
+	BIN_END,		// ends the current object or array
+	BIN_KEY,		// varint key index
+	BIN_NEWKEY,		// varint length, characters, 0. Gets the next key index.
+};
+
+struct FBinaryWriter
+{
+	TArray<uint8_t> mData;
+	TMap<FString, unsigned> mKeys;
+	TMap<const char *, unsigned> mKeyPointers;	// most keys are string literals, so this saves hashing their contents
+	TArray<const char *> mKeyNames;
+
+	FBinaryWriter()
+	{
+		mData.Grow(65536);
+		Bytes(BinarySerializerMagic, 4);
+		mData.Push(BINSER_VERSION);
+	}
+
+	void Bytes(const char *data, unsigned len)
+	{
+		unsigned pos = mData.Reserve(len);
+		memcpy(&mData[pos], data, len);
+	}
+
+	void VarInt(uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			mData.Push(uint8_t(v | 0x80));
+			v >>= 7;
+		}
+		mData.Push(uint8_t(v));
+	}
+
+	void Chars(uint8_t tag, const char *k)
+	{
+		unsigned len = (unsigned)strlen(k);
+		mData.Push(tag);
+		VarInt(len);
+		Bytes(k, len + 1);
+	}
+
+	void StartObject() { mData.Push(BIN_OBJECT); }
+	void EndObject() { mData.Push(BIN_END); }
+	void StartArray() { mData.Push(BIN_ARRAY); }
+	void EndArray() { mData.Push(BIN_END); }
+	void Null() { mData.Push(BIN_NULL); }
+	void Bool(bool k) { mData.Push(k ? BIN_TRUE : BIN_FALSE); }
+	void String(const char *k) { Chars(BIN_STRING, k); }
+
+	void Key(const char *k)
+	{
+		// The pointer only counts if the text behind it is still the same, keys can also come from reused buffers.
+		unsigned *index = mKeyPointers.CheckKey(k);
+		if (index == nullptr || strcmp(mKeyNames[*index], k) != 0)
+		{
+			FString key = k;
+			index = mKeys.CheckKey(key);
+			if (index == nullptr)
+			{
+				// The name's characters are shared with the map's copy and stay where they are.
+				mKeyPointers[k] = mKeys[key] = mKeyNames.Push(key.GetChars());
+				Chars(BIN_NEWKEY, k);
+				return;
+			}
+			mKeyPointers[k] = *index;
+		}
+		mData.Push(BIN_KEY);
+		VarInt(*index);
+	}
+
+	void Int64(int64_t k)
+	{
+		mData.Push(BIN_INT);
+		VarInt((uint64_t(k) << 1) ^ uint64_t(k >> 63));
+	}
+
+	void Uint64(uint64_t k)
+	{
+		mData.Push(BIN_UINT);
+		VarInt(k);
+	}
+
+	void Double(double k)
+	{
+		uint64_t bits;
+		memcpy(&bits, &k, 8);
+		mData.Push(BIN_DOUBLE);
+		for (int i = 0; i < 8; i++, bits >>= 8)
+		{
+			mData.Push(uint8_t(bits));
+		}
+	}
+};
+
 //==========================================================================
 //
 // some wrapper stuff to keep the RapidJSON dependencies out of the global headers.
@@ -38,21 +162,27 @@ struct FWriter
 
 	Writer *mWriter1;
 	PrettyWriter *mWriter2;
+	FBinaryWriter *mWriter3;
 	TArray<bool> mInObject;
 	rapidjson::StringBuffer mOutString;
 	TArray<DObject *> mDObjects;
 	TMap<DObject *, int> mObjectMap;
 	
-	FWriter(bool pretty)
+	FWriter(bool pretty, bool binary = false)
 	{
-		if (!pretty)
+		mWriter1 = nullptr;
+		mWriter2 = nullptr;
+		mWriter3 = nullptr;
+		if (binary)
+		{
+			mWriter3 = new FBinaryWriter;
+		}
+		else if (!pretty)
 		{
 			mWriter1 = new Writer(mOutString);
-			mWriter2 = nullptr;
 		}
 		else
 		{
-			mWriter1 = nullptr;
 			mWriter2 = new PrettyWriter(mOutString);
 		}
 	}
@@ -61,6 +191,18 @@ struct FWriter
 	{
 		if (mWriter1) delete mWriter1;
 		if (mWriter2) delete mWriter2;
+		if (mWriter3) delete mWriter3;
+	}
+
+	const char *GetOutput(unsigned *len)
+	{
+		if (mWriter3)
+		{
+			*len = mWriter3->mData.Size();
+			return (const char *)mWriter3->mData.Data();
+		}
+		*len = (unsigned)mOutString.GetSize();
+		return mOutString.GetString();
 	}
 
 
@@ -73,36 +215,42 @@ struct FWriter
 	{
 		if (mWriter1) mWriter1->StartObject();
 		else if (mWriter2) mWriter2->StartObject();
+		else if (mWriter3) mWriter3->StartObject();
 	}
 
 	void EndObject()
 	{
 		if (mWriter1) mWriter1->EndObject();
 		else if (mWriter2) mWriter2->EndObject();
+		else if (mWriter3) mWriter3->EndObject();
 	}
 
 	void StartArray()
 	{
 		if (mWriter1) mWriter1->StartArray();
 		else if (mWriter2) mWriter2->StartArray();
+		else if (mWriter3) mWriter3->StartArray();
 	}
 
 	void EndArray()
 	{
 		if (mWriter1) mWriter1->EndArray();
 		else if (mWriter2) mWriter2->EndArray();
+		else if (mWriter3) mWriter3->EndArray();
 	}
 
 	void Key(const char *k)
 	{
 		if (mWriter1) mWriter1->Key(k);
 		else if (mWriter2) mWriter2->Key(k);
+		else if (mWriter3) mWriter3->Key(k);
 	}
 
 	void Null()
 	{
 		if (mWriter1) mWriter1->Null();
 		else if (mWriter2) mWriter2->Null();
+		else if (mWriter3) mWriter3->Null();
 	}
 
 	void StringU(const char *k, bool encode)
@@ -110,6 +258,7 @@ struct FWriter
 		if (encode) k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void String(const char *k)
@@ -117,6 +266,7 @@ struct FWriter
 		k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void String(const char *k, int size)
@@ -124,36 +274,42 @@ struct FWriter
 		k = StringToUnicode(k, size);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void Bool(bool k)
 	{
 		if (mWriter1) mWriter1->Bool(k);
 		else if (mWriter2) mWriter2->Bool(k);
+		else if (mWriter3) mWriter3->Bool(k);
 	}
 
 	void Int(int32_t k)
 	{
 		if (mWriter1) mWriter1->Int(k);
 		else if (mWriter2) mWriter2->Int(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Int64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Int64(k);
 		else if (mWriter2) mWriter2->Int64(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Uint(uint32_t k)
 	{
 		if (mWriter1) mWriter1->Uint(k);
 		else if (mWriter2) mWriter2->Uint(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Uint64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Uint64(k);
 		else if (mWriter2) mWriter2->Uint64(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Double(double k)
@@ -166,6 +322,10 @@ struct FWriter
 		{
 			mWriter2->Double(k);
 		}
+		else if (mWriter3)
+		{
+			mWriter3->Double(k);
+		}
 	}
 
 };
@@ -176,6 +336,141 @@ struct FWriter
 //
 //==========================================================================
 
+// Feeds binary serializer data into a rapidjson document, the same way
+// the JSON parser does it. Strings and keys are not copied, they point
+// into the binary data, which has to live as long as the document.
+struct FBinaryReader
+{
+	const uint8_t *mPos;
+	const uint8_t *mEnd;
+	TArray<const char *> mKeys;
+	TArray<unsigned> mKeyLengths;
+
+	FBinaryReader(const uint8_t *data, size_t length)
+	{
+		mPos = data;
+		mEnd = data + length;
+	}
+
+	bool VarInt(uint64_t &v)
+	{
+		v = 0;
+		for (int shift = 0; mPos < mEnd && shift < 64; shift += 7)
+		{
+			uint8_t b = *mPos++;
+			v |= uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) return true;
+		}
+		return false;
+	}
+
+	bool Chars(const char *&str, unsigned &len)
+	{
+		uint64_t v;
+		if (!VarInt(v) || v >= uint64_t(mEnd - mPos) || mPos[v] != 0) return false;
+		str = (const char *)mPos;
+		len = (unsigned)v;
+		mPos += v + 1;
+		return true;
+	}
+
+	template<class Handler>
+	bool Value(Handler &handler, uint8_t tag)
+	{
+		uint64_t v;
+		const char *str;
+		unsigned len;
+
+		switch (tag)
+		{
+		case BIN_NULL:
+			return handler.Null();
+
+		case BIN_FALSE:
+		case BIN_TRUE:
+			return handler.Bool(tag == BIN_TRUE);
+
+		case BIN_INT:
+		{
+			if (!VarInt(v)) return false;
+			int64_t i = int64_t(v >> 1) ^ -int64_t(v & 1);
+			// Pick the same value types the JSON parser would.
+			if (i >= 0) return uint64_t(i) <= 0xffffffffu ? handler.Uint(unsigned(i)) : handler.Uint64(uint64_t(i));
+			return i >= INT_MIN ? handler.Int(int(i)) : handler.Int64(i);
+		}
+
+		case BIN_UINT:
+			if (!VarInt(v)) return false;
+			return v <= 0xffffffffu ? handler.Uint(unsigned(v)) : handler.Uint64(v);
+
+		case BIN_DOUBLE:
+		{
+			if (mEnd - mPos < 8) return false;
+			uint64_t bits = 0;
+			for (int i = 7; i >= 0; i--) bits = (bits << 8) | mPos[i];
+			mPos += 8;
+			double d;
+			memcpy(&d, &bits, 8);
+			return handler.Double(d);
+		}
+
+		case BIN_STRING:
+			return Chars(str, len) && handler.String(str, len, false);
+
+		case BIN_OBJECT:
+		{
+			unsigned count = 0;
+			if (!handler.StartObject()) return false;
+			while (mPos < mEnd)
+			{
+				tag = *mPos++;
+				if (tag == BIN_END) return handler.EndObject(count);
+				if (tag == BIN_NEWKEY)
+				{
+					if (!Chars(str, len)) return false;
+					mKeys.Push(str);
+					mKeyLengths.Push(len);
+				}
+				else if (tag == BIN_KEY)
+				{
+					if (!VarInt(v) || v >= mKeys.Size()) return false;
+					str = mKeys[v];
+					len = mKeyLengths[v];
+				}
+				else return false;
+
+				if (!handler.Key(str, len, false) || mPos == mEnd || !Value(handler, *mPos++)) return false;
+				count++;
+			}
+			return false;
+		}
+
+		case BIN_ARRAY:
+		{
+			unsigned count = 0;
+			if (!handler.StartArray()) return false;
+			while (mPos < mEnd)
+			{
+				tag = *mPos++;
+				if (tag == BIN_END) return handler.EndArray(count);
+				if (!Value(handler, tag)) return false;
+				count++;
+			}
+			return false;
+		}
+
+		default:
+			return false;
+		}
+	}
+
+	template<class Handler>
+	bool operator()(Handler &handler)
+	{
+		return mPos < mEnd && Value(handler, *mPos++);
+	}
+};
+
 struct FReader
 {
 	TArray<FJSONObject> mObjects;
@@ -183,10 +478,29 @@ struct FReader
 	TArray<DObject *> mDObjects;
 	rapidjson::Value *mKeyValue = nullptr;
 	bool mObjectsRead = false;
+	TArray<char> mBinary;	// binary data, referenced by the document
 
 	FReader(const char *buffer, size_t length)
 	{
-		mDoc.Parse(buffer, length);
+		if (length > 5 && !memcmp(buffer, BinarySerializerMagic, 4))
+		{
+			if (buffer[4] == BINSER_VERSION)
+			{
+				mBinary.Resize((unsigned)length - 5);
+				memcpy(mBinary.Data(), buffer + 5, length - 5);
+				FBinaryReader reader((const uint8_t *)mBinary.Data(), mBinary.Size());
+				mDoc.Populate(reader);
+			}
+			if (!mDoc.IsObject())
+			{
+				Printf(TEXTCOLOR_RED "Invalid binary savegame data\n");
+				mDoc.SetObject();
+			}
+		}
+		else
+		{
+			mDoc.Parse(buffer, length);
+		}
 		mObjects.Push(FJSONObject(&mDoc));
 	}
 
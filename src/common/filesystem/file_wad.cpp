@@ -88,7 +88,7 @@ public:
 
 			if (buffer != NULL)
 			{
-				// This is an in-memory file so the cache can point directly to the file's data.
+				// This is an in-memory or memory mapped file so the cache can point directly to the file's data.
 				Cache = const_cast<char*>(buffer) + Position;
 				RefCount = -1;
 				return -1;
@@ -440,7 +440,7 @@ int FZipLump::FillCache()
 
 	if (Method == METHOD_STORED && (buffer = Owner->Reader.GetBuffer()) != NULL)
 	{
-		// This is an in-memory file so the cache can point directly to the file's data.
+		// This is an in-memory or memory mapped file so the cache can point directly to the file's data.
 		Cache = const_cast<char*>(buffer) + Position;
 		RefCount = -1;
 		return -1;
@@ -215,6 +215,7 @@ void FileSystem::InitMultipleFiles (TArray<FString> &filenames, bool quiet, Lump
 	// open all the files, load headers, and count lumps
 	DeleteAll();
 	numfiles = 0;
+	FResourceFile::UseFileMapping = !Args->CheckParm("-nomapfiles");
 
 	for(unsigned i=0;i<filenames.Size(); i++)
 	{
@@ -316,7 +317,8 @@ void FileSystem::AddFile (const char *filename, FileReader *filer, bool quiet, L
 
 		if (!isdir)
 		{
-			if (!filereader.OpenFile(filename))
+			// A mapped file lets stored lumps be used in place instead of being copied into the heap.
+			if ((!FResourceFile::UseFileMapping || !filereader.OpenMappedFile(filename)) && !filereader.OpenFile(filename))
 			{ // Didn't find file
 				if (!quiet)
 				{
@@ -1391,7 +1393,8 @@ FileReader FileSystem::OpenFileReader(int lump)
 	auto rl = FileInfo[lump].lump;
 	auto rd = rl->GetReader();
 
-	if (rl->RefCount == 0 && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & LUMPF_COMPRESSED))
+	// A reader redirecting to the containing file shares that file's position with all other lumps in it.
+	if (!ConcurrentReads && rl->RefCount == 0 && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & LUMPF_COMPRESSED))
 	{
 		FileReader rdr;
 		rdr.OpenFilePart(*rd, rl->GetFileOffset(), rl->LumpSize);
@@ -1449,6 +1452,23 @@ FileReader *FileSystem::GetFileReader(int rfnum)
 	return Files[rfnum]->GetReader();
 }
 
+//==========================================================================
+//
+// GetMemoryInfo
+//
+// Reports how much of a resource file's data is held in the heap and how
+// much is served from file mappings.
+//
+//==========================================================================
+
+void FileSystem::GetMemoryInfo(int rfnum, FResourceMemoryInfo &info)
+{
+	if ((uint32_t)rfnum < Files.Size())
+	{
+		Files[rfnum]->GetMemoryInfo(info);
+	}
+}
+
 //==========================================================================
 //
 // GetResourceFileName
@@ -145,6 +145,9 @@ public:
 	FileReader ReopenFileReader(int lump, bool alwayscache = false);		// opens an independent reader.
 	FileReader OpenFileReader(const char* name);
 
+	// While set, OpenFileReader always reads through the lump cache, so that several threads can read lumps at once.
+	void SetConcurrentReads(bool on) { ConcurrentReads = on; }
+
 	int FindLump (const char *name, int *lastlump, bool anyns=false);		// [RH] Find lumps with duplication
 	int FindLumpMulti (const char **names, int *lastlump, bool anyns = false, int *nameindex = NULL); // same with multiple possible names
 	int FindLumpFullName(const char* name, int* lastlump, bool noext = false);
@@ -187,6 +190,7 @@ public:
 	int AddExternalFile(const char *filename);
 	int AddFromBuffer(const char* name, const char* type, char* data, int size, int id, int flags);
 	FileReader* GetFileReader(int wadnum);	// Gets a FileReader object to the entire WAD
+	void GetMemoryInfo(int wadnum, FResourceMemoryInfo &info);
 	void InitHashChains();
 	FResourceLump* GetFileAt(int no);
 
@@ -216,6 +220,8 @@ protected:
 	int IwadIndex = -1;
 	int MaxIwadIndex = -1;
 
+	bool ConcurrentReads = false;
+
 private:
 	void DeleteAll();
 	void MoveLumpsInFolder(const char *);
@@ -35,6 +35,7 @@
 */
 
 #include <zlib.h>
+#include <mutex>
 #include "resourcefile.h"
 #include "cmdlib.h"
 #include "md5.h"
@@ -183,10 +184,23 @@ FileReader FResourceLump::NewReader()
 //
 // Caches a lump's content and increases the reference counter
 //
+// The lock makes it safe to read lumps from several threads. Filling the
+// cache goes through the container's file reader, so it is taken per
+// resource file: lumps from different files can be loaded in parallel.
+// Lumps without a container share no reader and use a common lock.
+//
 //==========================================================================
 
+static std::mutex LooseLumpCacheMutex;
+
+static std::mutex &GetCacheMutex(FResourceLump *lump)
+{
+	return lump->Owner != nullptr ? lump->Owner->CacheMutex : LooseLumpCacheMutex;
+}
+
 void *FResourceLump::Lock()
 {
+	std::lock_guard<std::mutex> lock(GetCacheMutex(this));
 	if (Cache != NULL)
 	{
 		if (RefCount > 0) RefCount++;
@@ -206,6 +220,7 @@ void *FResourceLump::Lock()
 
 int FResourceLump::Unlock()
 {
+	std::lock_guard<std::mutex> lock(GetCacheMutex(this));
 	if (LumpSize > 0 && RefCount > 0)
 	{
 		if (--RefCount == 0)
@@ -271,6 +286,8 @@ FResourceFile *FResourceFile::OpenDirectory(const char *filename, bool quiet, Lu
 //
 //==========================================================================
 
+bool FResourceFile::UseFileMapping = true;
+
 FResourceFile::FResourceFile(const char *filename)
 	: FileName(filename)
 {
@@ -569,6 +586,31 @@ FResourceLump *FResourceFile::FindLump(const char *name)
 	return nullptr;
 }
 
+//==========================================================================
+//
+// FResourceFile :: GetMemoryInfo
+//
+// Lumps with a negative reference count point into the file's own buffer
+// and do not occupy any memory of their own.
+//
+//==========================================================================
+
+void FResourceFile::GetMemoryInfo(FResourceMemoryInfo &info)
+{
+	if (Reader.isOpen() && Reader.GetResidentSize() >= 0)
+	{
+		info.MappedBytes += Reader.GetLength();
+		info.ResidentBytes += Reader.GetResidentSize();
+	}
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		FResourceLump *lump = GetLump(i);
+		if (lump->Cache == nullptr) continue;
+		if (lump->RefCount < 0) info.SharedBytes += lump->LumpSize;
+		else info.HeapBytes += lump->LumpSize;
+	}
+}
+
 //==========================================================================
 //
 // Caches a lump's content and increases the reference counter
@@ -593,7 +635,7 @@ int FUncompressedLump::FillCache()
 
 	if (buffer != NULL)
 	{
-		// This is an in-memory file so the cache can point directly to the file's data.
+		// This is an in-memory or memory mapped file so the cache can point directly to the file's data.
 		Cache = const_cast<char*>(buffer) + Position;
 		RefCount = -1;
 		return -1;
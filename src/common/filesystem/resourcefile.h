@@ -4,6 +4,7 @@
 #define __RESFILE_H
 
 #include <limits.h>
+#include <mutex>
 
 #include "files.h"
 
@@ -21,6 +22,15 @@ struct LumpFilterInfo
 
 class FResourceFile;
 
+// Where the data of a resource file's lumps currently lives.
+struct FResourceMemoryInfo
+{
+	size_t HeapBytes = 0;		// lump data copied or decompressed into heap buffers
+	size_t MappedBytes = 0;		// size of all file mappings
+	size_t ResidentBytes = 0;	// part of the mappings currently in RAM
+	size_t SharedBytes = 0;		// locked lump data served straight from a mapping or memory buffer
+};
+
 // [RH] Namespaces from BOOM.
 // These are needed here in the low level part so that WAD files can be properly set up.
 typedef enum {
@@ -132,6 +142,7 @@ class FResourceFile
 public:
 	FileReader Reader;
 	FString FileName;
+	std::mutex CacheMutex;	// guards the lumps' caches and the reader while a cache is filled
 protected:
 	uint32_t NumLumps;
 	FString Hash;
@@ -167,6 +178,9 @@ public:
 
 	virtual FResourceLump *GetLump(int no) = 0;
 	FResourceLump *FindLump(const char *name);
+	virtual void GetMemoryInfo(FResourceMemoryInfo &info);
+
+	static bool UseFileMapping;	// serve uncompressed lumps from memory mapped files where possible
 };
 
 struct FUncompressedLump : public FResourceLump
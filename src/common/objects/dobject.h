@@ -42,6 +42,7 @@
 #include "palentry.h"
 #include "textureid.h"
 #include "autosegs.h"
+#include "dobjslab.h"
 
 class PClass;
 class PType;
@@ -267,18 +268,20 @@ private:
 
 	void *operator new(size_t len, nonew&)
 	{
-		return M_Calloc(len, 1);
+		void *mem = M_ObjectAlloc(len);
+		memset(mem, 0, len);
+		return mem;
 	}
 public:
 
 	void operator delete (void *mem, nonew&)
 	{
-		M_Free(mem);
+		M_ObjectFree(mem);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		M_ObjectFree(mem);
 	}
 
 	// GC fiddling
@@ -345,7 +348,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		M_ObjectFree (mem);
 	}
 
 	template<typename T, typename... Args>
@@ -56,12 +56,15 @@
 
 // HEADER FILES ------------------------------------------------------------
 
+#include <algorithm>
 #include "dobject.h"
 #include "templates.h"
 #include "c_dispatch.h"
 #include "menu.h"
 #include "stats.h"
 #include "printf.h"
+#include "i_time.h"
+#include "c_cvars.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -91,6 +94,15 @@
 #define GCSWEEPCOST		10
 #define GCFINALIZECOST	100
 
+// Number of tics whose GC time is kept for the pause statistics.
+
+#define GCPAUSEHISTORY	1024
+
+// Multiple of the pause threshold at which gc_maxtictime stops being honored,
+// so that a collection which keeps running out of time still finishes.
+
+#define GCBACKSTOPMUL	2
+
 // TYPES -------------------------------------------------------------------
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
@@ -103,6 +115,11 @@
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+// Upper limit for the time the collector may take per tic in microseconds. 0 means no limit.
+// With a limit, collection can fall behind allocation and memory grows until
+// the backstop (GCBACKSTOPMUL times the pause threshold) lifts it.
+CVAR(Int, gc_maxtictime, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 namespace GC
 {
 size_t AllocBytes;
@@ -123,6 +140,14 @@ bool FinalGC;
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
+static uint32_t PauseHistory[GCPAUSEHISTORY];	// GC time per tic in microseconds
+static unsigned PauseCount;
+static uint64_t TicTime;						// in nanoseconds
+static uint64_t CycleTime, LastCycleTime;		// in nanoseconds
+static int LastCycleSteps;
+static bool Deferred;							// the tic's time is used up, resume in the next one
+static const size_t DeferredThreshold = ~(size_t)0 - 1;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -353,8 +378,12 @@ static size_t SingleStep()
 	  }
 
 	case GCS_Finalize:
+		M_ObjectTrim();			// give back the slabs the sweep has emptied
 		State = GCS_Pause;		// end collection
 		Dept = 0;
+		LastCycleTime = CycleTime;
+		LastCycleSteps = StepCount + 1;
+		CycleTime = 0;
 		return 0;
 
 	default:
@@ -374,6 +403,17 @@ static size_t SingleStep()
 
 void Step()
 {
+	uint64_t start = I_nsTime();
+	uint64_t budget = gc_maxtictime > 0 ? uint64_t(gc_maxtictime) * 1000 : 0;
+	// Don't let the budget defer a cycle forever when the game allocates faster than it can be collected.
+	if (budget > 0 && (AllocBytes >= (Estimate / 100) * Pause * GCBACKSTOPMUL || Dept >= Estimate))
+	{
+		budget = 0;
+	}
+	uint64_t deadline = budget > TicTime ? start + budget - TicTime : budget > 0 ? start : 0;
+	bool outoftime = false;
+	int checktime = 0;
+
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
 	if (lim == 0)
@@ -385,10 +425,28 @@ void Step()
 	{
 		olim = lim;
 		lim -= SingleStep();
-	} while (olim > lim && State != GCS_Pause);
+
+		// Reading the clock costs about as much as marking an object, so don't do it every time.
+		if (deadline != 0 && ++checktime == 32)
+		{
+			checktime = 0;
+			outoftime = I_nsTime() >= deadline;
+		}
+	} while (olim > lim && State != GCS_Pause && !outoftime);
+	uint64_t time = I_nsTime() - start;
+	TicTime += time;
+	CycleTime += time;
+	if (budget > 0 && TicTime >= budget) outoftime = true;
+
 	if (State != GCS_Pause)
 	{
-		if (Dept < GCSTEPSIZE)
+		if (outoftime)
+		{
+			// Keep the unfinished work in the debt and hold off until the next tic.
+			Deferred = true;
+			Threshold = DeferredThreshold;
+		}
+		else if (Dept < GCSTEPSIZE)
 		{
 			Threshold = AllocBytes + GCSTEPSIZE;	// - lim/StepMul
 		}
@@ -406,6 +464,27 @@ void Step()
 	StepCount++;
 }
 
+//==========================================================================
+//
+// NewTic
+//
+// Records the time the collector took in the last tic and resumes a
+// collection that ran out of time.
+//
+//==========================================================================
+
+void NewTic()
+{
+	PauseHistory[PauseCount++ % GCPAUSEHISTORY] = uint32_t(MIN<uint64_t>(TicTime / 1000, UINT32_MAX));
+	TicTime = 0;
+	if (Deferred)
+	{
+		Deferred = false;
+		// Unless 'gc stop' was used in the meantime.
+		if (Threshold == DeferredThreshold) Threshold = AllocBytes;
+	}
+}
+
 //==========================================================================
 //
 // FullGC
@@ -581,6 +660,18 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+
+	unsigned count = MIN<unsigned>(GC::PauseCount, GCPAUSEHISTORY);
+	if (count > 0)
+	{
+		TArray<uint32_t> pauses(count, true);
+		memcpy(pauses.Data(), GC::PauseHistory, count * sizeof(uint32_t));
+		std::sort(pauses.begin(), pauses.end());
+		auto percentile = [&](int p) { return pauses[MIN(count - 1, count * p / 100)]; };
+		out.AppendFormat("\nGC time per tic (us, last %u): p50 %u  p90 %u  p99 %u  max %u  Last cycle: %.3f ms in %d steps",
+			count, percentile(50), percentile(90), percentile(99), pauses[count - 1],
+			GC::LastCycleTime / 1e6, GC::LastCycleSteps);
+	}
 	return out;
 }
 
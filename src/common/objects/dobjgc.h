@@ -88,6 +88,9 @@ namespace GC
 	// Does a complete collection.
 	void FullGC();
 
+	// Must be called once per game tic for the per-tic time limit and statistics.
+	void NewTic();
+
 	// Handles the grunt work for a write barrier.
 	void Barrier(DObject *pointing, DObject *pointed);
 
@@ -0,0 +1,394 @@
+/*
+** dobjslab.cpp
+** Size class slab allocator for DObjects
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Objects are rounded up to a multiple of 16 bytes and every size gets its
+** own pool. A pool's slabs start small and double in size up to 64 KB, so
+** classes that are only instantiated a few times do not waste much memory.
+** Free slots are kept in a list per slab; slots that were never used are
+** handed out from the end of the slab so a new slab is not touched before
+** it is needed.
+**
+** GC::AllocBytes is adjusted per object, not per slab, so the collector
+** is paced the same way as with individually allocated objects.
+**
+*/
+
+#include "dobject.h"
+#include "dobjslab.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "printf.h"
+#include "i_time.h"
+#include "v_text.h"
+
+CVAR(Bool, gc_objectslabs, true, 0)
+
+enum
+{
+	SLAB_GRANULARITY = 16,
+	SLAB_HEADER = 16,			// keeps the objects 16 byte aligned
+	SLAB_MAXOBJECT = 8192,		// larger objects get a block of their own
+	SLAB_MINCOUNT = 8,
+	SLAB_MAXBYTES = 65536,		// a pool's slabs grow until they reach this size
+	SLAB_NUMPOOLS = (SLAB_MAXOBJECT + SLAB_HEADER) / SLAB_GRANULARITY + 1,
+};
+
+struct FObjectSlab;
+struct FObjectPool;
+
+struct FObjectHeader
+{
+	FObjectSlab *Slab;		// nullptr for blocks that do not come from a slab
+};
+static_assert(sizeof(FObjectHeader) <= SLAB_HEADER, "object header too large");
+
+struct FFreeSlot
+{
+	FFreeSlot *Next;
+};
+
+struct FObjectSlab
+{
+	FObjectPool *Pool;
+	FObjectSlab *Prev, *Next;	// in the pool's list of slabs with free slots
+	FFreeSlot *FreeSlots;
+	uint8_t *Unused;			// slots from here on have never been handed out
+	unsigned Capacity;
+	unsigned Used;
+};
+
+struct FObjectPool
+{
+	size_t SlotSize;
+	unsigned NextCapacity = SLAB_MINCOUNT;
+	FObjectSlab *Available = nullptr;
+	unsigned NumSlabs = 0;
+	unsigned EmptySlabs = 0;
+	size_t SlabBytes = 0;
+	size_t Live = 0;
+	size_t Allocs = 0;
+
+	FObjectPool(size_t slotsize) : SlotSize(slotsize) {}
+
+	void Link(FObjectSlab *slab)
+	{
+		slab->Prev = nullptr;
+		slab->Next = Available;
+		if (Available != nullptr) Available->Prev = slab;
+		Available = slab;
+	}
+
+	void Unlink(FObjectSlab *slab)
+	{
+		if (slab->Prev != nullptr) slab->Prev->Next = slab->Next;
+		else Available = slab->Next;
+		if (slab->Next != nullptr) slab->Next->Prev = slab->Prev;
+		slab->Prev = slab->Next = nullptr;
+	}
+
+	static size_t DataOffset()
+	{
+		return (sizeof(FObjectSlab) + SLAB_GRANULARITY - 1) & ~(SLAB_GRANULARITY - 1);
+	}
+
+	FObjectSlab *NewSlab()
+	{
+		unsigned count = NextCapacity;
+		size_t bytes = DataOffset() + count * SlotSize;
+
+		// Slab memory is not counted in GC::AllocBytes, the objects in it are.
+		auto mem = (uint8_t *)malloc(bytes);
+		if (mem == nullptr)
+		{
+			I_FatalError("Could not malloc %zu bytes", bytes);
+		}
+		auto slab = (FObjectSlab *)mem;
+		slab->Pool = this;
+		slab->FreeSlots = nullptr;
+		slab->Unused = mem + DataOffset();
+		slab->Capacity = count;
+		slab->Used = 0;
+		Link(slab);
+
+		NumSlabs++;
+		EmptySlabs++;
+		SlabBytes += bytes;
+		unsigned maxcount = MAX<unsigned>(SLAB_MINCOUNT, unsigned(SLAB_MAXBYTES / SlotSize));
+		NextCapacity = MIN(count * 2, maxcount);
+		return slab;
+	}
+
+	void FreeSlab(FObjectSlab *slab)
+	{
+		Unlink(slab);
+		NumSlabs--;
+		EmptySlabs--;
+		SlabBytes -= DataOffset() + slab->Capacity * SlotSize;
+		free(slab);
+	}
+
+	void *Alloc()
+	{
+		FObjectSlab *slab = Available;
+		if (slab == nullptr) slab = NewSlab();
+
+		uint8_t *slot;
+		if (slab->FreeSlots != nullptr)
+		{
+			slot = (uint8_t *)slab->FreeSlots;
+			slab->FreeSlots = slab->FreeSlots->Next;
+		}
+		else
+		{
+			slot = slab->Unused;
+			slab->Unused += SlotSize;
+		}
+		if (slab->Used++ == 0) EmptySlabs--;
+		if (slab->Used == slab->Capacity) Unlink(slab);
+
+		((FObjectHeader *)slot)->Slab = slab;
+		Live++;
+		Allocs++;
+		return slot + SLAB_HEADER;
+	}
+
+	static void Free(FObjectHeader *header)
+	{
+		FObjectSlab *slab = header->Slab;
+		FObjectPool *pool = slab->Pool;
+
+		if (slab->Used == slab->Capacity) pool->Link(slab);
+		auto slot = (FFreeSlot *)header;
+		slot->Next = slab->FreeSlots;
+		slab->FreeSlots = slot;
+		if (--slab->Used == 0) pool->EmptySlabs++;
+		pool->Live--;
+	}
+
+	void Trim()
+	{
+		// Keep one empty slab around so that a pool whose last object just
+		// died does not have to allocate again right away.
+		FObjectSlab *slab = Available;
+		while (slab != nullptr && EmptySlabs > 1)
+		{
+			FObjectSlab *next = slab->Next;
+			if (slab->Used == 0) FreeSlab(slab);
+			slab = next;
+		}
+	}
+};
+
+static FObjectPool *Pools[SLAB_NUMPOOLS];
+static size_t UnpooledObjects;
+
+static inline size_t SlotSize(size_t size)
+{
+	return (size + SLAB_HEADER + SLAB_GRANULARITY - 1) & ~size_t(SLAB_GRANULARITY - 1);
+}
+
+static void *SlabAlloc(size_t size)
+{
+	size_t slotsize = SlotSize(size);
+	FObjectPool *&pool = Pools[slotsize / SLAB_GRANULARITY];
+	if (pool == nullptr) pool = new FObjectPool(slotsize);
+	return pool->Alloc();
+}
+
+//==========================================================================
+//
+// M_ObjectAlloc
+//
+//==========================================================================
+
+void *M_ObjectAlloc(size_t size)
+{
+	if (!gc_objectslabs || size > SLAB_MAXOBJECT)
+	{
+		auto header = (FObjectHeader *)M_Malloc(size + SLAB_HEADER);
+		header->Slab = nullptr;
+		UnpooledObjects++;
+		return (uint8_t *)header + SLAB_HEADER;
+	}
+	GC::AllocBytes += SlotSize(size);
+	return SlabAlloc(size);
+}
+
+//==========================================================================
+//
+// M_ObjectFree
+//
+//==========================================================================
+
+void M_ObjectFree(void *mem)
+{
+	if (mem == nullptr) return;
+
+	auto header = (FObjectHeader *)((uint8_t *)mem - SLAB_HEADER);
+	if (header->Slab == nullptr)
+	{
+		UnpooledObjects--;
+		M_Free(header);
+		return;
+	}
+	GC::AllocBytes -= header->Slab->Pool->SlotSize;
+	FObjectPool::Free(header);
+}
+
+//==========================================================================
+//
+// M_ObjectTrim
+//
+//==========================================================================
+
+void M_ObjectTrim()
+{
+	for (auto pool : Pools)
+	{
+		if (pool != nullptr && pool->EmptySlabs > 1) pool->Trim();
+	}
+}
+
+//==========================================================================
+//
+// STAT objslabs
+//
+//==========================================================================
+
+ADD_STAT(objslabs)
+{
+	size_t pools = 0, slabs = 0, empty = 0, bytes = 0, live = 0, used = 0;
+	for (auto pool : Pools)
+	{
+		if (pool == nullptr) continue;
+		pools++;
+		slabs += pool->NumSlabs;
+		empty += pool->EmptySlabs;
+		bytes += pool->SlabBytes;
+		live += pool->Live;
+		used += pool->Live * pool->SlotSize;
+	}
+	FString out;
+	out.Format("Objects: %zu in %zu slabs (%zu empty) of %zu sizes, %zu outside slabs\n"
+		"Slab memory: %zuK, %zuK in use (%.1f%%)",
+		live, slabs, empty, pools, UnpooledObjects,
+		(bytes + 1023) >> 10, (used + 1023) >> 10, bytes > 0 ? used * 100. / bytes : 0.);
+	return out;
+}
+
+//==========================================================================
+//
+// CCMD dumpobjslabs
+//
+//==========================================================================
+
+CCMD(dumpobjslabs)
+{
+	Printf(TEXTCOLOR_YELLOW "Size   Live      Allocs     Slabs  Empty  KBytes\n");
+	for (auto pool : Pools)
+	{
+		if (pool == nullptr) continue;
+		Printf("%5zu  %8zu  %10zu  %5u  %5u  %6zu\n", pool->SlotSize - SLAB_HEADER, pool->Live, pool->Allocs,
+			pool->NumSlabs, pool->EmptySlabs, (pool->SlabBytes + 1023) >> 10);
+	}
+}
+
+//==========================================================================
+//
+// CCMD objallocbench [class] [count] [iterations]
+//
+// Allocates and frees blocks the size of the given class the way spawning
+// and sweeping objects does, once through the slabs and once through
+// M_Malloc. The blocks are freed in a shuffled order, since dead objects
+// do not die in the order they were spawned.
+//
+//==========================================================================
+
+CCMD(objallocbench)
+{
+	const char *classname = argv.argc() >= 2 ? argv[1] : "Actor";
+	int count = argv.argc() >= 3 ? atoi(argv[2]) : 1000;
+	int iterations = argv.argc() >= 4 ? atoi(argv[3]) : 100;
+
+	PClass *cls = PClass::FindClass(classname);
+	if (cls == nullptr)
+	{
+		Printf("Unknown class '%s'\n", classname);
+		return;
+	}
+	if (count <= 0 || iterations <= 0)
+	{
+		Printf("Usage: objallocbench [class] [count] [iterations]\n");
+		return;
+	}
+
+	size_t size = cls->Size;
+	TArray<int> order(count, true);
+	uint32_t seed = 0x9e3779b9;
+	for (int i = 0; i < count; i++) order[i] = i;
+	for (int i = count - 1; i > 0; i--)
+	{
+		seed = seed * 1664525 + 1013904223;
+		std::swap(order[i], order[(seed >> 8) % (i + 1)]);
+	}
+
+	TArray<void *> blocks(count, true);
+	auto run = [&](void *(*alloc)(size_t), void (*release)(void *))
+	{
+		uint64_t start = I_nsTime();
+		for (int it = 0; it < iterations; it++)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				blocks[i] = alloc(size);
+				memset(blocks[i], 0, size);
+			}
+			for (int i = 0; i < count; i++)
+			{
+				release(blocks[order[i]]);
+			}
+		}
+		return (I_nsTime() - start) / 1e6;
+	};
+
+	size_t oldalloc = GC::AllocBytes;
+	double slabms = run(SlabAlloc, M_ObjectFree);
+	double mallocms = run([](size_t size) { return M_Malloc(size); }, M_Free);
+	GC::AllocBytes = oldalloc;
+	M_ObjectTrim();
+
+	Printf("%s (%zu bytes), %d objects x %d iterations\n", cls->TypeName.GetChars(), size, count, iterations);
+	Printf("  slabs:    %8.3f ms\n", slabms);
+	Printf("  M_Malloc: %8.3f ms\n", mallocms);
+}
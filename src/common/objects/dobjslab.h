@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+//==========================================================================
+//
+// Object slabs
+//
+// Memory for DObjects comes from slabs that each hold objects of a single
+// size, so objects of the same class end up next to each other and a freed
+// object's memory is reused by the next object of that size. Every block
+// carries a small header in front of it, which lets M_ObjectFree handle
+// blocks that are too large for a slab as well.
+//
+// Like the rest of the object system this is not thread safe.
+//
+//==========================================================================
+
+void *M_ObjectAlloc(size_t size);
+void M_ObjectFree(void *mem);
+
+// Releases slabs that contain no objects. Called by the GC after each sweep.
+void M_ObjectTrim();
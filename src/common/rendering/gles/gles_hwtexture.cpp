@@ -308,7 +308,7 @@ bool FHardwareTexture::BindOrCreate(FTexture *tex, int texunit, int clampmode, i
 
 		if (!tex->isHardwareCanvas())
 		{
-			texbuffer = tex->CreateTexBuffer(translation, flags | CTF_ProcessData);
+			texbuffer = tex->CreateTexBuffer(translation, flags | CTF_ProcessData | CTF_AllowDeferred);
 			w = texbuffer.mWidth;
 			h = texbuffer.mHeight;
 		}
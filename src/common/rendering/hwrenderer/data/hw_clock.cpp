@@ -53,8 +53,12 @@ glcycle_t twoD, Flush3D;
 glcycle_t MTWait, WTTotal;
 int vertexcount, flatvertices, flatprimitives;
 
-int rendered_lines,rendered_flats,rendered_sprites,render_vertexsplit,render_texsplit,rendered_decals, rendered_portals, rendered_commandbuffers;
-int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+int rendered_lines,rendered_sprites,render_vertexsplit,rendered_decals, rendered_portals, rendered_commandbuffers;
+std::atomic<int> iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
+std::atomic<int> upload_dlight, shared_dlight;
+std::atomic<int> rendered_flats, render_texsplit;
+int link_dlight, linksect_dlight, linkside_dlight, linkadd_dlight, linkdel_dlight;	// these are per tic, not per frame
+double linkms_dlight;
 
 void ResetProfilingData()
 {
@@ -113,13 +117,16 @@ static void AppendRenderStats(FString &out)
 	out.AppendFormat("Walls: %d (%d splits, %d t-splits, %d vertices)\n"
 		"Flats: %d (%d primitives, %d vertices)\n"
 		"Sprites: %d, Decals=%d, Portals: %d, Command buffers: %d\n",
-		rendered_lines, render_vertexsplit, render_texsplit, vertexcount, rendered_flats, flatprimitives, flatvertices, rendered_sprites,rendered_decals, rendered_portals, rendered_commandbuffers );
+		rendered_lines, render_vertexsplit, render_texsplit.load(), vertexcount, rendered_flats.load(), flatprimitives, flatvertices, rendered_sprites,rendered_decals, rendered_portals, rendered_commandbuffers );
 }
 
 static void AppendLightStats(FString &out)
 {
 	out.AppendFormat("DLight - Walls: %d processed, %d rendered - Flats: %d processed, %d rendered\n", 
-		iter_dlight, draw_dlight, iter_dlightf, draw_dlightf );
+		iter_dlight.load(), draw_dlight.load(), iter_dlightf.load(), draw_dlightf.load() );
+	out.AppendFormat("DLight lists: %d uploaded, %d shared\n", upload_dlight.load(), shared_dlight.load());
+	out.AppendFormat("DLight links per tic: %d lights in %2.3f ms - %d sections, %d sides touched - %d nodes added, %d removed\n",
+		link_dlight, linkms_dlight, linksect_dlight, linkside_dlight, linkadd_dlight, linkdel_dlight);
 }
 
 ADD_STAT(rendertimes)
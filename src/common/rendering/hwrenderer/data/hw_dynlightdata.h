@@ -26,12 +26,14 @@
 struct FDynLightData
 {
 	TArray<float> arrays[3];
+	TArray<uintptr_t> keys;		// two per light, identifying the source of each record. Used to share uploads of identical lists.
 
 	void Clear()
 	{
 		arrays[0].Clear();
 		arrays[1].Clear();
 		arrays[2].Clear();
+		keys.Clear();
 	}
 
 	void Combine(int *siz, int max)
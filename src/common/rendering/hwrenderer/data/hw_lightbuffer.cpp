@@ -27,11 +27,52 @@
 
 #include "hw_lightbuffer.h"
 #include "hw_dynlightdata.h"
+#include "hw_clock.h"
+#include "hw_cvars.h"
 #include "shaderuniforms.h"
 
 static const int ELEMENTS_PER_LIGHT = 4;			// each light needs 4 vec4's.
 static const int ELEMENT_SIZE = (4*sizeof(float));
 
+CVAR(Bool, gl_light_sharelists, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+//==========================================================================
+//
+// Neighbouring walls and flats are usually lit by the same set of lights,
+// so a list that has already been uploaded in this frame gets reused.
+// Lists are compared by the lights they were built from instead of their
+// contents because a light's record does not change within a frame.
+// Every render thread keeps its own cache so no locking is needed.
+//
+//==========================================================================
+
+struct FSharedLightList
+{
+	unsigned KeyStart;
+	unsigned KeyCount;
+	int Index;
+};
+
+struct FLightListCache
+{
+	const FLightBuffer *Owner = nullptr;
+	unsigned Frame = 0;
+	TMap<uint64_t, FSharedLightList> Lists;
+	TArray<uintptr_t> Keys;
+};
+
+static thread_local FLightListCache ListCache;
+
+static uint64_t HashLightKeys(const TArray<uintptr_t> &keys)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (auto key : keys)
+	{
+		hash = (hash ^ uint64_t(key)) * 1099511628211ull;
+	}
+	return hash;
+}
+
 
 FLightBuffer::FLightBuffer(int pipelineNbr):
 	mPipelineNbr(pipelineNbr)
@@ -78,6 +119,7 @@ FLightBuffer::~FLightBuffer()
 void FLightBuffer::Clear()
 {
 	mIndex = 0;
+	mFrame++;
 
 	mPipelinePos++;
 	mPipelinePos %= mPipelineNbr;
@@ -86,6 +128,50 @@ void FLightBuffer::Clear()
 }
 
 int FLightBuffer::UploadLights(FDynLightData &data)
+{
+	// The keys only describe the list if every record was added through AddLightToList.
+	unsigned numlights = (data.arrays[0].Size() + data.arrays[1].Size() + data.arrays[2].Size()) / 16;
+	if (!gl_light_sharelists || numlights == 0 || data.keys.Size() != numlights * 2)
+	{
+		upload_dlight++;
+		return UploadLightData(data);
+	}
+
+	auto &cache = ListCache;
+	if (cache.Owner != this || cache.Frame != mFrame)
+	{
+		cache.Owner = this;
+		cache.Frame = mFrame;
+		cache.Lists.Clear();
+		cache.Keys.Clear();
+	}
+
+	uint64_t hash = HashLightKeys(data.keys);
+	auto shared = cache.Lists.CheckKey(hash);
+	if (shared != nullptr)
+	{
+		if (shared->KeyCount == data.keys.Size() && !memcmp(&cache.Keys[shared->KeyStart], data.keys.Data(), data.keys.Size() * sizeof(uintptr_t)))
+		{
+			shared_dlight++;
+			return shared->Index;
+		}
+		// A hash collision. Just upload this list on its own.
+		upload_dlight++;
+		return UploadLightData(data);
+	}
+
+	upload_dlight++;
+	int index = UploadLightData(data);
+	if (index >= 0)
+	{
+		unsigned start = cache.Keys.Reserve(data.keys.Size());
+		memcpy(&cache.Keys[start], data.keys.Data(), data.keys.Size() * sizeof(uintptr_t));
+		cache.Lists.Insert(hash, { start, data.keys.Size(), index });
+	}
+	return index;
+}
+
+int FLightBuffer::UploadLightData(FDynLightData &data)
 {
 	// All meaasurements here are in vec4's.
 	int size0 = data.arrays[0].Size()/4;
@@ -23,8 +23,10 @@ class FLightBuffer
 	unsigned int mBufferSize;
 	unsigned int mByteSize;
     unsigned int mMaxUploadSize;
+	unsigned int mFrame = 0;
     
 	void CheckSize();
+	int UploadLightData(FDynLightData &data);
 
 public:
 
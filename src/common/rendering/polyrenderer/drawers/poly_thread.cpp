@@ -29,9 +29,7 @@
 #include "poly_thread.h"
 #include "screen_triangle.h"
 
-#ifndef NO_SSE
-#include <immintrin.h>
-#endif
+#include "simd.h"
 
 PolyTriangleThreadData::PolyTriangleThreadData(int32_t core, int32_t num_cores, int32_t numa_node, int32_t num_numa_nodes, int numa_start_y, int numa_end_y)
 	: core(core), num_cores(num_cores), numa_node(numa_node), num_numa_nodes(num_numa_nodes), numa_start_y(numa_start_y), numa_end_y(numa_end_y)
@@ -43,16 +41,27 @@ void PolyTriangleThreadData::ClearDepth(float value)
 	int width = depthstencil->Width();
 	int height = depthstencil->Height();
 	float *data = depthstencil->DepthValues();
+	float *tilemax = depthstencil->TileMaxDepth();
+	uint8_t *tiledirty = depthstencil->TileDirty();
+	int tilesX = depthstencil->TilesX();
 
-	int skip = skipped_by_thread(0);
-	int count = count_for_thread(0, height);
-
-	data += skip * width;
-	for (int i = 0; i < count; i++)
+	int bottom = MIN(height, numa_end_y);
+	for (int y = next_line_for_thread(0); y < bottom; y = next_line_for_thread(y))
 	{
-		for (int x = 0; x < width; x++)
-			data[x] = value;
-		data += num_cores * width;
+		int end = MIN(band_end(y), bottom);
+		for (; y < end; y++)
+		{
+			float *line = data + (size_t)y * width;
+			for (int x = 0; x < width; x++)
+				line[x] = value;
+		}
+
+		int tileoffset = (end - 1) / PolyDepthStencil::TileHeight * tilesX;
+		for (int x = 0; x < tilesX; x++)
+		{
+			tilemax[tileoffset + x] = value;
+			tiledirty[tileoffset + x] = 0;
+		}
 	}
 }
 
@@ -62,14 +71,14 @@ void PolyTriangleThreadData::ClearStencil(uint8_t value)
 	int height = depthstencil->Height();
 	uint8_t *data = depthstencil->StencilValues();
 
-	int skip = skipped_by_thread(0);
-	int count = count_for_thread(0, height);
-
-	data += skip * width;
-	for (int i = 0; i < count; i++)
+	int bottom = MIN(height, numa_end_y);
+	for (int y = next_line_for_thread(0); y < bottom; y = next_line_for_thread(y))
 	{
-		memset(data, value, width);
-		data += num_cores * width;
+		int end = MIN(band_end(y), bottom);
+		for (; y < end; y++)
+		{
+			memset(data + (size_t)y * width, value, width);
+		}
 	}
 }
 
@@ -541,7 +550,8 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *const* ve
 	ScreenTriVertex clippedvert[max_additional_vertices];
 	int numclipvert = ClipEdge(vert);
 
-	// Convert barycentric weights to actual vertices
+	// Convert barycentric weights to actual vertices. The position comes first so that
+	// triangles outside this thread's bands can be skipped before doing the rest.
 	for (int i = 0; i < numclipvert; i++)
 	{
 		auto &v = clippedvert[i];
@@ -553,74 +563,78 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *const* ve
 			v.y += vert[w]->gl_Position.Y * weight;
 			v.z += vert[w]->gl_Position.Z * weight;
 			v.w += vert[w]->gl_Position.W * weight;
-			v.u += vert[w]->vTexCoord.X * weight;
-			v.v += vert[w]->vTexCoord.Y * weight;
-			v.worldX += vert[w]->pixelpos.X * weight;
-			v.worldY += vert[w]->pixelpos.Y * weight;
-			v.worldZ += vert[w]->pixelpos.Z * weight;
-			v.a += vert[w]->vColor.W * weight;
-			v.r += vert[w]->vColor.X * weight;
-			v.g += vert[w]->vColor.Y * weight;
-			v.b += vert[w]->vColor.Z * weight;
-			v.gradientdistZ += vert[w]->gradientdist.Z * weight;
 		}
 	}
 
-#ifdef NO_SSE
 	// Map to 2D viewport:
-	for (int j = 0; j < numclipvert; j++)
-	{
-		auto &v = clippedvert[j];
-
-		// Calculate normalized device coordinates:
-		v.w = 1.0f / v.w;
-		v.x *= v.w;
-		v.y *= v.w;
-		v.z *= v.w;
-
-		// Apply viewport scale to get screen coordinates:
-		v.x = viewport_x + viewport_width * (1.0f + v.x) * 0.5f;
-		if (topdown)
-			v.y = viewport_y + viewport_height * (1.0f - v.y) * 0.5f;
-		else
-			v.y = viewport_y + viewport_height * (1.0f + v.y) * 0.5f;
-		}
-#else
-	// Map to 2D viewport:
-	__m128 mviewport_x = _mm_set1_ps((float)viewport_x);
-	__m128 mviewport_y = _mm_set1_ps((float)viewport_y);
-	__m128 mviewport_halfwidth = _mm_set1_ps(viewport_width * 0.5f);
-	__m128 mviewport_halfheight = _mm_set1_ps(viewport_height * 0.5f);
-	__m128 mone = _mm_set1_ps(1.0f);
+	using V = simd::native;
+	V::fvec mviewport_x = V::set1f((float)viewport_x);
+	V::fvec mviewport_y = V::set1f((float)viewport_y);
+	V::fvec mviewport_halfwidth = V::set1f(viewport_width * 0.5f);
+	V::fvec mviewport_halfheight = V::set1f(viewport_height * 0.5f);
+	V::fvec mone = V::set1f(1.0f);
 	int sse_length = (numclipvert + 3) / 4 * 4;
 	for (int j = 0; j < sse_length; j += 4)
 	{
-		__m128 vx = _mm_loadu_ps(&clippedvert[j].x);
-		__m128 vy = _mm_loadu_ps(&clippedvert[j + 1].x);
-		__m128 vz = _mm_loadu_ps(&clippedvert[j + 2].x);
-		__m128 vw = _mm_loadu_ps(&clippedvert[j + 3].x);
-		_MM_TRANSPOSE4_PS(vx, vy, vz, vw);
+		V::fvec vx = V::loadf(&clippedvert[j].x);
+		V::fvec vy = V::loadf(&clippedvert[j + 1].x);
+		V::fvec vz = V::loadf(&clippedvert[j + 2].x);
+		V::fvec vw = V::loadf(&clippedvert[j + 3].x);
+		V::transpose4(vx, vy, vz, vw);
 
 		// Calculate normalized device coordinates:
-		vw = _mm_div_ps(mone, vw);
-		vx = _mm_mul_ps(vx, vw);
-		vy = _mm_mul_ps(vy, vw);
-		vz = _mm_mul_ps(vz, vw);
+		vw = V::divf(mone, vw);
+		vx = V::mulf(vx, vw);
+		vy = V::mulf(vy, vw);
+		vz = V::mulf(vz, vw);
 
 		// Apply viewport scale to get screen coordinates:
-		vx = _mm_add_ps(mviewport_x, _mm_mul_ps(mviewport_halfwidth, _mm_add_ps(mone, vx)));
+		vx = V::addf(mviewport_x, V::mulf(mviewport_halfwidth, V::addf(mone, vx)));
 		if (topdown)
-			vy = _mm_add_ps(mviewport_y, _mm_mul_ps(mviewport_halfheight, _mm_sub_ps(mone, vy)));
+			vy = V::addf(mviewport_y, V::mulf(mviewport_halfheight, V::subf(mone, vy)));
 		else
-			vy = _mm_add_ps(mviewport_y, _mm_mul_ps(mviewport_halfheight, _mm_add_ps(mone, vy)));
+			vy = V::addf(mviewport_y, V::mulf(mviewport_halfheight, V::addf(mone, vy)));
 
-		_MM_TRANSPOSE4_PS(vx, vy, vz, vw);
-		_mm_storeu_ps(&clippedvert[j].x, vx);
-		_mm_storeu_ps(&clippedvert[j + 1].x, vy);
-		_mm_storeu_ps(&clippedvert[j + 2].x, vz);
-		_mm_storeu_ps(&clippedvert[j + 3].x, vw);
+		V::transpose4(vx, vy, vz, vw);
+		V::storef(&clippedvert[j].x, vx);
+		V::storef(&clippedvert[j + 1].x, vy);
+		V::storef(&clippedvert[j + 2].x, vz);
+		V::storef(&clippedvert[j + 3].x, vw);
+	}
+
+	// Skip the rest of the setup if the triangle is entirely outside of this thread's bands
+	if (numclipvert < 3)
+		return;
+
+	float miny = clippedvert[0].y, maxy = clippedvert[0].y;
+	for (int i = 1; i < numclipvert; i++)
+	{
+		miny = MIN(miny, clippedvert[i].y);
+		maxy = MAX(maxy, clippedvert[i].y);
+	}
+	int topY = MAX((int)(miny + 0.5f), clip.top);
+	int bottomY = MIN(MIN((int)(maxy + 0.5f), clip.bottom), numa_end_y);
+	if (next_line_for_thread(topY) >= bottomY)
+		return;
+
+	for (int i = 0; i < numclipvert; i++)
+	{
+		auto &v = clippedvert[i];
+		for (int w = 0; w < 3; w++)
+		{
+			float weight = weights[i * 3 + w];
+			v.u += vert[w]->vTexCoord.X * weight;
+			v.v += vert[w]->vTexCoord.Y * weight;
+			v.worldX += vert[w]->pixelpos.X * weight;
+			v.worldY += vert[w]->pixelpos.Y * weight;
+			v.worldZ += vert[w]->pixelpos.Z * weight;
+			v.a += vert[w]->vColor.W * weight;
+			v.r += vert[w]->vColor.X * weight;
+			v.g += vert[w]->vColor.Y * weight;
+			v.b += vert[w]->vColor.Z * weight;
+			v.gradientdistZ += vert[w]->gradientdist.Z * weight;
+		}
 	}
-#endif
 
 	if (!topdown) ccw = !ccw;
 
@@ -682,79 +696,44 @@ int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *const* verts)
 	
 	// halfspace clip distances
 	static const int numclipdistances = 9;
-#ifdef NO_SSE
-	float clipdistance[numclipdistances * 3];
-	bool needsclipping = false;
-	float *clipd = clipdistance;
-	for (int i = 0; i < 3; i++)
-	{
-		const auto &v = *verts[i];
-		clipd[0] = v.gl_Position.X + v.gl_Position.W;
-		clipd[1] = v.gl_Position.W - v.gl_Position.X;
-		clipd[2] = v.gl_Position.Y + v.gl_Position.W;
-		clipd[3] = v.gl_Position.W - v.gl_Position.Y;
-		if (DepthClamp)
-		{
-			clipd[4] = 1.0f;
-			clipd[5] = 1.0f;
-		}
-		else
-		{
-			clipd[4] = v.gl_Position.Z + v.gl_Position.W;
-			clipd[5] = v.gl_Position.W - v.gl_Position.Z;
-		}
-		clipd[6] = v.gl_ClipDistance[0];
-		clipd[7] = v.gl_ClipDistance[1];
-		clipd[8] = v.gl_ClipDistance[2];
-		for (int j = 0; j < 9; j++)
-			needsclipping = needsclipping || clipd[i];
-		clipd += numclipdistances;
-	}
-
-	// If all halfspace clip distances are positive then the entire triangle is visible. Skip the expensive clipping step.
-	if (!needsclipping)
-	{
-		return 3;
-	}
-#else
-	__m128 mx = _mm_loadu_ps(&verts[0]->gl_Position.X);
-	__m128 my = _mm_loadu_ps(&verts[1]->gl_Position.X);
-	__m128 mz = _mm_loadu_ps(&verts[2]->gl_Position.X);
-	__m128 mw = _mm_setzero_ps();
-	_MM_TRANSPOSE4_PS(mx, my, mz, mw);
-	__m128 clipd0 = _mm_add_ps(mx, mw);
-	__m128 clipd1 = _mm_sub_ps(mw, mx);
-	__m128 clipd2 = _mm_add_ps(my, mw);
-	__m128 clipd3 = _mm_sub_ps(mw, my);
-	__m128 clipd4 = DepthClamp ? _mm_set1_ps(1.0f) : _mm_add_ps(mz, mw);
-	__m128 clipd5 = DepthClamp ? _mm_set1_ps(1.0f) : _mm_sub_ps(mw, mz);
-	__m128 clipd6 = _mm_setr_ps(verts[0]->gl_ClipDistance[0], verts[1]->gl_ClipDistance[0], verts[2]->gl_ClipDistance[0], 0.0f);
-	__m128 clipd7 = _mm_setr_ps(verts[0]->gl_ClipDistance[1], verts[1]->gl_ClipDistance[1], verts[2]->gl_ClipDistance[1], 0.0f);
-	__m128 clipd8 = _mm_setr_ps(verts[0]->gl_ClipDistance[2], verts[1]->gl_ClipDistance[2], verts[2]->gl_ClipDistance[2], 0.0f);
-	__m128 mneedsclipping = _mm_cmplt_ps(clipd0, _mm_setzero_ps());
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd1, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd2, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd3, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd4, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd5, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd6, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd7, _mm_setzero_ps()));
-	mneedsclipping = _mm_or_ps(mneedsclipping, _mm_cmplt_ps(clipd8, _mm_setzero_ps()));
-	if (_mm_movemask_ps(mneedsclipping) == 0)
+	using V = simd::native;
+	V::fvec mx = V::loadf(&verts[0]->gl_Position.X);
+	V::fvec my = V::loadf(&verts[1]->gl_Position.X);
+	V::fvec mz = V::loadf(&verts[2]->gl_Position.X);
+	V::fvec mw = V::zerof();
+	V::transpose4(mx, my, mz, mw);
+	V::fvec clipd0 = V::addf(mx, mw);
+	V::fvec clipd1 = V::subf(mw, mx);
+	V::fvec clipd2 = V::addf(my, mw);
+	V::fvec clipd3 = V::subf(mw, my);
+	V::fvec clipd4 = DepthClamp ? V::set1f(1.0f) : V::addf(mz, mw);
+	V::fvec clipd5 = DepthClamp ? V::set1f(1.0f) : V::subf(mw, mz);
+	V::fvec clipd6 = V::setrf(verts[0]->gl_ClipDistance[0], verts[1]->gl_ClipDistance[0], verts[2]->gl_ClipDistance[0], 0.0f);
+	V::fvec clipd7 = V::setrf(verts[0]->gl_ClipDistance[1], verts[1]->gl_ClipDistance[1], verts[2]->gl_ClipDistance[1], 0.0f);
+	V::fvec clipd8 = V::setrf(verts[0]->gl_ClipDistance[2], verts[1]->gl_ClipDistance[2], verts[2]->gl_ClipDistance[2], 0.0f);
+	V::fvec mneedsclipping = V::cmpltf(clipd0, V::zerof());
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd1, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd2, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd3, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd4, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd5, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd6, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd7, V::zerof()));
+	mneedsclipping = V::orf(mneedsclipping, V::cmpltf(clipd8, V::zerof()));
+	if (!V::anyf(mneedsclipping))
 	{
 		return 3;
 	}
 	float clipdistance[numclipdistances * 4];
-	_mm_storeu_ps(clipdistance, clipd0);
-	_mm_storeu_ps(clipdistance + 4, clipd1);
-	_mm_storeu_ps(clipdistance + 8, clipd2);
-	_mm_storeu_ps(clipdistance + 12, clipd3);
-	_mm_storeu_ps(clipdistance + 16, clipd4);
-	_mm_storeu_ps(clipdistance + 20, clipd5);
-	_mm_storeu_ps(clipdistance + 24, clipd6);
-	_mm_storeu_ps(clipdistance + 28, clipd7);
-	_mm_storeu_ps(clipdistance + 32, clipd8);
-#endif
+	V::storef(clipdistance, clipd0);
+	V::storef(clipdistance + 4, clipd1);
+	V::storef(clipdistance + 8, clipd2);
+	V::storef(clipdistance + 12, clipd3);
+	V::storef(clipdistance + 16, clipd4);
+	V::storef(clipdistance + 20, clipd5);
+	V::storef(clipdistance + 24, clipd6);
+	V::storef(clipdistance + 28, clipd7);
+	V::storef(clipdistance + 32, clipd8);
 
 	// Clip against each halfspace
 	float *input = weights;
@@ -767,17 +746,6 @@ int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *const* verts)
 		for (int i = 0; i < inputverts; i++)
 		{
 			int j = (i + 1) % inputverts;
-#ifdef NO_SSE
-			float clipdistance1 =
-				clipdistance[0 * numclipdistances + p] * input[i * 3 + 0] +
-				clipdistance[1 * numclipdistances + p] * input[i * 3 + 1] +
-				clipdistance[2 * numclipdistances + p] * input[i * 3 + 2];
-
-			float clipdistance2 =
-				clipdistance[0 * numclipdistances + p] * input[j * 3 + 0] +
-				clipdistance[1 * numclipdistances + p] * input[j * 3 + 1] +
-				clipdistance[2 * numclipdistances + p] * input[j * 3 + 2];
-#else
 			float clipdistance1 =
 				clipdistance[0 + p * 4] * input[i * 3 + 0] +
 				clipdistance[1 + p * 4] * input[i * 3 + 1] +
@@ -787,7 +755,6 @@ int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *const* verts)
 				clipdistance[0 + p * 4] * input[j * 3 + 0] +
 				clipdistance[1 + p * 4] * input[j * 3 + 1] +
 				clipdistance[2 + p * 4] * input[j * 3 + 2];
-#endif
 
 			// Clip halfspace
 			if ((clipdistance1 >= 0.0f || clipdistance2 >= 0.0f) && outputverts + 1 < max_additional_vertices)
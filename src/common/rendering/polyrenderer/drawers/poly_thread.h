@@ -78,23 +78,28 @@ public:
 	int numa_start_y;
 	int numa_end_y;
 
+	// Lines are handed out in bands rather than one by one, so that a small
+	// triangle only has to be set up by the one or two threads it touches.
+	enum { band_height = PolyDepthStencil::TileHeight };
+
 	bool line_skipped_by_thread(int line)
 	{
-		return line < numa_start_y || line >= numa_end_y || line % num_cores != core;
+		return line < numa_start_y || line >= numa_end_y || (line / band_height) % num_cores != core;
 	}
 
-	int skipped_by_thread(int first_line)
+	// First line at or after the given one that belongs to this thread
+	int next_line_for_thread(int line)
 	{
-		int clip_first_line = MAX(first_line, numa_start_y);
-		int core_skip = (num_cores - (clip_first_line - core) % num_cores) % num_cores;
-		return clip_first_line + core_skip - first_line;
+		line = MAX(line, numa_start_y);
+		int band = line / band_height;
+		int skip = (core - band % num_cores + num_cores) % num_cores;
+		return skip == 0 ? line : (band + skip) * band_height;
 	}
 
-	int count_for_thread(int first_line, int count)
+	// End of the band containing the line
+	int band_end(int line)
 	{
-		count = MIN(count, numa_end_y - first_line);
-		int c = (count - skipped_by_thread(first_line) + num_cores - 1) / num_cores;
-		return MAX(c, 0);
+		return MIN((line / band_height + 1) * band_height, numa_end_y);
 	}
 
 	struct Scanline
@@ -82,18 +82,31 @@ private:
 class PolyDepthStencil
 {
 public:
-	PolyDepthStencil(int width, int height) : width(width), height(height), depthbuffer(width * height), stencilbuffer(width * height) { }
+	// Tiles are one drawer thread band high, so each tile is only ever touched by the thread owning its band.
+	enum { TileWidth = 64, TileHeight = 16 };
+
+	PolyDepthStencil(int width, int height) : width(width), height(height), depthbuffer(width * height), stencilbuffer(width * height),
+		tilesX((width + TileWidth - 1) / TileWidth), tilemaxdepth(tilesX * ((height + TileHeight - 1) / TileHeight)), tiledirty(tilemaxdepth.size()) { }
 
 	int Width() const { return width; }
 	int Height() const { return height; }
 	float *DepthValues() { return depthbuffer.data(); }
 	uint8_t *StencilValues() { return stencilbuffer.data(); }
 
+	// Upper bound of the depth values in each tile. The dirty flag is set when writes may have lowered
+	// the actual maximum below it, so that a rescan could give a tighter value.
+	int TilesX() const { return tilesX; }
+	float *TileMaxDepth() { return tilemaxdepth.data(); }
+	uint8_t *TileDirty() { return tiledirty.data(); }
+
 private:
 	int width;
 	int height;
 	std::vector<float> depthbuffer;
 	std::vector<uint8_t> stencilbuffer;
+	int tilesX;
+	std::vector<float> tilemaxdepth;
+	std::vector<uint8_t> tiledirty;
 };
 
 struct PolyPushConstants
@@ -21,6 +21,7 @@
 */
 
 #include "screen_blend.h"
+#include "simd.h"
 
 #ifndef NO_SSE
 #include <immintrin.h>
@@ -180,7 +181,6 @@ void BlendColor(int y, int x0, int x1, PolyTriangleThreadData* thread)
 }
 #endif
 
-#ifdef NO_SSE
 void BlendColorOpaque(int y, int x0, int x1, PolyTriangleThreadData* thread)
 {
 	uint32_t* dest = (uint32_t*)thread->dest;
@@ -189,28 +189,6 @@ void BlendColorOpaque(int y, int x0, int x1, PolyTriangleThreadData* thread)
 
 	memcpy(line + x0, fragcolor + x0, (x1 - x0) * sizeof(uint32_t));
 }
-#else
-void BlendColorOpaque(int y, int x0, int x1, PolyTriangleThreadData* thread)
-{
-	uint32_t* dest = (uint32_t*)thread->dest;
-	uint32_t* line = dest + y * (ptrdiff_t)thread->dest_pitch;
-	uint32_t* fragcolor = thread->scanline.FragColor;
-
-	int ssecount = ((x1 - x0) & ~3);
-	int sseend = x0 + ssecount;
-
-	for (int x = x0; x < sseend; x += 4)
-	{
-		__m128i v = _mm_loadu_si128((__m128i*) & fragcolor[x]);
-		_mm_storeu_si128((__m128i*) & line[x], v);
-	}
-
-	for (int x = sseend; x < x1; x++)
-	{
-		line[x] = fragcolor[x];
-	}
-}
-#endif
 
 void BlendColorAdd_Src_InvSrc(int y, int x0, int x1, PolyTriangleThreadData* thread)
 {
@@ -219,20 +197,21 @@ void BlendColorAdd_Src_InvSrc(int y, int x0, int x1, PolyTriangleThreadData* thr
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
-		__m128i dstscale = _mm_sub_epi16(_mm_set1_epi16(256), srcscale);
+		V::vec srcscale = V::splatalpha(src);
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
+		V::vec dstscale = V::sub(V::set1(256), srcscale);
 
-		__m128i out = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_mullo_epi16(dst, dstscale)), _mm_set1_epi16(127)), 8);
-		_mm_storel_epi64((__m128i*)&line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::srli<8>(V::add(V::add(V::mullo(src, srcscale), V::mullo(dst, dstscale)), V::set1(127)));
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -261,20 +240,21 @@ void BlendColorAdd_SrcCol_InvSrcCol(int y, int x0, int x1, PolyTriangleThreadDat
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = src;
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
-		__m128i dstscale = _mm_sub_epi16(_mm_set1_epi16(256), srcscale);
+		V::vec srcscale = src;
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
+		V::vec dstscale = V::sub(V::set1(256), srcscale);
 
-		__m128i out = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_mullo_epi16(dst, dstscale)), _mm_set1_epi16(127)), 8);
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::srli<8>(V::add(V::add(V::mullo(src, srcscale), V::mullo(dst, dstscale)), V::set1(127)));
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -312,19 +292,20 @@ void BlendColorAdd_Src_One(int y, int x0, int x1, PolyTriangleThreadData* thread
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
+		V::vec srcscale = V::splatalpha(src);
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
 
-		__m128i out = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_set1_epi16(127)), 8), dst);
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::add(V::srli<8>(V::add(V::mullo(src, srcscale), V::set1(127))), dst);
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -352,19 +333,20 @@ void BlendColorAdd_SrcCol_One(int y, int x0, int x1, PolyTriangleThreadData* thr
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = src;
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
+		V::vec srcscale = src;
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
 
-		__m128i out = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_set1_epi16(127)), 8), dst);
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::add(V::srli<8>(V::add(V::mullo(src, srcscale), V::set1(127))), dst);
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -398,19 +380,20 @@ void BlendColorAdd_DstCol_Zero(int y, int x0, int x1, PolyTriangleThreadData* th
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = dst;
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
+		V::vec srcscale = dst;
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
 
-		__m128i out = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_set1_epi16(127)), 8);
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::srli<8>(V::add(V::mullo(src, srcscale), V::set1(127)));
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -444,19 +427,20 @@ void BlendColorAdd_InvDstCol_Zero(int y, int x0, int x1, PolyTriangleThreadData*
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = _mm_sub_epi16(_mm_set1_epi16(255), dst);
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
+		V::vec srcscale = V::sub(V::set1(255), dst);
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
 
-		__m128i out = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_set1_epi16(127)), 8);
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::srli<8>(V::add(V::mullo(src, srcscale), V::set1(127)));
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -490,19 +474,20 @@ void BlendColorRevSub_Src_One(int y, int x0, int x1, PolyTriangleThreadData* thr
 
 	int sseend = x0;
 
-#ifndef NO_SSE
+#ifndef SIMD_BACKEND_SCALAR
+	using V = simd::native;
 	int ssecount = ((x1 - x0) & ~1);
 	sseend = x0 + ssecount;
 	for (int x = x0; x < sseend; x += 2)
 	{
-		__m128i dst = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & line[x]), _mm_setzero_si128());
-		__m128i src = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*) & fragcolor[x]), _mm_setzero_si128());
+		V::vec dst = V::load2px(&line[x]);
+		V::vec src = V::load2px(&fragcolor[x]);
 
-		__m128i srcscale = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
-		srcscale = _mm_add_epi16(srcscale, _mm_srli_epi16(srcscale, 7));
+		V::vec srcscale = V::splatalpha(src);
+		srcscale = V::add(srcscale, V::srli<7>(srcscale));
 
-		__m128i out = _mm_sub_epi16(dst, _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(src, srcscale), _mm_set1_epi16(127)), 8));
-		_mm_storel_epi64((__m128i*) & line[x], _mm_packus_epi16(out, out));
+		V::vec out = V::sub(dst, V::srli<8>(V::add(V::mullo(src, srcscale), V::set1(127))));
+		V::store2px(&line[x], out);
 	}
 #endif
 
@@ -32,10 +32,33 @@
 #include "screen_shader.h"
 #include <cmath>
 
+// Keeps the tile maximums used by the coarse depth test an upper bound of the written values
+static void RaiseTileMaxDepth(int y, int x0, int x1, const float* values, PolyTriangleThreadData* thread)
+{
+	float* tilemax = thread->depthstencil->TileMaxDepth() + y / PolyDepthStencil::TileHeight * thread->depthstencil->TilesX();
+	int x = x0;
+	while (x < x1)
+	{
+		int tx = x / PolyDepthStencil::TileWidth;
+		int end = MIN(x1, (tx + 1) * (int)PolyDepthStencil::TileWidth);
+		float m = tilemax[tx];
+		for (; x < end; x++)
+			m = MAX(m, values[x]);
+		tilemax[tx] = m;
+	}
+}
+
 static void WriteDepth(int y, int x0, int x1, PolyTriangleThreadData* thread)
 {
 	float* line = thread->depthstencil->DepthValues() + (size_t)thread->depthstencil->Width() * y;
 
+	if (x0 < x1)
+	{
+		uint8_t* dirty = thread->depthstencil->TileDirty() + y / PolyDepthStencil::TileHeight * thread->depthstencil->TilesX();
+		for (int tx = x0 / PolyDepthStencil::TileWidth; tx <= (x1 - 1) / PolyDepthStencil::TileWidth; tx++)
+			dirty[tx] = 1;
+	}
+
 	if (thread->DepthRangeScale != 0.0f)
 	{
 		float* w = thread->scanline.W;
@@ -43,6 +66,11 @@ static void WriteDepth(int y, int x0, int x1, PolyTriangleThreadData* thread)
 		{
 			line[x] = w[x];
 		}
+
+		// A write that passed the depth test stores a value no larger than the one it replaced
+		// (unless the bias favors the new one), so the tile maximums only change for untested writes.
+		if (!thread->DepthTest || thread->depthbias < 0.0f)
+			RaiseTileMaxDepth(y, x0, x1, w, thread);
 	}
 	else // portal fills always uses DepthRangeStart = 1 and DepthRangeScale = 0
 	{
@@ -50,6 +78,7 @@ static void WriteDepth(int y, int x0, int x1, PolyTriangleThreadData* thread)
 		{
 			line[x] = 65536.0f;
 		}
+		RaiseTileMaxDepth(y, x0, x1, line, thread);
 	}
 }
 
@@ -200,6 +229,74 @@ static void SortVertices(const TriDrawTriangleArgs* args, ScreenTriVertex** sort
 		std::swap(sortedVertices[1], sortedVertices[2]);
 }
 
+//==========================================================================
+//
+// Coarse depth test
+//
+// Finds the part of a band's x range where the triangle can pass the depth
+// test at all, in whole tiles. The depth written by WriteW is 1 / posW and
+// posW is linear in screen space, so its extremes over a rectangle are at
+// the corners. Returns false if nothing in the band can be visible.
+//
+//==========================================================================
+
+static bool CoarseDepthTest(int y0, int y1, int& x0, int& x1, const TriDrawTriangleArgs* args, PolyTriangleThreadData* thread)
+{
+	float startX0 = x0 + (0.5f - args->v1->x);
+	float startX1 = x1 - 1 + (0.5f - args->v1->x);
+	float startY0 = y0 + (0.5f - args->v1->y);
+	float startY1 = y1 - 1 + (0.5f - args->v1->y);
+	float gx = args->gradientX.W, gy = args->gradientY.W;
+	float maxPosW = args->v1->w + MAX(gx * startX0, gx * startX1) + MAX(gy * startY0, gy * startY1);
+	if (!(maxPosW > 0.0f))
+		return true;
+
+	// Leave some room for the reciprocal approximation in WriteW
+	float minDepth = (1.0f / maxPosW) * 0.999f + thread->depthbias;
+
+	PolyDepthStencil* ds = thread->depthstencil;
+	int width = ds->Width();
+	int tileoffset = y0 / PolyDepthStencil::TileHeight * ds->TilesX();
+	float* tilemax = ds->TileMaxDepth() + tileoffset;
+	uint8_t* tiledirty = ds->TileDirty() + tileoffset;
+	int tileY0 = y0 / PolyDepthStencil::TileHeight * PolyDepthStencil::TileHeight;
+	int tileY1 = MIN(tileY0 + (int)PolyDepthStencil::TileHeight, ds->Height());
+
+	int first = -1, last = -1;
+	for (int tx = x0 / PolyDepthStencil::TileWidth; tx <= (x1 - 1) / PolyDepthStencil::TileWidth; tx++)
+	{
+		// The stored maximum is always an upper bound. Only rescan when it is not low enough to reject the
+		// tile and writes since the last scan may have lowered the real maximum.
+		if (tilemax[tx] >= minDepth && tiledirty[tx])
+		{
+			int tileX0 = tx * PolyDepthStencil::TileWidth;
+			int tileX1 = MIN(tileX0 + (int)PolyDepthStencil::TileWidth, width);
+			float m = -FLT_MAX;
+			for (int y = tileY0; y < tileY1; y++)
+			{
+				const float* line = ds->DepthValues() + (size_t)width * y;
+				for (int x = tileX0; x < tileX1; x++)
+					m = MAX(m, line[x]);
+			}
+			tilemax[tx] = m;
+			tiledirty[tx] = 0;
+		}
+
+		if (tilemax[tx] >= minDepth)
+		{
+			if (first == -1) first = tx;
+			last = tx;
+		}
+	}
+
+	if (first == -1)
+		return false;
+
+	x0 = MAX(x0, first * (int)PolyDepthStencil::TileWidth);
+	x1 = MIN(x1, (last + 1) * (int)PolyDepthStencil::TileWidth);
+	return true;
+}
+
 void ScreenTriangle::Draw(const TriDrawTriangleArgs* args, PolyTriangleThreadData* thread)
 {
 	// Sort vertices by Y position
@@ -219,7 +316,7 @@ void ScreenTriangle::Draw(const TriDrawTriangleArgs* args, PolyTriangleThreadDat
 	midY = MIN(midY, clipbottom);
 	bottomY = MIN(bottomY, clipbottom);
 
-	if (topY >= bottomY)
+	if (topY >= bottomY || clipleft >= clipright)
 		return;
 
 	SelectFragmentShader(thread);
@@ -232,64 +329,74 @@ void ScreenTriangle::Draw(const TriDrawTriangleArgs* args, PolyTriangleThreadDat
 	if (thread->StencilTest) opt |= SWTRI_StencilTest;
 	testfunc = ScreenTriangle::TestSpanOpts[opt];
 
-	topY += thread->skipped_by_thread(topY);
-	int num_cores = thread->num_cores;
+	// Bounding box columns of the triangle with a pixel of slack on each side, for the coarse depth test
+	float minX = MIN(MIN(sortedVertices[0]->x, sortedVertices[1]->x), sortedVertices[2]->x);
+	float maxX = MAX(MAX(sortedVertices[0]->x, sortedVertices[1]->x), sortedVertices[2]->x);
+	int boxleft = clamp((int)floorf(minX) - 1, clipleft, clipright);
+	int boxright = clamp((int)ceilf(maxX) + 2, clipleft, clipright);
 
-	// Find start/end X positions for each line covered by the triangle:
+	float longStep = (sortedVertices[2]->x - sortedVertices[0]->x) / (sortedVertices[2]->y - sortedVertices[0]->y);
+	float topStep = (sortedVertices[1]->x - sortedVertices[0]->x) / (sortedVertices[1]->y - sortedVertices[0]->y);
+	float bottomStep = (sortedVertices[2]->x - sortedVertices[1]->x) / (sortedVertices[2]->y - sortedVertices[1]->y);
 
-	int y = topY;
+	// Walk the bands of this thread, finding start/end X positions for each line covered by the triangle:
 
-	float longDX = sortedVertices[2]->x - sortedVertices[0]->x;
-	float longDY = sortedVertices[2]->y - sortedVertices[0]->y;
-	float longStep = longDX / longDY;
-	float longPos = sortedVertices[0]->x + longStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
-	longStep *= num_cores;
-
-	if (y < midY)
+	for (int y = thread->next_line_for_thread(topY); y < bottomY; y = thread->next_line_for_thread(y))
 	{
-		float shortDX = sortedVertices[1]->x - sortedVertices[0]->x;
-		float shortDY = sortedVertices[1]->y - sortedVertices[0]->y;
-		float shortStep = shortDX / shortDY;
-		float shortPos = sortedVertices[0]->x + shortStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
-		shortStep *= num_cores;
+		int bandEnd = MIN(thread->band_end(y), bottomY);
+		int left = clipleft;
+		int right = clipright;
 
-		while (y < midY)
+		if (thread->DepthTest && boxleft < boxright)
 		{
-			int x0 = (int)shortPos;
-			int x1 = (int)longPos;
-			if (x1 < x0) std::swap(x0, x1);
-			x0 = clamp(x0, clipleft, clipright);
-			x1 = clamp(x1, clipleft, clipright);
+			left = boxleft;
+			right = boxright;
+			if (!CoarseDepthTest(y, bandEnd, left, right, args, thread))
+			{
+				y = bandEnd;
+				continue;
+			}
+		}
 
-			testfunc(y, x0, x1, args, thread);
+		float longPos = sortedVertices[0]->x + longStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
 
-			shortPos += shortStep;
-			longPos += longStep;
-			y += num_cores;
-		}
-	}
+		if (y < midY)
+		{
+			float shortPos = sortedVertices[0]->x + topStep * (y + 0.5f - sortedVertices[0]->y) + 0.5f;
+			int end = MIN(midY, bandEnd);
+			while (y < end)
+			{
+				int x0 = (int)shortPos;
+				int x1 = (int)longPos;
+				if (x1 < x0) std::swap(x0, x1);
+				x0 = clamp(x0, left, right);
+				x1 = clamp(x1, left, right);
 
-	if (y < bottomY)
-	{
-		float shortDX = sortedVertices[2]->x - sortedVertices[1]->x;
-		float shortDY = sortedVertices[2]->y - sortedVertices[1]->y;
-		float shortStep = shortDX / shortDY;
-		float shortPos = sortedVertices[1]->x + shortStep * (y + 0.5f - sortedVertices[1]->y) + 0.5f;
-		shortStep *= num_cores;
+				testfunc(y, x0, x1, args, thread);
 
-		while (y < bottomY)
+				shortPos += topStep;
+				longPos += longStep;
+				y++;
+			}
+		}
+
+		if (y < bandEnd)
 		{
-			int x0 = (int)shortPos;
-			int x1 = (int)longPos;
-			if (x1 < x0) std::swap(x0, x1);
-			x0 = clamp(x0, clipleft, clipright);
-			x1 = clamp(x1, clipleft, clipright);
+			float shortPos = sortedVertices[1]->x + bottomStep * (y + 0.5f - sortedVertices[1]->y) + 0.5f;
+			while (y < bandEnd)
+			{
+				int x0 = (int)shortPos;
+				int x1 = (int)longPos;
+				if (x1 < x0) std::swap(x0, x1);
+				x0 = clamp(x0, left, right);
+				x1 = clamp(x1, left, right);
 
-			testfunc(y, x0, x1, args, thread);
+				testfunc(y, x0, x1, args, thread);
 
-			shortPos += shortStep;
-			longPos += longStep;
-			y += num_cores;
+				shortPos += bottomStep;
+				longPos += longStep;
+				y++;
+			}
 		}
 	}
 }
@@ -30,8 +30,14 @@
 #include "poly_thread.h"
 #include "printf.h"
 #include "polyrenderer/drawers/poly_triangle.h"
+#include "c_dispatch.h"
+#include "i_time.h"
 #include <chrono>
 
+#ifdef ARCH_IA32
+#include <immintrin.h>
+#endif // ARCH_IA32
+
 #ifdef WIN32
 void PeekThreadedErrorPane();
 #endif
@@ -39,6 +45,21 @@ void PeekThreadedErrorPane();
 CVAR(Int, r_multithreaded, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 CVAR(Int, r_debug_draw, 0, 0);
 
+// How long idle workers and a waiting main thread poll before going to sleep.
+// Command lists usually come in bursts, so waking up from a sleep would often cost more than the work.
+// Polling only pays off when the thread being waited for has a core of its own. On a single core it
+// just burns the time slice that thread needs, so go straight to sleep there.
+static const int DrawerSpinCount = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+
+static inline void SpinPause()
+{
+#ifdef ARCH_IA32
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 DrawerThreads *DrawerThreads::Instance()
@@ -65,20 +86,34 @@ void DrawerThreads::Execute(DrawerCommandQueuePtr commands)
 
 	queue->StartThreads();
 
-	// Add to queue and awaken worker threads
-	std::unique_lock<std::mutex> start_lock(queue->start_mutex);
-	std::unique_lock<std::mutex> end_lock(queue->end_mutex);
+	// Hand the list to every worker first and only then wake those that went to sleep
 	queue->active_commands.push_back(commands);
-	queue->tasks_left += queue->threads.size();
-	end_lock.unlock();
-	start_lock.unlock();
-	queue->start_condition.notify_all();
+	queue->tasks_left.fetch_add(queue->threads.size(), std::memory_order_acq_rel);
+	size_t count = queue->threads.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		while (!queue->rings[i].Push(commands.get()))
+			std::this_thread::yield();
+	}
+
+	// Pairs with the fence in WaitForCommands: either the worker sees the new list or we see it sleeping.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (size_t i = 0; i < count; i++)
+	{
+		DrawerQueueRing &ring = queue->rings[i];
+		if (ring.sleeping.load(std::memory_order_relaxed))
+		{
+			std::unique_lock<std::mutex> lock(ring.park_mutex);
+			lock.unlock();
+			ring.park_condition.notify_one();
+		}
+	}
 }
 
 void DrawerThreads::ResetDebugDrawPos()
 {
 	auto queue = Instance();
-	std::unique_lock<std::mutex> start_lock(queue->start_mutex);
+	std::unique_lock<std::mutex> lock(queue->threads_mutex);
 	bool reached_end = false;
 	for (auto &thread : queue->threads)
 	{
@@ -98,23 +133,29 @@ void DrawerThreads::WaitForWorkers()
 
 	// Wait for workers to finish
 	auto queue = Instance();
-	std::unique_lock<std::mutex> end_lock(queue->end_mutex);
-	if (!queue->end_condition.wait_for(end_lock, 5s, [&]() { return queue->tasks_left == 0; }))
+	bool finished = false;
+	for (int i = 0; i < DrawerSpinCount && !finished; i++)
 	{
+		finished = queue->tasks_left.load(std::memory_order_acquire) == 0;
+		if (!finished)
+			SpinPause();
+	}
+
+	if (!finished)
+	{
+		std::unique_lock<std::mutex> end_lock(queue->end_mutex);
+		if (!queue->end_condition.wait_for(end_lock, 5s, [&]() { return queue->tasks_left.load(std::memory_order_acquire) == 0; }))
+		{
 #ifdef WIN32
-		PeekThreadedErrorPane();
+			PeekThreadedErrorPane();
 #endif
-		// Invoke the crash reporter so that we can capture the call stack of whatever the hung worker thread is doing
-		int *threadCrashed = nullptr;
-		*threadCrashed = 0xdeadbeef;
+			// Invoke the crash reporter so that we can capture the call stack of whatever the hung worker thread is doing
+			int *threadCrashed = nullptr;
+			*threadCrashed = 0xdeadbeef;
+		}
 	}
-	end_lock.unlock();
 
 	// Clean up
-	std::unique_lock<std::mutex> start_lock(queue->start_mutex);
-	for (auto &thread : queue->threads)
-		thread.current_queue = 0;
-
 	for (auto &list : queue->active_commands)
 	{
 		for (auto &command : list->commands)
@@ -124,27 +165,49 @@ void DrawerThreads::WaitForWorkers()
 	queue->active_commands.clear();
 }
 
+DrawerCommandQueue *DrawerThreads::WaitForCommands(DrawerQueueRing *ring)
+{
+	for (int i = 0; i < DrawerSpinCount; i++)
+	{
+		DrawerCommandQueue *list = ring->Pop();
+		if (list || shutdown_flag.load(std::memory_order_relaxed))
+			return list;
+		SpinPause();
+	}
+
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(ring->park_mutex);
+		ring->sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		ring->park_condition.wait(lock, [&]() { return !ring->Empty() || shutdown_flag.load(std::memory_order_relaxed); });
+		ring->sleeping.store(false, std::memory_order_relaxed);
+		lock.unlock();
+
+		DrawerCommandQueue *list = ring->Pop();
+		if (list || shutdown_flag.load(std::memory_order_relaxed))
+			return list;
+	}
+}
+
 void DrawerThreads::WorkerMain(DrawerThread *thread)
 {
 	while (true)
 	{
 		// Wait until we are signalled to run:
-		std::unique_lock<std::mutex> start_lock(start_mutex);
-		start_condition.wait(start_lock, [&]() { return thread->current_queue < active_commands.size() || shutdown_flag; });
-		if (shutdown_flag)
+		DrawerCommandQueue *list = WaitForCommands(thread->ring);
+		if (shutdown_flag.load(std::memory_order_relaxed))
 			break;
 
-		// Grab the commands
-		DrawerCommandQueuePtr list = active_commands[thread->current_queue];
-		thread->current_queue++;
 		thread->numa_start_y = thread->numa_node * screen->GetHeight() / thread->num_numa_nodes;
 		thread->numa_end_y = (thread->numa_node + 1) * screen->GetHeight() / thread->num_numa_nodes;
 		if (thread->poly)
 		{
-			thread->poly->numa_start_y = thread->numa_start_y;
-			thread->poly->numa_end_y = thread->numa_end_y;
+			// The poly drawers hand out whole bands, so a node boundary must not split one.
+			int band = PolyTriangleThreadData::band_height;
+			thread->poly->numa_start_y = thread->numa_start_y / band * band;
+			thread->poly->numa_end_y = thread->numa_node + 1 == thread->num_numa_nodes ? thread->numa_end_y : thread->numa_end_y / band * band;
 		}
-		start_lock.unlock();
 
 		// Do the work:
 		if (r_debug_draw)
@@ -164,13 +227,13 @@ void DrawerThreads::WorkerMain(DrawerThread *thread)
 			}
 		}
 
-		// Notify main thread that we finished:
-		std::unique_lock<std::mutex> end_lock(end_mutex);
-		tasks_left--;
-		bool finishedTasks = tasks_left == 0;
-		end_lock.unlock();
-		if (finishedTasks)
+		// Notify main thread if we were the last to finish:
+		if (tasks_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::unique_lock<std::mutex> end_lock(end_mutex);
+			end_lock.unlock();
 			end_condition.notify_all();
+		}
 	}
 }
 
@@ -206,6 +269,9 @@ void DrawerThreads::StartThreads()
 		StopThreads();
 
 		threads.resize(num_threads);
+		rings.reset(new DrawerQueueRing[num_threads]);
+		for (int i = 0; i < num_threads; i++)
+			threads[i].ring = &rings[i];
 
 		if (num_threads == num_numathreads)
 		{
@@ -244,15 +310,18 @@ void DrawerThreads::StartThreads()
 
 void DrawerThreads::StopThreads()
 {
-	std::unique_lock<std::mutex> lock(start_mutex);
-	shutdown_flag = true;
-	lock.unlock();
-	start_condition.notify_all();
+	shutdown_flag.store(true);
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		std::unique_lock<std::mutex> lock(rings[i].park_mutex);
+		lock.unlock();
+		rings[i].park_condition.notify_all();
+	}
 	for (auto &thread : threads)
 		thread.thread.join();
 	threads.clear();
-	lock.lock();
-	shutdown_flag = false;
+	rings.reset();
+	shutdown_flag.store(false);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -270,10 +339,16 @@ void *DrawerCommandQueue::AllocMemory(size_t size)
 
 void GroupMemoryBarrierCommand::Execute(DrawerThread *thread)
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	count++;
-	condition.notify_all();
-	condition.wait(lock, [&]() { return count >= (size_t)thread->num_cores; });
+	// All workers run the same list at the same time, so the others are never far away.
+	count.fetch_add(1, std::memory_order_acq_rel);
+	int spins = 0;
+	while (count.load(std::memory_order_acquire) < (size_t)thread->num_cores)
+	{
+		if (++spins < DrawerSpinCount)
+			SpinPause();
+		else
+			std::this_thread::yield();
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -299,3 +374,59 @@ void MemcpyCommand::Execute(DrawerThread *thread)
 		s += sstep;
 	}
 }
+
+/////////////////////////////////////////////////////////////////////////////
+
+static thread_local int DrawerBenchSink;
+
+// Does next to nothing, so that the benchmark measures the queue and not the drawing
+class DrawerBenchCommand : public DrawerCommand
+{
+public:
+	DrawerBenchCommand(int value) : value(value) { }
+
+	void Execute(DrawerThread *thread) override
+	{
+		DrawerBenchSink += value;
+	}
+
+private:
+	int value;
+};
+
+// r_drawerbench [total commands]
+CCMD(r_drawerbench)
+{
+	int total = argv.argc() > 1 ? atoi(argv[1]) : 1000000;
+	if (total <= 0) total = 1000000;
+
+	RenderMemory memory;
+	auto queue = std::make_shared<DrawerCommandQueue>(&memory);
+	static const int listSizes[] = { 1, 16, 256, 4096 };
+
+	Printf("Drawer queue with r_multithreaded %d, %d commands per run\n", *r_multithreaded, total);
+	for (int listSize : listSizes)
+	{
+		// A frame usually submits several lists before it waits for them.
+		const int listsPerWait = 16;
+		int lists = MAX(total / listSize, 1);
+
+		uint64_t start = I_nsTime();
+		for (int i = 0; i < lists; i++)
+		{
+			for (int j = 0; j < listSize; j++)
+				queue->Push<DrawerBenchCommand>(j);
+			DrawerThreads::Execute(queue);
+			queue = std::make_shared<DrawerCommandQueue>(&memory);
+			if (i % listsPerWait == listsPerWait - 1 || i == lists - 1)
+			{
+				DrawerThreads::WaitForWorkers();
+				memory.Clear();
+			}
+		}
+		double seconds = (I_nsTime() - start) / 1e9;
+
+		double commands = double(lists) * listSize;
+		Printf("%5d commands per list: %8.2f M commands/s, %8.2f us per list\n", listSize, commands / seconds / 1e6, seconds * 1e6 / lists);
+	}
+}
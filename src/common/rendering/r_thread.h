@@ -26,6 +26,7 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include "templates.h"
 #include "c_cvars.h"
@@ -38,12 +39,15 @@ class PolyTriangleThreadData;
 
 namespace swrenderer { class WallColumnDrawerArgs; }
 
+class DrawerCommandQueue;
+class DrawerQueueRing;
+
 // Worker data for each thread executing drawer commands
 class DrawerThread
 {
 public:
 	std::thread thread;
-	size_t current_queue = 0;
+	DrawerQueueRing *ring = nullptr;
 
 	// Thread line index of this thread
 	int core = 0;
@@ -121,9 +125,7 @@ public:
 	void Execute(DrawerThread *thread);
 
 private:
-	std::mutex mutex;
-	std::condition_variable condition;
-	size_t count = 0;
+	std::atomic<size_t> count { 0 };
 };
 
 // Copy finished rows to video memory
@@ -143,9 +145,50 @@ private:
 	int pixelsize;
 };
 
-class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
 
+// Command lists waiting for one worker thread. Only the thread calling
+// DrawerThreads::Execute pushes and only the worker pops, so no locks are
+// needed. The mutex and condition are only used when the worker parks.
+class DrawerQueueRing
+{
+public:
+	bool Push(DrawerCommandQueue *queue)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[h & (Capacity - 1)] = queue;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	DrawerCommandQueue *Pop()
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+			return nullptr;
+		DrawerCommandQueue *queue = items[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return queue;
+	}
+
+	bool Empty() const
+	{
+		return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+	}
+
+	std::atomic<bool> sleeping { false };
+	std::mutex park_mutex;
+	std::condition_variable park_condition;
+
+private:
+	enum { Capacity = 256 };	// must be a power of two
+	DrawerCommandQueue *items[Capacity];
+	alignas(64) std::atomic<size_t> head { 0 };
+	alignas(64) std::atomic<size_t> tail { 0 };
+};
+
 class DrawerThreads
 {
 public:
@@ -164,20 +207,21 @@ private:
 	void StartThreads();
 	void StopThreads();
 	void WorkerMain(DrawerThread *thread);
+	DrawerCommandQueue *WaitForCommands(DrawerQueueRing *ring);
 
 	static DrawerThreads *Instance();
 	
 	std::mutex threads_mutex;
 	std::vector<DrawerThread> threads;
+	std::unique_ptr<DrawerQueueRing[]> rings;
 
-	std::mutex start_mutex;
-	std::condition_variable start_condition;
+	// Keeps the lists alive until WaitForWorkers. Only touched by the submitting thread.
 	std::vector<DrawerCommandQueuePtr> active_commands;
-	bool shutdown_flag = false;
+	std::atomic<bool> shutdown_flag { false };
 
 	std::mutex end_mutex;
 	std::condition_variable end_condition;
-	size_t tasks_left = 0;
+	std::atomic<size_t> tasks_left { 0 };
 
 	size_t debug_draw_end = 0;
 
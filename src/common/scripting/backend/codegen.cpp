@@ -2113,6 +2113,26 @@ ExpEmit FxSizeAlign::Emit(VMFunctionBuilder *build)
 	return ExpEmit();
 }
 
+//==========================================================================
+//
+// Flags native fields that get modified by scripts, so that the engine
+// can tell whether it may keep data derived from them.
+//
+//==========================================================================
+
+static void MarkScriptWrite(FxExpression *x)
+{
+	if (x->ExprType == EFX_ArrayElement)
+	{
+		x = static_cast<FxArrayElement *>(x)->Array;
+	}
+	if (x->ExprType == EFX_StructMember || x->ExprType == EFX_ClassMember)
+	{
+		auto field = static_cast<FxMemberBase *>(x)->membervar;
+		if (field->Flags & VARF_Native) field->Flags |= VARF_ScriptWritten;
+	}
+}
+
 //==========================================================================
 //
 // FxPreIncrDecr
@@ -2163,6 +2183,7 @@ FxExpression *FxPreIncrDecr::Resolve(FCompileContext &ctx)
 		delete this;
 		return nullptr;
 	}
+	MarkScriptWrite(Base);
 
 	return this;
 }
@@ -2249,6 +2270,7 @@ FxExpression *FxPostIncrDecr::Resolve(FCompileContext &ctx)
 		delete this;
 		return nullptr;
 	}
+	MarkScriptWrite(Base);
 
 	return this;
 }
@@ -2420,6 +2442,7 @@ FxExpression *FxAssign::Resolve(FCompileContext &ctx)
 		delete this;
 		return nullptr;
 	}
+	MarkScriptWrite(Base);
 
 	// Special case: Assignment to a bitfield.
 	IsBitWrite = Base->GetBitValue();
@@ -6656,6 +6679,42 @@ FxExpression *FxCVar::Resolve(FCompileContext &ctx)
 	return this;
 }
 
+//==========================================================================
+//
+// Address of the variable holding the CVar's value
+//
+//==========================================================================
+
+void *FxCVar::ValueAddress(FBaseCVar *CVar)
+{
+	switch (CVar->GetRealType())
+	{
+	case CVAR_Int:
+		return &static_cast<FIntCVar *>(CVar)->Value;
+
+	case CVAR_Color:
+		return &static_cast<FColorCVar *>(CVar)->Value;
+
+	case CVAR_Float:
+		return &static_cast<FFloatCVar *>(CVar)->Value;
+
+	case CVAR_Bool:
+		return &static_cast<FBoolCVar *>(CVar)->Value;
+
+	case CVAR_String:
+		return &static_cast<FStringCVar *>(CVar)->mValue;
+
+	case CVAR_DummyBool:
+		return &static_cast<FFlagCVar *>(CVar)->ValueVar.Value;
+
+	case CVAR_DummyInt:
+		return &static_cast<FMaskCVar *>(CVar)->ValueVar.Value;
+
+	default:
+		return nullptr;
+	}
+}
+
 ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 {
 	ExpEmit dest(build, CVar->GetRealType() == CVAR_String ? REGT_STRING : ValueType->GetRegType());
@@ -6664,37 +6723,34 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	switch (CVar->GetRealType())
 	{
 	case CVAR_Int:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FIntCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Color:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FColorCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Float:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FFloatCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LSP, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Bool:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FBoolCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LBU, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_String:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FStringCVar *>(CVar)->mValue));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LS, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_DummyBool:
 	{
-		int *pVal;
 		auto cv = static_cast<FFlagCVar *>(CVar);
-		auto vcv = &cv->ValueVar;
-		pVal = &vcv->Value;
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(pVal));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(1));
@@ -6704,7 +6760,7 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	case CVAR_DummyInt:
 	{
 		auto cv = static_cast<FMaskCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(cv->BitVal));
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
@@ -48,6 +48,7 @@
 #include "types.h"
 #include "vmintern.h"
 #include "c_cvars.h"
+#include "vmcache.h"
 
 struct FState; // needed for FxConstant. Maybe move the state constructor to a subclass later?
 
@@ -1367,6 +1368,7 @@ public:
 	FxCVar(FBaseCVar*, const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+	static void *ValueAddress(FBaseCVar *CVar);
 };
 
 
@@ -2156,6 +2158,14 @@ struct CompileEnvironment
 	FxExpression* (*CheckCustomGlobalFunctions)(FxFunctionCall* func, FCompileContext& ctx);
 	bool (*ResolveSpecialFunction)(FxVMFunctionCall* func, FCompileContext& ctx);
 	FName CustomBuiltinNew;	//override the 'new' function if some classes need special treatment.
+
+	// Bytecode cache support for game data referenced by the generated code.
+	bool (*CacheWritePointer)(FBytecodeWriter &w, void *ptr);
+	bool (*CacheReadPointer)(FBytecodeReader &r, void *&ptr);
+	// Game side tables the code generator appends to.
+	void (*CacheBeginTables)(FBytecodeWriter &key);
+	bool (*CacheWriteTables)(FBytecodeWriter &w);
+	bool (*CacheReadTables)(FBytecodeReader &r);
 };
 
 extern CompileEnvironment compileEnvironment;
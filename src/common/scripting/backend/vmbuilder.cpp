@@ -37,8 +37,11 @@
 #include "m_argv.h"
 #include "c_cvars.h"
 #include "jit.h"
+#include "vmcache.h"
 
 CVAR(Bool, strictdecorate, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
+EXTERN_CVAR(Bool, vm_jit)
+EXTERN_CVAR(Bool, vm_superinstructions)
 
 struct VMRemap
 {
@@ -289,6 +292,20 @@ unsigned VMFunctionBuilder::GetConstantAddress(void *ptr)
 	}
 }
 
+//==========================================================================
+//
+// VMFunctionBuilder :: GetConstantBlob
+//
+//==========================================================================
+
+unsigned VMFunctionBuilder::GetConstantBlob(const void *data, unsigned size)
+{
+	void *blob = ClassDataAllocator.Alloc(size);	// Allocate in the arena so that the pointer does not need to be maintained.
+	memcpy(blob, data, size);
+	ConstantBlobs.Insert(blob, size);
+	return GetConstantAddress(blob);
+}
+
 //==========================================================================
 //
 // VMFunctionBuilder :: AllocConstants*
@@ -812,10 +829,49 @@ VMFunction *FFunctionBuildList::AddFunction(PNamespace *gnspc, const VersionInfo
 }
 
 
+//==========================================================================
+//
+// NumArgs for the VMFunction must be the amount of stack elements, which can
+// differ from the amount of logical function arguments if vectors are in the list.
+// For the VM a vector is 2 or 3 args, depending on size.
+//
+//==========================================================================
+
+static int CountArgumentSlots(PFunction *func)
+{
+	int numargs = 0;
+	auto &funcVariant = func->Variants[0];
+	for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
+	{
+		auto argType = funcVariant.Proto->ArgumentTypes[i];
+		auto argFlags = funcVariant.ArgFlags[i];
+		if (argFlags & VARF_Out)
+		{
+			auto argPointer = NewPointer(argType);
+			numargs += argPointer->GetRegCount();
+		}
+		else
+		{
+			numargs += argType->GetRegCount();
+		}
+	}
+	return numargs;
+}
+
 void FFunctionBuildList::Build()
 {
 	VMDisassemblyDumper disasmdump(VMDisassemblyDumper::Overwrite);
 
+	TArray<VMScriptFunction *> functions;
+	for (auto &item : mItems)
+	{
+		if (!(item.Func->Variants[0].Implementation->VarFlags & VARF_Abstract)) functions.Push(item.Function);
+	}
+	FBytecodeCache cache(mSourceLumps, functions);
+	TArray<PPrototype *> cachedprotos;
+	bool fromcache = cache.Load(cachedprotos);
+	unsigned cachedindex = 0;
+
 	for (auto &item : mItems)
 	{
 		// [Player701] Do not emit code for abstract functions
@@ -824,6 +880,23 @@ void FFunctionBuildList::Build()
 
 		assert(item.Code != NULL);
 
+		if (fromcache)
+		{
+			// The code was loaded already, only the parts not stored in the cache need to be set up.
+			VMScriptFunction *sfunc = item.Function;
+			item.Proto = cachedprotos[cachedindex++];
+			if (sfunc->Proto == nullptr)
+			{
+				sfunc->Proto = NewPrototype(item.Proto->ReturnTypes, item.Func->Variants[0].Proto->ArgumentTypes);
+				sfunc->ArgFlags = item.Func->Variants[0].ArgFlags;
+			}
+			sfunc->NumArgs = CountArgumentSlots(item.Func);
+			disasmdump.Write(sfunc, item.PrintableName);
+			delete item.Code;
+			disasmdump.Flush();
+			continue;
+		}
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
 
@@ -886,28 +959,13 @@ void FFunctionBuildList::Build()
 				item.Code->Emit(&buildit);
 				buildit.EndStatement();
 				buildit.MakeFunction(sfunc);
-				sfunc->NumArgs = 0;
-				// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
-				// For the VM a vector is 2 or 3 args, depending on size.
-				auto funcVariant = item.Func->Variants[0];
-				for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
-				{
-					auto argType = funcVariant.Proto->ArgumentTypes[i];
-					auto argFlags = funcVariant.ArgFlags[i];
-					if (argFlags & VARF_Out)
-					{
-						auto argPointer = NewPointer(argType);
-						sfunc->NumArgs += argPointer->GetRegCount();
-					}
-					else
-					{
-						sfunc->NumArgs += argType->GetRegCount();
-					}
-				}
+				if (!vm_jit && vm_superinstructions) VMFuseInstructions(sfunc->Code, sfunc->CodeSize);
+				sfunc->NumArgs = CountArgumentSlots(item.Func);
 
 				disasmdump.Write(sfunc, item.PrintableName);
 
 				sfunc->Unsafe = ctx.Unsafe;
+				cache.Store(sfunc, item.Proto, buildit);
 			}
 			catch (CRecoverableError &err)
 			{
@@ -921,9 +979,12 @@ void FFunctionBuildList::Build()
 	VMFunction::CreateRegUseInfo();
 	FScriptPosition::StrictErrors = strictdecorate;
 
+	if (!fromcache && FScriptPosition::ErrorCounter == 0) cache.Save();
+
 	if (FScriptPosition::ErrorCounter == 0 && Args->CheckParm("-dumpjit")) DumpJit();
 	mItems.Clear();
 	mItems.ShrinkToFit();
+	mSourceLumps.Reset();
 	FxAlloc.FreeAllBlocks();
 }
 
@@ -1058,7 +1119,6 @@ void FunctionCallEmitter::AddParameterStringConst(const FString &konst)
 	});
 }
 
-EXTERN_CVAR(Bool, vm_jit)
 
 ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit> *ReturnRegs)
 {
@@ -1072,9 +1132,7 @@ ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit>
 	{
 		// Pass a hidden type information parameter to vararg functions.
 		// It would really be nicer to actually pass real types but that'd require a far more complex interface on the compiler side than what we have.
-		uint8_t *regbuffer = (uint8_t*)ClassDataAllocator.Alloc(reginfo.Size());	// Allocate in the arena so that the pointer does not need to be maintained.
-		memcpy(regbuffer, reginfo.Data(), reginfo.Size());
-		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantAddress(regbuffer));
+		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantBlob(reginfo.Data(), reginfo.Size()));
 		paramcount++;
 	}
 
@@ -64,6 +64,8 @@ public:
 	unsigned GetConstantFloat(double val);
 	unsigned GetConstantAddress(void *ptr);
 	unsigned GetConstantString(FString str);
+	// Copies the data to the class data arena and returns the constant register holding its address.
+	unsigned GetConstantBlob(const void *data, unsigned size);
 
 	unsigned AllocConstantsInt(unsigned int count, int *values);
 	unsigned AllocConstantsFloat(unsigned int count, double *values);
@@ -105,6 +107,9 @@ public:
 	ExpEmit FramePointer;
 	TArray<FxLocalVariableDeclaration *> ConstructedStructs;
 
+	// Address constants created by GetConstantBlob and their size.
+	TMap<void *, unsigned> ConstantBlobs;
+
 private:
 	TArray<FStatementInfo> LineNumbers;
 	TArray<FxExpression *> StatementStack;
@@ -154,11 +159,13 @@ class FFunctionBuildList
 	};
 
 	TArray<Item> mItems;
+	TArray<int> mSourceLumps;
 
 	void DumpJit();
 
 public:
 	VMFunction *AddFunction(PNamespace *curglobals, const VersionInfo &ver, PFunction *func, FxExpression *code, const FString &name, bool fromdecorate, int currentstate, int statecnt, int lumpnum);
+	void AddSourceLump(int lump) { mSourceLumps.Push(lump); }
 	void Build();
 };
 
@@ -0,0 +1,835 @@
+/*
+** vmcache.cpp
+** Persistent cache for the output of the script code generator
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The parser and the symbol table setup still run on every launch because
+** they create the classes, types and native bindings everything else
+** depends on. What gets cached is the work done by Resolve and Emit for
+** every function body.
+**
+** The cache key covers the engine build, the contents of all script lumps
+** and the name, sound and type tables the code generator bakes into the
+** generated code by index. Integer constants are stored verbatim, which is
+** only correct as long as those tables are identical.
+**
+*/
+
+#include <memory>
+#include "vmcache.h"
+#include "vmbuilder.h"
+#include "codegen.h"
+#include "m_argv.h"
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "md5.h"
+#include "m_crc32.h"
+#include "m_random.h"
+#include "files.h"
+#include "filesystem.h"
+#include "i_specialpaths.h"
+#include "printf.h"
+#include "version.h"
+#include "v_font.h"
+#include "texturemanager.h"
+
+CVAR(Bool, vm_bytecodecache, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Bool, vm_jit)
+EXTERN_CVAR(Bool, vm_superinstructions)
+EXTERN_CVAR(Bool, strictdecorate)
+extern FRandom pr_exrandom;
+
+static const char BytecodeMagic[4] = { 'L', 'Z', 'B', 'C' };
+enum { BYTECODE_CACHE_VERSION = 2 };
+
+enum ERefType
+{
+	REF_Null,
+	REF_Function,
+	REF_Class,
+	REF_Type,
+	REF_Address,
+	REF_CVar,
+	REF_RNG,
+	REF_Font,
+	REF_Blob,
+	REF_Game,
+};
+
+enum ETypeRef
+{
+	TREF_Index,
+	TREF_Pointer,
+	TREF_ClassPointer,
+	TREF_Array,
+	TREF_StaticArray,
+	TREF_DynArray,
+	TREF_Map,
+	TREF_Prototype,
+};
+
+//==========================================================================
+//
+// FBytecodeCache :: FBytecodeCache
+//
+// Records the state of the global tables and computes the cache key.
+// Must be called before any function gets resolved.
+//
+//==========================================================================
+
+FBytecodeCache::FBytecodeCache(const TArray<int> &sourcelumps, const TArray<VMScriptFunction *> &functions)
+	: Functions(functions)
+{
+	NamesAtStart = FName::GetNumNames();
+	TypesAtStart = TypeTable.AllTypes.Size();
+	FunctionsAtStart = VMFunction::AllFunctions.Size();
+	Enabled = vm_bytecodecache && !Args->CheckParm("-nobytecodecache");
+	if (!Enabled) return;
+
+	FBytecodeWriter key;
+	key.Write(BytecodeMagic, 4);
+	key.WriteInt(BYTECODE_CACHE_VERSION);
+	key.WriteString(GetGitHash());
+	key.WriteString(GetVersionString());
+	key.WriteInt(sizeof(void *));
+	key.WriteByte(vm_jit);
+	key.WriteByte(vm_superinstructions);
+	key.WriteByte(strictdecorate);
+
+	for (int i = 0; i < NamesAtStart; i++)
+	{
+		key.WriteString(FName(ENamedName(i)).GetChars());
+	}
+	if (soundEngine != nullptr)
+	{
+		for (auto &sfx : soundEngine->GetSounds())
+		{
+			key.WriteString(sfx.name.GetChars());
+		}
+	}
+	key.WriteInt(TypesAtStart);
+	key.WriteInt(FunctionsAtStart);
+	key.WriteInt(PClass::AllClasses.Size());
+	for (auto func : functions)
+	{
+		key.WriteString(func->PrintableName.GetChars());
+	}
+	if (compileEnvironment.CacheBeginTables != nullptr)
+	{
+		compileEnvironment.CacheBeginTables(key);
+	}
+
+	for (int lump : sourcelumps)
+	{
+		if (lump < 0)
+		{
+			// Scripts that were not read from a lump cannot be checked for changes.
+			Enabled = false;
+			return;
+		}
+		auto data = fileSystem.ReadFile(lump);
+		uint8_t digest[16];
+		MD5Context md5;
+		md5.Update((const uint8_t *)data.GetMem(), (unsigned)data.GetSize());
+		md5.Final(digest);
+		key.WriteString(fileSystem.GetFileFullName(lump, false));
+		key.Write(digest, 16);
+	}
+
+	MD5Context md5;
+	md5.Update(key.Data.Data(), key.Data.Size());
+	md5.Final(Key);
+}
+
+FString FBytecodeCache::GetCacheFileName(bool create)
+{
+	FString path = M_GetCachePath(create);
+	if (create) CreatePath(path);
+	path << "/bytecode.lzbc";
+	return path;
+}
+
+//==========================================================================
+//
+// Reverse lookup tables for the pointers that can appear in the
+// address constants. Only built when the cache gets written.
+//
+//==========================================================================
+
+void FBytecodeCache::BuildAddressMaps()
+{
+	if (HaveAddressMaps) return;
+	HaveAddressMaps = true;
+
+	for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+	{
+		FunctionIndices.Insert(VMFunction::AllFunctions[i], i);
+	}
+	for (unsigned i = 0; i < TypeTable.AllTypes.Size(); i++)
+	{
+		TypeIndices.Insert(TypeTable.AllTypes[i], i);
+	}
+
+	// Native global variables and static constant arrays are accessed through their address.
+	auto addfields = [&](PSymbolTable &symbols, const FString &owner, bool staticonly)
+	{
+		auto it = symbols.GetIterator();
+		PSymbolTable::MapType::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto field = dyn_cast<PField>(pair->Value);
+			if (field == nullptr || (staticonly && !(field->Flags & VARF_Static))) continue;
+
+			FString name = owner + "." + field->SymbolName.GetChars();
+			void *addr = (void *)(intptr_t)field->Offset;
+			if (AddressNames.CheckKey(addr) == nullptr) AddressNames.Insert(addr, name);
+		}
+	};
+	for (unsigned i = 0; i < Namespaces.AllNamespaces.Size(); i++)
+	{
+		addfields(Namespaces.AllNamespaces[i]->Symbols, FStringf("N%u", i), false);
+	}
+	for (unsigned i = 0; i < TypesAtStart; i++)
+	{
+		addfields(TypeTable.AllTypes[i]->Symbols, FStringf("T%u", i), true);
+	}
+	AddressNames.Insert(&((FArray *)&TexMan.Textures)->Count, "TexMan.Textures.Count");
+}
+
+//==========================================================================
+//
+// FBytecodeCache :: WritePointer
+//
+//==========================================================================
+
+bool FBytecodeCache::WritePointer(FBytecodeWriter &w, void *ptr)
+{
+	if (ptr == nullptr)
+	{
+		w.WriteByte(REF_Null);
+		return true;
+	}
+	if (auto blob = Blobs.CheckKey(ptr))
+	{
+		w.WriteByte(REF_Blob);
+		w.WriteInt(blob->Size());
+		w.Write(blob->Data(), blob->Size());
+		return true;
+	}
+	if (auto index = FunctionIndices.CheckKey((VMFunction *)ptr))
+	{
+		if (*index >= FunctionsAtStart) return false;
+		w.WriteByte(REF_Function);
+		w.WriteInt(*index);
+		w.WriteString(VMFunction::AllFunctions[*index]->PrintableName.GetChars());
+		return true;
+	}
+	for (auto cls : PClass::AllClasses)
+	{
+		if (cls == ptr)
+		{
+			w.WriteByte(REF_Class);
+			w.WriteString(cls->TypeName.GetChars());
+			return true;
+		}
+	}
+	if (TypeIndices.CheckKey((PType *)ptr))
+	{
+		w.WriteByte(REF_Type);
+		return WriteType(w, (PType *)ptr);
+	}
+	if (auto name = AddressNames.CheckKey(ptr))
+	{
+		w.WriteByte(REF_Address);
+		w.WriteString(name->GetChars());
+		return true;
+	}
+	for (auto cvar = CVars; cvar != nullptr; cvar = cvar->GetNext())
+	{
+		if (FxCVar::ValueAddress(cvar) == ptr)
+		{
+			w.WriteByte(REF_CVar);
+			w.WriteString(cvar->GetName());
+			return true;
+		}
+	}
+
+	// Named RNGs and fonts can only be looked up by name, so try all names that exist.
+	if (ptr == &pr_exrandom)
+	{
+		w.WriteByte(REF_RNG);
+		w.WriteString("");
+		return true;
+	}
+	for (int i = 0, count = FName::GetNumNames(); i < count; i++)
+	{
+		const char *name = FName(ENamedName(i)).GetChars();
+		if (FRandom::StaticFindRNGByCRC(CalcCRC32((const uint8_t *)name, (unsigned)strlen(name))) == ptr)
+		{
+			w.WriteByte(REF_RNG);
+			w.WriteString(name);
+			return true;
+		}
+		if (FFont::FindFont(ENamedName(i)) == ptr)
+		{
+			w.WriteByte(REF_Font);
+			w.WriteString(name);
+			return true;
+		}
+	}
+
+	if (compileEnvironment.CacheWritePointer != nullptr)
+	{
+		unsigned pos = w.Data.Size();
+		w.WriteByte(REF_Game);
+		if (compileEnvironment.CacheWritePointer(w, ptr)) return true;
+		w.Data.Clamp(pos);
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// FBytecodeCache :: ReadPointer
+//
+//==========================================================================
+
+bool FBytecodeCache::ReadPointer(FBytecodeReader &r, void *&ptr)
+{
+	ptr = nullptr;
+	switch (r.ReadByte())
+	{
+	case REF_Null:
+		return !r.Failed();
+
+	case REF_Blob:
+	{
+		uint32_t size = r.ReadInt();
+		if (r.Failed() || size > 65536) return false;
+		ptr = ClassDataAllocator.Alloc(size);
+		return r.Read(ptr, size);
+	}
+
+	case REF_Function:
+	{
+		uint32_t index = r.ReadInt();
+		FString name = r.ReadString();
+		if (r.Failed() || index >= FunctionsAtStart) return false;
+		ptr = VMFunction::AllFunctions[index];
+		return VMFunction::AllFunctions[index]->PrintableName.Compare(name) == 0;
+	}
+
+	case REF_Class:
+		ptr = PClass::FindClass(r.ReadString());
+		return ptr != nullptr;
+
+	case REF_Type:
+		ptr = ReadType(r);
+		return ptr != nullptr;
+
+	case REF_Address:
+	{
+		if (!HaveAddressMaps)
+		{
+			BuildAddressMaps();
+			TMap<void *, FString>::Iterator it(AddressNames);
+			TMap<void *, FString>::Pair *pair;
+			while (it.NextPair(pair)) NamedAddresses.Insert(pair->Value, pair->Key);
+		}
+		auto addr = NamedAddresses.CheckKey(r.ReadString());
+		if (addr == nullptr) return false;
+		ptr = *addr;
+		return true;
+	}
+
+	case REF_CVar:
+	{
+		auto cvar = FindCVar(r.ReadString().GetChars(), nullptr);
+		if (cvar == nullptr) return false;
+		ptr = FxCVar::ValueAddress(cvar);
+		return ptr != nullptr;
+	}
+
+	case REF_RNG:
+	{
+		FString name = r.ReadString();
+		if (r.Failed()) return false;
+		// Names were replayed before this gets called, so the returned text is the same the code generator used.
+		if (name.IsEmpty())
+		{
+			ptr = &pr_exrandom;
+			return true;
+		}
+		FName rngname(name, true);
+		if (rngname == NAME_None) return false;
+		ptr = FRandom::StaticFindRNG(rngname.GetChars());
+		return true;
+	}
+
+	case REF_Font:
+	{
+		FName name(r.ReadString(), true);
+		if (name == NAME_None) return false;
+		ptr = V_GetFont(name.GetChars());
+		return ptr != nullptr;
+	}
+
+	case REF_Game:
+		return compileEnvironment.CacheReadPointer != nullptr && compileEnvironment.CacheReadPointer(r, ptr);
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// Types that existed before the build are referenced by their creation
+// index. The code generator only creates derived types, which are stored
+// by their components.
+//
+//==========================================================================
+
+bool FBytecodeCache::WriteType(FBytecodeWriter &w, const PType *ctype)
+{
+	auto type = const_cast<PType *>(ctype);
+	auto index = TypeIndices.CheckKey(type);
+	if (index == nullptr) return false;
+	if (*index < TypesAtStart)
+	{
+		w.WriteByte(TREF_Index);
+		w.WriteInt(*index);
+		return true;
+	}
+	if (type->isClassPointer())
+	{
+		auto cls = static_cast<PClassPointer *>(type)->ClassRestriction;
+		w.WriteByte(TREF_ClassPointer);
+		w.WriteString(cls->TypeName.GetChars());
+		return true;
+	}
+	if (type->isPointer())
+	{
+		auto ptype = static_cast<PPointer *>(type);
+		w.WriteByte(TREF_Pointer);
+		w.WriteByte(ptype->IsConst);
+		return WriteType(w, ptype->PointedType);
+	}
+	if (type->isStaticArray())
+	{
+		w.WriteByte(TREF_StaticArray);
+		return WriteType(w, static_cast<PStaticArray *>(type)->ElementType);
+	}
+	if (type->isArray())
+	{
+		w.WriteByte(TREF_Array);
+		w.WriteInt(static_cast<PArray *>(type)->ElementCount);
+		return WriteType(w, static_cast<PArray *>(type)->ElementType);
+	}
+	if (type->isDynArray())
+	{
+		w.WriteByte(TREF_DynArray);
+		return WriteType(w, static_cast<PDynArray *>(type)->ElementType);
+	}
+	if (type->TypeTableType == NAME_Map)
+	{
+		w.WriteByte(TREF_Map);
+		return WriteType(w, static_cast<PMap *>(type)->KeyType) && WriteType(w, static_cast<PMap *>(type)->ValueType);
+	}
+	if (type->isPrototype())
+	{
+		auto proto = static_cast<PPrototype *>(type);
+		w.WriteByte(TREF_Prototype);
+		w.WriteInt(proto->ReturnTypes.Size());
+		for (auto t : proto->ReturnTypes) if (!WriteType(w, t)) return false;
+		w.WriteInt(proto->ArgumentTypes.Size());
+		for (auto t : proto->ArgumentTypes) if (!WriteType(w, t)) return false;
+		return true;
+	}
+	return false;
+}
+
+PType *FBytecodeCache::ReadType(FBytecodeReader &r)
+{
+	switch (r.ReadByte())
+	{
+	case TREF_Index:
+	{
+		uint32_t index = r.ReadInt();
+		return !r.Failed() && index < TypesAtStart ? TypeTable.AllTypes[index] : nullptr;
+	}
+
+	case TREF_ClassPointer:
+	{
+		auto cls = PClass::FindClass(r.ReadString());
+		return cls != nullptr ? NewClassPointer(cls) : nullptr;
+	}
+
+	case TREF_Pointer:
+	{
+		bool isconst = !!r.ReadByte();
+		auto pointed = ReadType(r);
+		return pointed != nullptr ? NewPointer(pointed, isconst) : nullptr;
+	}
+
+	case TREF_StaticArray:
+	{
+		auto elem = ReadType(r);
+		return elem != nullptr ? NewStaticArray(elem) : nullptr;
+	}
+
+	case TREF_Array:
+	{
+		uint32_t count = r.ReadInt();
+		auto elem = ReadType(r);
+		return elem != nullptr ? NewArray(elem, count) : nullptr;
+	}
+
+	case TREF_DynArray:
+	{
+		auto elem = ReadType(r);
+		return elem != nullptr ? NewDynArray(elem) : nullptr;
+	}
+
+	case TREF_Map:
+	{
+		auto key = ReadType(r);
+		auto value = ReadType(r);
+		return key != nullptr && value != nullptr ? NewMap(key, value) : nullptr;
+	}
+
+	case TREF_Prototype:
+	{
+		TArray<PType *> rets, args;
+		for (uint32_t i = 0, count = r.ReadInt(); i < count && !r.Failed(); i++)
+		{
+			auto t = ReadType(r);
+			if (t == nullptr) return nullptr;
+			rets.Push(t);
+		}
+		for (uint32_t i = 0, count = r.ReadInt(); i < count && !r.Failed(); i++)
+		{
+			auto t = ReadType(r);
+			if (t == nullptr) return nullptr;
+			args.Push(t);
+		}
+		return r.Failed() ? nullptr : NewPrototype(rets, args);
+	}
+
+	default:
+		return nullptr;
+	}
+}
+
+//==========================================================================
+//
+// FBytecodeCache :: Store
+//
+// Called for each function right after it has been emitted. The actual
+// serialization happens in Save once all types the code generator creates
+// are known.
+//
+//==========================================================================
+
+void FBytecodeCache::Store(VMScriptFunction *func, PPrototype *returnproto, const VMFunctionBuilder &build)
+{
+	if (!Enabled) return;
+	if (StoredFunctions >= Functions.Size() || Functions[StoredFunctions] != func)
+	{
+		Writable = false;
+		return;
+	}
+	StoredFunctions++;
+	ReturnProtos.Push(returnproto);
+
+	TMap<void *, unsigned>::ConstIterator it(build.ConstantBlobs);
+	TMap<void *, unsigned>::ConstPair *pair;
+	while (it.NextPair(pair))
+	{
+		auto &blob = Blobs[pair->Key];
+		blob.Resize(pair->Value);
+		memcpy(blob.Data(), pair->Key, pair->Value);
+	}
+}
+
+//==========================================================================
+//
+// FBytecodeCache :: Save
+//
+//==========================================================================
+
+void FBytecodeCache::Save()
+{
+	if (!Enabled || !Writable || StoredFunctions != Functions.Size()) return;
+
+	BuildAddressMaps();
+	FBytecodeWriter w;
+	w.Write(BytecodeMagic, 4);
+	w.WriteInt(BYTECODE_CACHE_VERSION);
+	w.Write(Key, 16);
+
+	// Names the code generator created, in creation order.
+	int numnames = FName::GetNumNames();
+	w.WriteInt(numnames - NamesAtStart);
+	for (int i = NamesAtStart; i < numnames; i++)
+	{
+		w.WriteString(FName(ENamedName(i)).GetChars());
+	}
+
+	w.WriteInt(Functions.Size());
+	for (unsigned i = 0; i < Functions.Size(); i++)
+	{
+		auto func = Functions[i];
+		w.WriteString(func->PrintableName.GetChars());
+		w.WriteInt(func->CodeSize);
+		w.Write(func->Code, func->CodeSize * sizeof(VMOP));
+		w.WriteInt(func->LineInfoCount);
+		w.Write(func->LineInfo, func->LineInfoCount * sizeof(FStatementInfo));
+		w.WriteInt(func->NumKonstD);
+		w.Write(func->KonstD, func->NumKonstD * sizeof(int));
+		w.WriteInt(func->NumKonstF);
+		w.Write(func->KonstF, func->NumKonstF * sizeof(double));
+		w.WriteInt(func->NumKonstS);
+		for (int j = 0; j < func->NumKonstS; j++)
+		{
+			w.WriteString(func->KonstS[j].GetChars());
+		}
+		w.WriteInt(func->NumKonstA);
+		for (int j = 0; j < func->NumKonstA; j++)
+		{
+			if (!WritePointer(w, func->KonstA[j].v))
+			{
+				DPrintf(DMSG_NOTIFY, "Bytecode cache not written: unknown address constant in %s\n", func->PrintableName.GetChars());
+				return;
+			}
+		}
+		w.WriteByte(func->NumRegD);
+		w.WriteByte(func->NumRegF);
+		w.WriteByte(func->NumRegS);
+		w.WriteByte(func->NumRegA);
+		w.WriteInt(func->MaxParam);
+		w.WriteInt(func->ExtraSpace);
+		w.WriteInt(func->SpecialInits.Size());
+		for (auto &init : func->SpecialInits)
+		{
+			if (!WriteType(w, init.first)) return;
+			w.WriteInt(init.second);
+		}
+		w.WriteByte(func->Unsafe);
+		w.WriteString(func->SourceFileName.GetChars());
+		w.WriteByte(ReturnProtos[i] != nullptr);
+		if (ReturnProtos[i] != nullptr && !WriteType(w, ReturnProtos[i])) return;
+	}
+
+	// The code generator flags the native fields that scripts write to, and the engine
+	// checks those flags to decide whether it may keep data derived from these fields.
+	TArray<std::pair<PType *, PField *>> written;
+	for (unsigned i = 0; i < TypesAtStart; i++)
+	{
+		auto type = TypeTable.AllTypes[i];
+		if (!type->isContainer()) continue;
+		auto it = type->Symbols.GetIterator();
+		PSymbolTable::MapType::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto field = dyn_cast<PField>(pair->Value);
+			if (field != nullptr && (field->Flags & VARF_ScriptWritten)) written.Push(std::make_pair(type, field));
+		}
+	}
+	w.WriteInt(written.Size());
+	for (auto &entry : written)
+	{
+		if (!WriteType(w, entry.first)) return;
+		w.WriteString(entry.second->SymbolName.GetChars());
+	}
+
+	w.WriteByte(compileEnvironment.CacheWriteTables != nullptr);
+	if (compileEnvironment.CacheWriteTables != nullptr && !compileEnvironment.CacheWriteTables(w)) return;
+
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(GetCacheFileName(true)));
+	if (fw != nullptr)
+	{
+		fw->Write(w.Data.Data(), w.Data.Size());
+	}
+}
+
+//==========================================================================
+//
+// FBytecodeCache :: Load
+//
+// Fills in all functions from the cache. Nothing gets assigned to the
+// functions unless the entire file could be resolved.
+//
+//==========================================================================
+
+struct FCachedFunction
+{
+	TArray<VMOP> Code;
+	TArray<FStatementInfo> LineInfo;
+	TArray<int> KonstD;
+	TArray<double> KonstF;
+	TArray<FString> KonstS;
+	TArray<void *> KonstA;
+	uint8_t NumRegD, NumRegF, NumRegS, NumRegA;
+	int MaxParam;
+	int ExtraSpace;
+	TArray<FTypeAndOffset> SpecialInits;
+	bool Unsafe;
+	FString SourceFileName;
+};
+
+template<class T> static bool ReadArray(FBytecodeReader &r, TArray<T> &array, unsigned limit = 65535)
+{
+	uint32_t count = r.ReadInt();
+	if (r.Failed() || count > limit) return false;
+	array.Resize(count);
+	return r.Read(array.Data(), count * sizeof(T));
+}
+
+bool FBytecodeCache::Load(TArray<PPrototype *> &returnprotos)
+{
+	if (!Enabled) return false;
+
+	FileReader fr;
+	if (!fr.OpenFile(GetCacheFileName(false))) return false;
+	auto data = fr.Read();
+	FBytecodeReader r(data.Data(), data.Size());
+
+	char magic[4];
+	uint8_t key[16];
+	r.Read(magic, 4);
+	uint32_t version = r.ReadInt();
+	r.Read(key, 16);
+	if (r.Failed() || memcmp(magic, BytecodeMagic, 4) || version != BYTECODE_CACHE_VERSION || memcmp(key, Key, 16))
+	{
+		return false;
+	}
+
+	// Recreate the names first so that they get the same indices the cached code uses.
+	uint32_t numnames = r.ReadInt();
+	for (uint32_t i = 0; i < numnames && !r.Failed(); i++)
+	{
+		FName name = r.ReadString();
+		if (name.GetIndex() != NamesAtStart + (int)i) return false;
+	}
+
+	if (r.ReadInt() != Functions.Size()) return false;
+	TArray<FCachedFunction> cached(Functions.Size(), true);
+	returnprotos.Resize(Functions.Size());
+	for (unsigned i = 0; i < Functions.Size() && !r.Failed(); i++)
+	{
+		auto &cf = cached[i];
+		if (r.ReadString().Compare(Functions[i]->PrintableName) != 0) return false;
+		if (!ReadArray(r, cf.Code, 0x7fffffff) || cf.Code.Size() == 0) return false;
+		if (!ReadArray(r, cf.LineInfo) || !ReadArray(r, cf.KonstD) || !ReadArray(r, cf.KonstF)) return false;
+
+		uint32_t count = r.ReadInt();
+		if (count > 65535) return false;
+		for (uint32_t j = 0; j < count && !r.Failed(); j++)
+		{
+			cf.KonstS.Push(r.ReadString());
+		}
+		count = r.ReadInt();
+		if (count > 65535) return false;
+		cf.KonstA.Resize(count);
+		for (uint32_t j = 0; j < count; j++)
+		{
+			if (!ReadPointer(r, cf.KonstA[j])) return false;
+		}
+		cf.NumRegD = r.ReadByte();
+		cf.NumRegF = r.ReadByte();
+		cf.NumRegS = r.ReadByte();
+		cf.NumRegA = r.ReadByte();
+		cf.MaxParam = r.ReadInt();
+		cf.ExtraSpace = r.ReadInt();
+		count = r.ReadInt();
+		if (count > 65535) return false;
+		for (uint32_t j = 0; j < count && !r.Failed(); j++)
+		{
+			auto type = ReadType(r);
+			if (type == nullptr) return false;
+			cf.SpecialInits.Push(std::make_pair(type, r.ReadInt()));
+		}
+		cf.Unsafe = !!r.ReadByte();
+		cf.SourceFileName = r.ReadString();
+		returnprotos[i] = nullptr;
+		if (r.ReadByte())
+		{
+			auto proto = ReadType(r);
+			if (proto == nullptr || !proto->isPrototype()) return false;
+			returnprotos[i] = static_cast<PPrototype *>(proto);
+		}
+	}
+
+	uint32_t numwritten = r.ReadInt();
+	if (numwritten > 65535) return false;
+	TArray<PField *> written(numwritten, true);
+	for (uint32_t i = 0; i < numwritten && !r.Failed(); i++)
+	{
+		auto type = ReadType(r);
+		if (type == nullptr || !type->isContainer()) return false;
+		written[i] = dyn_cast<PField>(type->Symbols.FindSymbol(FName(r.ReadString(), true), false));
+		if (written[i] == nullptr) return false;
+	}
+
+	bool hastables = !!r.ReadByte();
+	if (r.Failed() || hastables != (compileEnvironment.CacheReadTables != nullptr)) return false;
+	if (hastables && !compileEnvironment.CacheReadTables(r)) return false;
+	if (r.Failed() || !r.AtEnd()) return false;
+
+	for (unsigned i = 0; i < Functions.Size(); i++)
+	{
+		auto func = Functions[i];
+		auto &cf = cached[i];
+		func->Alloc(cf.Code.Size(), cf.KonstD.Size(), cf.KonstF.Size(), cf.KonstS.Size(), cf.KonstA.Size(), cf.LineInfo.Size());
+		memcpy(func->Code, cf.Code.Data(), cf.Code.Size() * sizeof(VMOP));
+		if (cf.LineInfo.Size() > 0) memcpy(func->LineInfo, cf.LineInfo.Data(), cf.LineInfo.Size() * sizeof(FStatementInfo));
+		if (cf.KonstD.Size() > 0) memcpy(func->KonstD, cf.KonstD.Data(), cf.KonstD.Size() * sizeof(int));
+		if (cf.KonstF.Size() > 0) memcpy(func->KonstF, cf.KonstF.Data(), cf.KonstF.Size() * sizeof(double));
+		for (unsigned j = 0; j < cf.KonstS.Size(); j++) func->KonstS[j] = cf.KonstS[j];
+		for (unsigned j = 0; j < cf.KonstA.Size(); j++) func->KonstA[j].v = cf.KonstA[j];
+		func->NumRegD = cf.NumRegD;
+		func->NumRegF = cf.NumRegF;
+		func->NumRegS = cf.NumRegS;
+		func->NumRegA = cf.NumRegA;
+		func->MaxParam = cf.MaxParam;
+		func->ExtraSpace = cf.ExtraSpace;
+		func->SpecialInits = std::move(cf.SpecialInits);
+		func->StackSize = VMFrame::FrameSize(func->NumRegD, func->NumRegF, func->NumRegS, func->NumRegA, func->MaxParam, func->ExtraSpace);
+		func->Unsafe = cf.Unsafe;
+		func->SourceFileName = cf.SourceFileName;
+	}
+	for (auto field : written)
+	{
+		field->Flags |= VARF_ScriptWritten;
+	}
+	DPrintf(DMSG_NOTIFY, "Loaded %u script functions from the bytecode cache\n", Functions.Size());
+	return true;
+}
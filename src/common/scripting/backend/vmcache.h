@@ -0,0 +1,127 @@
+#pragma once
+
+#include "tarray.h"
+#include "zstring.h"
+
+class PType;
+class PPrototype;
+class VMFunction;
+class VMScriptFunction;
+class VMFunctionBuilder;
+
+//==========================================================================
+//
+// Raw buffers for the bytecode cache. These are also handed to the
+// game specific hooks in CompileEnvironment.
+//
+//==========================================================================
+
+class FBytecodeWriter
+{
+public:
+	TArray<uint8_t> Data;
+
+	void Write(const void *p, size_t len)
+	{
+		if (len > 0) memcpy(&Data[Data.Reserve((unsigned)len)], p, len);
+	}
+	void WriteByte(uint8_t v) { Data.Push(v); }
+	void WriteInt(uint32_t v) { Write(&v, 4); }
+	void WriteString(const char *s)
+	{
+		uint32_t len = (uint32_t)strlen(s);
+		WriteInt(len);
+		Write(s, len);
+	}
+};
+
+class FBytecodeReader
+{
+	const uint8_t *Pos;
+	const uint8_t *End;
+	bool Error = false;
+
+public:
+	FBytecodeReader(const uint8_t *data, size_t len) : Pos(data), End(data + len) {}
+
+	bool Read(void *p, size_t len)
+	{
+		if (Error || size_t(End - Pos) < len)
+		{
+			Error = true;
+			return false;
+		}
+		if (len > 0) memcpy(p, Pos, len);
+		Pos += len;
+		return true;
+	}
+	uint8_t ReadByte() { uint8_t v = 0; Read(&v, 1); return v; }
+	uint32_t ReadInt() { uint32_t v = 0; Read(&v, 4); return v; }
+	FString ReadString()
+	{
+		uint32_t len = ReadInt();
+		if (Error || size_t(End - Pos) < len)
+		{
+			Error = true;
+			return FString();
+		}
+		FString s((const char *)Pos, len);
+		Pos += len;
+		return s;
+	}
+	void Fail() { Error = true; }
+	bool Failed() const { return Error; }
+	bool AtEnd() const { return Pos == End; }
+};
+
+//==========================================================================
+//
+// FBytecodeCache
+//
+// Stores the output of the code generator for all functions of one
+// FFunctionBuildList::Build() run. Pointers in the constant tables are
+// written as symbolic references and the names and game tables that the
+// code generator extends are replayed on load, so a later launch with the
+// same scripts can skip resolving and emitting every function.
+//
+// The cache is all or nothing: if anything cannot be represented on save
+// or resolved on load, all functions get compiled normally.
+//
+//==========================================================================
+
+class FBytecodeCache
+{
+public:
+	FBytecodeCache(const TArray<int> &sourcelumps, const TArray<VMScriptFunction *> &functions);
+
+	bool Load(TArray<PPrototype *> &returnprotos);
+	void Store(VMScriptFunction *func, PPrototype *returnproto, const VMFunctionBuilder &build);
+	void Save();
+
+private:
+	bool WritePointer(FBytecodeWriter &w, void *ptr);
+	bool ReadPointer(FBytecodeReader &r, void *&ptr);
+	bool WriteType(FBytecodeWriter &w, const PType *type);
+	PType *ReadType(FBytecodeReader &r);
+	void BuildAddressMaps();
+	FString GetCacheFileName(bool create);
+
+	const TArray<VMScriptFunction *> &Functions;
+	uint8_t Key[16];
+	bool Enabled;
+	bool Writable = true;
+	unsigned StoredFunctions = 0;
+
+	// State at the start of the build. Everything beyond this was created by the code generator.
+	int NamesAtStart;
+	unsigned TypesAtStart;
+	unsigned FunctionsAtStart;
+
+	TArray<PPrototype *> ReturnProtos;
+	TMap<void *, TArray<uint8_t>> Blobs;
+	TMap<VMFunction *, unsigned> FunctionIndices;
+	TMap<PType *, unsigned> TypeIndices;
+	TMap<void *, FString> AddressNames;
+	TMap<FString, void *> NamedAddresses;
+	bool HaveAddressMaps = false;
+};
@@ -2478,6 +2478,7 @@ void FTypeTable::AddType(PType *type, FName type_name, intptr_t parm1, intptr_t
 	type->TypeTableType = type_name;
 	type->HashNext = TypeHash[bucket];
 	TypeHash[bucket] = type;
+	AllTypes.Push(type);
 }
 
 //==========================================================================
@@ -2499,6 +2500,7 @@ void FTypeTable::AddType(PType *type, FName type_name)
 
 	type->HashNext = TypeHash[bucket];
 	TypeHash[bucket] = type;
+	AllTypes.Push(type);
 }
 
 //==========================================================================
@@ -2555,6 +2557,7 @@ void FTypeTable::Clear()
 		}
 	}
 	memset(TypeHash, 0, sizeof(TypeHash));
+	AllTypes.Clear();
 }
 
 #include "c_dispatch.h"
@@ -37,6 +37,7 @@ enum
 	VARF_VirtualScope	= (1<<22),  // [ZZ] virtualscope: object should use the scope of the particular class it's being used with (methods only)
 	VARF_ClearScope		= (1<<23),  // [ZZ] clearscope: this method ignores the member access chain that leads to it and is always plain data.
 	VARF_Abstract		= (1<<24),  // [Player701] Function does not have a body and must be overridden in subclasses
+	VARF_ScriptWritten	= (1<<25),	// native field that gets modified by script code somewhere. Set by the compiler.
 };
 
 // Basic information shared by all types ------------------------------------
@@ -634,6 +635,7 @@ struct FTypeTable
 	enum { HASH_SIZE = 1021 };
 
 	PType *TypeHash[HASH_SIZE];
+	TArray<PType *> AllTypes;	// in order of creation
 
 	PType *FindType(FName type_name, intptr_t parm1, intptr_t parm2, size_t *bucketnum);
 	void AddType(PType *type, FName type_name, intptr_t parm1, intptr_t parm2, size_t bucket);
@@ -295,7 +295,7 @@ void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction
 			a &= CMP_CHECK | CMP_APPROX;
 			cmp = true;
 		}
-		if (code[i].op == OP_PARAM && code[i].a & REGT_ADDROF)
+		if ((code[i].op == OP_PARAM || code[i].op == OP_PARAM2) && code[i].a & REGT_ADDROF)
 		{
 			name = "parama";
 		}
@@ -344,6 +344,7 @@ void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction
 		}
 
 		case OP_PARAM:
+		case OP_PARAM2:
 		{
 			col = print_reg(out, col, code[i].i24 & 0xffffff, MODE_PARAM24, 16, func);
 			break;
@@ -262,6 +262,7 @@ static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void
 		pSC = &lsc;
 	}
 	FScanner &sc = *pSC;
+	FunctionBuildList.AddSourceLump(sc.LumpNum);
 	sc.SetParseVersion(state.ParseVersion);
 	state.sc = &sc;
 
@@ -13,6 +13,12 @@ void JitCompiler::EmitPARAMI()
 	ParamOpcodes.Push(pc);
 }
 
+// Superinstructions only need their first half here, the second instruction gets compiled on its own.
+void JitCompiler::EmitPARAM2()
+{
+	EmitPARAM();
+}
+
 void JitCompiler::EmitRESULT()
 {
 	// This instruction is just a placeholder to indicate where a return
@@ -212,7 +218,7 @@ void JitCompiler::LoadInOuts()
 	for (unsigned int i = 0; i < ParamOpcodes.Size(); i++)
 	{
 		const VMOP &param = *ParamOpcodes[i];
-		if (param.op == OP_PARAM && (param.a & REGT_ADDROF))
+		if ((param.op == OP_PARAM || param.op == OP_PARAM2) && (param.a & REGT_ADDROF))
 		{
 			LoadCallResult(param.a, param.i16u, true);
 		}
@@ -184,6 +184,11 @@ void JitCompiler::EmitLDP_R()
 	cc.movsd(regF[A], asmjit::x86::qword_ptr(regA[B], regD[C]));
 }
 
+void JitCompiler::EmitLDP2()
+{
+	EmitLDP();
+}
+
 void JitCompiler::EmitLS()
 {
 	EmitNullPointerThrow(B, X_READ_NIL);
@@ -275,6 +280,11 @@ void JitCompiler::EmitLO_R()
 
 #endif
 
+void JitCompiler::EmitLO_EQA()
+{
+	EmitLO();
+}
+
 void JitCompiler::EmitLP()
 {
 	EmitNullPointerThrow(B, X_READ_NIL);
@@ -0,0 +1,278 @@
+/*
+** vmbench.cpp
+** Micro benchmark for the VM interpreter's dispatch
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The kernels are assembled directly with VMFunctionBuilder and mimic the
+** code the compiler generates for typical action functions: member field
+** math, null checks on object pointers and calls with several arguments.
+** Each one runs with the computed goto and the switch dispatcher, with and
+** without superinstructions.
+**
+*/
+
+#include <algorithm>
+#include "vmintern.h"
+#include "types.h"
+#include "vmbuilder.h"
+#include "c_dispatch.h"
+#include "printf.h"
+#include "i_time.h"
+#include "cmdlib.h"
+
+// Stand-in for the actor fields the kernels work on.
+struct FBenchActor
+{
+	double X, VelX;
+	double Angle, AngleSpeed;
+	DObject *Target;
+	int Health;
+	int Flags;
+	double Result;
+};
+
+static const uint8_t BenchCalleeRegs[] = { REGT_POINTER, REGT_INT, REGT_FLOAT };
+static const uint8_t BenchKernelRegs[] = { REGT_POINTER, REGT_INT };
+
+//==========================================================================
+//
+// Emits the loop counter decrement and the backwards jump.
+//
+//==========================================================================
+
+static void EmitLoopEnd(VMFunctionBuilder &build, int counter, size_t loopstart)
+{
+	build.Emit(OP_ADDI, counter, counter, -1 & 255);
+	build.Emit(OP_EQ_K, 0, counter, build.GetConstantInt(0));
+	build.Backpatch(build.Emit(OP_JMP, 0), loopstart);
+	build.Emit(OP_RET, RET_FINAL, REGT_NIL, 0);
+}
+
+static VMScriptFunction *FinishKernel(VMFunctionBuilder &build, const char *name, const uint8_t *regtypes, int numargs, bool fuse)
+{
+	auto func = new VMScriptFunction;
+	func->PrintableName = name;
+	build.MakeFunction(func);
+	func->RegTypes = regtypes;
+	func->NumArgs = numargs;
+	if (fuse) VMFuseInstructions(func->Code, func->CodeSize);
+	return func;
+}
+
+// self.X += self.VelX; self.Angle += self.AngleSpeed * 0.5;
+static VMScriptFunction *BuildMovementKernel(bool fuse)
+{
+	VMFunctionBuilder build(0);
+	int self = build.Registers[REGT_POINTER].Get(1);
+	int count = build.Registers[REGT_INT].Get(1);
+	int f = build.Registers[REGT_FLOAT].Get(4);
+
+	size_t loopstart = build.GetAddress();
+	build.Emit(OP_LDP, f, self, build.GetConstantInt(myoffsetof(FBenchActor, X)));
+	build.Emit(OP_LDP, f + 1, self, build.GetConstantInt(myoffsetof(FBenchActor, VelX)));
+	build.Emit(OP_ADDF_RR, f, f, f + 1);
+	build.Emit(OP_SDP, self, f, build.GetConstantInt(myoffsetof(FBenchActor, X)));
+	build.Emit(OP_LDP, f + 2, self, build.GetConstantInt(myoffsetof(FBenchActor, Angle)));
+	build.Emit(OP_LDP, f + 3, self, build.GetConstantInt(myoffsetof(FBenchActor, AngleSpeed)));
+	build.Emit(OP_MULF_RK, f + 3, f + 3, build.GetConstantFloat(0.5));
+	build.Emit(OP_ADDF_RR, f + 2, f + 2, f + 3);
+	build.Emit(OP_SDP, self, f + 2, build.GetConstantInt(myoffsetof(FBenchActor, Angle)));
+	EmitLoopEnd(build, count, loopstart);
+	return FinishKernel(build, "Bench.Movement", BenchKernelRegs, 2, fuse);
+}
+
+// if (self.Target != null) self.Health--; else self.Health = (self.Health + 1) & 255; if (self.Flags & 4) self.Flags ^= 1;
+static VMScriptFunction *BuildLogicKernel(bool fuse)
+{
+	VMFunctionBuilder build(0);
+	int self = build.Registers[REGT_POINTER].Get(1);
+	int count = build.Registers[REGT_INT].Get(1);
+	int target = build.Registers[REGT_POINTER].Get(1);
+	int d = build.Registers[REGT_INT].Get(2);
+
+	size_t loopstart = build.GetAddress();
+	build.Emit(OP_LO, target, self, build.GetConstantInt(myoffsetof(FBenchActor, Target)));
+	build.Emit(OP_EQA_K, 1, target, build.GetConstantAddress(nullptr));
+	size_t isnull = build.Emit(OP_JMP, 0);
+	build.Emit(OP_LW, d, self, build.GetConstantInt(myoffsetof(FBenchActor, Health)));
+	build.Emit(OP_ADDI, d, d, -1 & 255);
+	build.Emit(OP_SW, self, d, build.GetConstantInt(myoffsetof(FBenchActor, Health)));
+	size_t done = build.Emit(OP_JMP, 0);
+	build.BackpatchToHere(isnull);
+	build.Emit(OP_LW, d, self, build.GetConstantInt(myoffsetof(FBenchActor, Health)));
+	build.Emit(OP_ADDI, d, d, 1);
+	build.Emit(OP_AND_RK, d, d, build.GetConstantInt(255));
+	build.Emit(OP_SW, self, d, build.GetConstantInt(myoffsetof(FBenchActor, Health)));
+	build.BackpatchToHere(done);
+	build.Emit(OP_LW, d + 1, self, build.GetConstantInt(myoffsetof(FBenchActor, Flags)));
+	build.Emit(OP_AND_RK, d, d + 1, build.GetConstantInt(4));
+	build.Emit(OP_EQ_K, 1, d, build.GetConstantInt(0));
+	size_t noflag = build.Emit(OP_JMP, 0);
+	build.Emit(OP_XOR_RK, d + 1, d + 1, build.GetConstantInt(1));
+	build.Emit(OP_SW, self, d + 1, build.GetConstantInt(myoffsetof(FBenchActor, Flags)));
+	build.BackpatchToHere(noflag);
+	EmitLoopEnd(build, count, loopstart);
+	return FinishKernel(build, "Bench.Logic", BenchKernelRegs, 2, fuse);
+}
+
+// Callee(self, count, 0.25); with Callee storing into self.Result
+static VMScriptFunction *BuildCallKernel(bool fuse, VMScriptFunction *&callee)
+{
+	{
+		VMFunctionBuilder build(0);
+		int self = build.Registers[REGT_POINTER].Get(1);
+		build.Registers[REGT_INT].Get(1);
+		int f = build.Registers[REGT_FLOAT].Get(1);
+		build.Emit(OP_SDP, self, f, build.GetConstantInt(myoffsetof(FBenchActor, Result)));
+		build.Emit(OP_RET, RET_FINAL, REGT_NIL, 0);
+		callee = FinishKernel(build, "Bench.Callee", BenchCalleeRegs, 3, fuse);
+	}
+
+	VMFunctionBuilder build(0);
+	int self = build.Registers[REGT_POINTER].Get(1);
+	int count = build.Registers[REGT_INT].Get(1);
+
+	size_t loopstart = build.GetAddress();
+	build.Emit(OP_PARAM, REGT_POINTER, self);
+	build.Emit(OP_PARAM, REGT_INT, count);
+	build.Emit(OP_PARAM, REGT_FLOAT | REGT_KONST, build.GetConstantFloat(0.25));
+	build.Emit(OP_CALL_K, build.GetConstantAddress(callee), 3, 0);
+	EmitLoopEnd(build, count, loopstart);
+	return FinishKernel(build, "Bench.Calls", BenchKernelRegs, 2, fuse);
+}
+
+//==========================================================================
+//
+// vm_dispatchbench [iterations]
+//
+//==========================================================================
+
+CCMD(vm_dispatchbench)
+{
+	struct FKernel
+	{
+		const char *Name;
+		VMScriptFunction *Func[2];
+		VMScriptFunction *Callee[2];
+	};
+	static FKernel kernels[3];
+	if (kernels[0].Name == nullptr || VMFunction::AllFunctions.Find(kernels[0].Func[0]) == VMFunction::AllFunctions.Size())
+	{
+		// Keep the kernels around until the VM gets reset instead of creating new ones each time.
+		kernels[0] = { "movement" };
+		kernels[1] = { "logic" };
+		kernels[2] = { "calls" };
+		for (int fuse = 0; fuse < 2; fuse++)
+		{
+			kernels[0].Func[fuse] = BuildMovementKernel(!!fuse);
+			kernels[1].Func[fuse] = BuildLogicKernel(!!fuse);
+			kernels[2].Func[fuse] = BuildCallKernel(!!fuse, kernels[2].Callee[fuse]);
+		}
+	}
+
+	int iterations = argv.argc() > 1 ? atoi(argv[1]) : 1000000;
+	if (iterations <= 0) iterations = 1000000;
+
+	struct FEngine
+	{
+		const char *Name;
+		EVMEngine Engine;
+	};
+	static const FEngine engines[] = { { "threaded", VMEngine_Default }, { "switch", VMEngine_Switch } };
+
+	auto savedexec = VMExec;
+	FBenchActor actor = {};
+	actor.VelX = 1;
+	actor.AngleSpeed = 2;
+
+	Printf("VM dispatch, %d iterations, ns per iteration:\n", iterations);
+	Printf("%-10s %12s %12s %12s %12s\n", "kernel", "threaded", "+fused", "switch", "+fused");
+	for (auto &kernel : kernels)
+	{
+		double times[4];
+		int col = 0;
+		for (auto &engine : engines)
+		{
+			VMSelectEngine(engine.Engine);
+			for (int fuse = 0; fuse < 2; fuse++)
+			{
+				auto func = kernel.Func[fuse];
+				func->ScriptCall = VMExec;
+				if (kernel.Callee[fuse] != nullptr) kernel.Callee[fuse]->ScriptCall = VMExec;
+
+				VMValue params[] = { &actor, iterations };
+				VMExec(func, params, 2, nullptr, 0);	// warm up
+				uint64_t start = I_nsTime();
+				VMExec(func, params, 2, nullptr, 0);
+				times[col++] = double(I_nsTime() - start) / iterations;
+			}
+		}
+		Printf("%-10s %12.2f %12.2f %12.2f %12.2f\n", kernel.Name, times[0], times[1], times[2], times[3]);
+	}
+	VMExec = savedexec;
+}
+
+//==========================================================================
+//
+// vm_oppairs [count]
+//
+// Lists the most common adjacent opcode pairs in all compiled script
+// functions, to check which pairs are worth a superinstruction.
+//
+//==========================================================================
+
+CCMD(vm_oppairs)
+{
+	TMap<uint32_t, unsigned> pairs;
+	for (auto func : VMFunction::AllFunctions)
+	{
+		if (func->VarFlags & VARF_Native) continue;
+		auto sfunc = static_cast<VMScriptFunction *>(func);
+		for (int i = 0; i < sfunc->CodeSize - 1; i++)
+		{
+			pairs[(sfunc->Code[i].op << 8) | sfunc->Code[i + 1].op]++;
+		}
+	}
+
+	TArray<std::pair<uint32_t, unsigned>> sorted;
+	TMap<uint32_t, unsigned>::Iterator it(pairs);
+	TMap<uint32_t, unsigned>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		sorted.Push(std::make_pair(pair->Key, pair->Value));
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+	unsigned count = argv.argc() > 1 ? (unsigned)atoi(argv[1]) : 20;
+	for (unsigned i = 0; i < sorted.Size() && i < count; i++)
+	{
+		Printf("%8u %s %s\n", sorted[i].second, OpInfo[sorted[i].first >> 8].Name, OpInfo[sorted[i].first & 255].Name);
+	}
+}
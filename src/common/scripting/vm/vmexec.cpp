@@ -39,14 +39,19 @@
 //#include "r_state.h"
 #include "stats.h"
 #include "vmintern.h"
+#include "vmprofiler.h"
 #include "types.h"
 #include "basics.h"
 #include "texturemanager.h"
 #include "palutil.h"
+#include "c_cvars.h"
 
 extern cycle_t VMCycles[10];
 extern int VMCalls[10];
 
+// Takes effect the next time the scripts get compiled.
+CVAR(Bool, vm_superinstructions, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 // THe sprite ID to string cast is game specific so let's do it with a callback to remove the dependency and allow easier reuse.
 void (*VM_CastSpriteIDToString)(FString* a, unsigned int b) = [](FString* a, unsigned int b) { a->Format("%d", b); };
 
@@ -69,6 +74,10 @@ void ThrowVMException(VMException *x);
 #define NEXTOP	pc++; break
 #endif
 
+// Hooks for the profiling interpreter
+#define VMPROFILE_OP(op)		(void)0
+#define VMPROFILE_NATIVE(func)
+
 #define luai_nummod(a,b)        ((a) - floor((a)/(b))*(b))
 
 #define A				(pc[0].a)
@@ -142,6 +151,49 @@ struct VMExec_Unchecked
 #undef assert
 #include <assert.h>
 
+#if COMPGOTO
+// Also build the interpreter with switch based dispatch so that both methods can be compared on the same binary.
+#undef COMPGOTO
+#undef OP
+#undef NEXTOP
+#define COMPGOTO 0
+#define OP(x)	case OP_##x
+#define NEXTOP	pc++; break
+struct VMExec_Switch
+{
+#include "vmexec.h"
+};
+#define HAVE_VMEXEC_SWITCH
+#endif
+
+// Instrumented interpreter for the VM profiler.
+#undef COMPGOTO
+#undef OP
+#undef NEXTOP
+#undef VMPROFILE_OP
+#undef VMPROFILE_NATIVE
+#ifdef HAVE_VMEXEC_SWITCH
+#define COMPGOTO 1
+#define OP(x)	x
+#define NEXTOP	do { pc++; unsigned op = pc->op; a = pc->a; VMOpCounts[op]++; goto *ops[op]; } while(0)
+#else
+#define COMPGOTO 0
+#define OP(x)	case OP_##x
+#define NEXTOP	pc++; break
+#endif
+#define VMPROFILE_OP(op)		VMOpCounts[op]++
+#define VMPROFILE_NATIVE(func)	FVMProfileScope profilescope(func)
+struct VMExec_Profiled
+{
+#include "vmexec.h"
+};
+
+int VMProfiledExec(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret)
+{
+	FVMProfileScope profilescope(func);
+	return VMExec_Profiled::Exec(func, params, numparams, ret, numret);
+}
+
 int (*VMExec)(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret) =
 #ifdef NDEBUG
 VMExec_Unchecked::Exec
@@ -182,6 +234,44 @@ void VMSelectEngine(EVMEngine engine)
 	case VMEngine_Checked:
 		VMExec = VMExec_Checked::Exec;
 		break;
+	case VMEngine_Switch:
+#ifdef HAVE_VMEXEC_SWITCH
+		VMExec = VMExec_Switch::Exec;
+#else
+		VMSelectEngine(VMEngine_Default);	// the default engine already uses a switch.
+#endif
+		break;
+	}
+}
+
+//===========================================================================
+//
+// VMFuseInstructions
+//
+// Replaces the first instruction of frequent pairs with a superinstruction
+// that executes both. Since the second instruction stays where it is, jumps
+// into the middle of a pair keep working and no offsets need adjusting.
+// Only for the interpreter, the JIT compiles each instruction on its own.
+//
+//===========================================================================
+
+void VMFuseInstructions(VMOP *code, int codesize)
+{
+	for (int i = 0; i < codesize - 1; i++)
+	{
+		int next = code[i + 1].op;
+		switch (code[i].op)
+		{
+		case OP_PARAM:
+			if (next == OP_PARAM) code[i].op = OP_PARAM2;
+			break;
+		case OP_LDP:
+			if (next == OP_LDP) code[i].op = OP_LDP2;
+			break;
+		case OP_LO:
+			if (next == OP_EQA_K) code[i].op = OP_LO_EQA;
+			break;
+		}
 	}
 }
 
@@ -70,7 +70,7 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 	{
 #if !COMPGOTO
 	VM_UBYTE op;
-	for(;;) switch(op = pc->op, a = pc->a, op)
+	for(;;) switch(op = pc->op, a = pc->a, VMPROFILE_OP(op), op)
 #else
 	pc--;
 	NEXTOP;
@@ -570,87 +570,12 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 		}
 		NEXTOP;
 	OP(PARAM):
-		assert(f->NumParam < sfunc->MaxParam);
-		{
-			VMValue *param = &reg.param[f->NumParam++];
-			b = BC;
-			if (a == REGT_NIL)
-			{
-				::new(param) VMValue();
-			}
-			else
-			{
-				switch(a)
-				{
-				case REGT_INT:
-					assert(b < f->NumRegD);
-					::new(param) VMValue(reg.d[b]);
-					break;
-				case REGT_INT | REGT_ADDROF:
-					assert(b < f->NumRegD);
-					::new(param) VMValue(&reg.d[b]);
-					break;
-				case REGT_INT | REGT_KONST:
-					assert(b < sfunc->NumKonstD);
-					::new(param) VMValue(konstd[b]);
-					break;
-				case REGT_STRING:
-					assert(b < f->NumRegS);
-					::new(param) VMValue(&reg.s[b]);
-					break;
-				case REGT_STRING | REGT_ADDROF:
-					assert(b < f->NumRegS);
-					::new(param) VMValue((void*)&reg.s[b]);	// Note that this may not use the FString* version of the constructor!
-					break;
-				case REGT_STRING | REGT_KONST:
-					assert(b < sfunc->NumKonstS);
-					::new(param) VMValue(&konsts[b]);
-					break;
-				case REGT_POINTER:
-					assert(b < f->NumRegA);
-					::new(param) VMValue(reg.a[b]);
-					break;
-				case REGT_POINTER | REGT_ADDROF:
-					assert(b < f->NumRegA);
-					::new(param) VMValue(&reg.a[b]);
-					break;
-				case REGT_POINTER | REGT_KONST:
-					assert(b < sfunc->NumKonstA);
-					::new(param) VMValue(konsta[b].v);
-					break;
-				case REGT_FLOAT:
-					assert(b < f->NumRegF);
-					::new(param) VMValue(reg.f[b]);
-					break;
-				case REGT_FLOAT | REGT_MULTIREG2:
-					assert(b < f->NumRegF - 1);
-					assert(f->NumParam < sfunc->MaxParam);
-					::new(param) VMValue(reg.f[b]);
-					::new(param + 1) VMValue(reg.f[b + 1]);
-					f->NumParam++;
-					break;
-				case REGT_FLOAT | REGT_MULTIREG3:
-					assert(b < f->NumRegF - 2);
-					assert(f->NumParam < sfunc->MaxParam - 1);
-					::new(param) VMValue(reg.f[b]);
-					::new(param + 1) VMValue(reg.f[b + 1]);
-					::new(param + 2) VMValue(reg.f[b + 2]);
-					f->NumParam += 2;
-					break;
-				case REGT_FLOAT | REGT_ADDROF:
-					assert(b < f->NumRegF);
-					::new(param) VMValue(&reg.f[b]);
-					break;
-				case REGT_FLOAT | REGT_KONST:
-					assert(b < sfunc->NumKonstF);
-					::new(param) VMValue(konstf[b]);
-					break;
-				default:
-					assert(0);
-					break;
-				}
-			}
-		}
+		PushParam(reg, f, a, BC);
+		NEXTOP;
+	OP(PARAM2):
+		PushParam(reg, f, a, BC);
+		pc++;
+		PushParam(reg, f, pc->a, BC);
 		NEXTOP;
 	OP(VTBL):
 		ASSERTA(a); ASSERTA(B);
@@ -698,6 +623,7 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 			FillReturns(reg, f, returns, pc+1, C);
 			if (call->VarFlags & VARF_Native)
 			{
+				VMPROFILE_NATIVE(call);
 				try
 				{
 					VMCycles[0].Unclock();
@@ -1645,6 +1571,28 @@ static int ExecScriptFunc(VMFrameStack *stack, VMReturn *ret, int numret)
 		CMPJMP(reg.a[B] == konsta[C].v);
 		NEXTOP;
 
+	// Superinstructions. These replace the first instruction of a pair and
+	// execute both, the second instruction is left in place as a jump target.
+	OP(LDP2):
+		ASSERTF(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		reg.f[a] = *(double *)ptr;
+		pc++;
+		a = pc->a;
+		ASSERTF(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		reg.f[a] = *(double *)ptr;
+		NEXTOP;
+	OP(LO_EQA):
+		ASSERTA(a); ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		reg.a[a] = GC::ReadBarrier(*(DObject **)ptr);
+		pc++;
+		a = pc->a;
+		ASSERTA(B); ASSERTKA(C);
+		CMPJMP(reg.a[B] == konsta[C].v);
+		NEXTOP;
+
 	OP(NOP):
 		NEXTOP;
 	}
@@ -1862,6 +1810,97 @@ static void DoCast(const VMRegisters &reg, const VMFrame *f, int a, int b, int c
 	}
 }
 
+//===========================================================================
+//
+// PushParam
+//
+// Pushes the parameter encoded in a PARAM instruction's A and BC fields.
+//
+//===========================================================================
+
+static void PushParam(const VMRegisters &reg, VMFrame *f, int a, int b)
+{
+	auto sfunc = static_cast<VMScriptFunction *>(f->Func);
+	assert(f->NumParam < sfunc->MaxParam);
+	VMValue *param = &reg.param[f->NumParam++];
+	if (a == REGT_NIL)
+	{
+		::new(param) VMValue();
+	}
+	else
+	{
+		switch(a)
+		{
+		case REGT_INT:
+			assert(b < f->NumRegD);
+			::new(param) VMValue(reg.d[b]);
+			break;
+		case REGT_INT | REGT_ADDROF:
+			assert(b < f->NumRegD);
+			::new(param) VMValue(&reg.d[b]);
+			break;
+		case REGT_INT | REGT_KONST:
+			assert(b < sfunc->NumKonstD);
+			::new(param) VMValue(sfunc->KonstD[b]);
+			break;
+		case REGT_STRING:
+			assert(b < f->NumRegS);
+			::new(param) VMValue(&reg.s[b]);
+			break;
+		case REGT_STRING | REGT_ADDROF:
+			assert(b < f->NumRegS);
+			::new(param) VMValue((void*)&reg.s[b]);	// Note that this may not use the FString* version of the constructor!
+			break;
+		case REGT_STRING | REGT_KONST:
+			assert(b < sfunc->NumKonstS);
+			::new(param) VMValue(&sfunc->KonstS[b]);
+			break;
+		case REGT_POINTER:
+			assert(b < f->NumRegA);
+			::new(param) VMValue(reg.a[b]);
+			break;
+		case REGT_POINTER | REGT_ADDROF:
+			assert(b < f->NumRegA);
+			::new(param) VMValue(&reg.a[b]);
+			break;
+		case REGT_POINTER | REGT_KONST:
+			assert(b < sfunc->NumKonstA);
+			::new(param) VMValue(sfunc->KonstA[b].v);
+			break;
+		case REGT_FLOAT:
+			assert(b < f->NumRegF);
+			::new(param) VMValue(reg.f[b]);
+			break;
+		case REGT_FLOAT | REGT_MULTIREG2:
+			assert(b < f->NumRegF - 1);
+			assert(f->NumParam < sfunc->MaxParam);
+			::new(param) VMValue(reg.f[b]);
+			::new(param + 1) VMValue(reg.f[b + 1]);
+			f->NumParam++;
+			break;
+		case REGT_FLOAT | REGT_MULTIREG3:
+			assert(b < f->NumRegF - 2);
+			assert(f->NumParam < sfunc->MaxParam - 1);
+			::new(param) VMValue(reg.f[b]);
+			::new(param + 1) VMValue(reg.f[b + 1]);
+			::new(param + 2) VMValue(reg.f[b + 2]);
+			f->NumParam += 2;
+			break;
+		case REGT_FLOAT | REGT_ADDROF:
+			assert(b < f->NumRegF);
+			::new(param) VMValue(&reg.f[b]);
+			break;
+		case REGT_FLOAT | REGT_KONST:
+			assert(b < sfunc->NumKonstF);
+			::new(param) VMValue(sfunc->KonstF[b]);
+			break;
+		default:
+			assert(0);
+			break;
+		}
+	}
+}
+
 //===========================================================================
 //
 // FillReturns
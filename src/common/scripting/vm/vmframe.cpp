@@ -780,7 +780,12 @@ CCMD(vmengine)
 			VMSelectEngine(VMEngine_Unchecked);
 			return;
 		}
+		else if (stricmp(argv[1], "switch") == 0)
+		{
+			VMSelectEngine(VMEngine_Switch);
+			return;
+		}
 	}
-	Printf("Usage: vmengine <default|checked|unchecked>\n");
+	Printf("Usage: vmengine <default|checked|unchecked|switch>\n");
 }
 
@@ -427,10 +427,12 @@ enum EVMEngine
 {
 	VMEngine_Default,
 	VMEngine_Unchecked,
-	VMEngine_Checked
+	VMEngine_Checked,
+	VMEngine_Switch		// default interpreter with switch instead of computed goto dispatch, for comparison
 };
 
 void VMSelectEngine(EVMEngine engine);
+void VMFuseInstructions(VMOP *code, int codesize);
 extern int (*VMExec)(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
 void VMFillParams(VMValue *params, VMFrame *callee, int numparam);
 
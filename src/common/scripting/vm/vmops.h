@@ -255,4 +255,10 @@ xx(SUBA,		sub,	RIRPRP,		NOP,	0, 0)		// dA = pB - pC
 xx(EQA_R,		beq,	CPRR,		NOP,	0, 0)			// if ((pB == pkC) != A) then pc++
 xx(EQA_K,		beq,	CPRK,		EQA_R,	4, REGT_POINTER)
 
+// Superinstructions. Only created by VMFunctionBuilder::MakeFunction for the interpreter, never emitted directly.
+// They occupy the first slot of the pair they replace, the second instruction stays in the code.
+xx(PARAM2,		param2,	__BCP,		NOP,	0, 0)		// PARAM followed by PARAM
+xx(LDP2,		ldp2,	RFRPKI,		NOP,	0, 0)		// LDP followed by LDP
+xx(LO_EQA,		lo_eqa,	RPRPKI,		NOP,	0, 0)		// LO followed by EQA_K
+
 #undef xx
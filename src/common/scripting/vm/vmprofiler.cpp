@@ -0,0 +1,323 @@
+/*
+** vmprofiler.cpp
+** Function and instruction level profiling for the script VM
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Starting the profiler redirects every script function to the
+** instrumented interpreter, which also takes JIT compiled code out of the
+** picture, so the numbers are interpreter numbers. Times include the
+** profiler's own overhead.
+**
+** Call times are collected into a tree of call paths. Every node keeps
+** the exclusive time spent in it, which is exactly what the folded stack
+** format used by flamegraph.pl and speedscope wants.
+**
+*/
+
+#include <algorithm>
+#include <thread>
+#include "vmprofiler.h"
+#include "types.h"
+#include "c_dispatch.h"
+#include "printf.h"
+#include "v_text.h"
+#include "i_time.h"
+#include "files.h"
+
+thread_local uint64_t VMOpCounts[NUM_OPS];
+
+struct FVMFunctionProfile
+{
+	uint64_t Calls = 0;
+	uint64_t Inclusive = 0;
+	uint64_t Exclusive = 0;
+	int Depth = 0;		// for not counting the inclusive time of recursive calls twice
+};
+
+struct FVMCallNode
+{
+	VMFunction *Func;
+	unsigned Parent;
+	uint64_t Exclusive;
+};
+
+struct FVMProfileFrame
+{
+	VMFunction *Func;
+	unsigned Node;
+	uint64_t Start;
+	uint64_t ChildTime;
+};
+
+static struct FVMProfiler
+{
+	bool Active = false;
+	std::thread::id Owner;
+	uint64_t StartTime, StopTime;
+
+	TMap<VMFunction *, FVMFunctionProfile> Functions;
+	TArray<FVMCallNode> Nodes;
+	TMap<uint64_t, unsigned> NodeLookup;
+	TMap<VMFunction *, unsigned> FunctionIds;
+	TArray<FVMProfileFrame> Stack;
+	TMap<VMFunction *, decltype(VMFunction::ScriptCall)> SavedCalls;
+
+	unsigned GetNode(unsigned parent, VMFunction *func)
+	{
+		unsigned *id = FunctionIds.CheckKey(func);
+		if (id == nullptr) id = &FunctionIds.Insert(func, FunctionIds.CountUsed());
+		uint64_t key = (uint64_t(parent) << 32) | *id;
+		unsigned *node = NodeLookup.CheckKey(key);
+		if (node != nullptr) return *node;
+		unsigned index = Nodes.Push({ func, parent, 0 });
+		NodeLookup.Insert(key, index);
+		return index;
+	}
+
+	void Reset()
+	{
+		Functions.Clear();
+		Nodes.Clear();
+		NodeLookup.Clear();
+		FunctionIds.Clear();
+		Stack.Clear();
+		memset(VMOpCounts, 0, sizeof(VMOpCounts));
+		Nodes.Push({ nullptr, 0, 0 });	// root
+	}
+} Profiler;
+
+//==========================================================================
+//
+// FVMProfileScope
+//
+//==========================================================================
+
+FVMProfileScope::FVMProfileScope(VMFunction *func)
+{
+	Recording = Profiler.Active && std::this_thread::get_id() == Profiler.Owner;
+	if (Recording)
+	{
+		unsigned parent = Profiler.Stack.Size() > 0 ? Profiler.Stack.Last().Node : 0;
+		Profiler.Stack.Push({ func, Profiler.GetNode(parent, func), I_nsTime(), 0 });
+		Profiler.Functions[func].Depth++;
+	}
+}
+
+FVMProfileScope::~FVMProfileScope()
+{
+	// The profiler may have been restarted from inside the call.
+	if (!Recording || Profiler.Stack.Size() == 0) return;
+
+	FVMProfileFrame frame;
+	Profiler.Stack.Pop(frame);
+	uint64_t total = I_nsTime() - frame.Start;
+	uint64_t self = total > frame.ChildTime ? total - frame.ChildTime : 0;
+
+	auto &stats = Profiler.Functions[frame.Func];
+	stats.Calls++;
+	stats.Exclusive += self;
+	if (--stats.Depth <= 0)
+	{
+		stats.Depth = 0;
+		stats.Inclusive += total;
+	}
+	Profiler.Nodes[frame.Node].Exclusive += self;
+	if (Profiler.Stack.Size() > 0) Profiler.Stack.Last().ChildTime += total;
+}
+
+//==========================================================================
+//
+// Switching all script functions to the instrumented interpreter
+//
+//==========================================================================
+
+static void StartProfiling()
+{
+	if (!Profiler.Active)
+	{
+		for (auto func : VMFunction::AllFunctions)
+		{
+			if (func->VarFlags & VARF_Native) continue;
+			Profiler.SavedCalls.Insert(func, func->ScriptCall);
+			func->ScriptCall = VMProfiledExec;
+		}
+	}
+	Profiler.Reset();
+	Profiler.Owner = std::this_thread::get_id();
+	Profiler.StartTime = I_nsTime();
+	Profiler.Active = true;
+}
+
+static void StopProfiling()
+{
+	if (!Profiler.Active) return;
+
+	TMap<VMFunction *, decltype(VMFunction::ScriptCall)>::Iterator it(Profiler.SavedCalls);
+	TMap<VMFunction *, decltype(VMFunction::ScriptCall)>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		pair->Key->ScriptCall = pair->Value;
+	}
+	Profiler.SavedCalls.Clear();
+	Profiler.StopTime = I_nsTime();
+	Profiler.Active = false;
+}
+
+//==========================================================================
+//
+// Reports
+//
+//==========================================================================
+
+static void PrintFunctions(unsigned limit, bool byinclusive)
+{
+	struct FSorted
+	{
+		VMFunction *Func;
+		const FVMFunctionProfile *Stats;
+	};
+	TArray<FSorted> sorted;
+	TMap<VMFunction *, FVMFunctionProfile>::ConstIterator it(Profiler.Functions);
+	TMap<VMFunction *, FVMFunctionProfile>::ConstPair *pair;
+	while (it.NextPair(pair))
+	{
+		if (pair->Value.Calls > 0) sorted.Push({ pair->Key, &pair->Value });
+	}
+	std::sort(sorted.begin(), sorted.end(), [=](const FSorted &left, const FSorted &right)
+	{
+		return byinclusive ? left.Stats->Inclusive > right.Stats->Inclusive : left.Stats->Exclusive > right.Stats->Exclusive;
+	});
+
+	uint64_t end = Profiler.Active ? I_nsTime() : Profiler.StopTime;
+	Printf(TEXTCOLOR_YELLOW "VM profile over %.1f ms\n", (end - Profiler.StartTime) / 1e6);
+	Printf(TEXTCOLOR_YELLOW "Excl, ms    Incl, ms    Calls     Function\n");
+	Printf(TEXTCOLOR_YELLOW "----------  ----------  --------  --------------------\n");
+	for (unsigned i = 0; i < sorted.Size() && i < limit; i++)
+	{
+		auto &s = *sorted[i].Stats;
+		Printf("%10.3f  %10.3f  %8llu  %s%s\n", s.Exclusive / 1e6, s.Inclusive / 1e6, (unsigned long long)s.Calls,
+			(sorted[i].Func->VarFlags & VARF_Native) ? TEXTCOLOR_GRAY : "", sorted[i].Func->PrintableName.GetChars());
+	}
+}
+
+static void PrintOpcodes(unsigned limit)
+{
+	TArray<int> ops;
+	uint64_t total = 0;
+	for (int i = 0; i < NUM_OPS; i++)
+	{
+		if (VMOpCounts[i] > 0) ops.Push(i);
+		total += VMOpCounts[i];
+	}
+	std::sort(ops.begin(), ops.end(), [](int left, int right) { return VMOpCounts[left] > VMOpCounts[right]; });
+
+	Printf(TEXTCOLOR_YELLOW "%llu instructions executed\n", (unsigned long long)total);
+	Printf(TEXTCOLOR_YELLOW "Count         %%       Opcode\n");
+	Printf(TEXTCOLOR_YELLOW "------------  ------  --------\n");
+	for (unsigned i = 0; i < ops.Size() && i < limit; i++)
+	{
+		Printf("%12llu  %6.2f  %s\n", (unsigned long long)VMOpCounts[ops[i]], VMOpCounts[ops[i]] * 100. / total, OpInfo[ops[i]].Name);
+	}
+}
+
+// One line per call path: "outer;inner;innermost <microseconds>"
+static bool WriteFoldedStacks(const char *filename)
+{
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(filename));
+	if (fw == nullptr) return false;
+
+	TArray<const char *> path;
+	for (unsigned i = 1; i < Profiler.Nodes.Size(); i++)
+	{
+		uint64_t us = Profiler.Nodes[i].Exclusive / 1000;
+		if (us == 0) continue;
+
+		path.Clear();
+		for (unsigned n = i; n != 0; n = Profiler.Nodes[n].Parent)
+		{
+			path.Push(Profiler.Nodes[n].Func->PrintableName.GetChars());
+		}
+		FString line;
+		for (int j = path.Size() - 1; j >= 0; j--)
+		{
+			line << path[j] << (j > 0 ? ";" : "");
+		}
+		line.AppendFormat(" %llu\n", (unsigned long long)us);
+		fw->Write(line.GetChars(), line.Len());
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// vmprofile start|stop|report [count] [incl]|ops [count]|folded [file]
+//
+//==========================================================================
+
+CCMD(vmprofile)
+{
+	if (argv.argc() >= 2)
+	{
+		const char *cmd = argv[1];
+		unsigned limit = argv.argc() >= 3 ? (unsigned)atoi(argv[2]) : 30;
+		if (limit == 0) limit = UINT_MAX;
+
+		if (!stricmp(cmd, "start"))
+		{
+			StartProfiling();
+			Printf("VM profiling started\n");
+			return;
+		}
+		else if (!stricmp(cmd, "stop"))
+		{
+			StopProfiling();
+			PrintFunctions(limit, false);
+			return;
+		}
+		else if (!stricmp(cmd, "report"))
+		{
+			PrintFunctions(limit, argv.argc() >= 4 && !stricmp(argv[3], "incl"));
+			return;
+		}
+		else if (!stricmp(cmd, "ops"))
+		{
+			PrintOpcodes(limit);
+			return;
+		}
+		else if (!stricmp(cmd, "folded"))
+		{
+			const char *filename = argv.argc() >= 3 ? argv[2] : "vmprofile.folded";
+			if (WriteFoldedStacks(filename)) Printf("Folded stacks written to %s\n", filename);
+			else Printf("Could not write %s\n", filename);
+			return;
+		}
+	}
+	Printf("Usage: vmprofile start|stop [count]|report [count] [incl]|ops [count]|folded [file]\n");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include "vmintern.h"
+
+//==========================================================================
+//
+// VM profiler
+//
+// While active, every script function runs in an instrumented copy of the
+// interpreter that counts executed instructions and reports entering and
+// leaving script and native functions. Only the thread that started the
+// profiler records call data.
+//
+//==========================================================================
+
+extern thread_local uint64_t VMOpCounts[NUM_OPS];
+
+int VMProfiledExec(VMFunction *func, VMValue *params, int numparams, VMReturn *ret, int numret);
+
+class FVMProfileScope
+{
+public:
+	FVMProfileScope(VMFunction *func);
+	~FVMProfileScope();
+
+private:
+	bool Recording;
+};
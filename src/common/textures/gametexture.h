@@ -373,6 +373,8 @@ enum EUpscaleFlags : int
 
 extern int upscalemask;
 void UpdateUpscaleMask();
+void UpdateUpscaleQueue();
+void ClearUpscaleQueue();
 
 void calcShouldUpscale(FGameTexture* tex);
 inline int shouldUpscale(FGameTexture* tex, EUpscaleFlags UseType)
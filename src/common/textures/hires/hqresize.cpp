@@ -34,6 +34,10 @@
 **
 */
 
+#include <zlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "c_cvars.h"
 #include "hqnx/hqx.h"
 #ifdef HAVE_MMX
@@ -45,6 +49,12 @@
 #include "textures.h"
 #include "texturemanager.h"
 #include "printf.h"
+#include "md5.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "i_specialpaths.h"
+#include "m_swap.h"
+#include "templates.h"
 
 int upscalemask;
 
@@ -55,6 +65,7 @@ CUSTOM_CVAR(Int, gl_texture_hqresizemode, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG |
 		self = 0;
 	if ((gl_texture_hqresizemult > 4) && (self < 4) && (self > 0))
 		gl_texture_hqresizemult = 4;
+	ClearUpscaleQueue();
 	TexMan.FlushAll();
 	UpdateUpscaleMask();
 }
@@ -65,6 +76,7 @@ CUSTOM_CVAR(Int, gl_texture_hqresizemult, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG |
 		self = 1;
 	if ((self > 4) && (gl_texture_hqresizemode < 4) && (gl_texture_hqresizemode > 0))
 		self = 4;
+	ClearUpscaleQueue();
 	TexMan.FlushAll();
 	UpdateUpscaleMask();
 }
@@ -102,6 +114,11 @@ CUSTOM_CVAR(Int, gl_texture_hqresize_mt_height, 4, CVAR_ARCHIVE | CVAR_GLOBALCON
 
 CVAR(Int, xbrz_colorformat, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 
+// Hardware textures are shown unscaled until their upscaled version has been made in the background.
+CVAR(Bool, gl_texture_hqresize_async, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+// Upscaled textures are stored in the cache directory and reused across sessions.
+CVAR(Bool, gl_texture_hqresize_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 void UpdateUpscaleMask()
 {
 	if (!gl_texture_hqresizemode || gl_texture_hqresizemult == 1) upscalemask = 0;
@@ -296,13 +313,8 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		HQnX_asm::InitLUTs();
-		initdone = true;
-	}
+	static std::once_flag initdone;
+	std::call_once(initdone, HQnX_asm::InitLUTs);
 
 	HQnX_asm::CImage cImageIn;
 	cImageIn.SetImage(inputBuffer, inWidth, inHeight, 32);
@@ -323,13 +335,8 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 							  int &outWidth,
 							  int &outHeight )
 {
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		hqxInit();
-		initdone = true;
-	}
+	static std::once_flag initdone;
+	std::call_once(initdone, hqxInit);
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
@@ -412,14 +419,425 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+// 
+// Runs the scaler on a buffer it takes ownership of. Returns nullptr
+// without touching the buffer if the combination is not supported.
+//
+//===========================================================================
+
+static unsigned char *UpscaleBuffer(int type, int mult, unsigned char *buffer, int inWidth, int inHeight, int &outWidth, int &outHeight)
+{
+	if (type == 1)
+	{
+		if (mult == 2)
+			return scaleNxHelper(&scale2x, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return scaleNxHelper(&scale3x, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return scaleNxHelper(&scale4x, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+	}
+	else if (type == 2)
+	{
+		if (mult == 2)
+			return hqNxHelper(&hq2x_32, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return hqNxHelper(&hq3x_32, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return hqNxHelper(&hq4x_32, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+	}
+#ifdef HAVE_MMX
+	else if (type == 3)
+	{
+		if (mult == 2)
+			return hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 3)
+			return hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, buffer, inWidth, inHeight, outWidth, outHeight);
+		else if (mult == 4)
+			return hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, buffer, inWidth, inHeight, outWidth, outHeight);
+	}
+#endif
+	else if (type == 4)
+		return xbrzHelper(xbrz::scale, mult, buffer, inWidth, inHeight, outWidth, outHeight);
+	else if (type == 5)
+		return xbrzHelper(xbrzOldScale, mult, buffer, inWidth, inHeight, outWidth, outHeight);
+	else if (type == 6)
+		return normalNx(mult, buffer, inWidth, inHeight, outWidth, outHeight);
+
+	return nullptr;
+}
+
+static bool IsUpscaleSupported(int type, int mult)
+{
+#ifndef HAVE_MMX
+	if (type == 3) return false;
+#endif
+	return type < 4 ? mult <= 4 : true;
+}
+
+//===========================================================================
+// 
+// Upscale jobs
+//
+// A job owns its buffer, which holds the source image until the job has
+// run and the upscaled image afterward. Before scaling anything, the job
+// looks for a previous result in the disk cache, which is keyed by the
+// MD5 of the source pixels and everything that affects the scaler output.
+//
+//===========================================================================
+
+struct FUpscaleRequest
+{
+	FTexture *Texture;
+	int Translation;
+	int ScaleFlags;
+};
+
+struct FUpscaleJob
+{
+	int Type, Mult;
+	unsigned char *Buffer;
+	int Width, Height;
+	FString CacheFile;
+	TArray<FUpscaleRequest> Requests;	// hardware textures to recreate once the job is done
+	unsigned Pending = 0;				// requests that have not fetched the result yet
+	int Age = 0;
+	bool Done = false;
+
+	~FUpscaleJob()
+	{
+		delete[] Buffer;
+	}
+};
+
+enum
+{
+	UPSCALE_CACHE_VERSION = 1,
+	UPSCALE_MAX_AGE = 600,		// frames a finished job waits to be fetched
+};
+
+static FString GetUpscaleCacheName(const FString &cachepath, int type, int mult, const unsigned char *buffer, int width, int height)
+{
+	MD5Context md5;
+	int32_t params[] = { UPSCALE_CACHE_VERSION, type, mult, width, height, 0 };
+	float xbrzparams[] = { 0, 0, 0, 0, 0 };
+	if (type == 4 || type == 5)
+	{
+		params[5] = xbrz_colorformat;
+		xbrzparams[0] = xbrz_luminanceweight;
+		xbrzparams[1] = xbrz_equalcolortolerance;
+		xbrzparams[2] = xbrz_centerdirectionbias;
+		xbrzparams[3] = xbrz_dominantdirectionthreshold;
+		xbrzparams[4] = xbrz_steepdirectionthreshold;
+	}
+	md5.Update((const uint8_t*)params, sizeof(params));
+	md5.Update((const uint8_t*)xbrzparams, sizeof(xbrzparams));
+	md5.Update(buffer, width * height * 4);
+
+	uint8_t digest[16];
+	md5.Final(digest);
+
+	FString name = cachepath;
+	for (auto b : digest) name.AppendFormat("%02x", b);
+	name += ".ups";
+	return name;
+}
+
+static bool LoadUpscaleCache(FUpscaleJob &job)
+{
+	FileReader fr;
+	if (!fr.OpenFile(job.CacheFile)) return false;
+
+	char id[4];
+	uint32_t header[3];
+	if (fr.Read(id, 4) != 4 || memcmp(id, "UPSC", 4) || fr.Read(header, sizeof(header)) != sizeof(header)) return false;
+	int width = job.Width * job.Mult, height = job.Height * job.Mult;
+	if (LittleLong(header[0]) != UPSCALE_CACHE_VERSION || LittleLong(header[1]) != (uint32_t)width || LittleLong(header[2]) != (uint32_t)height) return false;
+
+	auto packed = fr.Read();
+	uLongf size = width * height * 4;
+	auto result = new unsigned char[size];
+	if (uncompress(result, &size, packed.Data(), packed.Size()) != Z_OK || size != uLongf(width * height * 4))
+	{
+		delete[] result;
+		return false;
+	}
+	delete[] job.Buffer;
+	job.Buffer = result;
+	job.Width = width;
+	job.Height = height;
+	return true;
+}
+
+static void SaveUpscaleCache(const FUpscaleJob &job)
+{
+	uLongf size = compressBound(job.Width * job.Height * 4);
+	TArray<uint8_t> packed(size, true);
+	// Speed matters more than size here, this runs for every texture that gets upscaled.
+	if (compress2(packed.Data(), &size, job.Buffer, job.Width * job.Height * 4, 1) != Z_OK) return;
+
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(job.CacheFile));
+	if (fw == nullptr) return;
+	uint32_t header[3] = { LittleLong(uint32_t(UPSCALE_CACHE_VERSION)), LittleLong(uint32_t(job.Width)), LittleLong(uint32_t(job.Height)) };
+	fw->Write("UPSC", 4);
+	fw->Write(header, sizeof(header));
+	fw->Write(packed.Data(), size);
+}
+
+static void RunUpscaleJob(FUpscaleJob &job)
+{
+	if (job.CacheFile.IsNotEmpty() && LoadUpscaleCache(job)) return;
+
+	int outWidth, outHeight;
+	job.Buffer = UpscaleBuffer(job.Type, job.Mult, job.Buffer, job.Width, job.Height, outWidth, outHeight);
+	job.Width = outWidth;
+	job.Height = outHeight;
+	if (job.CacheFile.IsNotEmpty()) SaveUpscaleCache(job);
+}
+
+//===========================================================================
+// 
+// Background upscaling
+//
+// Jobs are identified by the upscaled content ID, so textures sharing an
+// image also share the job. The game thread polls for finished jobs once
+// per frame and deletes the hardware textures that were created from the
+// unscaled image, so that they get recreated with the result.
+//
+//===========================================================================
+
+static class FUpscaleQueue
+{
+public:
+	~FUpscaleQueue()
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			Quit = true;
+		}
+		Signal.notify_all();
+		for (auto &thread : Threads) thread.join();
+		Clear();
+	}
+
+	FString GetCachePath()
+	{
+		// The precacher upscales on several threads at once.
+		std::call_once(CachePathDone, [this]()
+		{
+			CachePath = M_GetCachePath(true) + "/upscale/";
+			CreatePath(CachePath);
+		});
+		return CachePath;
+	}
+
+	// Returns true if the upscaled image was put into the buffer.
+	bool Fetch(uint64_t contentId, const FUpscaleRequest &request, FTextureBuffer &texbuffer, int type, int mult, bool usecache)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+
+		auto pjob = Jobs.CheckKey(contentId);
+		if (pjob != nullptr && (*pjob)->Done)
+		{
+			FUpscaleJob *job = *pjob;
+			delete[] texbuffer.mBuffer;
+			texbuffer.mWidth = job->Width;
+			texbuffer.mHeight = job->Height;
+			if (job->Pending > 1)
+			{
+				job->Pending--;
+				texbuffer.mBuffer = new unsigned char[job->Width * job->Height * 4];
+				memcpy(texbuffer.mBuffer, job->Buffer, job->Width * job->Height * 4);
+			}
+			else
+			{
+				texbuffer.mBuffer = job->Buffer;
+				job->Buffer = nullptr;
+				Jobs.Remove(contentId);
+				delete job;
+			}
+			return true;
+		}
+
+		if (pjob == nullptr)
+		{
+			auto job = new FUpscaleJob;
+			job->Type = type;
+			job->Mult = mult;
+			job->Width = texbuffer.mWidth;
+			job->Height = texbuffer.mHeight;
+			job->Buffer = new unsigned char[job->Width * job->Height * 4];
+			memcpy(job->Buffer, texbuffer.mBuffer, job->Width * job->Height * 4);
+			if (usecache) job->CacheFile = GetUpscaleCacheName(GetCachePath(), type, mult, job->Buffer, job->Width, job->Height);
+			pjob = &Jobs.Insert(contentId, job);
+			Queue.Push(job);
+			StartThreads();
+			Signal.notify_one();
+		}
+
+		FUpscaleJob *job = *pjob;
+		for (auto &r : job->Requests)
+		{
+			if (r.Texture == request.Texture && r.Translation == request.Translation && r.ScaleFlags == request.ScaleFlags) return false;
+		}
+		job->Requests.Push(request);
+		job->Pending++;
+		return false;
+	}
+
+	void Update()
+	{
+		TArray<FUpscaleRequest> finished;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			if (Finished.Size() == 0 && Jobs.CountUsed() == 0) return;
+
+			for (auto job : Finished)
+			{
+				finished.Append(job->Requests);
+			}
+			Finished.Clear();
+
+			// Results nobody came for, e.g. because the texture got deleted in the meantime.
+			TArray<uint64_t> expired;
+			decltype(Jobs)::Iterator it(Jobs);
+			decltype(Jobs)::Pair *pair;
+			while (it.NextPair(pair))
+			{
+				if (pair->Value->Done && ++pair->Value->Age > UPSCALE_MAX_AGE) expired.Push(pair->Key);
+			}
+			for (auto key : expired)
+			{
+				delete Jobs[key];
+				Jobs.Remove(key);
+			}
+		}
+		if (finished.Size() == 0) return;
+
+		// The textures may be gone by now, so they must be found before anything is done with them.
+		TMap<FTexture *, bool> textures;
+		for (auto &r : finished) textures[r.Texture] = true;
+
+		for (int i = 0; i < TexMan.NumTextures(); i++)
+		{
+			auto gtex = TexMan.GameByIndex(i);
+			if (gtex == nullptr) continue;
+			auto tex = gtex->GetTexture();
+			bool *found = textures.CheckKey(tex);
+			if (found == nullptr) continue;
+
+			if (*found)
+			{
+				for (auto &r : finished)
+				{
+					if (r.Texture == tex) tex->SystemTextures.AddHardwareTexture(r.Translation, r.ScaleFlags, nullptr);
+				}
+				*found = false;
+			}
+			// Materials may still reference the old hardware texture.
+			gtex->CleanHardwareData(false);
+		}
+	}
+
+	void Clear()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		// Jobs that are running right now are not in the queue any longer and get deleted when they are done.
+		for (auto job : Queue)
+		{
+			Jobs.Remove(FindKey(job));
+			delete job;
+		}
+		Queue.Clear();
+		Finished.Clear();
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		TArray<uint64_t> done;
+		while (it.NextPair(pair))
+		{
+			if (pair->Value->Done) done.Push(pair->Key);
+			else Orphans.Push(pair->Value);
+		}
+		for (auto key : done) delete Jobs[key];
+		Jobs.Clear();
+	}
+
+private:
+	uint64_t FindKey(FUpscaleJob *job)
+	{
+		decltype(Jobs)::Iterator it(Jobs);
+		decltype(Jobs)::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			if (pair->Value == job) return pair->Key;
+		}
+		return 0;
+	}
+
+	void StartThreads()
+	{
+		if (Threads.size() > 0) return;
+		int count = clamp<int>((int)std::thread::hardware_concurrency() / 2, 1, 4);
+		for (int i = 0; i < count; i++)
+		{
+			Threads.push_back(std::thread([this]() { WorkerMain(); }));
+		}
+	}
+
+	void WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			Signal.wait(lock, [this]() { return Quit || Queue.Size() > 0; });
+			if (Quit) return;
+
+			FUpscaleJob *job;
+			Queue.Pop(job);
+			lock.unlock();
+			RunUpscaleJob(*job);
+			lock.lock();
+
+			unsigned orphan = Orphans.Find(job);
+			if (orphan < Orphans.Size())
+			{
+				Orphans.Delete(orphan);
+				delete job;
+				continue;
+			}
+			job->Done = true;
+			Finished.Push(job);
+		}
+	}
+
+	std::mutex Mutex;
+	std::condition_variable Signal;
+	std::vector<std::thread> Threads;
+	bool Quit = false;
+	TMap<uint64_t, FUpscaleJob *> Jobs;
+	TArray<FUpscaleJob *> Queue;		// jobs that have not been started yet, the most recent one last
+	TArray<FUpscaleJob *> Finished;		// jobs that are done but whose textures have not been invalidated yet
+	TArray<FUpscaleJob *> Orphans;		// running jobs that were cleared
+	FString CachePath;
+	std::once_flag CachePathDone;
+} UpscaleQueue;
+
+void UpdateUpscaleQueue()
+{
+	UpscaleQueue.Update();
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
 //  the upsampled buffer.
 //
+// With CTF_AllowDeferred the buffer may be returned unscaled while the
+// work is being done in the background.
+//
 //===========================================================================
 
-void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, bool checkonly)
+void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, int translation, int flags)
 {
 	// [BB] Make sure that inWidth and inHeight denote the size of
 	// the returned buffer even if we don't upsample the input buffer.
@@ -439,63 +857,57 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 	// These checks are to ensure consistency of the content ID.
 	if (mult < 2 || mult > 6 || type < 1 || type > 6) return;
 	if (type < 4 && mult > 4) mult = 4;
+	if (!IsUpscaleSupported(type, mult)) return;
+
+	// Encode the scaling method in the content ID.
+	FContentIdBuilder contentId;
+	contentId.id = texbuffer.mContentId;
+	contentId.scaler = type;
+	contentId.scalefactor = mult;
 
-	if (!checkonly)
+	if (!(flags & CTF_CheckOnly))
 	{
-		if (type == 1)
+		// Luminosity translations do not fit into the content ID, so those cannot share jobs.
+		if ((flags & CTF_AllowDeferred) && gl_texture_hqresize_async && !IsLuminosityTranslation(translation))
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = scaleNxHelper(&scale3x, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = scaleNxHelper(&scale4x, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			FUpscaleRequest request = { this, translation, flags & CTF_CreateMask };
+			if (!UpscaleQueue.Fetch(contentId.id, request, texbuffer, type, mult, gl_texture_hqresize_cache)) return;
 		}
-		else if (type == 2)
-		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxHelper(&hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxHelper(&hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxHelper(&hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
-		}
-#ifdef HAVE_MMX
-		else if (type == 3)
+		else
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			FUpscaleJob job;
+			job.Type = type;
+			job.Mult = mult;
+			job.Buffer = texbuffer.mBuffer;
+			job.Width = inWidth;
+			job.Height = inHeight;
+			if (gl_texture_hqresize_cache) job.CacheFile = GetUpscaleCacheName(UpscaleQueue.GetCachePath(), type, mult, job.Buffer, inWidth, inHeight);
+			RunUpscaleJob(job);
+			texbuffer.mBuffer = job.Buffer;
+			texbuffer.mWidth = job.Width;
+			texbuffer.mHeight = job.Height;
+			job.Buffer = nullptr;
 		}
-#endif
-		else if (type == 4)
-			texbuffer.mBuffer = xbrzHelper(xbrz::scale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 5)
-			texbuffer.mBuffer = xbrzHelper(xbrzOldScale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 6)
-			texbuffer.mBuffer = normalNx(mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else
-			return;
 	}
 	else
 	{
 		texbuffer.mWidth *= mult;
 		texbuffer.mHeight *= mult;
 	}
-	// Encode the scaling method in the content ID.
-	FContentIdBuilder contentId;
-	contentId.id = texbuffer.mContentId;
-	contentId.scaler = type;
-	contentId.scalefactor = mult;
 	texbuffer.mContentId = contentId.id;
 }
 
+//===========================================================================
+//
+// Drops all upscaling work, e.g. when the scaler settings change.
+//
+//===========================================================================
+
+void ClearUpscaleQueue()
+{
+	UpscaleQueue.Clear();
+}
+
 //===========================================================================
 // 
 // This was pulled out of the above function to allow running these
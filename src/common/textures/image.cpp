@@ -34,6 +34,8 @@
 **
 */
 
+#include <mutex>
+#include <condition_variable>
 #include "bitmap.h"
 #include "image.h"
 #include "filesystem.h"
@@ -51,6 +53,7 @@ struct PrecacheDataPaletted
 	TArray<uint8_t> Pixels;
 	int RefCount;
 	int ImageID;
+	bool Ready;		// false while the thread that created the entry is still filling it in
 };
 
 struct PrecacheDataRgba
@@ -59,12 +62,30 @@ struct PrecacheDataRgba
 	int TransInfo;
 	int RefCount;
 	int ImageID;
+	bool Ready;
 };
 
 // TMap doesn't handle this kind of data well.  std::map neither. The linear search is still faster, even for a few 100 entries because it doesn't have to access the heap as often..
 TArray<PrecacheDataPaletted> precacheDataPaletted;
 TArray<PrecacheDataRgba> precacheDataRgba;
 
+// The precacher may create images from several threads at once.
+// In that mode cached images are always handed out as copies.
+static std::mutex precacheMutex;
+static std::condition_variable precacheReady;
+static bool precacheConcurrent;
+
+template<class T>
+static unsigned FindCachedImage(TArray<T> &cache, int imageID, std::unique_lock<std::mutex> &lock)
+{
+	while (true)
+	{
+		unsigned index = cache.FindEx([=](T &entry) { return entry.ImageID == imageID; });
+		if (index >= cache.Size() || cache[index].Ready) return index;
+		precacheReady.wait(lock);
+	}
+}
+
 //===========================================================================
 // 
 // the default just returns an empty texture.
@@ -88,8 +109,10 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 	std::pair<int, int> *info = nullptr;
 	auto imageID = ImageID;
 
+	std::unique_lock<std::mutex> lock(precacheMutex);
+
 	// Do we have this image in the cache?
-	unsigned index = conversion != normal? UINT_MAX : precacheDataPaletted.FindEx([=](PrecacheDataPaletted &entry) { return entry.ImageID == imageID; });
+	unsigned index = conversion != normal? UINT_MAX : FindCachedImage(precacheDataPaletted, imageID, lock);
 	if (index < precacheDataPaletted.Size())
 	{
 		auto cache = &precacheDataPaletted[index];
@@ -97,7 +120,13 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 		if (cache->RefCount > 1)
 		{
 			//Printf("returning reference to %s, refcount = %d\n", name.GetChars(), cache->RefCount);
-			ret.Pixels.Set(cache->Pixels.Data(), cache->Pixels.Size());
+			if (precacheConcurrent)
+			{
+				// The last user may free the cached data while this copy is still being worked on.
+				ret.PixelStore = cache->Pixels;
+				ret.Pixels.Set(ret.PixelStore.Data(), ret.PixelStore.Size());
+			}
+			else ret.Pixels.Set(cache->Pixels.Data(), cache->Pixels.Size());
 			cache->RefCount--;
 		}
 		else if (cache->Pixels.Size() > 0)
@@ -120,6 +149,7 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 		{
 			// This is either the only copy needed or some access outside the caching block. In these cases create a new one and directly return it.
 			//Printf("returning fresh copy of %s\n", name.GetChars());
+			lock.unlock();
 			ret.PixelStore = CreatePalettedPixels(conversion);
 			ret.Pixels.Set(ret.PixelStore.Data(), ret.PixelStore.Size());
 		}
@@ -127,13 +157,32 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion)
 		{
 			//Printf("creating cached entry for %s, refcount = %d\n", name.GetChars(), info->second);
 			// This is the first time it gets accessed and needs to be placed in the cache.
+			// Other threads wanting the image wait until it is ready.
 			PrecacheDataPaletted *pdp = &precacheDataPaletted[precacheDataPaletted.Reserve(1)];
 
 			pdp->ImageID = imageID;
 			pdp->RefCount = info->second - 1;
+			pdp->Ready = false;
 			info->second = 0;
-			pdp->Pixels = CreatePalettedPixels(normal);
-			ret.Pixels.Set(pdp->Pixels.Data(), pdp->Pixels.Size());
+
+			lock.unlock();
+			auto pixels = CreatePalettedPixels(normal);
+			lock.lock();
+
+			pdp = &precacheDataPaletted[precacheDataPaletted.FindEx([=](PrecacheDataPaletted &entry) { return entry.ImageID == imageID; })];
+			if (precacheConcurrent)
+			{
+				pdp->Pixels = pixels;
+				ret.PixelStore = std::move(pixels);
+				ret.Pixels.Set(ret.PixelStore.Data(), ret.PixelStore.Size());
+			}
+			else
+			{
+				pdp->Pixels = std::move(pixels);
+				ret.Pixels.Set(pdp->Pixels.Data(), pdp->Pixels.Size());
+			}
+			pdp->Ready = true;
+			precacheReady.notify_all();
 		}
 	}
 	return ret;
@@ -215,8 +264,11 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 	else
 	{
 		if (conversion == luminance) conversion = normal;	// luminance has no meaning for true color.
+
+		std::unique_lock<std::mutex> lock(precacheMutex);
+
 		// Do we have this image in the cache?
-		unsigned index = conversion != normal? UINT_MAX : precacheDataRgba.FindEx([=](PrecacheDataRgba &entry) { return entry.ImageID == imageID; });
+		unsigned index = conversion != normal? UINT_MAX : FindCachedImage(precacheDataRgba, imageID, lock);
 		if (index < precacheDataRgba.Size())
 		{
 			auto cache = &precacheDataRgba[index];
@@ -225,7 +277,8 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			if (cache->RefCount > 1)
 			{
 				//Printf("returning reference to %s, refcount = %d\n", name.GetChars(), cache->RefCount);
-				ret.Copy(cache->Pixels, false);
+				// The last user may free the cached data while a shallow copy is still being worked on.
+				ret.Copy(cache->Pixels, precacheConcurrent);
 				cache->RefCount--;
 			}
 			else if (cache->Pixels.GetPixels())
@@ -238,6 +291,7 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			{
 				// This should never happen if the function is implemented correctly
 				//Printf("something bad happened for %s, refcount = %d\n", name.GetChars(), cache->RefCount);
+				lock.unlock();
 				ret.Create(Width, Height);
 				trans = CopyPixels(&ret, normal);
 			}
@@ -250,6 +304,7 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			{
 				// This is either the only copy needed or some access outside the caching block. In these cases create a new one and directly return it.
 				//Printf("returning fresh copy of %s\n", name.GetChars());
+				lock.unlock();
 				ret.Create(Width, Height);
 				trans = CopyPixels(&ret, conversion);
 			}
@@ -257,14 +312,26 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 			{
 				//Printf("creating cached entry for %s, refcount = %d\n", name.GetChars(), info->first);
 				// This is the first time it gets accessed and needs to be placed in the cache.
+				// Other threads wanting the image wait until it is ready.
 				PrecacheDataRgba *pdr = &precacheDataRgba[precacheDataRgba.Reserve(1)];
 				
 				pdr->ImageID = imageID;
 				pdr->RefCount = info->first - 1;
+				pdr->Ready = false;
 				info->first = 0;
-				pdr->Pixels.Create(Width, Height);
-				trans = pdr->TransInfo = CopyPixels(&pdr->Pixels, normal);
-				ret.Copy(pdr->Pixels, false);
+
+				lock.unlock();
+				FBitmap pixels;
+				pixels.Create(Width, Height);
+				trans = CopyPixels(&pixels, normal);
+				lock.lock();
+
+				pdr = &precacheDataRgba[precacheDataRgba.FindEx([=](PrecacheDataRgba &entry) { return entry.ImageID == imageID; })];
+				pdr->Pixels = std::move(pixels);
+				pdr->TransInfo = trans;
+				ret.Copy(pdr->Pixels, precacheConcurrent);
+				pdr->Ready = true;
+				precacheReady.notify_all();
 			}
 		}
 	}
@@ -303,6 +370,7 @@ void FImageSource::EndPrecaching()
 {
 	precacheDataPaletted.Clear();
 	precacheDataRgba.Clear();
+	precacheConcurrent = false;
 }
 
 void FImageSource::RegisterForPrecache(FImageSource *img, bool requiretruecolor)
@@ -310,6 +378,11 @@ void FImageSource::RegisterForPrecache(FImageSource *img, bool requiretruecolor)
 	img->CollectForPrecache(precacheInfo, requiretruecolor);
 }
 
+void FImageSource::SetConcurrentPrecache(bool on)
+{
+	precacheConcurrent = on;
+}
+
 //==========================================================================
 //
 //
@@ -146,6 +146,7 @@ public:
 	static void BeginPrecaching();
 	static void EndPrecaching();
 	static void RegisterForPrecache(FImageSource *img, bool requiretruecolor);
+	static void SetConcurrentPrecache(bool on);
 };
 
 
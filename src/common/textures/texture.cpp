@@ -326,6 +326,20 @@ void V_ApplyLuminosityTranslation(int translation, uint8_t *buffer, int size);
 FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 {
 	FTextureBuffer result;
+	if ((flags & CTF_ProcessData) && !(flags & CTF_CheckOnly) && PreparedBuffers.Size() > 0)
+	{
+		int key = flags & (CTF_CreateMask | CTF_Indexed);
+		for (unsigned i = 0; i < PreparedBuffers.Size(); i++)
+		{
+			if (PreparedBuffers[i].Translation == translation && PreparedBuffers[i].Flags == key)
+			{
+				result = std::move(PreparedBuffers[i].Buffer);
+				PreparedBuffers.Delete(i);
+				return result;
+			}
+		}
+	}
+
 	if (flags & CTF_Indexed)
 	{
 		// Indexed textures will never be translated and never be scaled.
@@ -400,7 +414,7 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 		// Only do postprocessing for image-backed textures. (i.e. not for the burn texture which can also pass through here.)
 		if (GetImage() && flags & CTF_ProcessData)
 		{
-			if (flags & CTF_Upscale) CreateUpsampledTextureBuffer(result, !!isTransparent, checkonly);
+			if (flags & CTF_Upscale) CreateUpsampledTextureBuffer(result, !!isTransparent, translation, flags);
 
 			if (!checkonly) ProcessData(result.mBuffer, result.mWidth, result.mHeight, false);
 		}
@@ -409,6 +423,20 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 
 }
 
+//===========================================================================
+// 
+// Buffers made by the precacher on worker threads, see hw_precache.cpp
+//
+//===========================================================================
+
+void FTexture::SetPreparedBuffer(int translation, int flags, FTextureBuffer &&buffer)
+{
+	unsigned index = PreparedBuffers.Reserve(1);
+	PreparedBuffers[index].Translation = translation;
+	PreparedBuffers[index].Flags = flags & (CTF_CreateMask | CTF_Indexed);
+	PreparedBuffers[index].Buffer = std::move(buffer);
+}
+
 //===========================================================================
 // 
 // Dummy texture for the 0-entry.
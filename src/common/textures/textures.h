@@ -220,12 +220,20 @@ protected:
 	int8_t bTranslucent = -1;
 	int8_t areacount = 0;			// this is capped at 4 sections.
 
+	struct FPreparedBuffer
+	{
+		int Translation;
+		int Flags;
+		FTextureBuffer Buffer;
+	};
+	TArray<FPreparedBuffer> PreparedBuffers;
+
 
 public:
 
 	IHardwareTexture* GetHardwareTexture(int translation, int scaleflags);
 	virtual FImageSource *GetImage() const { return nullptr; }
-	void CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, bool checkonly);
+	void CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, int translation, int flags);
 
 	void CleanHardwareTextures()
 	{
@@ -287,6 +295,10 @@ public:
 
 public:
 	FTextureBuffer CreateTexBuffer(int translation, int flags = 0);
+
+	// Buffers made in advance by the precacher. The next CreateTexBuffer call with the same parameters takes them over.
+	void SetPreparedBuffer(int translation, int flags, FTextureBuffer &&buffer);
+	void ClearPreparedBuffers() { PreparedBuffers.Clear(); }
 	virtual bool DetermineTranslucency();
 	bool GetTranslucency()
 	{
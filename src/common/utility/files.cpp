@@ -33,6 +33,18 @@
 **
 */
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <limits.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
 #include "files.h"
 #include "templates.h"	// just for 'clamp'
 #include "zstring.h"
@@ -348,6 +360,181 @@ public:
 };
 
 
+#ifndef _WIN32
+//==========================================================================
+//
+// Truncation guard for file mappings
+//
+// Accessing a page of a mapping that lies beyond the end of its file
+// raises SIGBUS. That happens if a resource file gets truncated or
+// rewritten in place while the game is running, e.g. when rebuilding a
+// pk3 during development. Reading such a file through stdio merely
+// returned bad data, so the handler below does the same: it puts a page
+// of zeros in place of the missing one and lets the access continue.
+// Faults outside the registered mappings go to the previous handler.
+//
+//==========================================================================
+
+struct FMappedRange
+{
+	std::atomic<char *> Start;
+	std::atomic<size_t> Size;
+};
+
+enum { MAX_MAPPED_FILES = 256 };
+static FMappedRange MappedRanges[MAX_MAPPED_FILES];
+static std::mutex MappedRangesMutex;
+static struct sigaction OldBusAction;
+static size_t MappingPageSize;
+
+static void MappedFileBusHandler(int sig, siginfo_t *info, void *context)
+{
+	char *addr = (char *)info->si_addr;
+	for (auto &range : MappedRanges)
+	{
+		char *start = range.Start.load(std::memory_order_acquire);
+		if (start != nullptr && addr >= start && addr < start + range.Size.load(std::memory_order_relaxed))
+		{
+			char *page = (char *)((uintptr_t)addr & ~(uintptr_t)(MappingPageSize - 1));
+			if (mmap(page, MappingPageSize, PROT_READ, MAP_PRIVATE | MAP_ANON | MAP_FIXED, -1, 0) != MAP_FAILED)
+			{
+				return;
+			}
+			break;
+		}
+	}
+
+	if (OldBusAction.sa_flags & SA_SIGINFO)
+	{
+		OldBusAction.sa_sigaction(sig, info, context);
+	}
+	else if (OldBusAction.sa_handler != SIG_DFL && OldBusAction.sa_handler != SIG_IGN)
+	{
+		OldBusAction.sa_handler(sig);
+	}
+	else
+	{
+		// Returning repeats the access, which now gets the default action.
+		sigaction(SIGBUS, &OldBusAction, nullptr);
+	}
+}
+
+static bool RegisterMapping(void *start, size_t size)
+{
+	std::lock_guard<std::mutex> lock(MappedRangesMutex);
+	if (MappingPageSize == 0)
+	{
+		struct sigaction sa = {};
+		sa.sa_sigaction = MappedFileBusHandler;
+		sa.sa_flags = SA_SIGINFO;
+		sigemptyset(&sa.sa_mask);
+		if (sigaction(SIGBUS, &sa, &OldBusAction) != 0) return false;
+		MappingPageSize = (size_t)sysconf(_SC_PAGESIZE);
+	}
+	for (auto &range : MappedRanges)
+	{
+		if (range.Start.load(std::memory_order_relaxed) == nullptr)
+		{
+			range.Size.store(size, std::memory_order_relaxed);
+			range.Start.store((char *)start, std::memory_order_release);
+			return true;
+		}
+	}
+	return false;	// without the guard the file must not be mapped.
+}
+
+static void UnregisterMapping(void *start)
+{
+	std::lock_guard<std::mutex> lock(MappedRangesMutex);
+	for (auto &range : MappedRanges)
+	{
+		if (range.Start.load(std::memory_order_relaxed) == start)
+		{
+			range.Start.store(nullptr, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+//==========================================================================
+//
+// MappedFileReader
+//
+// reads from a read-only mapping of an entire file. Lumps of archives
+// opened this way are served straight from the mapping, so the kernel can
+// share and drop their pages instead of them being copied into the heap.
+// Nothing writes into a lump's cache, so the mapping does not need to be
+// writable.
+//
+//==========================================================================
+
+class MappedFileReader : public MemoryReader
+{
+	void *Mapping = nullptr;
+	size_t MappingSize = 0;
+
+public:
+	~MappedFileReader()
+	{
+		if (Mapping != nullptr)
+		{
+			UnregisterMapping(Mapping);
+			munmap(Mapping, MappingSize);
+		}
+	}
+
+	bool Open(const char *filename)
+	{
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0 ||
+			// Don't exhaust the address space of 32 bit systems with huge files.
+			(sizeof(void *) < 8 && info.st_size > 0x10000000) || info.st_size > LONG_MAX)
+		{
+			close(fd);
+			return false;
+		}
+
+		MappingSize = (size_t)info.st_size;
+		Mapping = mmap(nullptr, MappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);	// the mapping keeps the file referenced.
+		if (Mapping == MAP_FAILED)
+		{
+			Mapping = nullptr;
+			return false;
+		}
+		if (!RegisterMapping(Mapping, MappingSize))
+		{
+			munmap(Mapping, MappingSize);
+			Mapping = nullptr;
+			return false;
+		}
+		bufptr = (const char *)Mapping;
+		Length = (long)MappingSize;
+		FilePos = 0;
+		return true;
+	}
+
+	long GetResidentSize() const override
+	{
+		size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+		TArray<uint8_t> pages((unsigned)((MappingSize + pagesize - 1) / pagesize), true);
+#ifdef __APPLE__
+		if (mincore(Mapping, MappingSize, (char *)pages.Data()) != 0) return 0;
+#else
+		if (mincore(Mapping, MappingSize, pages.Data()) != 0) return 0;
+#endif
+		size_t resident = 0;
+		for (auto page : pages)
+		{
+			if (page & 1) resident += pagesize;
+		}
+		return (long)std::min(resident, MappingSize);
+	}
+};
+#endif // !_WIN32
 
 //==========================================================================
 //
@@ -370,6 +557,23 @@ bool FileReader::OpenFile(const char *filename, FileReader::Size start, FileRead
 	return true;
 }
 
+bool FileReader::OpenMappedFile(const char *filename)
+{
+#ifndef _WIN32
+	auto reader = new MappedFileReader;
+	if (!reader->Open(filename))
+	{
+		delete reader;
+		return false;
+	}
+	Close();
+	mReader = reader;
+	return true;
+#else
+	return false;
+#endif
+}
+
 bool FileReader::OpenFilePart(FileReader &parent, FileReader::Size start, FileReader::Size length)
 {
 	auto reader = new FileReaderRedirect(parent, (long)start, (long)length);
@@ -71,6 +71,7 @@ public:
 	virtual long Read (void *buffer, long len) = 0;
 	virtual char *Gets(char *strbuf, int len) = 0;
 	virtual const char *GetBuffer() const { return nullptr; }
+	virtual long GetResidentSize() const { return -1; }	// -1 if this is not a file mapping
 	long GetLength () const { return Length; }
 };
 
@@ -169,6 +170,7 @@ public:
 
 	bool OpenFile(const char *filename, Size start = 0, Size length = -1);
 	bool OpenFilePart(FileReader &parent, Size start, Size length);
+	bool OpenMappedFile(const char *filename);	// maps the entire file into memory. Fails where this is not supported.
 	bool OpenMemory(const void *mem, Size length);	// read directly from the buffer
 	bool OpenMemoryArray(const void *mem, Size length);	// read from a copy of the buffer.
 	bool OpenMemoryArray(std::function<bool(TArray<uint8_t>&)> getter);	// read contents to a buffer and return a reader to it
@@ -224,6 +226,11 @@ public:
 		return mReader->GetBuffer();
 	}
 
+	Size GetResidentSize() const
+	{
+		return mReader->GetResidentSize();
+	}
+
 	Size GetLength() const
 	{
 		return mReader->GetLength();
@@ -72,6 +72,7 @@ public:
 	int SetName (const char *text, bool noCreate=false) { return Index = NameData.FindName (text, noCreate); }
 
 	bool IsValidName() const { return (unsigned)Index < (unsigned)NameData.NumNames; }
+	static int GetNumNames() { return NameData.NumNames; }
 
 	// Note that the comparison operators compare the names' indices, not
 	// their text, so they cannot be used to do a lexicographical sort.
@@ -41,6 +41,7 @@
 #include "printf.h"
 #include "templates.h"
 #include "m_png.h"
+#include "simd.h"
 
 /****************************/
 /* Palette management stuff */
@@ -110,87 +111,24 @@ int PTM_BestColor (const uint32_t *pal_in, int r, int g, int b, bool reverselook
 	return bestcolor;
 }
 
-#if defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__)
-
-#ifdef _MSC_VER
-#include <intrin.h>
-#endif
-#include <emmintrin.h>
-
-static void DoBlending_SSE2(const PalEntry *from, PalEntry *to, int count, int r, int g, int b, int a)
+#ifndef SIMD_BACKEND_SCALAR
+static void DoBlending_SIMD(const PalEntry *from, PalEntry *to, int count, int r, int g, int b, int a)
 {
-	__m128i blendcolor;
-	__m128i blendalpha;
-	__m128i zero;
-	__m128i blending256;
-	__m128i color1;
-	__m128i color2;
-	size_t unaligned;
-
-	unaligned = ((size_t)from | (size_t)to) & 0xF;
-
-#if defined(__amd64__) || defined(_M_X64)
-	int64_t color;
-
-	blending256 = _mm_set_epi64x(0x10001000100ll, 0x10001000100ll);
-
-	color = ((int64_t)r << 32) | (g << 16) | b;
-	blendcolor = _mm_set_epi64x(color, color);
-
-	color = ((int64_t)a << 32) | (a << 16) | a;
-	blendalpha = _mm_set_epi64x(color, color);
-#else
-	int color;
-
-	blending256 = _mm_set_epi32(0x100, 0x1000100, 0x100, 0x1000100);
-
-	color = (g << 16) | b;
-	blendcolor = _mm_set_epi32(r, color, r, color);
+	using V = simd::native;
 
-	color = (a << 16) | a;
-	blendalpha = _mm_set_epi32(a, color, a, color);
-#endif
-
-	blendcolor = _mm_mullo_epi16(blendcolor, blendalpha);	// premultiply blend by alpha
-	blendalpha = _mm_subs_epu16(blending256, blendalpha);	// one minus alpha
-
-	zero = _mm_setzero_si128();
+	V::vec blendalpha = V::set4(a, a, a, 0);
+	V::vec blendcolor = V::mullo(V::set4(b, g, r, 0), blendalpha);	// premultiply blend by alpha
+	blendalpha = V::subs(V::set4(256, 256, 256, 0), blendalpha);	// one minus alpha
 
-	if (unaligned)
-	{
-		for (count >>= 2; count > 0; --count)
-		{
-			color1 = _mm_loadu_si128((__m128i *)from);
-			from += 4;
-			color2 = _mm_unpackhi_epi8(color1, zero);
-			color1 = _mm_unpacklo_epi8(color1, zero);
-			color1 = _mm_mullo_epi16(blendalpha, color1);
-			color2 = _mm_mullo_epi16(blendalpha, color2);
-			color1 = _mm_adds_epu16(blendcolor, color1);
-			color2 = _mm_adds_epu16(blendcolor, color2);
-			color1 = _mm_srli_epi16(color1, 8);
-			color2 = _mm_srli_epi16(color2, 8);
-			_mm_storeu_si128((__m128i *)to, _mm_packus_epi16(color1, color2));
-			to += 4;
-		}
-	}
-	else
+	for (count >>= 2; count > 0; --count)
 	{
-		for (count >>= 2; count > 0; --count)
-		{
-			color1 = _mm_load_si128((__m128i *)from);
-			from += 4;
-			color2 = _mm_unpackhi_epi8(color1, zero);
-			color1 = _mm_unpacklo_epi8(color1, zero);
-			color1 = _mm_mullo_epi16(blendalpha, color1);
-			color2 = _mm_mullo_epi16(blendalpha, color2);
-			color1 = _mm_adds_epu16(blendcolor, color1);
-			color2 = _mm_adds_epu16(blendcolor, color2);
-			color1 = _mm_srli_epi16(color1, 8);
-			color2 = _mm_srli_epi16(color2, 8);
-			_mm_store_si128((__m128i *)to, _mm_packus_epi16(color1, color2));
-			to += 4;
-		}
+		V::vec color1, color2;
+		V::load4px((const uint32_t *)from, color1, color2);
+		from += 4;
+		color1 = V::srli<8>(V::adds(blendcolor, V::mullo(blendalpha, color1)));
+		color2 = V::srli<8>(V::adds(blendcolor, V::mullo(blendalpha, color2)));
+		V::store4px((uint32_t *)to, color1, color2);
+		to += 4;
 	}
 }
 #endif
@@ -216,11 +154,11 @@ void DoBlending (const PalEntry *from, PalEntry *to, int count, int r, int g, in
 		}
 		return;
 	}
-#if defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__)
+#ifndef SIMD_BACKEND_SCALAR
 	else if (count >= 4)
 	{
 		int not3count = count & ~3;
-		DoBlending_SSE2 (from, to, not3count, r, g, b, a);
+		DoBlending_SIMD (from, to, not3count, r, g, b, a);
 		count &= 3;
 		if (count <= 0)
 		{
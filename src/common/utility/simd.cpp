@@ -0,0 +1,204 @@
+/*
+** simd.cpp
+** Consistency check between the native SIMD backend and the scalar one
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The kernels below use the wrapper the same way the blenders and drawers
+** do and are run with random pixels on both backends. Any difference in
+** the produced pixels is reported.
+**
+*/
+
+#include <random>
+#include "simd.h"
+#include "c_dispatch.h"
+#include "printf.h"
+
+// Source-alpha blend as in the poly blenders
+template<typename V> static void BlendKernel(const uint32_t *src, const uint32_t *dst, uint32_t *out)
+{
+	typename V::vec s = V::load2px(src);
+	typename V::vec d = V::load2px(dst);
+	typename V::vec scale = V::splatalpha(s);
+	scale = V::add(scale, V::template srli<7>(scale));
+	typename V::vec invscale = V::sub(V::set1(256), scale);
+	V::store2px(out, V::template srli<8>(V::add(V::add(V::mullo(s, scale), V::mullo(d, invscale)), V::set1(127))));
+}
+
+// Additive and reverse subtractive blends, which rely on the pack saturation
+template<typename V> static void AddSubKernel(const uint32_t *src, const uint32_t *dst, uint32_t *out)
+{
+	typename V::vec s = V::load2px(src);
+	typename V::vec d = V::load2px(dst);
+	typename V::vec scale = V::add(s, V::template srli<7>(s));
+	typename V::vec term = V::template srli<8>(V::add(V::mullo(s, scale), V::set1(127)));
+	V::store2px(out, V::add(term, d));
+	V::store2px(out + 2, V::sub(d, term));
+}
+
+// Palette blending
+template<typename V> static void PaletteKernel(const uint32_t *src, int r, int g, int b, int a, uint32_t *out)
+{
+	typename V::vec alpha = V::set4(a, a, a, 0);
+	typename V::vec color = V::mullo(V::set4(b, g, r, 0), alpha);
+	alpha = V::subs(V::set4(256, 256, 256, 0), alpha);
+	typename V::vec lo, hi;
+	V::load4px(src, lo, hi);
+	lo = V::template srli<8>(V::adds(color, V::mullo(alpha, lo)));
+	hi = V::template srli<8>(V::adds(color, V::mullo(alpha, hi)));
+	V::store4px(out, lo, hi);
+}
+
+// Single pixel fade as in the sky drawer
+template<typename V> static uint32_t FadeKernel(uint32_t fg, uint32_t fill, int alpha)
+{
+	typename V::vec a = V::set1(alpha);
+	typename V::vec inva = V::sub(V::set1(256), a);
+	return V::store1px(V::template srli<8>(V::add(V::mullo(V::load1px(fg), a), V::mullo(V::load1px(fill), inva))));
+}
+
+// Blends with 32 bit intermediates and the masked select as in the wall, span and sprite drawers
+template<typename V> static void DrawerBlendKernel(const uint32_t *src, const uint32_t *dst, int fa0, int fa1, int ba0, int ba1, uint32_t *out)
+{
+	typename V::vec fg = V::mullo(V::load2px(src), V::set8(fa0, fa0, fa0, fa0, fa1, fa1, fa1, fa1));
+	typename V::vec bg = V::mullo(V::load2px(dst), V::set8(ba0, ba0, ba0, ba0, ba1, ba1, ba1, ba1));
+	typename V::ivec fglo = V::widenlo(fg), fghi = V::widenhi(fg), bglo = V::widenlo(bg), bghi = V::widenhi(bg);
+	V::store2px(out, V::narrow(V::template srai<8>(V::addi(fglo, bglo)), V::template srai<8>(V::addi(fghi, bghi))));
+	V::store2px(out + 2, V::narrow(V::template srai<8>(V::subi(fglo, bglo)), V::template srai<8>(V::subi(fghi, bghi))));
+	typename V::vec s = V::min(V::load2px(src), V::set1(200));
+	V::store2px(out + 4, V::select(V::pixeliszero(s), V::load2px(dst), s));
+}
+
+// Dynamic light attenuation as in the drawers, minus the rsqrt approximation
+template<typename V> static void LightKernel(const float *dist, const float *radius, uint32_t color, uint32_t *out)
+{
+	typename V::fvec m256 = V::set1f(256.0f);
+	typename V::fvec d = V::loadf(dist);
+	typename V::fvec att = V::subf(m256, V::minf(V::mulf(d, V::loadf(radius)), m256));
+	typename V::fvec point = V::divf(V::mulf(att, V::set1f(0.75f)), V::addf(d, V::set1f(1.0f)));
+	typename V::fvec mask = V::cmpeqf(V::loadf(radius), V::set1f(0.5f));
+	typename V::vec a = V::narrowsplat(V::roundi(V::selectf(mask, att, point)));
+	typename V::vec c = V::set4(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, color >> 24);
+	V::store2px(out, V::template srli<8>(V::mullo(c, a)));
+}
+
+// Viewport mapping and clip test as in the poly triangle setup
+template<typename V> static bool VertexKernel(float *v)
+{
+	typename V::fvec x = V::loadf(v), y = V::loadf(v + 4), z = V::loadf(v + 8), w = V::loadf(v + 12);
+	V::transpose4(x, y, z, w);
+	w = V::divf(V::set1f(1.0f), w);
+	x = V::addf(V::set1f(160.0f), V::mulf(V::set1f(320.0f), V::addf(V::set1f(1.0f), V::mulf(x, w))));
+	y = V::subf(V::set1f(1.0f), V::mulf(y, w));
+	bool clipped = V::anyf(V::orf(V::cmpltf(x, V::zerof()), V::cmpltf(y, V::zerof())));
+	V::transpose4(x, y, z, w);
+	V::storef(v, x);
+	V::storef(v + 4, y);
+	V::storef(v + 8, z);
+	V::storef(v + 12, w);
+	return clipped;
+}
+
+CCMD(simd_selftest)
+{
+#ifdef SIMD_BACKEND_SCALAR
+	Printf("No vector backend in this build, nothing to compare.\n");
+#else
+	using N = simd::native;
+	using S = simd::scalar;
+
+	int iterations = argv.argc() > 1 ? atoi(argv[1]) : 100000;
+	std::mt19937 rng(iterations);
+	int errors = 0;
+
+	auto report = [&](const char *kernel, const uint32_t *a, const uint32_t *b, int count)
+	{
+		if (memcmp(a, b, count * sizeof(uint32_t)) != 0)
+		{
+			if (errors++ < 10)
+			{
+				Printf("%s: %s %08x %08x, scalar %08x %08x\n", kernel, N::Name(), a[0], a[1], b[0], b[1]);
+			}
+		}
+	};
+
+	for (int i = 0; i < iterations; i++)
+	{
+		uint32_t src[4], dst[4], out1[4] = {}, out2[4] = {};
+		for (auto &p : src) p = rng();
+		for (auto &p : dst) p = rng();
+
+		BlendKernel<N>(src, dst, out1);
+		BlendKernel<S>(src, dst, out2);
+		report("blend", out1, out2, 2);
+
+		AddSubKernel<N>(src, dst, out1);
+		AddSubKernel<S>(src, dst, out2);
+		report("add/sub", out1, out2, 4);
+
+		int r = rng() & 255, g = rng() & 255, b = rng() & 255, a = rng() % 257;
+		PaletteKernel<N>(src, r, g, b, a, out1);
+		PaletteKernel<S>(src, r, g, b, a, out2);
+		report("palette", out1, out2, 4);
+
+		out1[0] = FadeKernel<N>(src[0], dst[0], a);
+		out2[0] = FadeKernel<S>(src[0], dst[0], a);
+		report("fade", out1, out2, 1);
+
+		uint32_t out3[6] = {}, out4[6] = {};
+		if ((rng() & 3) == 0) src[1] = 0;
+		int fa0 = rng() % 257, fa1 = rng() % 257, ba0 = rng() % 257, ba1 = rng() % 257;
+		DrawerBlendKernel<N>(src, dst, fa0, fa1, ba0, ba1, out3);
+		DrawerBlendKernel<S>(src, dst, fa0, fa1, ba0, ba1, out4);
+		report("drawer blend", out3, out4, 6);
+
+		float dist[4], radius[4];
+		for (int j = 0; j < 4; j++)
+		{
+			dist[j] = (float)(rng() % 100000) / 64.0f;
+			radius[j] = (rng() & 1) ? 0.5f : (float)(rng() % 1000) / 1000.0f;
+		}
+		LightKernel<N>(dist, radius, src[2], out1);
+		LightKernel<S>(dist, radius, src[2], out2);
+		report("light", out1, out2, 2);
+
+		float v1[16], v2[16];
+		for (int j = 0; j < 16; j++) v1[j] = v2[j] = (float)((int)(rng() % 20001) - 10000) / 1000.0f;
+		bool clip1 = VertexKernel<N>(v1);
+		bool clip2 = VertexKernel<S>(v2);
+		if (clip1 != clip2 || memcmp(v1, v2, sizeof(v1)) != 0)
+		{
+			if (errors++ < 10) Printf("vertex: %s %f %f, scalar %f %f\n", N::Name(), v1[0], v1[1], v2[0], v2[1]);
+		}
+	}
+
+	Printf("%s backend: %d of %d iterations differ from the scalar backend\n", N::Name(), errors, iterations);
+#endif
+}
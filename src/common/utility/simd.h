@@ -0,0 +1,397 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+//==========================================================================
+//
+// Minimal SIMD wrapper for 32 bit BGRA pixel kernels.
+//
+// A vector holds eight 16 bit lanes, i.e. two pixels that have been
+// unpacked to one channel per lane. Every backend implements the same set
+// of operations with identical results, including the saturation rules of
+// the pack step, so kernels written against simd::native produce the same
+// pixels on SSE2, NEON and plain C++.
+//
+// For the drawers' blend and light math there are also four lane vectors
+// of 32 bit integers (ivec) and floats (fvec). Float operations follow
+// SSE semantics on every backend (min returns the second operand for NaN,
+// rounding to integer is round-to-nearest-even and NaN becomes INT32_MIN).
+// The only exception is rsqrtf, which is an approximation whose precision
+// depends on the backend.
+//
+// Define SIMD_FORCE_SCALAR to build without vector instructions.
+//
+//==========================================================================
+
+#if !defined(SIMD_FORCE_SCALAR) && !defined(NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SIMD_BACKEND_SSE2
+#include <emmintrin.h>
+#elif !defined(SIMD_FORCE_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64))
+#define SIMD_BACKEND_NEON
+#include <arm_neon.h>
+#else
+#define SIMD_BACKEND_SCALAR
+#endif
+
+namespace simd
+{
+	//==========================================================================
+	//
+	// Reference implementation
+	//
+	//==========================================================================
+
+	struct scalar
+	{
+		static const char *Name() { return "scalar"; }
+
+		struct vec { uint16_t v[8]; };
+
+		static vec zero() { vec r; memset(&r, 0, sizeof(r)); return r; }
+		static vec set1(int x) { vec r; for (int i = 0; i < 8; i++) r.v[i] = (uint16_t)x; return r; }
+		// Same four lanes for both pixels, in memory order (b, g, r, a)
+		static vec set4(int b, int g, int r, int a)
+		{
+			vec res;
+			for (int i = 0; i < 8; i += 4) { res.v[i] = (uint16_t)b; res.v[i + 1] = (uint16_t)g; res.v[i + 2] = (uint16_t)r; res.v[i + 3] = (uint16_t)a; }
+			return res;
+		}
+
+		static vec unpack(const uint8_t *p, int count)
+		{
+			vec r = zero();
+			for (int i = 0; i < count; i++) r.v[i] = p[i];
+			return r;
+		}
+		static vec load1px(uint32_t px) { return unpack((const uint8_t *)&px, 4); }
+		static vec load2px(const uint32_t *p) { return unpack((const uint8_t *)p, 8); }
+		static void load4px(const uint32_t *p, vec &lo, vec &hi) { lo = load2px(p); hi = load2px(p + 2); }
+
+		// Narrows like a signed saturating pack: < 0 becomes 0, > 255 becomes 255
+		static uint8_t pack(uint16_t x) { int16_t s = (int16_t)x; return s < 0 ? 0 : s > 255 ? 255 : (uint8_t)s; }
+		static uint32_t store1px(vec a)
+		{
+			uint8_t b[4];
+			for (int i = 0; i < 4; i++) b[i] = pack(a.v[i]);
+			uint32_t r;
+			memcpy(&r, b, 4);
+			return r;
+		}
+		static void store2px(uint32_t *p, vec a)
+		{
+			uint8_t b[8];
+			for (int i = 0; i < 8; i++) b[i] = pack(a.v[i]);
+			memcpy(p, b, 8);
+		}
+		static void store4px(uint32_t *p, vec lo, vec hi) { store2px(p, lo); store2px(p + 2, hi); }
+
+		static vec add(vec a, vec b) { for (int i = 0; i < 8; i++) a.v[i] = (uint16_t)(a.v[i] + b.v[i]); return a; }
+		static vec sub(vec a, vec b) { for (int i = 0; i < 8; i++) a.v[i] = (uint16_t)(a.v[i] - b.v[i]); return a; }
+		static vec mullo(vec a, vec b) { for (int i = 0; i < 8; i++) a.v[i] = (uint16_t)(a.v[i] * b.v[i]); return a; }
+		static vec adds(vec a, vec b) { for (int i = 0; i < 8; i++) { int s = a.v[i] + b.v[i]; a.v[i] = (uint16_t)(s > 0xffff ? 0xffff : s); } return a; }
+		static vec subs(vec a, vec b) { for (int i = 0; i < 8; i++) { int s = a.v[i] - b.v[i]; a.v[i] = (uint16_t)(s < 0 ? 0 : s); } return a; }
+		template<int N> static vec srli(vec a) { for (int i = 0; i < 8; i++) a.v[i] = (uint16_t)(a.v[i] >> N); return a; }
+		// Broadcasts each pixel's alpha to all its channels
+		static vec splatalpha(vec a) { for (int i = 0; i < 8; i++) a.v[i] = a.v[(i & 4) + 3]; return a; }
+
+		static vec set8(int l0, int l1, int l2, int l3, int l4, int l5, int l6, int l7)
+		{
+			vec r = { { (uint16_t)l0, (uint16_t)l1, (uint16_t)l2, (uint16_t)l3, (uint16_t)l4, (uint16_t)l5, (uint16_t)l6, (uint16_t)l7 } };
+			return r;
+		}
+		// Signed 16 bit minimum
+		static vec min(vec a, vec b) { for (int i = 0; i < 8; i++) a.v[i] = (int16_t)a.v[i] < (int16_t)b.v[i] ? a.v[i] : b.v[i]; return a; }
+		// Lanes of a where mask is set, otherwise lanes of b
+		static vec select(vec mask, vec a, vec b) { for (int i = 0; i < 8; i++) a.v[i] = (a.v[i] & mask.v[i]) | (b.v[i] & ~mask.v[i]); return a; }
+		// Mask covering the pixels that store as 0
+		static vec pixeliszero(vec a)
+		{
+			for (int p = 0; p < 8; p += 4)
+			{
+				bool zero = pack(a.v[p]) == 0 && pack(a.v[p + 1]) == 0 && pack(a.v[p + 2]) == 0 && pack(a.v[p + 3]) == 0;
+				for (int i = p; i < p + 4; i++) a.v[i] = zero ? 0xffff : 0;
+			}
+			return a;
+		}
+
+		struct ivec { int32_t v[4]; };
+
+		// Zero extends lanes 0-3 or 4-7 to 32 bit
+		static ivec widenlo(vec a) { ivec r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i]; return r; }
+		static ivec widenhi(vec a) { ivec r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i + 4]; return r; }
+		static int16_t narrow(int32_t x) { return (int16_t)(x < -32768 ? -32768 : x > 32767 ? 32767 : x); }
+		// Narrows with signed saturation, lo to lanes 0-3 and hi to lanes 4-7
+		static vec narrow(ivec lo, ivec hi)
+		{
+			vec r;
+			for (int i = 0; i < 4; i++) { r.v[i] = (uint16_t)narrow(lo.v[i]); r.v[i + 4] = (uint16_t)narrow(hi.v[i]); }
+			return r;
+		}
+		// Narrows with signed saturation, lane 0 to the first pixel and lane 1 to the second
+		static vec narrowsplat(ivec a)
+		{
+			vec r;
+			for (int i = 0; i < 8; i++) r.v[i] = (uint16_t)narrow(a.v[i >> 2]);
+			return r;
+		}
+		static ivec addi(ivec a, ivec b) { for (int i = 0; i < 4; i++) a.v[i] = (int32_t)((uint32_t)a.v[i] + (uint32_t)b.v[i]); return a; }
+		static ivec subi(ivec a, ivec b) { for (int i = 0; i < 4; i++) a.v[i] = (int32_t)((uint32_t)a.v[i] - (uint32_t)b.v[i]); return a; }
+		template<int N> static ivec srai(ivec a) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] >> N; return a; }
+
+		struct fvec { float v[4]; };
+
+		static float maskbits(bool set) { uint32_t u = set ? 0xffffffff : 0; float f; memcpy(&f, &u, 4); return f; }
+		static uint32_t bits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+
+		static fvec zerof() { fvec r = { { 0.0f, 0.0f, 0.0f, 0.0f } }; return r; }
+		static fvec set1f(float x) { fvec r = { { x, x, x, x } }; return r; }
+		static fvec setrf(float a, float b, float c, float d) { fvec r = { { a, b, c, d } }; return r; }
+		static fvec loadf(const float *p) { fvec r; memcpy(r.v, p, sizeof(r.v)); return r; }
+		static void storef(float *p, fvec a) { memcpy(p, a.v, sizeof(a.v)); }
+		static fvec addf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+		static fvec subf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+		static fvec mulf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+		static fvec divf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+		static fvec minf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+		static fvec rsqrtf(fvec a) { for (int i = 0; i < 4; i++) a.v[i] = 1.0f / sqrtf(a.v[i]); return a; }
+		static fvec cmpltf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] = maskbits(a.v[i] < b.v[i]); return a; }
+		static fvec cmpeqf(fvec a, fvec b) { for (int i = 0; i < 4; i++) a.v[i] = maskbits(a.v[i] == b.v[i]); return a; }
+		static fvec orf(fvec a, fvec b) { for (int i = 0; i < 4; i++) { uint32_t u = bits(a.v[i]) | bits(b.v[i]); memcpy(&a.v[i], &u, 4); } return a; }
+		static fvec selectf(fvec mask, fvec a, fvec b) { for (int i = 0; i < 4; i++) if (!bits(mask.v[i])) a.v[i] = b.v[i]; return a; }
+		// True if any lane of a comparison mask is set
+		static bool anyf(fvec mask) { for (int i = 0; i < 4; i++) if (bits(mask.v[i])) return true; return false; }
+		static ivec roundi(fvec a)
+		{
+			ivec r;
+			for (int i = 0; i < 4; i++) r.v[i] = (a.v[i] != a.v[i] || fabsf(a.v[i]) >= 2147483648.0f) ? INT32_MIN : (int32_t)lrintf(a.v[i]);
+			return r;
+		}
+		static void transpose4(fvec &a, fvec &b, fvec &c, fvec &d)
+		{
+			fvec m[4] = { a, b, c, d };
+			for (int i = 0; i < 4; i++) { a.v[i] = m[i].v[0]; b.v[i] = m[i].v[1]; c.v[i] = m[i].v[2]; d.v[i] = m[i].v[3]; }
+		}
+	};
+
+#ifdef SIMD_BACKEND_SSE2
+	struct sse2
+	{
+		static const char *Name() { return "SSE2"; }
+
+		typedef __m128i vec;
+
+		static vec zero() { return _mm_setzero_si128(); }
+		static vec set1(int x) { return _mm_set1_epi16((short)x); }
+		static vec set4(int b, int g, int r, int a) { return _mm_setr_epi16((short)b, (short)g, (short)r, (short)a, (short)b, (short)g, (short)r, (short)a); }
+
+		static vec load1px(uint32_t px) { return _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)px), _mm_setzero_si128()); }
+		static vec load2px(const uint32_t *p) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128()); }
+		static void load4px(const uint32_t *p, vec &lo, vec &hi)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *)p);
+			lo = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+			hi = _mm_unpackhi_epi8(v, _mm_setzero_si128());
+		}
+
+		static uint32_t store1px(vec a) { return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(a, _mm_setzero_si128())); }
+		static void store2px(uint32_t *p, vec a) { _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(a, a)); }
+		static void store4px(uint32_t *p, vec lo, vec hi) { _mm_storeu_si128((__m128i *)p, _mm_packus_epi16(lo, hi)); }
+
+		static vec add(vec a, vec b) { return _mm_add_epi16(a, b); }
+		static vec sub(vec a, vec b) { return _mm_sub_epi16(a, b); }
+		static vec mullo(vec a, vec b) { return _mm_mullo_epi16(a, b); }
+		static vec adds(vec a, vec b) { return _mm_adds_epu16(a, b); }
+		static vec subs(vec a, vec b) { return _mm_subs_epu16(a, b); }
+		template<int N> static vec srli(vec a) { return _mm_srli_epi16(a, N); }
+		static vec splatalpha(vec a) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)); }
+
+		static vec set8(int l0, int l1, int l2, int l3, int l4, int l5, int l6, int l7) { return _mm_setr_epi16((short)l0, (short)l1, (short)l2, (short)l3, (short)l4, (short)l5, (short)l6, (short)l7); }
+		static vec min(vec a, vec b) { return _mm_min_epi16(a, b); }
+		static vec select(vec mask, vec a, vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+		static vec pixeliszero(vec a)
+		{
+			__m128i mask = _mm_cmpeq_epi32(_mm_packus_epi16(a, _mm_setzero_si128()), _mm_setzero_si128());
+			return _mm_unpacklo_epi8(mask, mask);
+		}
+
+		typedef __m128i ivec;
+
+		static ivec widenlo(vec a) { return _mm_unpacklo_epi16(a, _mm_setzero_si128()); }
+		static ivec widenhi(vec a) { return _mm_unpackhi_epi16(a, _mm_setzero_si128()); }
+		static vec narrow(ivec lo, ivec hi) { return _mm_packs_epi32(lo, hi); }
+		static vec narrowsplat(ivec a) { return _mm_packs_epi32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 1, 1, 1))); }
+		static ivec addi(ivec a, ivec b) { return _mm_add_epi32(a, b); }
+		static ivec subi(ivec a, ivec b) { return _mm_sub_epi32(a, b); }
+		template<int N> static ivec srai(ivec a) { return _mm_srai_epi32(a, N); }
+
+		typedef __m128 fvec;
+
+		static fvec zerof() { return _mm_setzero_ps(); }
+		static fvec set1f(float x) { return _mm_set1_ps(x); }
+		static fvec setrf(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+		static fvec loadf(const float *p) { return _mm_loadu_ps(p); }
+		static void storef(float *p, fvec a) { _mm_storeu_ps(p, a); }
+		static fvec addf(fvec a, fvec b) { return _mm_add_ps(a, b); }
+		static fvec subf(fvec a, fvec b) { return _mm_sub_ps(a, b); }
+		static fvec mulf(fvec a, fvec b) { return _mm_mul_ps(a, b); }
+		static fvec divf(fvec a, fvec b) { return _mm_div_ps(a, b); }
+		static fvec minf(fvec a, fvec b) { return _mm_min_ps(a, b); }
+		static fvec rsqrtf(fvec a) { return _mm_rsqrt_ps(a); }
+		static fvec cmpltf(fvec a, fvec b) { return _mm_cmplt_ps(a, b); }
+		static fvec cmpeqf(fvec a, fvec b) { return _mm_cmpeq_ps(a, b); }
+		static fvec orf(fvec a, fvec b) { return _mm_or_ps(a, b); }
+		static fvec selectf(fvec mask, fvec a, fvec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static bool anyf(fvec mask) { return _mm_movemask_ps(mask) != 0; }
+		static ivec roundi(fvec a) { return _mm_cvtps_epi32(a); }
+		static void transpose4(fvec &a, fvec &b, fvec &c, fvec &d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+	};
+	typedef sse2 native;
+#endif
+
+#ifdef SIMD_BACKEND_NEON
+	struct neon
+	{
+		static const char *Name() { return "NEON"; }
+
+		typedef uint16x8_t vec;
+
+		static vec zero() { return vdupq_n_u16(0); }
+		static vec set1(int x) { return vdupq_n_u16((uint16_t)x); }
+		static vec set4(int b, int g, int r, int a)
+		{
+			const uint16_t lanes[8] = { (uint16_t)b, (uint16_t)g, (uint16_t)r, (uint16_t)a, (uint16_t)b, (uint16_t)g, (uint16_t)r, (uint16_t)a };
+			return vld1q_u16(lanes);
+		}
+
+		static vec load1px(uint32_t px) { return vmovl_u8(vreinterpret_u8_u32(vset_lane_u32(px, vdup_n_u32(0), 0))); }
+		static vec load2px(const uint32_t *p) { return vmovl_u8(vld1_u8((const uint8_t *)p)); }
+		static void load4px(const uint32_t *p, vec &lo, vec &hi)
+		{
+			uint8x16_t v = vld1q_u8((const uint8_t *)p);
+			lo = vmovl_u8(vget_low_u8(v));
+			hi = vmovl_u8(vget_high_u8(v));
+		}
+
+		static uint8x8_t pack(vec a) { return vqmovun_s16(vreinterpretq_s16_u16(a)); }
+		static uint32_t store1px(vec a) { return vget_lane_u32(vreinterpret_u32_u8(pack(a)), 0); }
+		static void store2px(uint32_t *p, vec a) { vst1_u8((uint8_t *)p, pack(a)); }
+		static void store4px(uint32_t *p, vec lo, vec hi) { vst1q_u8((uint8_t *)p, vcombine_u8(pack(lo), pack(hi))); }
+
+		static vec add(vec a, vec b) { return vaddq_u16(a, b); }
+		static vec sub(vec a, vec b) { return vsubq_u16(a, b); }
+		static vec mullo(vec a, vec b) { return vmulq_u16(a, b); }
+		static vec adds(vec a, vec b) { return vqaddq_u16(a, b); }
+		static vec subs(vec a, vec b) { return vqsubq_u16(a, b); }
+		template<int N> static vec srli(vec a) { return vshrq_n_u16(a, N); }
+		static vec splatalpha(vec a) { return vcombine_u16(vdup_lane_u16(vget_low_u16(a), 3), vdup_lane_u16(vget_high_u16(a), 3)); }
+
+		static vec set8(int l0, int l1, int l2, int l3, int l4, int l5, int l6, int l7)
+		{
+			const uint16_t lanes[8] = { (uint16_t)l0, (uint16_t)l1, (uint16_t)l2, (uint16_t)l3, (uint16_t)l4, (uint16_t)l5, (uint16_t)l6, (uint16_t)l7 };
+			return vld1q_u16(lanes);
+		}
+		static vec min(vec a, vec b) { return vreinterpretq_u16_s16(vminq_s16(vreinterpretq_s16_u16(a), vreinterpretq_s16_u16(b))); }
+		static vec select(vec mask, vec a, vec b) { return vbslq_u16(mask, a, b); }
+		static vec pixeliszero(vec a)
+		{
+			uint32x2_t mask = vceq_u32(vreinterpret_u32_u8(pack(a)), vdup_n_u32(0));
+			return vcombine_u16(vreinterpret_u16_u32(vdup_lane_u32(mask, 0)), vreinterpret_u16_u32(vdup_lane_u32(mask, 1)));
+		}
+
+		typedef int32x4_t ivec;
+
+		static ivec widenlo(vec a) { return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(a))); }
+		static ivec widenhi(vec a) { return vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(a))); }
+		static vec narrow(ivec lo, ivec hi) { return vreinterpretq_u16_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))); }
+		static vec narrowsplat(ivec a)
+		{
+			int16x4_t n = vqmovn_s32(a);
+			return vreinterpretq_u16_s16(vcombine_s16(vdup_lane_s16(n, 0), vdup_lane_s16(n, 1)));
+		}
+		static ivec addi(ivec a, ivec b) { return vaddq_s32(a, b); }
+		static ivec subi(ivec a, ivec b) { return vsubq_s32(a, b); }
+		template<int N> static ivec srai(ivec a) { return vshrq_n_s32(a, N); }
+
+		typedef float32x4_t fvec;
+
+		static fvec zerof() { return vdupq_n_f32(0.0f); }
+		static fvec set1f(float x) { return vdupq_n_f32(x); }
+		static fvec setrf(float a, float b, float c, float d)
+		{
+			const float lanes[4] = { a, b, c, d };
+			return vld1q_f32(lanes);
+		}
+		static fvec loadf(const float *p) { return vld1q_f32(p); }
+		static void storef(float *p, fvec a) { vst1q_f32(p, a); }
+		static fvec addf(fvec a, fvec b) { return vaddq_f32(a, b); }
+		static fvec subf(fvec a, fvec b) { return vsubq_f32(a, b); }
+		static fvec mulf(fvec a, fvec b) { return vmulq_f32(a, b); }
+#if defined(__aarch64__) || defined(_M_ARM64)
+		static fvec divf(fvec a, fvec b) { return vdivq_f32(a, b); }
+#else
+		static fvec divf(fvec a, fvec b)
+		{
+			float x[4], y[4];
+			vst1q_f32(x, a);
+			vst1q_f32(y, b);
+			for (int i = 0; i < 4; i++) x[i] /= y[i];
+			return vld1q_f32(x);
+		}
+#endif
+		// vminq_f32 would propagate NaN where SSE returns the second operand
+		static fvec minf(fvec a, fvec b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+		// The estimate alone only has 8 bits of precision. One refinement step brings it past SSE's 12 bits.
+		static fvec rsqrtf(fvec a)
+		{
+			float32x4_t e = vrsqrteq_f32(a);
+			return vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a, e), e));
+		}
+		static fvec cmpltf(fvec a, fvec b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+		static fvec cmpeqf(fvec a, fvec b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+		static fvec orf(fvec a, fvec b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+		static fvec selectf(fvec mask, fvec a, fvec b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+		static bool anyf(fvec mask)
+		{
+			uint32x4_t m = vreinterpretq_u32_f32(mask);
+			uint32x2_t m2 = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+			return (vget_lane_u32(m2, 0) | vget_lane_u32(m2, 1)) != 0;
+		}
+#if defined(__aarch64__) || defined(_M_ARM64)
+		static ivec roundi(fvec a)
+		{
+			// Out of range values already saturate to INT32_MIN/INT32_MAX, so only NaN needs fixing up.
+			uint32x4_t isnum = vceqq_f32(a, a);
+			uint32x4_t inrange = vcltq_f32(vabsq_f32(a), vdupq_n_f32(2147483648.0f));
+			return vbslq_s32(vandq_u32(isnum, inrange), vcvtnq_s32_f32(a), vdupq_n_s32(INT32_MIN));
+		}
+#else
+		static ivec roundi(fvec a)
+		{
+			float x[4];
+			int32_t r[4];
+			vst1q_f32(x, a);
+			for (int i = 0; i < 4; i++) r[i] = (x[i] != x[i] || fabsf(x[i]) >= 2147483648.0f) ? INT32_MIN : (int32_t)lrintf(x[i]);
+			return vld1q_s32(r);
+		}
+#endif
+		static void transpose4(fvec &a, fvec &b, fvec &c, fvec &d)
+		{
+			float32x4x2_t ac = vzipq_f32(a, c);
+			float32x4x2_t bd = vzipq_f32(b, d);
+			float32x4x2_t lo = vzipq_f32(ac.val[0], bd.val[0]);
+			float32x4x2_t hi = vzipq_f32(ac.val[1], bd.val[1]);
+			a = lo.val[0];
+			b = lo.val[1];
+			c = hi.val[0];
+			d = hi.val[1];
+		}
+	};
+	typedef neon native;
+#endif
+
+#ifdef SIMD_BACKEND_SCALAR
+	typedef scalar native;
+#endif
+}
@@ -0,0 +1,230 @@
+/*
+** workstealing.cpp
+** Fork/join pool with per-participant ranges and range stealing
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Each participant's remaining work is packed into a single 64 bit word so
+** that both the owner (taking from the front) and thieves (taking the back
+** half) can claim indices with one compare-and-swap.
+**
+*/
+
+#include <algorithm>
+#include "workstealing.h"
+
+static inline uint64_t PackRange(uint32_t start, uint32_t end)
+{
+	return (uint64_t(start) << 32) | end;
+}
+
+FWorkStealingPool::~FWorkStealingPool()
+{
+	Stop();
+}
+
+//==========================================================================
+//
+// Thread management
+//
+//==========================================================================
+
+void FWorkStealingPool::SetThreadCount(int count)
+{
+	count = std::max(0, std::min(count, (int)MAX_PARTICIPANTS - 1));
+	if (count == (int)Threads.size()) return;
+
+	Stop();
+	Quit = false;
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t generation = Generation;
+		Threads.emplace_back([=]() { WorkerMain(i + 1, generation); });
+	}
+}
+
+void FWorkStealingPool::Stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Quit = true;
+	}
+	WakeUp.notify_all();
+	for (auto &thread : Threads) thread.join();
+	Threads.clear();
+}
+
+void FWorkStealingPool::WorkerMain(int index, uint64_t generation)
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WakeUp.wait(lock, [&]() { return Quit || Generation != generation; });
+			if (Quit) return;
+			generation = Generation;
+		}
+
+		if (index < Participants) Participate(index);
+
+		std::unique_lock<std::mutex> lock(Mutex);
+		if (--Running == 0) Finished.notify_all();
+	}
+}
+
+//==========================================================================
+//
+// Runs body over [0, count) and waits for all of it to complete.
+// An exception thrown by the body is rethrown on the calling thread
+// once every participant has stopped.
+//
+//==========================================================================
+
+void FWorkStealingPool::Run(int count, int grain, const Body &body)
+{
+	if (count <= 0) return;
+	grain = std::max(grain, 1);
+	if (Threads.empty() || count <= grain)
+	{
+		body(0, count);
+		return;
+	}
+
+	Participants = std::min((int)Threads.size() + 1, (count + grain - 1) / grain);
+	for (int i = 0; i < Participants; i++)
+	{
+		uint32_t start = uint32_t(int64_t(count) * i / Participants);
+		uint32_t end = uint32_t(int64_t(count) * (i + 1) / Participants);
+		Ranges[i].Bounds.store(PackRange(start, end), std::memory_order_relaxed);
+	}
+	CurrentBody = &body;
+	Grain = grain;
+	Error = nullptr;
+	Remaining.store(count, std::memory_order_release);
+
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Running = (int)Threads.size();
+		Generation++;
+	}
+	WakeUp.notify_all();
+
+	Participate(0);
+
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Finished.wait(lock, [&]() { return Running == 0; });
+	}
+	CurrentBody = nullptr;
+
+	if (Error)
+	{
+		std::exception_ptr error = Error;
+		Error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+//==========================================================================
+//
+// Work loop of a single participant
+//
+//==========================================================================
+
+void FWorkStealingPool::Participate(int index)
+{
+	int start, end;
+	while (true)
+	{
+		while (TakeOwn(index, start, end))
+		{
+			try
+			{
+				(*CurrentBody)(start, end);
+			}
+			catch (...)
+			{
+				std::unique_lock<std::mutex> lock(Mutex);
+				if (!Error) Error = std::current_exception();
+			}
+			Remaining.fetch_sub(end - start, std::memory_order_acq_rel);
+		}
+
+		if (Remaining.load(std::memory_order_acquire) == 0) return;
+		if (!Steal(index))
+		{
+			// Everything left is already being processed by someone else.
+			if (Remaining.load(std::memory_order_acquire) == 0) return;
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool FWorkStealingPool::TakeOwn(int index, int &start, int &end)
+{
+	auto &bounds = Ranges[index].Bounds;
+	uint64_t value = bounds.load(std::memory_order_acquire);
+	while (true)
+	{
+		uint32_t first = uint32_t(value >> 32);
+		uint32_t last = uint32_t(value);
+		if (first >= last) return false;
+
+		uint32_t next = std::min(first + (uint32_t)Grain, last);
+		if (bounds.compare_exchange_weak(value, PackRange(next, last), std::memory_order_acq_rel))
+		{
+			start = first;
+			end = next;
+			return true;
+		}
+	}
+}
+
+bool FWorkStealingPool::Steal(int thief)
+{
+	for (int i = 1; i < Participants; i++)
+	{
+		auto &bounds = Ranges[(thief + i) % Participants].Bounds;
+		uint64_t value = bounds.load(std::memory_order_acquire);
+		uint32_t first = uint32_t(value >> 32);
+		uint32_t last = uint32_t(value);
+		if (first >= last) continue;
+
+		// Take the back half, or all of it if it is less than a chunk.
+		uint32_t count = last - first;
+		uint32_t mid = count > (uint32_t)Grain ? first + count / 2 : first;
+		if (bounds.compare_exchange_strong(value, PackRange(first, mid), std::memory_order_acq_rel))
+		{
+			// Our own range is empty here so nobody else is modifying it.
+			Ranges[thief].Bounds.store(PackRange(mid, last), std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==========================================================================
+//
+// A small fork/join pool for data parallel loops.
+//
+// Every participant (the calling thread included) starts with an equal
+// slice of the index range and takes grain sized chunks from its front.
+// Once its own slice is exhausted it steals the back half of another
+// participant's remaining slice. Run() returns after all indices have been
+// processed, so the caller never observes partial results.
+//
+//==========================================================================
+
+class FWorkStealingPool
+{
+public:
+	using Body = std::function<void(int start, int end)>;
+
+	~FWorkStealingPool();
+
+	void SetThreadCount(int count);
+	int ThreadCount() const { return (int)Threads.size(); }
+
+	void Run(int count, int grain, const Body &body);
+
+private:
+	enum { MAX_PARTICIPANTS = 32 };
+
+	struct alignas(64) FRange
+	{
+		std::atomic<uint64_t> Bounds { 0 };	// (begin << 32) | end
+	};
+
+	void Stop();
+	void WorkerMain(int index, uint64_t generation);
+	void Participate(int index);
+	bool TakeOwn(int index, int &start, int &end);
+	bool Steal(int thief);
+
+	std::vector<std::thread> Threads;
+	FRange Ranges[MAX_PARTICIPANTS];
+
+	std::mutex Mutex;
+	std::condition_variable WakeUp;
+	std::condition_variable Finished;
+	uint64_t Generation = 0;
+	int Running = 0;
+	bool Quit = false;
+
+	const Body *CurrentBody = nullptr;
+	int Grain = 1;
+	int Participants = 1;
+	std::atomic<int> Remaining { 0 };
+	std::exception_ptr Error;
+};
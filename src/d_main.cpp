@@ -118,6 +118,7 @@
 #include "hw_clock.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "doomfont.h"
+#include "g_benchmark.h"
 
 #ifdef __unix__
 #include "i_system.h"  // for SHARE_DIR
@@ -939,6 +940,7 @@ void D_Display ()
 
 	screen->FrameTime = I_msTimeFS();
 	TexAnim.UpdateAnimations(screen->FrameTime);
+	UpdateUpscaleQueue();
 	R_UpdateSky(screen->FrameTime);
 	screen->BeginFrame();
 	twod->ClearClipRect();
@@ -1212,7 +1214,9 @@ void D_DoomLoop ()
 					D_DoAdvanceDemo ();
 				C_Ticker ();
 				M_Ticker ();
+				G_BenchStartTic ();
 				G_Ticker ();
+				G_BenchEndTic ();
 				// [RH] Use the consoleplayer's camera to update sounds
 				S_UpdateSounds (players[consoleplayer].camera);	// move positional sounds
 				gametic++;
@@ -3052,6 +3056,7 @@ static int D_DoomMain_Internal (void)
 	
 	std::set_new_handler(NewFailure);
 	const char *batchout = Args->CheckValue("-errorlog");
+	G_BenchInit();
 	
 	C_InitConsole(80*8, 25*8, false);
 	Printf("%s version: %s\n", GAMENAME, GetVersionString());
@@ -3530,7 +3535,8 @@ static int D_DoomMain_Internal (void)
 				return 1337; // special exit
 			}
 
-			V_Init2();
+			// A headless benchmark keeps the dummy framebuffer and never opens a window.
+			if (!benchheadless) V_Init2();
 			twod->fullscreenautoaspect = gameinfo.fullscreenautoaspect;
 			// Initialize the size of the 2D drawer so that an attempt to access it outside the draw code won't crash.
 			twod->Begin(screen->GetWidth(), screen->GetHeight());
@@ -3675,6 +3681,8 @@ int GameMain()
 
 void D_Cleanup()
 {
+	G_PollPendingSave(true);
+
 	if (demorecording)
 	{
 		G_CheckDemoStatus();
@@ -0,0 +1,378 @@
+/*
+** g_benchmark.cpp
+** Headless demo benchmarking with a machine readable per-tic report
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The report is written once the timed demo ends. Each tic records the time
+** spent in G_Ticker, the VM time accumulated during it and the number of
+** thinkers that were ticked, so regressions in the playsim can be tracked
+** on machines without a display.
+**
+** Each tic also records a hash of all actors' positions and states, so two
+** runs of the same demo can be checked for identical game play.
+**
+*/
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+
+#define RAPIDJSON_48BITPOINTER_OPTIMIZATION 0	// disable this insanity which is bound to make the code break over time.
+#define RAPIDJSON_HAS_CXX11_RVALUE_REFS 1
+#define RAPIDJSON_HAS_CXX11_RANGE_FOR 1
+#include "rapidjson/document.h"
+
+#include "g_benchmark.h"
+#include "m_argv.h"
+#include "stats.h"
+#include "i_time.h"
+#include "printf.h"
+#include "version.h"
+#include "doomstat.h"
+#include "gamestate.h"
+#include "g_levellocals.h"
+#include "files.h"
+#include "m_crc32.h"
+
+extern bool timingdemo;
+extern FString defdemoname;
+extern cycle_t VMCycles[10];
+extern cycle_t ThinkCycles;
+extern int ThinkCount;
+
+bool benchheadless;
+
+struct FBenchTic
+{
+	double PlaysimMS;
+	double ThinkMS;
+	double VMMS;
+	int Thinkers;
+	int Actors;
+	uint32_t StateHash;
+};
+
+static FString BenchFile;
+static FString BenchCompareFile;
+static TArray<FBenchTic> BenchTics;
+static cycle_t BenchTicCycles;
+static double BenchVMStart;
+static uint64_t BenchStartTime;
+
+//==========================================================================
+//
+// Peak resident set size of the process in KB
+//
+//==========================================================================
+
+static uint64_t GetPeakMemoryKB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+	{
+		return pmc.PeakWorkingSetSize / 1024;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;	// reported in bytes on macOS
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+	return 0;
+#endif
+}
+
+//==========================================================================
+//
+// G_BenchInit
+//
+// Checks the command line for the benchmark parameters. Must be called
+// before the sound and video backends are set up.
+//
+//==========================================================================
+
+void G_BenchInit()
+{
+	const char *v = Args->CheckValue("-benchmark");
+	if (v != nullptr)
+	{
+		benchheadless = true;
+		// Run the regular -timedemo path without any drawing and sound.
+		Args->AppendArg("-timedemo");
+		Args->AppendArg(v);
+		if (!Args->CheckParm("-nodraw")) Args->AppendArg("-nodraw");
+		if (!Args->CheckParm("-nosound")) Args->AppendArg("-nosound");
+		BenchFile = "benchmark.json";
+	}
+	v = Args->CheckValue("-benchout");
+	if (v != nullptr)
+	{
+		BenchFile = v;
+	}
+	v = Args->CheckValue("-benchcompare");
+	if (v != nullptr)
+	{
+		BenchCompareFile = v;
+	}
+}
+
+bool G_BenchActive()
+{
+	return timingdemo && BenchFile.IsNotEmpty();
+}
+
+//==========================================================================
+//
+// Per-tic bookkeeping
+//
+//==========================================================================
+
+void G_BenchStartTic()
+{
+	if (!G_BenchActive() || gamestate != GS_LEVEL) return;
+
+	if (BenchTics.Size() == 0)
+	{
+		BenchStartTime = I_msTime();
+	}
+	BenchVMStart = VMCycles[0].TimeMS();
+	BenchTicCycles.Reset();
+	BenchTicCycles.Clock();
+}
+
+void G_BenchEndTic()
+{
+	if (!G_BenchActive() || gamestate != GS_LEVEL) return;
+
+	BenchTicCycles.Unclock();
+
+	FBenchTic &tic = BenchTics[BenchTics.Reserve(1)];
+	tic.PlaysimMS = BenchTicCycles.TimeMS();
+	tic.ThinkMS = ThinkCycles.TimeMS();
+	tic.VMMS = VMCycles[0].TimeMS() - BenchVMStart;
+	tic.Thinkers = ThinkCount;
+	tic.Actors = 0;
+
+	// Only use values that do not depend on where things are in memory.
+	uint32_t hash = 0;
+	auto add = [&](const auto &v) { hash = AddCRC32(hash, (const uint8_t *)&v, sizeof(v)); };
+
+	auto it = primaryLevel->GetThinkerIterator<AActor>();
+	AActor *ac;
+	while ((ac = it.Next()))
+	{
+		tic.Actors++;
+		add(ac->X());
+		add(ac->Y());
+		add(ac->Z());
+		add(ac->Angles.Yaw.Degrees);
+		add(ac->health);
+		add(ac->sprite);
+		add(ac->frame);
+		add(ac->tics);
+	}
+	tic.StateHash = hash;
+}
+
+//==========================================================================
+//
+// Compares the game state of each tic with an earlier report, to check
+// that changes which are only supposed to make things faster do not
+// change how a demo plays out.
+//
+//==========================================================================
+
+static bool CompareReport(const char *filename)
+{
+	FileReader fr;
+	TArray<uint8_t> text;
+	if (fr.OpenFile(filename)) text = fr.ReadPadded(1);
+	if (text.Size() == 0)
+	{
+		Printf("Unable to read benchmark report %s\n", filename);
+		return false;
+	}
+
+	rapidjson::Document doc;
+	doc.Parse((const char *)text.Data());
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("tics") || !doc["tics"].IsArray())
+	{
+		Printf("%s is not a benchmark report\n", filename);
+		return false;
+	}
+
+	auto &tics = doc["tics"];
+	unsigned count = std::min<unsigned>(tics.Size(), BenchTics.Size());
+	for (unsigned i = 0; i < count; i++)
+	{
+		auto &tic = tics[i];
+		if (!tic.IsObject() || !tic.HasMember("state") || !tic["state"].IsUint())
+		{
+			Printf("%s has no game state for tic %u\n", filename, i);
+			return false;
+		}
+		if (tic["state"].GetUint() != BenchTics[i].StateHash)
+		{
+			Printf(TEXTCOLOR_RED "Game state differs from %s at tic %u\n", filename, i);
+			return false;
+		}
+	}
+	if (tics.Size() != BenchTics.Size())
+	{
+		Printf(TEXTCOLOR_RED "%s has %u tics, this run has %u\n", filename, tics.Size(), BenchTics.Size());
+		return false;
+	}
+	Printf("Game state matches %s in all %u tics\n", filename, count);
+	return true;
+}
+
+//==========================================================================
+//
+// G_BenchWriteReport
+//
+// Writes the collected data as JSON. Called when the timed demo ends.
+// Returns false if -benchcompare found a difference.
+//
+//==========================================================================
+
+// Quotes a string for JSON output. The demo name comes from the command line
+// and may contain anything, including backslashes from Windows paths.
+static FString JSONString(const char *str)
+{
+	FString out = "\"";
+	for (; *str != 0; str++)
+	{
+		uint8_t c = (uint8_t)*str;
+		switch (c)
+		{
+		case '"':	out += "\\\""; break;
+		case '\\':	out += "\\\\"; break;
+		case '\b':	out += "\\b"; break;
+		case '\f':	out += "\\f"; break;
+		case '\n':	out += "\\n"; break;
+		case '\r':	out += "\\r"; break;
+		case '\t':	out += "\\t"; break;
+		default:
+			if (c < 0x20) out.AppendFormat("\\u%04x", c);
+			else out += (char)c;
+			break;
+		}
+	}
+	out += "\"";
+	return out;
+}
+
+static void WriteSummary(FILE *f, const char *name, TArray<double> &values)
+{
+	double total = 0, peak = 0;
+	for (auto v : values)
+	{
+		total += v;
+		peak = std::max(peak, v);
+	}
+	std::sort(values.begin(), values.end());
+
+	auto percentile = [&](double p) -> double
+	{
+		if (values.Size() == 0) return 0;
+		unsigned index = unsigned(p * (values.Size() - 1) + 0.5);
+		return values[index];
+	};
+
+	fprintf(f, "\t\t%s: { \"total\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+		JSONString(name).GetChars(), total, values.Size() ? total / values.Size() : 0., percentile(0.5), percentile(0.95), percentile(0.99), peak);
+}
+
+bool G_BenchWriteReport(int gametics)
+{
+	if (!G_BenchActive()) return true;
+
+	// Compare first, the report may be written over the one to compare with.
+	bool same = BenchCompareFile.IsEmpty() || CompareReport(BenchCompareFile.GetChars());
+
+	uint64_t realms = BenchTics.Size() > 0 ? I_msTime() - BenchStartTime : 0;
+
+	FILE *f = fopen(BenchFile.GetChars(), "w");
+	if (f == nullptr)
+	{
+		Printf("Unable to write benchmark report to %s\n", BenchFile.GetChars());
+		BenchTics.Clear();
+		return same;
+	}
+
+	TArray<double> playsim, think, vm;
+	for (auto &tic : BenchTics)
+	{
+		playsim.Push(tic.PlaysimMS);
+		think.Push(tic.ThinkMS);
+		vm.Push(tic.VMMS);
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "\t\"version\": %s,\n", JSONString(GetVersionString()).GetChars());
+	fprintf(f, "\t\"demo\": %s,\n", JSONString(defdemoname.GetChars()).GetChars());
+	fprintf(f, "\t\"headless\": %s,\n", benchheadless ? "true" : "false");
+	fprintf(f, "\t\"gametics\": %d,\n", gametics);
+	fprintf(f, "\t\"measuredtics\": %u,\n", BenchTics.Size());
+	fprintf(f, "\t\"realtime_ms\": %llu,\n", (unsigned long long)realms);
+	fprintf(f, "\t\"peakmemory_kb\": %llu,\n", (unsigned long long)GetPeakMemoryKB());
+	fprintf(f, "\t\"summary\": {\n");
+	WriteSummary(f, "playsim_ms", playsim);
+	fprintf(f, ",\n");
+	WriteSummary(f, "think_ms", think);
+	fprintf(f, ",\n");
+	WriteSummary(f, "vm_ms", vm);
+	fprintf(f, "\n\t},\n");
+	fprintf(f, "\t\"tics\": [\n");
+	for (unsigned i = 0; i < BenchTics.Size(); i++)
+	{
+		auto &tic = BenchTics[i];
+		fprintf(f, "\t\t{ \"playsim_ms\": %.4f, \"think_ms\": %.4f, \"vm_ms\": %.4f, \"thinkers\": %d, \"actors\": %d, \"state\": %u }%s\n",
+			tic.PlaysimMS, tic.ThinkMS, tic.VMMS, tic.Thinkers, tic.Actors, tic.StateHash, i + 1 < BenchTics.Size() ? "," : "");
+	}
+	fprintf(f, "\t]\n}\n");
+	fclose(f);
+
+	Printf("Benchmark report written to %s\n", BenchFile.GetChars());
+	BenchTics.Clear();
+	return same;
+}
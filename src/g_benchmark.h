@@ -0,0 +1,25 @@
+#ifndef __G_BENCHMARK_H
+#define __G_BENCHMARK_H
+
+// Headless, machine-readable demo benchmarking on top of -timedemo.
+//
+// -benchmark <demo>      plays the demo like -timedemo -nodraw, but without
+//                        initializing a video backend or a sound device.
+// -benchout <file>       writes the per-tic report as JSON (default is
+//                        benchmark.json when -benchmark is used).
+// -benchcompare <file>   checks that the game state in every tic is the same
+//                        as in an earlier report and exits with an error if
+//                        it is not. E.g. to check that the sight cache does
+//                        not change anything:
+//                        -benchmark demo.lmp -benchout nocache.json +cl_sightcache 0
+//                        -benchmark demo.lmp -benchcompare nocache.json
+
+extern bool benchheadless;
+
+void G_BenchInit();
+bool G_BenchActive();
+void G_BenchStartTic();
+void G_BenchEndTic();
+bool G_BenchWriteReport(int gametics);
+
+#endif
@@ -129,8 +129,8 @@ CUSTOM_CVAR(Int, r_maxparticles, 4000, CVAR_ARCHIVE | CVAR_NOINITCALL)
 {
 	if (self == 0)
 		self = 4000;
-	else if (self > 65535)
-		self = 65535;
+	else if (self > MAX_PARTICLES)
+		self = MAX_PARTICLES;
 	else if (self < 100)
 		self = 100;
 
@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <memory>
+#include <thread>
+#include <atomic>
 
 #include "i_time.h"
 #include "templates.h"
@@ -86,6 +88,7 @@
 #include "d_buttons.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "doommenu.h"
+#include "g_benchmark.h"
 
 
 static FRandom pr_dmspawn ("DMSpawn");
@@ -110,13 +113,14 @@ void STAT_Serialize(FSerializer &file);
 bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content);
 
 FIntCVar gameskill ("skill", 2, CVAR_SERVERINFO|CVAR_LATCH);
-CVAR(Bool, save_formatted, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use formatted JSON for saves (more readable but a larger files and a bit slower.
+CVAR(Bool, save_formatted, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use formatted JSON for saves (more readable but a larger files and a bit slower. Otherwise level snapshots are stored in binary.
 CVAR (Int, deathmatch, 0, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR (Bool, chasedemo, false, 0);
 CVAR (Bool, storesavepic, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, longsavemessages, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (String, save_dir, "", CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 CVAR (Bool, cl_waitforsave, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR (Bool, save_async, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);	// compress and write savegames on a worker thread
 CVAR (Bool, enablescriptscreenshot, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 EXTERN_CVAR (Float, con_midtime);
 
@@ -1109,6 +1113,9 @@ void G_Ticker ()
 	int i;
 	gamestate_t	oldgamestate;
 
+	G_PollPendingSave(false);
+	GC::NewTic();
+
 	// do player reborns if needed
 	for (i = 0; i < MAXPLAYERS; i++)
 	{
@@ -1982,6 +1989,9 @@ void G_DoLoadGame ()
 	hidecon = gameaction == ga_loadgamehidecon;
 	gameaction = ga_nothing;
 
+	// The file to load may still be being written.
+	G_PollPendingSave(true);
+
 	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile(savename.GetChars(), true, true));
 	if (resfile == nullptr)
 	{
@@ -2336,6 +2346,95 @@ static void PutSavePic (FileWriter *file, int width, int height)
 	}
 }
 
+//==========================================================================
+//
+// Asynchronous savegame writing
+//
+// G_DoSaveGame serializes everything into memory on the game thread. The
+// JSON gets compressed and the zip written on a worker, and the result
+// is reported back on the game thread once the worker is done.
+//
+//==========================================================================
+
+struct FPendingSave
+{
+	FString Filename;
+	FString Description;
+	bool OkForQuicksave;
+	bool ForceQuicksave;
+	TArray<FString> Filenames;
+	TArray<FCompressedBuffer> Content;	// all buffers are owned by the job
+	uint64_t CaptureTime = 0;
+	uint64_t WriteTime = 0;
+	bool Written = false;
+	std::thread Thread;
+	std::atomic<bool> Done { false };
+
+	~FPendingSave()
+	{
+		if (Thread.joinable()) Thread.join();
+		for (auto &buff : Content) buff.Clean();
+	}
+
+	void Write()
+	{
+		uint64_t start = I_nsTime();
+		for (unsigned i = 0; i < Content.Size(); i++)
+		{
+			// The savepic is already compressed and the snapshots of other levels were compressed when they were made.
+			if (Filenames[i].Right(5).CompareNoCase(".json") == 0)
+			{
+				FSerializer::CompressOutput(Content[i]);
+			}
+		}
+		Written = WriteZip(Filename, Filenames, Content);
+		WriteTime = I_nsTime() - start;
+		Done = true;
+	}
+};
+
+static std::unique_ptr<FPendingSave> PendingSave;
+
+void G_PollPendingSave(bool wait)
+{
+	if (PendingSave == nullptr || (!wait && !PendingSave->Done)) return;
+
+	std::unique_ptr<FPendingSave> save = std::move(PendingSave);
+	if (save->Thread.joinable()) save->Thread.join();
+
+	bool succeeded = false;
+	if (save->Written)
+	{
+		// Check whether the file is ok by trying to open it.
+		FResourceFile *test = FResourceFile::OpenResourceFile(save->Filename, true);
+		if (test != nullptr)
+		{
+			delete test;
+			succeeded = true;
+		}
+	}
+
+	if (succeeded)
+	{
+		savegameManager.NotifyNewSave(save->Filename, save->Description, save->OkForQuicksave, save->ForceQuicksave);
+		BackupSaveName = save->Filename;
+
+		if (longsavemessages) Printf("%s (%s)\n", GStrings("GGSAVED"), save->Filename.GetChars());
+		else Printf("%s\n", GStrings("GGSAVED"));
+	}
+	else
+	{
+		Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
+	}
+	DPrintf(DMSG_NOTIFY, "Savegame captured in %.1f ms, written in %.1f ms\n", save->CaptureTime / 1e6, save->WriteTime / 1e6);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
 void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description)
 {
 	TArray<FCompressedBuffer> savegame_content;
@@ -2350,6 +2449,9 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		return;
 	}
 
+	// Only one save can be in flight, and it may even be going to the same file.
+	G_PollPendingSave(true);
+
 	if (demoplayback)
 	{
 		filename = G_BuildSaveName ("demosave." SAVEGAME_EXT, -1);
@@ -2358,10 +2460,11 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	if (cl_waitforsave)
 		I_FreezeTime(true);
 
+	uint64_t capturestart = I_nsTime();
 	insave = true;
 	try
 	{
-		level.SnapshotLevel();
+		level.SnapshotLevel(false);
 	}
 	catch(CRecoverableError &err)
 	{
@@ -2434,57 +2537,61 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	}
 
 	auto picdata = savepic.GetBuffer();
-	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), (char*)&(*picdata)[0] };
+	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), new char[picdata->Size()] };
+	memcpy(bufpng.mBuffer, &(*picdata)[0], picdata->Size());
 
 	savegame_content.Push(bufpng);
 	savegame_filenames.Push("savepic.png");
-	savegame_content.Push(savegameinfo.GetCompressedOutput());
+	savegame_content.Push(savegameinfo.GetUncompressedOutput());
 	savegame_filenames.Push("info.json");
-	savegame_content.Push(savegameglobals.GetCompressedOutput());
+	savegame_content.Push(savegameglobals.GetUncompressedOutput());
 	savegame_filenames.Push("globals.json");
 
 	G_WriteSnapshots (savegame_filenames, savegame_content);
-	
 
-	bool succeeded = false;
-
-	if (WriteZip(filename, savegame_filenames, savegame_content))
+	// The snapshots of other levels in the hub can be discarded by a level change
+	// while the save is being written, so the job gets its own copies. The current
+	// level's snapshot is not needed any longer and can be handed over.
+	for (unsigned i = 3; i < savegame_content.Size(); i++)
 	{
-		// Check whether the file is ok by trying to open it.
-		FResourceFile *test = FResourceFile::OpenResourceFile(filename, true);
-		if (test != nullptr)
+		auto &buff = savegame_content[i];
+		if (buff.mBuffer == level.info->Snapshot.mBuffer)
 		{
-			delete test;
-			succeeded = true;
+			level.info->Snapshot.mBuffer = nullptr;
+		}
+		else
+		{
+			char *copy = new char[buff.mCompressedSize];
+			memcpy(copy, buff.mBuffer, buff.mCompressedSize);
+			buff.mBuffer = copy;
 		}
 	}
+	level.info->Snapshot.Clean();
 
-	if (succeeded)
-	{
-		savegameManager.NotifyNewSave(filename, description, okForQuicksave, forceQuicksave);
-		BackupSaveName = filename;
-
-		if (longsavemessages) Printf("%s (%s)\n", GStrings("GGSAVED"), filename.GetChars());
-		else Printf("%s\n", GStrings("GGSAVED"));
-	}
-	else
-	{
-		Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
-	}
-
-
-	// delete the JSON buffers we created just above. Everything else will
-	// either still be needed or taken care of automatically.
-	savegame_content[1].Clean();
-	savegame_content[2].Clean();
+	PendingSave.reset(new FPendingSave);
+	PendingSave->Filename = filename;
+	PendingSave->Description = description;
+	PendingSave->OkForQuicksave = okForQuicksave;
+	PendingSave->ForceQuicksave = forceQuicksave;
+	PendingSave->Filenames = std::move(savegame_filenames);
+	PendingSave->Content = std::move(savegame_content);
+	PendingSave->CaptureTime = I_nsTime() - capturestart;
 
-	// We don't need the snapshot any longer.
-	level.info->Snapshot.Clean();
-		
 	insave = false;
 
 	if (cl_waitforsave)
 		I_FreezeTime(false);
+
+	if (save_async)
+	{
+		FPendingSave *save = PendingSave.get();
+		PendingSave->Thread = std::thread([=]() { save->Write(); });
+	}
+	else
+	{
+		PendingSave->Write();
+		G_PollPendingSave(true);
+	}
 }
 
 
@@ -3021,6 +3128,13 @@ bool G_CheckDemoStatus (void)
 		{
 			if (timingdemo)
 			{
+				bool same = G_BenchWriteReport(gametic);
+				if (benchheadless)
+				{
+					Printf ("timed %i gametics in %i realtics (%.1f fps)\n", gametic,
+						endtime, (float)gametic/(float)endtime*(float)TICRATE);
+					throw CExitEvent(same ? 0 : 1);
+				}
 				// Trying to get back to a stable state after timing a demo
 				// seems to cause problems. I don't feel like fixing that
 				// right now.
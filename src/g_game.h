@@ -67,6 +67,9 @@ void G_SaveGame (const char *filename, const char *description);
 // Called by messagebox
 void G_DoQuickSave ();
 
+// Reports a savegame that has been written in the background, optionally waiting for it.
+void G_PollPendingSave (bool wait);
+
 // Only called by startup code.
 void G_RecordDemo (const char* name);
 
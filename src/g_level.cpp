@@ -48,6 +48,7 @@
 #include "c_dispatch.h"
 
 #include "p_setup.h"
+#include "maploader/rejectbuilder.h"
 #include "p_local.h"
 #include "r_sky.h"
 #include "c_console.h"
@@ -1637,6 +1638,7 @@ FLevelLocals::~FLevelLocals()
 {
 	if (localEventManager) delete localEventManager;
 	if (aabbTree) delete aabbTree;
+	if (rejectbuilder) delete rejectbuilder;
 }
 
 //==========================================================================
@@ -2095,6 +2097,12 @@ void FLevelLocals::Tick ()
 	{
 		memset (&Scrolls[0], 0, sizeof(Scrolls[0])*Scrolls.Size());
 	}
+
+	if (rejectbuilder && rejectbuilder->Poll(this))
+	{
+		delete rejectbuilder;
+		rejectbuilder = nullptr;
+	}
 }
 
 //==========================================================================
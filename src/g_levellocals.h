@@ -100,6 +100,7 @@ struct FStrifeDialogueNode;
 class DAutomapBase;
 struct wbstartstruct_t;
 class DSectorMarker;
+class FRejectBuilder;
 struct FTranslator;
 struct EventManager;
 
@@ -173,7 +174,7 @@ private:
 	void PlayerSpawnPickClass (int playernum);
 
 public:
-	void SnapshotLevel();
+	void SnapshotLevel(bool compress = true);
 	void UnSnapshotLevel(bool hubLoad);
 
 	void FinalizePortals();
@@ -465,6 +466,7 @@ public:
 	FCanvasTextureInfo canvasTextureInfo;
 	EventManager *localEventManager = nullptr;
 	DoomLevelAABBTree* aabbTree = nullptr;
+	FRejectBuilder *rejectbuilder = nullptr;	// generates a REJECT matrix if the map has none
 
 	// [ZZ] Destructible geometry information
 	TMap<int, FHealthGroup> healthGroups;
@@ -635,10 +637,8 @@ public:
 	DSeqNode *SequenceListHead;
 
 	// [RH] particle globals
-	uint32_t			ActiveParticles;
-	uint32_t			InactiveParticles;
-	TArray<particle_t>	Particles;
-	TArray<uint16_t>	ParticlesInSubsec;
+	FParticleStore		Particles;
+	TArray<uint32_t>	ParticlesInSubsec;
 	FThinkerCollection Thinkers;
 
 	TArray<DVector2>	Scrolls;		// NULL if no DScrollers in this level
@@ -41,11 +41,20 @@ struct FBlockmap
 	double				bmaporgy;		// origin of block map
 	FBlockNode**		blocklinks; 	// for thing chains
 
+	// Superblocks group SUPERBLOCKSIZE x SUPERBLOCKSIZE blocks and count the
+	// thing links in them, so that searches covering large areas can skip
+	// empty regions without looking at every block.
+	TArray<int>			superblockcounts;
+	int					sbwidth;
+	bool				usesuperblocks = true;	// only for benchmarking
+
 	// mapblocks are used to check movement
 	// against lines and things
 	enum
 	{
-		MAPBLOCKUNITS = 128
+		MAPBLOCKUNITS = 128,
+		SUPERBLOCKSHIFT = 3,
+		SUPERBLOCKSIZE = 1 << SUPERBLOCKSHIFT
 	};
 
 	inline int GetBlockX(double xpos)
@@ -73,6 +82,52 @@ struct FBlockmap
 		return blockmaplump + *(blockmap + offset) + 1;
 	}
 
+	void InitSuperBlocks()
+	{
+		sbwidth = (bmapwidth + SUPERBLOCKSIZE - 1) >> SUPERBLOCKSHIFT;
+		int sbheight = (bmapheight + SUPERBLOCKSIZE - 1) >> SUPERBLOCKSHIFT;
+		superblockcounts.Resize(sbwidth * sbheight);
+		memset(superblockcounts.Data(), 0, superblockcounts.Size() * sizeof(int));
+	}
+
+	inline int &SuperBlockCount(int blockindex)
+	{
+		int x = blockindex % bmapwidth;
+		int y = blockindex / bmapwidth;
+		return superblockcounts[(y >> SUPERBLOCKSHIFT) * sbwidth + (x >> SUPERBLOCKSHIFT)];
+	}
+
+	// Must be called whenever a node is linked into or unlinked from blocklinks.
+	inline void AddThingLink(int blockindex)
+	{
+		SuperBlockCount(blockindex)++;
+	}
+
+	inline void RemoveThingLink(int blockindex)
+	{
+		SuperBlockCount(blockindex)--;
+	}
+
+	// Returns true if no thing is linked anywhere in the superblock containing this (valid) block.
+	inline bool IsSuperBlockEmpty(int x, int y) const
+	{
+		return usesuperblocks && superblockcounts[(y >> SUPERBLOCKSHIFT) * sbwidth + (x >> SUPERBLOCKSHIFT)] == 0;
+	}
+
+	// Same for a rectangle of valid blocks, including both corners.
+	bool IsRegionEmpty(int x1, int y1, int x2, int y2) const
+	{
+		if (!usesuperblocks) return false;
+		for (int y = y1 >> SUPERBLOCKSHIFT; y <= y2 >> SUPERBLOCKSHIFT; y++)
+		{
+			for (int x = x1 >> SUPERBLOCKSHIFT; x <= x2 >> SUPERBLOCKSHIFT; x++)
+			{
+				if (superblockcounts[y * sbwidth + x] != 0) return false;
+			}
+		}
+		return true;
+	}
+
 	bool VerifyBlockMap(int count, unsigned numlines);
 
 	void Clear()
@@ -87,6 +142,7 @@ struct FBlockmap
 			delete[] blocklinks;
 			blocklinks = nullptr;
 		}
+		superblockcounts.Reset();
 	}
 
 	~FBlockmap()
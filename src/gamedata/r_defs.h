@@ -30,6 +30,7 @@
 #ifndef __R_DEFS_H__
 #define __R_DEFS_H__
 
+#include <atomic>
 #include "doomdef.h"
 #include "templates.h"
 #include "m_bbox.h"
@@ -706,6 +707,12 @@ struct sector_t
 	double			vboheight[HW_MAX_PIPELINE_BUFFERS][2];	// Last calculated height for the 2 planes of this actual sector
 	int				vbocount[2];	// Total count of vertices belonging to this sector's planes. This is used when a sector height changes and also contains all attached planes.
 	int				ibocount;		// number of indices per plane (identical for all planes.) If this is -1 the index buffer is not in use.
+	unsigned		vbogen[HW_MAX_PIPELINE_BUFFERS];	// ChangeGen when the planes were last checked against the vertex buffer
+
+	// Bumped whenever a plane height or the light level of this sector or one of its control sectors changes,
+	// so that the renderers can skip work for sectors that did not change. Scripts writing lightlevel directly are not seen.
+	unsigned		ChangeGen;
+	static std::atomic<unsigned> LastChangeGen;	// light thinkers may change sectors from several threads at once
 
 	// Below are all properties which are not used by the renderer.
 
@@ -973,7 +980,12 @@ public:
 	void SetPlaneTexZ(int pos, double val, bool dirtify = false)	// This mainly gets used by init code. The only place where it must set the vertex to dirty is the interpolation code.
 	{
 		planes[pos].TexZ = val;
-		if (dirtify) SetAllVerticesDirty();
+		if (dirtify)
+		{
+			SetAllVerticesDirty();
+			MarkAllChanged();
+		}
+		else MarkChanged();
 		CheckOverlap();
 	}
 
@@ -981,6 +993,7 @@ public:
 	{
 		planes[pos].TexZ += val;
 		SetAllVerticesDirty();
+		MarkAllChanged();
 		CheckOverlap();
 	}
 
@@ -991,12 +1004,17 @@ public:
 
 	void ChangeLightLevel(int newval)
 	{
-		lightlevel = ClampLight(lightlevel + newval);
+		SetLightLevel(lightlevel + newval);
 	}
 
 	void SetLightLevel(int newval)
 	{
-		lightlevel = ClampLight(newval);
+		short level = ClampLight(newval);
+		if (level != lightlevel)
+		{
+			lightlevel = level;
+			MarkAllChanged();
+		}
 	}
 
 	int GetLightLevel() const
@@ -1103,6 +1121,20 @@ public:
 		for (unsigned i = 0; i < e->XFloor.attached.Size(); i++) e->XFloor.attached[i]->SetVerticesDirty();
 	}
 
+	void MarkChanged()
+	{
+		ChangeGen = LastChangeGen.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	// Also marks the sectors using this one for fake flats or 3D floors.
+	// Thinkers ticking concurrently may only call this for sectors without such users, see DLighting.
+	void MarkAllChanged()
+	{
+		MarkChanged();
+		for (unsigned i = 0; i < e->FakeFloor.Sectors.Size(); i++) e->FakeFloor.Sectors[i]->ChangeGen = ChangeGen;
+		for (unsigned i = 0; i < e->XFloor.attached.Size(); i++) e->XFloor.attached[i]->ChangeGen = ChangeGen;
+	}
+
 	int GetTerrain(int pos) const;
 
 	void TransferSpecial(sector_t *model);
@@ -1216,6 +1248,7 @@ struct side_t
 	uint16_t	Flags;
 	int			UDMFIndex;		// needed to access custom UDMF fields which are stored in loading order.
 	FLightNode * lighthead;		// all dynamic lights that may affect this wall
+	unsigned lightlinkcount;			// used by FDynamicLight::LinkLight to compare old and new link targets
 	seg_t **segs;	// all segs belonging to this sidedef in ascending order. Used for precise rendering
 	int numsegs;
 	int sidenum;
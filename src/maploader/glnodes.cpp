@@ -997,7 +997,7 @@ bool MapLoader::CheckNodes(MapData * map, bool rebuilt, int buildtime)
 typedef TArray<uint8_t> MemFile;
 
 
-static FString CreateCacheName(MapData *map, bool create)
+FString CreateCacheName(MapData *map, bool create, const char *extension)
 {
 	FString path = M_GetCachePath(create);
 	FString lumpname = fileSystem.GetFileFullPath(map->lumpnum);
@@ -1007,7 +1007,7 @@ static FString CreateCacheName(MapData *map, bool create)
 
 	lumpname.ReplaceChars('/', '%');
 	lumpname.ReplaceChars(':', '$');
-	path << '/' << lumpname.Right((ptrdiff_t)lumpname.Len() - separator - 1) << ".gzc";
+	path << '/' << lumpname.Right((ptrdiff_t)lumpname.Len() - separator - 1) << extension;
 	return path;
 }
 
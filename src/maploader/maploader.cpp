@@ -60,6 +60,7 @@
 
 #include <math.h>
 #include "maploader.h"
+#include "rejectbuilder.h"
 #include "c_cvars.h"
 #include "actor.h"
 #include "g_levellocals.h"
@@ -2644,6 +2645,7 @@ void MapLoader::LoadBlockMap (MapData * map)
 	count = Level->blockmap.bmapwidth*Level->blockmap.bmapheight;
 	Level->blockmap.blocklinks = new FBlockNode *[count];
 	memset (Level->blockmap.blocklinks, 0, count*sizeof(*Level->blockmap.blocklinks));
+	Level->blockmap.InitSuperBlocks();
 	Level->blockmap.blockmap = Level->blockmap.blockmaplump+4;
 }
 
@@ -3239,7 +3241,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	InitRenderInfo();				// create hardware independent renderer resources for the level. This must be done BEFORE the PolyObj Spawn!!!
 	Level->ClearDynamic3DFloorData();	// CreateVBO must be run on the plain 3D floor data.
-	CreateVBO(screen->mVertexData, Level->sectors);
+	if (screen->mVertexData != nullptr) CreateVBO(screen->mVertexData, Level->sectors);	// not present when running headless
 
 	for (auto &sec : Level->sectors)
 	{
@@ -3256,5 +3258,6 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 		Level->FinalizePortals();	// finalize line portals after polyobjects have been initialized. This info is needed for properly flagging them.
 
 	Level->aabbTree = new DoomLevelAABBTree(Level);
+	Level->rejectbuilder = FRejectBuilder::Start(Level, map);
 }
 
@@ -98,6 +98,9 @@ typedef TMap<FString,FMissingCount> FMissingTextureTracker;
 struct FLevelLocals;
 struct MapData;
 
+// Cache file for data derived from a map, stored next to the node cache
+FString CreateCacheName(MapData *map, bool create, const char *extension = ".gzc");
+
 class MapLoader
 {
 	friend class UDMFParser;
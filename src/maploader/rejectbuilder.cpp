@@ -0,0 +1,492 @@
+/*
+** rejectbuilder.cpp
+** Background generation of REJECT data for maps that do not have any
+**
+**---------------------------------------------------------------------------
+** Copyright 2021 LZDoom contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The matrix is derived from the GL subsectors, because an actor's sector
+** is the sector of the subsector it is in. Every boundary between two
+** subsectors of different sectors becomes a portal, walls are everything
+** without a partner seg. A sector can see another one if some straight
+** line leaves it through one of its portals and reaches the other through
+** a chain of portals.
+**
+** The search follows the portal flow of Quake's vis tool in 2D: starting
+** from each portal of the source sector, every portal further down the
+** chain is clipped to the region that lines through the source portal and
+** the current pass portal can reach. Everything is done with a small
+** tolerance in favor of visibility and heights are ignored entirely, so
+** moving sectors and rounding in P_CheckSight can never make the matrix
+** reject a pair that can actually see each other. Sources whose search
+** gets too expensive simply see everything.
+**
+*/
+
+#include <zlib.h>
+#include "rejectbuilder.h"
+#include "g_levellocals.h"
+#include "p_setup.h"
+#include "maploader.h"
+#include "doomstat.h"
+#include "c_cvars.h"
+#include "printf.h"
+#include "i_time.h"
+#include "files.h"
+
+CVAR(Bool, genreject, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Bool, gl_cachenodes)
+
+enum
+{
+	REJECT_CACHE_VERSION = 1,
+	MAX_REJECT_SECTORS = 16384,			// 32 MB of matrix
+	MAX_STEPS_PER_SECTOR = 1 << 20,		// give up and see everything beyond this
+	CANCEL_CHECK_INTERVAL = 1024,
+	MAX_REJECT_THREADS = 4,
+};
+
+// Portals are lengthened by this much at both ends and points this close
+// to the wrong side of a line are kept.
+static const double PortalExtension = 1.;
+static const double SideEpsilon = 0.5;
+
+//==========================================================================
+//
+// Signed distance of p from the line through v1 and v2, positive on the left
+//
+//==========================================================================
+
+static inline double SideOf(const DVector2 &v1, const DVector2 &v2, const DVector2 &p)
+{
+	DVector2 d = v2 - v1;
+	double len = d.Length();
+	if (len == 0) return 0;
+	return (d.X * (p.Y - v1.Y) - d.Y * (p.X - v1.X)) / len;
+}
+
+// Keeps the part of a segment whose signed distance, multiplied by sign, is
+// at least -SideEpsilon. Returns false if nothing is left.
+static bool ClipSegment(DVector2 &a, DVector2 &b, const DVector2 &v1, const DVector2 &v2, double sign)
+{
+	double da = SideOf(v1, v2, a) * sign + SideEpsilon;
+	double db = SideOf(v1, v2, b) * sign + SideEpsilon;
+
+	if (da >= 0 && db >= 0) return true;
+	if (da < 0 && db < 0) return false;
+
+	DVector2 cut = a + (b - a) * (da / (da - db));
+	if (da < 0) a = cut;
+	else b = cut;
+	return true;
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: Start
+//
+//==========================================================================
+
+FRejectBuilder *FRejectBuilder::Start(FLevelLocals *Level, MapData *map)
+{
+	// Maps with separate game nodes may put actors into sectors the GL subsectors disagree with.
+	// Polyobjects move walls the subsectors know nothing about. Linked portals let sight cross
+	// between unrelated parts of the map. And sight checks must not depend on how fast a
+	// machine is in netgames and demos, even if the matrix should not change their results.
+	if (!genreject || Level->rejectmatrix.Size() > 0 || Level->gamenodes.Size() > 0 || Level->Polyobjects.Size() > 0 ||
+		Level->Displacements.size > 1 || Level->sectors.Size() < 2 || Level->sectors.Size() > MAX_REJECT_SECTORS ||
+		netgame || demorecording || demoplayback)
+	{
+		return nullptr;
+	}
+
+	auto builder = new FRejectBuilder;
+	builder->NumSectors = Level->sectors.Size();
+	map->GetChecksum(builder->MapChecksum);
+	builder->CollectPortals(Level);
+
+	if (builder->LoadCache(CreateCacheName(map, false, ".rej")))
+	{
+		DPrintf(DMSG_NOTIFY, "Loaded REJECT from cache\n");
+		Level->rejectmatrix = std::move(builder->Reject);
+		delete builder;
+		return nullptr;
+	}
+	if (gl_cachenodes)
+	{
+		builder->CachePath = CreateCacheName(map, true, ".rej");
+	}
+
+	builder->RowBytes = (builder->NumSectors + 7) / 8;
+	builder->VisibleRows.Resize(builder->RowBytes * builder->NumSectors);
+	builder->StartTime = I_msTime();
+
+	int count = clamp<int>((int)std::thread::hardware_concurrency() - 1, 1, MAX_REJECT_THREADS);
+	builder->RunningThreads = count;
+	for (int i = 0; i < count; i++)
+	{
+		builder->Threads.push_back(std::thread([=]() { builder->WorkerMain(); }));
+	}
+	return builder;
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: ~FRejectBuilder
+//
+//==========================================================================
+
+FRejectBuilder::~FRejectBuilder()
+{
+	Cancel = true;
+	for (auto &thread : Threads)
+	{
+		thread.join();
+	}
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: Poll
+//
+//==========================================================================
+
+bool FRejectBuilder::Poll(FLevelLocals *Level)
+{
+	if (!Done) return false;
+
+	for (auto &thread : Threads)
+	{
+		thread.join();
+	}
+	Threads.clear();
+
+	// Something may have provided a matrix or linked portals in the meantime.
+	if (Level->rejectmatrix.Size() == 0 && Level->sectors.Size() == NumSectors && Level->Displacements.size <= 1)
+	{
+		DPrintf(DMSG_NOTIFY, "Generated REJECT in %llu ms\n", (unsigned long long)(I_msTime() - StartTime));
+		Level->rejectmatrix = std::move(Reject);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: CollectPortals
+//
+// Copies the subsector boundaries between different sectors, so the
+// workers never touch level data.
+//
+//==========================================================================
+
+void FRejectBuilder::CollectPortals(FLevelLocals *Level)
+{
+	TArray<unsigned> portalOfSeg(Level->segs.Size(), true);
+	TArray<unsigned> counts(NumSectors + 1, true);
+	memset(counts.Data(), 0, counts.Size() * sizeof(unsigned));
+
+	for (auto &seg : Level->segs)
+	{
+		unsigned segnum = seg.Index();
+		portalOfSeg[segnum] = UINT_MAX;
+
+		if (seg.PartnerSeg == nullptr || seg.Subsector == nullptr || seg.PartnerSeg->Subsector == nullptr) continue;
+		auto from = seg.Subsector->sector;
+		auto to = seg.PartnerSeg->Subsector->sector;
+		if (from == nullptr || to == nullptr || from == to) continue;
+
+		DVector2 v1 = seg.v1->fPos();
+		DVector2 v2 = seg.v2->fPos();
+		DVector2 dir = v2 - v1;
+		double len = dir.Length();
+		if (len == 0) continue;
+		dir *= PortalExtension / len;
+
+		portalOfSeg[segnum] = Portals.Push({ v1 - dir, v2 + dir, from->Index(), to->Index(), UINT_MAX });
+		counts[from->Index()]++;
+	}
+
+	for (auto &portal : Portals)
+	{
+		portal.Partner = UINT_MAX;
+	}
+	for (auto &seg : Level->segs)
+	{
+		unsigned p = portalOfSeg[seg.Index()];
+		if (p != UINT_MAX)
+		{
+			Portals[p].Partner = portalOfSeg[seg.PartnerSeg->Index()];
+		}
+	}
+
+	FirstPortal.Resize(NumSectors + 1);
+	unsigned start = 0;
+	for (unsigned i = 0; i <= NumSectors; i++)
+	{
+		FirstPortal[i] = start;
+		if (i < NumSectors) start += counts[i];
+	}
+	SectorPortals.Resize(Portals.Size());
+	for (unsigned i = 0; i < NumSectors; i++) counts[i] = FirstPortal[i];
+	for (unsigned i = 0; i < Portals.Size(); i++)
+	{
+		SectorPortals[counts[Portals[i].From]++] = i;
+	}
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: WorkerMain
+//
+//==========================================================================
+
+void FRejectBuilder::WorkerMain()
+{
+	FScratch scratch;
+	scratch.Visible.Resize(NumSectors);
+	scratch.OnStack.Resize(Portals.Size());
+	memset(scratch.OnStack.Data(), 0, scratch.OnStack.Size());
+
+	unsigned sector;
+	while (!Cancel && (sector = NextSector++) < NumSectors)
+	{
+		memset(scratch.Visible.Data(), 0, NumSectors);
+		if (!FloodSector(sector, scratch))
+		{
+			if (Cancel) break;
+			memset(scratch.Visible.Data(), 1, NumSectors);
+		}
+
+		uint8_t *row = &VisibleRows[sector * RowBytes];
+		for (unsigned i = 0; i < NumSectors; i++)
+		{
+			if (scratch.Visible[i]) row[i >> 3] |= 1 << (i & 7);
+		}
+	}
+
+	if (--RunningThreads == 0 && !Cancel)
+	{
+		Finish();
+	}
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: FloodSector
+//
+// Marks all sectors a sector might see. Returns false if the search was
+// cancelled or took too long.
+//
+//==========================================================================
+
+bool FRejectBuilder::FloodSector(unsigned sector, FScratch &scratch)
+{
+	auto &stack = scratch.Stack;
+	unsigned steps = 0;
+
+	scratch.Visible[sector] = true;
+
+	for (unsigned i = FirstPortal[sector]; i < FirstPortal[sector + 1]; i++)
+	{
+		unsigned source = SectorPortals[i];
+		auto &sp = Portals[source];
+
+		scratch.Visible[sp.To] = true;
+		scratch.OnStack[source] = true;
+		stack.Clear();
+		stack.Push({ source, { sp.V1, sp.V2 }, FirstPortal[sp.To], FirstPortal[sp.To + 1] });
+
+		while (stack.Size() > 0)
+		{
+			FFrame &top = stack.Last();
+			if (top.Next == top.End)
+			{
+				scratch.OnStack[top.Portal] = false;
+				stack.Pop();
+				continue;
+			}
+
+			unsigned candidate = SectorPortals[top.Next++];
+			if (scratch.OnStack[candidate] || candidate == Portals[top.Portal].Partner) continue;
+
+			if ((++steps % CANCEL_CHECK_INTERVAL) == 0 && (Cancel || steps > MAX_STEPS_PER_SECTOR))
+			{
+				for (auto &frame : stack) scratch.OnStack[frame.Portal] = false;
+				return false;
+			}
+
+			auto &cp = Portals[candidate];
+			FSegment seg = { cp.V1, cp.V2 };
+			if (!ClipToVisibleRegion(seg, stack)) continue;
+
+			scratch.Visible[cp.To] = true;
+			scratch.OnStack[candidate] = true;
+			stack.Push({ candidate, seg, FirstPortal[cp.To], FirstPortal[cp.To + 1] });
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: ClipToVisibleRegion
+//
+// A line of sight that crossed all portals on the stack is beyond each of
+// them. It also stays within the lines that separate the source portal
+// from the current pass portal: those pass through one end of each, with
+// the source on one side and the pass portal on the other.
+//
+//==========================================================================
+
+bool FRejectBuilder::ClipToVisibleRegion(FSegment &seg, const TArray<FFrame> &stack) const
+{
+	for (auto &frame : stack)
+	{
+		// Portals are oriented with the sector being left on the right side.
+		if (!ClipSegment(seg.A, seg.B, frame.Pass.A, frame.Pass.B, 1.)) return false;
+	}
+
+	if (stack.Size() < 2) return true;
+
+	const FSegment &source = stack[0].Pass;
+	const FSegment &pass = stack.Last().Pass;
+	const DVector2 *src[2] = { &source.A, &source.B };
+	const DVector2 *dst[2] = { &pass.A, &pass.B };
+
+	for (int i = 0; i < 2; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			const DVector2 &v1 = *src[i];
+			const DVector2 &v2 = *dst[j];
+			if ((v2 - v1).LengthSquared() < SideEpsilon * SideEpsilon) continue;
+
+			double srcside = SideOf(v1, v2, *src[i ^ 1]);
+			double passside = SideOf(v1, v2, *dst[j ^ 1]);
+
+			if (srcside < -SideEpsilon && passside > SideEpsilon)
+			{
+				if (!ClipSegment(seg.A, seg.B, v1, v2, 1.)) return false;
+			}
+			else if (srcside > SideEpsilon && passside < -SideEpsilon)
+			{
+				if (!ClipSegment(seg.A, seg.B, v1, v2, -1.)) return false;
+			}
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FRejectBuilder :: Finish
+//
+// Runs on the last worker. Sight is symmetric, so a pair is only rejected
+// if neither side's search found the other.
+//
+//==========================================================================
+
+void FRejectBuilder::Finish()
+{
+	Reject.Resize((NumSectors * NumSectors + 7) / 8);
+	memset(Reject.Data(), 0, Reject.Size());
+
+	for (unsigned s1 = 0; s1 < NumSectors; s1++)
+	{
+		const uint8_t *row = &VisibleRows[s1 * RowBytes];
+		for (unsigned s2 = 0; s2 < NumSectors; s2++)
+		{
+			const uint8_t *other = &VisibleRows[s2 * RowBytes];
+			if (!(row[s2 >> 3] & (1 << (s2 & 7))) && !(other[s1 >> 3] & (1 << (s1 & 7))))
+			{
+				unsigned pnum = s1 * NumSectors + s2;
+				Reject[pnum >> 3] |= 1 << (pnum & 7);
+			}
+		}
+	}
+	VisibleRows.Reset();
+
+	if (CachePath.IsNotEmpty())
+	{
+		SaveCache();
+	}
+	Done = true;
+}
+
+//==========================================================================
+//
+// Cache file layout, stored next to the node cache:
+//
+// "REJC", version, sector count, portal count, map MD5,
+// followed by the zlib compressed matrix.
+//
+//==========================================================================
+
+void FRejectBuilder::SaveCache()
+{
+	uLongf outlen = compressBound(Reject.Size());
+	TArray<uint8_t> data(32 + outlen, true);
+
+	memcpy(&data[0], "REJC", 4);
+	uint32_t header[3] = { LittleLong(uint32_t(REJECT_CACHE_VERSION)), LittleLong(NumSectors), LittleLong(Portals.Size()) };
+	memcpy(&data[4], header, 12);
+	memcpy(&data[16], MapChecksum, 16);
+
+	if (compress(&data[32], &outlen, Reject.Data(), Reject.Size()) != Z_OK) return;
+
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(CachePath));
+	if (fw == nullptr || fw->Write(data.Data(), 32 + outlen) != 32 + outlen)
+	{
+		DPrintf(DMSG_WARNING, "Could not save REJECT cache %s\n", CachePath.GetChars());
+	}
+}
+
+bool FRejectBuilder::LoadCache(const FString &path)
+{
+	FileReader fr;
+	if (!fr.OpenFile(path)) return false;
+
+	auto data = fr.Read();
+	if (data.Size() < 32 || memcmp(&data[0], "REJC", 4) || memcmp(&data[16], MapChecksum, 16)) return false;
+
+	uint32_t header[3];
+	memcpy(header, &data[4], 12);
+	if (LittleLong(header[0]) != REJECT_CACHE_VERSION || LittleLong(header[1]) != NumSectors || LittleLong(header[2]) != Portals.Size())
+	{
+		return false;
+	}
+
+	Reject.Resize((NumSectors * NumSectors + 7) / 8);
+	uLongf outlen = Reject.Size();
+	if (uncompress(Reject.Data(), &outlen, &data[32], data.Size() - 32) != Z_OK || outlen != Reject.Size())
+	{
+		Reject.Reset();
+		return false;
+	}
+	return true;
+}
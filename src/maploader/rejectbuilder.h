@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "tarray.h"
+#include "zstring.h"
+#include "vectors.h"
+
+struct FLevelLocals;
+struct MapData;
+
+//==========================================================================
+//
+// FRejectBuilder
+//
+// Computes a conservative sector to sector visibility matrix for maps
+// without a usable REJECT lump. The level geometry is copied on the main
+// thread, the matrix is built on worker threads and installed by Poll()
+// once it is complete, so a running level never sees a partial matrix.
+//
+//==========================================================================
+
+class FRejectBuilder
+{
+public:
+	// Returns nullptr if no matrix is needed or it could be loaded from the cache.
+	static FRejectBuilder *Start(FLevelLocals *Level, MapData *map);
+	~FRejectBuilder();
+
+	// Installs the matrix into the level when it is done. Returns true if the builder can be deleted.
+	bool Poll(FLevelLocals *Level);
+
+private:
+	struct FPortal
+	{
+		DVector2 V1, V2;		// the sector being left is on the right side of V1->V2
+		unsigned From, To;
+		unsigned Partner;		// the same boundary going the other way
+	};
+
+	struct FSegment
+	{
+		DVector2 A, B;
+	};
+
+	struct FFrame
+	{
+		unsigned Portal;
+		FSegment Pass;
+		unsigned Next, End;		// remaining candidates in SectorPortals
+	};
+
+	struct FScratch
+	{
+		TArray<uint8_t> Visible;
+		TArray<uint8_t> OnStack;
+		TArray<FFrame> Stack;
+	};
+
+	FRejectBuilder() = default;
+
+	void CollectPortals(FLevelLocals *Level);
+	bool LoadCache(const FString &path);
+	void SaveCache();
+	void WorkerMain();
+	bool FloodSector(unsigned sector, FScratch &scratch);
+	bool ClipToVisibleRegion(FSegment &seg, const TArray<FFrame> &stack) const;
+	void Finish();
+
+	unsigned NumSectors = 0;
+	TArray<FPortal> Portals;
+	TArray<unsigned> SectorPortals;		// portal indices grouped by From
+	TArray<unsigned> FirstPortal;		// start of each sector's group, plus one end marker
+	TArray<uint8_t> VisibleRows;		// one bit per sector pair, rows padded to whole bytes
+	unsigned RowBytes = 0;
+	TArray<uint8_t> Reject;				// the final matrix in REJECT lump layout
+
+	uint8_t MapChecksum[16];
+	FString CachePath;
+	uint64_t StartTime = 0;
+
+	std::vector<std::thread> Threads;
+	std::atomic<unsigned> NextSector { 0 };
+	std::atomic<unsigned> RunningThreads { 0 };
+	std::atomic<bool> Cancel { false };
+	std::atomic<bool> Done { false };
+};
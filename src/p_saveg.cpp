@@ -1044,6 +1044,7 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 		for (auto &sec : sectors)
 		{
 			P_Recalculate3DFloors(&sec);
+			sec.MarkChanged();
 		}
 		for (int i = 0; i < MAXPLAYERS; ++i)
 		{
@@ -1072,7 +1073,7 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 //
 //==========================================================================
 
-void FLevelLocals::SnapshotLevel()
+void FLevelLocals::SnapshotLevel(bool compress)
 {
 	info->Snapshot.Clean();
 
@@ -1080,11 +1081,11 @@ void FLevelLocals::SnapshotLevel()
 	{
 		FDoomSerializer arc(this);
 
-		if (arc.OpenWriter(save_formatted))
+		if (save_formatted ? arc.OpenWriter(true) : arc.OpenBinaryWriter())
 		{
 			SaveVersion = SAVEVER;
 			Serialize(arc, false);
-			info->Snapshot = arc.GetCompressedOutput();
+			info->Snapshot = compress ? arc.GetCompressedOutput() : arc.GetUncompressedOutput();
 		}
 	}
 }
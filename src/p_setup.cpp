@@ -70,6 +70,7 @@
 #include "vm.h"
 #include "a_specialspot.h"
 #include "maploader/maploader.h"
+#include "maploader/rejectbuilder.h"
 #include "p_acs.h"
 #include "am_map.h"
 #include "i_system.h"
@@ -373,6 +374,8 @@ void FLevelLocals::ClearLevelData()
 	localEventManager->Shutdown();
 	if (aabbTree) delete aabbTree;
 	aabbTree = nullptr;
+	if (rejectbuilder) delete rejectbuilder;
+	rejectbuilder = nullptr;
 	if (screen)
 		screen->SetAABBTree(nullptr);
 }
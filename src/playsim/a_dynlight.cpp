@@ -64,6 +64,7 @@
 #include "a_dynlight.h"
 #include "actorinlines.h"
 #include "memarena.h"
+#include "hw_clock.h"
 
 static FMemArena DynLightArena(sizeof(FDynamicLight) * 200);
 static TArray<FDynamicLight*> FreeList;
@@ -412,35 +413,44 @@ void FDynamicLight::UpdateLocation()
 	}
 }
 
+//=============================================================================
+//
+// Link cost statistics, published once per tic for 'stat lightstats'
+//
+//=============================================================================
+
+static struct FLightLinkStats
+{
+	int Links, Sections, Sides, Added, Removed;
+	cycle_t Time;
+} LinkStats;
+
+void FDynamicLight::ResetLinkStats()
+{
+	link_dlight = LinkStats.Links;
+	linksect_dlight = LinkStats.Sections;
+	linkside_dlight = LinkStats.Sides;
+	linkadd_dlight = LinkStats.Added;
+	linkdel_dlight = LinkStats.Removed;
+	linkms_dlight = LinkStats.Time.TimeMS();
+	LinkStats = {};
+	LinkStats.Time.Reset();
+}
+
 //=============================================================================
 //
 // These have been copied from the secnode code and modified for the light links
 //
-// P_AddSecnode() searches the current list to see if this sector is
-// already there. If not, it adds a sector node at the head of the list of
-// sectors this object appears in. This is called when creating a list of
-// nodes that will get linked in later. Returns a pointer to the new node.
+// AddLightNode() adds a node at the head of the list of targets this light
+// touches and at the head of the target's light list. The caller must
+// make sure that the light has no node for this target yet.
 //
 //=============================================================================
 
-FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * light, FLightNode *& nextnode)
+static FLightNode * AddLightNode(FLightNode ** thread, void * linkto, FDynamicLight * light, FLightNode *& nextnode)
 {
 	FLightNode * node;
 
-	node = nextnode;
-	while (node)
-    {
-		if (node->targ==linkto)   // Already have a node for this sector?
-		{
-			node->lightsource = light; // Yes. Setting m_thing says 'keep it'.
-			return(nextnode);
-		}
-		node = node->nextTarget;
-    }
-
-	// Couldn't find an existing node for this sector. Add one at the head
-	// of the list.
-	
 	node = new FLightNode;
 	
 	node->targ = linkto;
@@ -525,6 +535,10 @@ double FDynamicLight::DistToSeg(const DVector3 &pos, vertex_t *start, vertex_t *
 // Collect all touched sidedefs and subsectors
 // to sidedefs and sector parts.
 //
+// This only gathers the new target set. LinkLight compares it against
+// the existing nodes afterward so that nodes for targets that are still
+// touched are left alone.
+//
 //==========================================================================
 struct LightLinkEntry
 {
@@ -532,11 +546,14 @@ struct LightLinkEntry
 	DVector3 pos;
 };
 static TArray<LightLinkEntry> collected_ss;
+static TArray<side_t *> collected_sides;
+static unsigned lightlinkcount;
 
 void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section, float radius)
 {
-	if (!section) return;
 	collected_ss.Clear();
+	collected_sides.Clear();
+	if (!section) return;
 	collected_ss.Push({ section, opos });
 	section->validcount = dl_validcount;
 
@@ -546,8 +563,6 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 		auto pos = collected_ss[i].pos;
 		section = collected_ss[i].sect;
 
-		touching_sector = AddLightNode(&section->lighthead, section, this, touching_sector);
-
 
 		auto processSide = [&](side_t *sidedef, const vertex_t *v1, const vertex_t *v2)
 		{
@@ -558,7 +573,7 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 				if ((pos.Y - v1->fY()) * (v2->fX() - v1->fX()) + (v1->fX() - pos.X) * (v2->fY() - v1->fY()) <= 0)
 				{
 					linedef->validcount = ::validcount;
-					touching_sides = AddLightNode(&sidedef->lighthead, sidedef, this, touching_sides);
+					collected_sides.Push(sidedef);
 				}
 				else if (linedef->sidedef[0] == sidedef && linedef->sidedef[1] == nullptr)
 				{
@@ -575,9 +590,9 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 					{
 						subsector_t *othersub = Level->PointInRenderSubsector(other->v1->fPos() + other->Delta() / 2);
 						FSection *othersect = othersub->section;
-						if (othersect->validcount != ::validcount)
+						if (othersect->validcount != dl_validcount)
 						{
-							othersect->validcount = ::validcount;
+							othersect->validcount = dl_validcount;
 							collected_ss.Push({ othersect, PosRelative(other->frontsector->PortalGroup) });
 						}
 					}
@@ -585,11 +600,18 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 			}
 		};
 
+		// If the section's bounding box lies completely within the radius all its segs are in range
+		// and the per-seg distance checks can be skipped.
+		auto &bounds = section->bounds;
+		double farx = MAX(fabs(pos.X - bounds.left), fabs(pos.X - bounds.right));
+		double fary = MAX(fabs(pos.Y - bounds.top), fabs(pos.Y - bounds.bottom));
+		bool allinside = farx * farx + fary * fary <= radius;
+
 		for (auto &segment : section->segments)
 		{
 			// check distance from x/y to seg and if within radius add this seg and, if present the opposing subsector (lather/rinse/repeat)
 			// If out of range we do not need to bother with this seg.
-			if (DistToSeg(pos, segment.start, segment.end) <= radius)
+			if (allinside || DistToSeg(pos, segment.start, segment.end) <= radius)
 			{
 				auto sidedef = segment.sidedef;
 				if (sidedef)
@@ -660,21 +682,8 @@ void FDynamicLight::CollectWithinRadius(const DVector3 &opos, FSection *section,
 
 void FDynamicLight::LinkLight()
 {
-	// mark the old light nodes
-	FLightNode * node;
-	
-	node = touching_sides;
-	while (node)
-    {
-		node->lightsource = nullptr;
-		node = node->nextTarget;
-    }
-	node = touching_sector;
-	while (node)
-	{
-		node->lightsource = nullptr;
-		node = node->nextTarget;
-	}
+	LinkStats.Time.Clock();
+	LinkStats.Links++;
 
 	if (radius>0)
 	{
@@ -684,33 +693,74 @@ void FDynamicLight::LinkLight()
 		dl_validcount++;
 		::validcount++;
 		CollectWithinRadius(Pos, sect, float(radius*radius));
-
 	}
-		
-	// Now delete any nodes that won't be used. These are the ones where
-	// m_thing is still nullptr.
-	
+	else
+	{
+		collected_ss.Clear();
+		collected_sides.Clear();
+	}
+	LinkStats.Sections += collected_ss.Size();
+	LinkStats.Sides += collected_sides.Size();
+
+	// Tag the new target set. Targets that already have a node get retagged
+	// while walking the old lists so that only the new ones are left to add.
+	unsigned touched = ++lightlinkcount;
+	unsigned linked = ++lightlinkcount;
+
+	for (auto &entry : collected_ss) entry.sect->lightlinkcount = touched;
+	for (auto side : collected_sides) side->lightlinkcount = touched;
+
+	FLightNode * node;
+
 	node = touching_sides;
 	while (node)
 	{
-		if (node->lightsource == nullptr)
+		side_t *side = node->targLine;
+		if (side->lightlinkcount == touched)
 		{
-			node = DeleteLightNode(node);
+			side->lightlinkcount = linked;
+			node = node->nextTarget;
 		}
 		else
-			node = node->nextTarget;
+		{
+			node = DeleteLightNode(node);
+			LinkStats.Removed++;
+		}
 	}
 
 	node = touching_sector;
 	while (node)
 	{
-		if (node->lightsource == nullptr)
+		auto sect = (FSection *)node->targ;
+		if (sect->lightlinkcount == touched)
 		{
-			node = DeleteLightNode(node);
+			sect->lightlinkcount = linked;
+			node = node->nextTarget;
 		}
 		else
-			node = node->nextTarget;
+		{
+			node = DeleteLightNode(node);
+			LinkStats.Removed++;
+		}
+	}
+
+	for (auto side : collected_sides)
+	{
+		if (side->lightlinkcount == touched)
+		{
+			touching_sides = AddLightNode(&side->lighthead, side, this, touching_sides);
+			LinkStats.Added++;
+		}
+	}
+	for (auto &entry : collected_ss)
+	{
+		if (entry.sect->lightlinkcount == touched)
+		{
+			touching_sector = AddLightNode(&entry.sect->lighthead, entry.sect, this, touching_sector);
+			LinkStats.Added++;
+		}
 	}
+	LinkStats.Time.Unclock();
 }
 
 
@@ -237,6 +237,7 @@ struct FDynamicLight
 	void UpdateLocation();
 	void LinkLight();
 	void UnlinkLight();
+	static void ResetLinkStats();
 	void ReleaseLight();
 
 private:
@@ -38,6 +38,7 @@
 #include "serializer_doom.h"
 #include "d_player.h"
 #include "vm.h"
+#include "types.h"
 #include "c_dispatch.h"
 #include "v_text.h"
 #include "g_levellocals.h"
@@ -45,9 +46,10 @@
 #include "v_video.h"
 #include "g_cvars.h"
 #include "d_main.h"
+#include "workstealing.h"
 
-static int ThinkCount;
-static cycle_t ThinkCycles;
+int ThinkCount;
+cycle_t ThinkCycles;
 extern cycle_t BotSupportCycles;
 extern cycle_t ActionCycles;
 extern int BotWTG;
@@ -69,6 +71,43 @@ static TMap<FName, ProfileInfo> Profiles;
 static unsigned int profilethinkers, profilelimit;
 DThinker *NextToThink;
 
+CVAR(Bool, cl_parallelthinkers, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, cl_parallelthinkers_workers, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else if (self > 16) self = 16;
+}
+
+static FWorkStealingPool ThinkerPool;
+
+// Lists shorter than this are not worth the synchronization.
+enum { MIN_CONCURRENT_THINKERS = 256, CONCURRENT_THINKER_GRAIN = 64 };
+
+//==========================================================================
+//
+// P_GetThinkerPool
+//
+// Returns the pool used for parallel ticking or nullptr if it is disabled.
+// Parallel ticking never changes the outcome of a tic, so it does not
+// need to be synchronized between netgame nodes or recorded in demos.
+//
+//==========================================================================
+
+FWorkStealingPool *P_GetThinkerPool()
+{
+	if (!cl_parallelthinkers) return nullptr;
+
+	int count = cl_parallelthinkers_workers;
+	if (count == 0)
+	{
+		count = std::min((int)std::thread::hardware_concurrency() - 1, 8);
+	}
+	if (count <= 0) return nullptr;
+
+	ThinkerPool.SetThreadCount(count);
+	return &ThinkerPool;
+}
+
 //==========================================================================
 //
 //
@@ -105,6 +144,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 	BotSupportCycles.Reset();
 	ActionCycles.Reset();
 	BotWTG = 0;
+	FDynamicLight::ResetLinkStats();
 
 	ThinkCycles.Clock();
 
@@ -141,10 +181,15 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 
 	if (!profilethinkers)
 	{
+		auto pool = P_GetThinkerPool();
+
 		// Tick every thinker left from last time
 		for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 		{
-			Thinkers[i].TickThinkers(nullptr);
+			if (pool == nullptr || !Thinkers[i].TickThinkersConcurrently(*pool))
+			{
+				Thinkers[i].TickThinkers(nullptr);
+			}
 		}
 
 		// Keep ticking the fresh thinkers until there are no new ones.
@@ -623,6 +668,110 @@ int FThinkerList::TickThinkers(FThinkerList *dest)
 	return count;
 }
 
+//==========================================================================
+//
+// Checks that Tick() has not been overridden by a script, which could
+// do anything.
+//
+//==========================================================================
+
+static bool HasNativeTick(DThinker *thinker)
+{
+	IFVIRTUALPTR(thinker, DThinker, Tick)
+	{
+		return !!(func->VarFlags & VARF_Native);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FThinkerList :: TickThinkersConcurrently
+//
+// Ticks the thinkers of a list in parallel where this cannot change the
+// result. This is only done if every thinker in the list can name the
+// element it modifies. Thinkers that can tick concurrently and whose key
+// is not shared with any other thinker in the list are run on the pool,
+// all others (e.g. everything that calls a random number generator) are
+// ticked afterwards in list order, so the RNG sequence is unchanged.
+//
+//==========================================================================
+
+bool FThinkerList::TickThinkersConcurrently(FWorkStealingPool &pool)
+{
+	static TArray<DThinker *> nodes;
+	static TArray<DThinker *> parallel;
+	static TMap<void *, int> keys;
+
+	DThinker *node = GetHead();
+	if (node == nullptr)
+	{
+		return false;
+	}
+
+	nodes.Clear();
+	for (; node != Sentinel; node = node->NextThinker)
+	{
+		if ((node->ObjectFlags & OF_JustSpawned) || node->TickKey() == nullptr || !HasNativeTick(node))
+		{
+			return false;
+		}
+		nodes.Push(node);
+	}
+	if (nodes.Size() < MIN_CONCURRENT_THINKERS)
+	{
+		return false;
+	}
+
+	// Count how many concurrent thinkers use each key. Keys used by
+	// a serial thinker are disqualified entirely.
+	keys.Clear();
+	for (auto thinker : nodes)
+	{
+		void *key = thinker->TickKey();
+		int *users = keys.CheckKey(key);
+		int add = thinker->CanTickConcurrently() ? 1 : -0x10000;
+		if (users == nullptr) keys.Insert(key, add);
+		else *users += add;
+	}
+
+	parallel.Clear();
+	for (auto &thinker : nodes)
+	{
+		if (thinker->ObjectFlags & OF_EuthanizeMe)
+		{
+			thinker = nullptr;
+		}
+		else if (*keys.CheckKey(thinker->TickKey()) == 1)
+		{
+			parallel.Push(thinker);
+			thinker = nullptr;
+		}
+	}
+
+	ThinkCount += parallel.Size();
+	pool.Run(parallel.Size(), CONCURRENT_THINKER_GRAIN, [](int start, int end)
+	{
+		for (int i = start; i < end; i++)
+		{
+			parallel[i]->Tick();
+		}
+	});
+
+	// None of these may destroy anything but themselves, so the snapshot
+	// stays valid as long as the GC does not run in between.
+	for (auto thinker : nodes)
+	{
+		if (thinker != nullptr && !(thinker->ObjectFlags & OF_EuthanizeMe))
+		{
+			ThinkCount++;
+			thinker->CallTick();
+		}
+	}
+	GC::CheckGC();
+	return true;
+}
+
 //==========================================================================
 //
 //
@@ -887,6 +1036,8 @@ DEFINE_ACTION_FUNCTION(DThinker, Tick)
 
 void DThinker::CallTick()
 {
+	// Another thinker may have moved things around since the last one.
+	P_InvalidateSightCache();
 	IFVIRTUAL(DThinker, Tick)
 	{
 		// Without the type cast this picks the 'void *' assignment...
@@ -47,9 +47,12 @@ class FSerializer;
 struct FLevelLocals;
 
 class FThinkerIterator;
+class FWorkStealingPool;
 
 enum { MAX_STATNUM = 127 };
 
+FWorkStealingPool *P_GetThinkerPool();	// nullptr if parallel ticking is off
+
 // Doubly linked ring list of thinkers
 struct FThinkerList
 {
@@ -62,6 +65,7 @@ struct FThinkerList
 	bool DoDestroyThinkers();
 	int TickThinkers(FThinkerList *dest);	// Returns: # of thinkers ticked
 	int ProfileThinkers(FThinkerList *dest);
+	bool TickThinkersConcurrently(FWorkStealingPool &pool);	// Returns false if the list must be ticked serially
 	void SaveList(FSerializer &arc);
 
 private:
@@ -105,6 +109,12 @@ public:
 	virtual void CallPostBeginPlay(); // different in actor.
 	virtual void PostSerialize();
 	void Serialize(FSerializer &arc) override;
+
+	// For parallel ticking: TickKey is the map element that Tick() modifies
+	// exclusively (nullptr if unknown), CanTickConcurrently tells whether
+	// Tick() touches nothing else, including the random number generators.
+	virtual void *TickKey() { return nullptr; }
+	virtual bool CanTickConcurrently() { return false; }
 	size_t PropagateMark();
 	
 	void ChangeStatNum (int statnum);
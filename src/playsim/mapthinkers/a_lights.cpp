@@ -171,7 +171,7 @@ void DFlicker::Construct(sector_t *sector, int upper, int lower)
 	Super::Construct(sector);
 	m_MaxLight = sector_t::ClampLight(upper);
 	m_MinLight = sector_t::ClampLight(lower);
-	sector->lightlevel = m_MaxLight;
+	sector->SetLightLevel(m_MaxLight);
 	m_Count = (pr_flicker()&64)+1;
 }
 
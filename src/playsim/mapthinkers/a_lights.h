@@ -5,6 +5,15 @@ class DLighting : public DSectorEffect
 	DECLARE_CLASS(DLighting, DSectorEffect)
 public:
 	static const int DEFAULT_STAT = STAT_LIGHT;
+	void *TickKey() override { return m_Sector; }
+
+protected:
+	// Changing the light level also marks the sectors that use this one for fake flats
+	// or 3D floors as changed. Those are not covered by the tick key.
+	bool OnlyChangesOwnSector() const
+	{
+		return m_Sector->e->FakeFloor.Sectors.Size() == 0 && m_Sector->e->XFloor.attached.Size() == 0;
+	}
 };
 
 class DFireFlicker : public DLighting
@@ -58,6 +67,7 @@ public:
 	void Construct(sector_t *sector, int upper, int lower, int utics, int ltics);
 	void		Serialize(FSerializer &arc);
 	void		Tick();
+	bool		CanTickConcurrently() override { return OnlyChangesOwnSector(); }
 protected:
 	int 		m_Count;
 	int 		m_MinLight;
@@ -73,6 +83,7 @@ public:
 	void Construct(sector_t *sector);
 	void		Serialize(FSerializer &arc);
 	void		Tick();
+	bool		CanTickConcurrently() override { return OnlyChangesOwnSector(); }
 protected:
 	int 		m_MinLight;
 	int 		m_MaxLight;
@@ -87,6 +98,7 @@ public:
 	void Construct(sector_t *sector, int start, int end, int tics, bool oneshot);
 	void		Serialize(FSerializer &arc);
 	void		Tick();
+	bool		CanTickConcurrently() override { return !m_OneShot && OnlyChangesOwnSector(); }
 protected:
 	int			m_Start;
 	int			m_End;
@@ -107,6 +119,7 @@ public:
 
 	void		Serialize(FSerializer &arc);
 	void		Tick();
+	bool		CanTickConcurrently() override { return OnlyChangesOwnSector(); }
 protected:
 	uint8_t		m_BaseLevel;
 	uint8_t		m_Phase;
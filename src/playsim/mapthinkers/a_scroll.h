@@ -19,6 +19,8 @@ public:
 
 	void Serialize(FSerializer &arc);
 	void Tick ();
+	void *TickKey() override { return m_Type == EScroll::sc_side ? (void*)m_Side : (void*)m_Sector; }
+	bool CanTickConcurrently() override { return m_Type == EScroll::sc_side || m_Type == EScroll::sc_floor || m_Type == EScroll::sc_ceiling; }
 
 	bool AffectsWall (side_t * wall) const { return m_Side == wall; }
 	side_t *GetWall () const { return m_Side; }
@@ -6211,6 +6211,7 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
 				{
 					Level->lines[line].activation = args[1];
 				}
+				P_InvalidateSightCache();
 			}
 			break;
 
@@ -8373,6 +8374,7 @@ scriptwait:
 			if (activationline != NULL)
 			{
 				activationline->special = 0;
+				P_InvalidateSightCache();
 				DPrintf(DMSG_SPAMMY, "Cleared line special on line %d\n", activationline->Index());
 			}
 			break;
@@ -8997,6 +8999,7 @@ scriptwait:
 						break;
 					}
 				}
+				P_InvalidateSightCache();
 
 				sp -= 2;
 			}
@@ -9014,6 +9017,7 @@ scriptwait:
 					else
 						Level->lines[line].flags &= ~ML_BLOCKMONSTERS;
 				}
+				P_InvalidateSightCache();
 
 				sp -= 2;
 			}
@@ -9045,6 +9049,7 @@ scriptwait:
 					DPrintf(DMSG_SPAMMY, "Set special on line %d (id %d) to %d(%d,%d,%d,%d,%d)\n",
 						linenum, STACK(7), specnum, arg0, STACK(4), STACK(3), STACK(2), STACK(1));
 				}
+				P_InvalidateSightCache();
 				sp -= 7;
 			}
 			break;
@@ -1686,25 +1686,23 @@ DEFINE_ACTION_FUNCTION(AActor, CheckIfSeen)
 	PARAM_SELF_PROLOGUE(AActor);
 
 	auto Level = self->Level;
+	AActor *lookers[MAXPLAYERS * 2];
+	int count = 0;
 	for (int i = 0; i < MAXPLAYERS; i++) 
 	{
 		if (Level->PlayerInGame(i))
 		{
 			auto p = Level->Players[i];
 			// Always check sight from each player.
-			if (P_CheckSight(p->mo, self, SF_IGNOREVISIBILITY))
-			{
-				ACTION_RETURN_BOOL(false);
-			}
+			lookers[count++] = p->mo;
 			// If a player is viewing from a non-player, then check that too.
-			if (p->camera != nullptr && p->camera->player == NULL &&
-				P_CheckSight(p->camera, self, SF_IGNOREVISIBILITY))
+			if (p->camera != nullptr && p->camera->player == NULL)
 			{
-				ACTION_RETURN_BOOL(false);
+				lookers[count++] = p->camera;
 			}
 		}
 	}
-	ACTION_RETURN_BOOL(true);
+	ACTION_RETURN_BOOL(P_CheckSightBatch(self, lookers, count, SF_IGNOREVISIBILITY, nullptr, true) == 0);
 }
 
 //===========================================================================
@@ -49,6 +49,7 @@
 #include "vm.h"
 #include "actorinlines.h"
 #include "g_game.h"
+#include "workstealing.h"
 
 CVAR (Int, cl_rockettrails, 1, CVAR_ARCHIVE);
 CVAR (Bool, r_rail_smartspiral, 0, CVAR_ARCHIVE);
@@ -101,15 +102,7 @@ static const struct ColorList {
 
 inline particle_t *NewParticle (FLevelLocals *Level)
 {
-	particle_t *result = nullptr;
-	if (Level->InactiveParticles != NO_PARTICLE)
-	{
-		result = &Level->Particles[Level->InactiveParticles];
-		Level->InactiveParticles = result->tnext;
-		result->tnext = Level->ActiveParticles;
-		Level->ActiveParticles = uint32_t(result - Level->Particles.Data());
-	}
-	return result;
+	return Level->Particles.New();
 }
 
 //
@@ -128,8 +121,7 @@ void P_InitParticles (FLevelLocals *Level)
 	else
 		num = r_maxparticles;
 
-	// This should be good, but eh...
-	int NumParticles = clamp<int>(num, 100, 65535);
+	int NumParticles = clamp<int>(num, 100, MAX_PARTICLES);
 
 	Level->Particles.Resize(NumParticles);
 	P_ClearParticles (Level);
@@ -137,13 +129,112 @@ void P_InitParticles (FLevelLocals *Level)
 
 void P_ClearParticles (FLevelLocals *Level)
 {
-	int i = 0;
-	memset (Level->Particles.Data(), 0, Level->Particles.Size() * sizeof(particle_t));
-	Level->ActiveParticles = NO_PARTICLE;
-	Level->InactiveParticles = 0;
-	for (auto &p : Level->Particles)
-		p.tnext = ++i;
-	Level->Particles.Last().tnext = NO_PARTICLE;
+	Level->Particles.Clear();
+}
+
+//==========================================================================
+//
+// FParticleStore
+//
+//==========================================================================
+
+void FParticleStore::Resize(unsigned capacity)
+{
+	Capacity = capacity;
+	for (auto array : { &PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &AccX, &AccY, &AccZ, &Size, &SizeStep })
+	{
+		array->Resize(capacity);
+	}
+	Alpha.Resize(capacity);
+	FadeStep.Resize(capacity);
+	TTL.Resize(capacity);
+	Color.Resize(capacity);
+	Bright.Resize(capacity);
+	NoTimeFreeze.Resize(capacity);
+	Subsector.Resize(capacity);
+	SNext.Resize(capacity);
+	Clear();
+}
+
+void FParticleStore::Clear()
+{
+	Count = 0;
+	Spawned.Clear();
+}
+
+particle_t *FParticleStore::New()
+{
+	if (Count + Spawned.Size() >= Capacity)
+	{
+		return nullptr;
+	}
+	particle_t *result = &Spawned[Spawned.Reserve(1)];
+	memset(result, 0, sizeof(particle_t));
+	return result;
+}
+
+void FParticleStore::FlushSpawned()
+{
+	for (auto &p : Spawned)
+	{
+		unsigned i = Count++;
+		PosX[i] = p.Pos.X;
+		PosY[i] = p.Pos.Y;
+		PosZ[i] = p.Pos.Z;
+		VelX[i] = p.Vel.X;
+		VelY[i] = p.Vel.Y;
+		VelZ[i] = p.Vel.Z;
+		AccX[i] = p.Acc.X;
+		AccY[i] = p.Acc.Y;
+		AccZ[i] = p.Acc.Z;
+		Size[i] = p.size;
+		SizeStep[i] = p.sizestep;
+		Alpha[i] = p.alpha;
+		FadeStep[i] = p.fadestep;
+		TTL[i] = p.ttl;
+		Color[i] = p.color;
+		Bright[i] = p.bright;
+		NoTimeFreeze[i] = p.notimefreeze;
+		Subsector[i] = nullptr;
+	}
+	Spawned.Clear();
+}
+
+void FParticleStore::Move(unsigned from, unsigned to)
+{
+	PosX[to] = PosX[from];
+	PosY[to] = PosY[from];
+	PosZ[to] = PosZ[from];
+	VelX[to] = VelX[from];
+	VelY[to] = VelY[from];
+	VelZ[to] = VelZ[from];
+	AccX[to] = AccX[from];
+	AccY[to] = AccY[from];
+	AccZ[to] = AccZ[from];
+	Size[to] = Size[from];
+	SizeStep[to] = SizeStep[from];
+	Alpha[to] = Alpha[from];
+	FadeStep[to] = FadeStep[from];
+	TTL[to] = TTL[from];
+	Color[to] = Color[from];
+	Bright[to] = Bright[from];
+	NoTimeFreeze[to] = NoTimeFreeze[from];
+	Subsector[to] = Subsector[from];
+}
+
+// Removes all particles whose alive flag is 0 and keeps the rest in order.
+void FParticleStore::Compact(const uint8_t *alive)
+{
+	unsigned dest = 0;
+	for (unsigned i = 0; i < Count; i++)
+	{
+		if (alive[i])
+		{
+			if (dest != i) Move(i, dest);
+			dest++;
+		}
+	}
+	Count = dest;
 }
 
 // Group particles by subsectors. Because particles are always
@@ -152,23 +243,28 @@ void P_ClearParticles (FLevelLocals *Level)
 
 void P_FindParticleSubsectors (FLevelLocals *Level)
 {
+	auto &particles = Level->Particles;
+
 	if (Level->ParticlesInSubsec.Size() < Level->subsectors.Size())
 	{
 		Level->ParticlesInSubsec.Reserve (Level->subsectors.Size() - Level->ParticlesInSubsec.Size());
 	}
 
-	fillshort (&Level->ParticlesInSubsec[0], Level->subsectors.Size(), NO_PARTICLE);
+	memset (&Level->ParticlesInSubsec[0], 0xff, Level->subsectors.Size() * sizeof(uint32_t));
+
+	// Particles spawned after the last update must be visible, too.
+	particles.FlushSpawned();
 
 	if (!r_particles)
 	{
 		return;
 	}
-	for (uint16_t i = Level->ActiveParticles; i != NO_PARTICLE; i = Level->Particles[i].tnext)
+	for (uint32_t i = 0; i < particles.Count; i++)
 	{
 		 // Try to reuse the subsector from the last portal check, if still valid.
-		if (Level->Particles[i].subsector == nullptr) Level->Particles[i].subsector = Level->PointInRenderSubsector(Level->Particles[i].Pos);
-		int ssnum = Level->Particles[i].subsector->Index();
-		Level->Particles[i].snext = Level->ParticlesInSubsec[ssnum];
+		if (particles.Subsector[i] == nullptr) particles.Subsector[i] = Level->PointInRenderSubsector(DVector2(particles.PosX[i], particles.PosY[i]));
+		int ssnum = particles.Subsector[i]->Index();
+		particles.SNext[i] = Level->ParticlesInSubsec[ssnum];
 		Level->ParticlesInSubsec[ssnum] = i;
 	}
 }
@@ -210,65 +306,153 @@ void P_InitEffects ()
 	blood2 = ParticleColor(RPART(kind)/3, GPART(kind)/3, BPART(kind)/3);
 }
 
-void P_ThinkParticles (FLevelLocals *Level)
+//==========================================================================
+//
+// Update kernel for the particles in [start, end). Each step is a separate
+// loop over plain arrays without dependencies between particles, so the
+// compiler can vectorize everything but the subsector and portal checks.
+// It only reads level data, so it can run on several threads at once as
+// long as no line portals need to be traversed.
+//
+//==========================================================================
+
+static void AdvanceParticles(FLevelLocals *Level, unsigned start, unsigned end, bool lineportals, uint8_t *alive)
 {
-	int i;
-	particle_t *particle, *prev;
+	auto &particles = Level->Particles;
+	double *__restrict posx = particles.PosX.Data();
+	double *__restrict posy = particles.PosY.Data();
+	double *__restrict posz = particles.PosZ.Data();
+	double *__restrict velx = particles.VelX.Data();
+	double *__restrict vely = particles.VelY.Data();
+	double *__restrict velz = particles.VelZ.Data();
+	const double *__restrict accx = particles.AccX.Data();
+	const double *__restrict accy = particles.AccY.Data();
+	const double *__restrict accz = particles.AccZ.Data();
+	double *__restrict size = particles.Size.Data();
+	const double *__restrict sizestep = particles.SizeStep.Data();
+	float *__restrict alpha = particles.Alpha.Data();
+	const float *__restrict fadestep = particles.FadeStep.Data();
+	int32_t *__restrict ttl = particles.TTL.Data();
+
+	for (unsigned i = start; i < end; i++)
+	{
+		float oldtrans = alpha[i];
+		alpha[i] -= fadestep[i];
+		size[i] += sizestep[i];
+		ttl[i]--;
+		alive[i] = !(alpha[i] <= 0 || oldtrans < alpha[i] || ttl[i] <= 0 || size[i] <= 0);
+	}
 
-	i = Level->ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
+	if (!lineportals)
 	{
-		particle = &Level->Particles[i];
-		i = particle->tnext;
-		if (!particle->notimefreeze && Level->isFrozen())
+		for (unsigned i = start; i < end; i++)
 		{
-			prev = particle;
-			continue;
+			posx[i] += velx[i];
+			posy[i] += vely[i];
 		}
-		
-		auto oldtrans = particle->alpha;
-		particle->alpha -= particle->fadestep;
-		particle->size += particle->sizestep;
-		if (particle->alpha <= 0 || oldtrans < particle->alpha || --particle->ttl <= 0 || (particle->size <= 0))
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				Level->ActiveParticles = i;
-			particle->tnext = Level->InactiveParticles;
-			Level->InactiveParticles = (int)(particle - Level->Particles.Data());
-			continue;
+	}
+	else
+	{
+		// Handle crossing a line portal
+		for (unsigned i = start; i < end; i++)
+		{
+			if (!alive[i]) continue;
+			DVector2 newxy = Level->GetPortalOffsetPosition(posx[i], posy[i], velx[i], vely[i]);
+			posx[i] = newxy.X;
+			posy[i] = newxy.Y;
 		}
+	}
 
-		// Handle crossing a line portal
-		DVector2 newxy = Level->GetPortalOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
-		particle->Pos.X = newxy.X;
-		particle->Pos.Y = newxy.Y;
-		particle->Pos.Z += particle->Vel.Z;
-		particle->Vel += particle->Acc;
-		particle->subsector = Level->PointInRenderSubsector(particle->Pos);
-		sector_t *s = particle->subsector->sector;
+	for (unsigned i = start; i < end; i++)
+	{
+		posz[i] += velz[i];
+		velx[i] += accx[i];
+		vely[i] += accy[i];
+		velz[i] += accz[i];
+	}
+
+	for (unsigned i = start; i < end; i++)
+	{
+		if (!alive[i]) continue;
+		DVector3 pos(posx[i], posy[i], posz[i]);
+		subsector_t *subsector = Level->PointInRenderSubsector(pos);
+		sector_t *s = subsector->sector;
 		// Handle crossing a sector portal.
 		if (!s->PortalBlocksMovement(sector_t::ceiling))
 		{
-			if (particle->Pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
+			if (pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
 			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::ceiling);
-				particle->subsector = NULL;
+				pos += s->GetPortalDisplacement(sector_t::ceiling);
+				subsector = nullptr;
 			}
 		}
 		else if (!s->PortalBlocksMovement(sector_t::floor))
 		{
-			if (particle->Pos.Z < s->GetPortalPlaneZ(sector_t::floor))
+			if (pos.Z < s->GetPortalPlaneZ(sector_t::floor))
 			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::floor);
-				particle->subsector = NULL;
+				pos += s->GetPortalDisplacement(sector_t::floor);
+				subsector = nullptr;
 			}
 		}
-		prev = particle;
+		posx[i] = pos.X;
+		posy[i] = pos.Y;
+		posz[i] = pos.Z;
+		particles.Subsector[i] = subsector;
+	}
+}
+
+//==========================================================================
+//
+// P_ThinkParticles
+//
+// Large particle counts are split over the thinker pool. Expired particles
+// are removed afterwards by compacting the arrays in order, so the result
+// does not depend on how the work was distributed.
+//
+//==========================================================================
+
+enum { MIN_CONCURRENT_PARTICLES = 4096, CONCURRENT_PARTICLE_GRAIN = 1024 };
+
+void P_ThinkParticles (FLevelLocals *Level)
+{
+	static TArray<uint8_t> alive;
+	auto &particles = Level->Particles;
+
+	particles.FlushSpawned();
+	unsigned count = particles.Count;
+	if (count == 0)
+	{
+		return;
+	}
+
+	alive.Resize(count);
+	uint8_t *alivep = alive.Data();
+	bool lineportals = Level->PortalBlockmap.containsLines;
+
+	if (Level->isFrozen())
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (particles.NoTimeFreeze[i]) AdvanceParticles(Level, i, i + 1, lineportals, alivep);
+			else alivep[i] = true;
+		}
+	}
+	else
+	{
+		auto pool = lineportals || count < MIN_CONCURRENT_PARTICLES ? nullptr : P_GetThinkerPool();
+		if (pool != nullptr)
+		{
+			pool->Run(count, CONCURRENT_PARTICLE_GRAIN, [=](int start, int end)
+			{
+				AdvanceParticles(Level, start, end, false, alivep);
+			});
+		}
+		else
+		{
+			AdvanceParticles(Level, 0, count, lineportals, alivep);
+		}
 	}
+	particles.Compact(alivep);
 }
 
 enum PSFlag
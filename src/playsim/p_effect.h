@@ -35,6 +35,7 @@
 
 #include "vectors.h"
 #include "doomdef.h"
+#include "tarray.h"
 
 #define FX_ROCKET			0x00000001
 #define FX_GRENADE			0x00000002
@@ -46,6 +47,8 @@ struct FLevelLocals;
 
 // [RH] Particle details
 
+// Spawn record for a new particle. Spawners fill this in and the level's
+// particle store copies it into its arrays before the next update.
 struct particle_t
 {
 	DVector3 Pos;
@@ -53,18 +56,51 @@ struct particle_t
 	DVector3 Acc;
 	double	size;
 	double	sizestep;
-	subsector_t * subsector;
 	int32_t	ttl;
 	uint8_t	bright;
 	bool	notimefreeze;
 	float	fadestep;
 	float	alpha;
 	int		color;
-	uint16_t	tnext;
-	uint16_t	snext;
 };
 
-const uint16_t NO_PARTICLE = 0xffff;
+const uint32_t NO_PARTICLE = 0xffffffff;
+enum { MAX_PARTICLES = 1000000 };
+
+// Structure of arrays particle storage. Live particles always occupy
+// [0, Count), expired ones are squeezed out when the particles think,
+// so allocating one is just taking the next free slot.
+struct FParticleStore
+{
+	// Touched by every update.
+	TArray<double>	PosX, PosY, PosZ;
+	TArray<double>	VelX, VelY, VelZ;
+	TArray<double>	AccX, AccY, AccZ;
+	TArray<double>	Size, SizeStep;
+	TArray<float>	Alpha, FadeStep;
+	TArray<int32_t>	TTL;
+
+	// Only needed for drawing.
+	TArray<int>		Color;
+	TArray<uint8_t>	Bright;
+	TArray<uint8_t>	NoTimeFreeze;
+	TArray<subsector_t *> Subsector;
+	TArray<uint32_t> SNext;
+
+	TArray<particle_t> Spawned;	// waiting to be added
+	unsigned Count = 0;
+	unsigned Capacity = 0;
+
+	void Resize(unsigned capacity);
+	void Clear();
+	particle_t *New();		// the result is only valid until the next call
+	void FlushSpawned();
+	void Compact(const uint8_t *alive);
+	void Move(unsigned from, unsigned to);
+
+	DVector3 Pos(unsigned i) const { return { PosX[i], PosY[i], PosZ[i] }; }
+	DVector3 Vel(unsigned i) const { return { VelX[i], VelY[i], VelZ[i] }; }
+};
 
 void P_InitParticles(FLevelLocals *);
 void P_ClearParticles (FLevelLocals *Level);
@@ -3954,6 +3954,7 @@ int P_ExecuteSpecial(FLevelLocals *Level, int			num,
 {
 	if (num >= 0 && num < (int)countof(LineSpecials))
 	{
+		P_InvalidateSightCache();
 		return LineSpecials[num](Level, line, activator, backSide, arg1, arg2, arg3, arg4, arg5);
 	}
 	return 0;
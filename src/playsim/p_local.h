@@ -268,6 +268,8 @@ void	P_SlideMove (AActor* mo, const DVector2 &pos, int numsteps);
 bool	P_BounceWall (AActor *mo);
 bool	P_BounceActor (AActor *mo, AActor *BlockingMobj, bool ontop);
 int	P_CheckSight (AActor *t1, AActor *t2, int flags=0);
+int	P_CheckSightBatch (AActor *target, AActor *const *lookers, int count, int flags, bool *results, bool firstonly = false);
+void	P_InvalidateSightCache ();
 
 enum ESightFlags
 {
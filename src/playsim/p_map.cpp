@@ -5722,6 +5722,7 @@ int P_UsePuzzleItem(AActor *PuzzleItemUser, int PuzzleItemType)
 			int args[3] = { in->d.line->args[2], in->d.line->args[3], in->d.line->args[4] };
 			P_StartScript(PuzzleItemUser->Level, PuzzleItemUser, in->d.line, in->d.line->args[1], NULL, args, 3, ACS_ALWAYS);
 			in->d.line->special = 0;
+			P_InvalidateSightCache();
 			return true;
 		}
 		// Check thing
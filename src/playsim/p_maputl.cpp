@@ -79,6 +79,9 @@
 // State.
 #include "po_man.h"
 #include "vm.h"
+#include "c_dispatch.h"
+#include "i_time.h"
+#include "v_text.h"
 
 int P_VanillaPointOnDivlineSide(double x, double y, const divline_t* line);
 
@@ -340,6 +343,7 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 				block->NextActor->PrevActor = block->PrevActor;
 			}
 			*(block->PrevActor) = block->NextActor;
+			Level->blockmap.RemoveThingLink(block->BlockIndex);
 			FBlockNode *next = block->NextBlock;
 			block->Release ();
 			block = next;
@@ -548,6 +552,7 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 						}
 						node->PrevActor = link;
 						*link = node;
+						Level->blockmap.AddThingLink(node->BlockIndex);
 
 						// Link in to actor
 						node->PrevBlock = alink;
@@ -1050,6 +1055,16 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 			curx = minx;
 			if (++cury > maxy) return NULL;
 		}
+		// Step over the rest of this row of an empty superblock at once.
+		while (Level->blockmap.isValidBlock(curx, cury) && Level->blockmap.IsSuperBlockEmpty(curx, cury))
+		{
+			curx = (curx | (FBlockmap::SUPERBLOCKSIZE - 1)) + 1;
+			if (curx > maxx)
+			{
+				curx = minx;
+				if (++cury > maxy) return NULL;
+			}
+		}
 		StartBlock(curx, cury);
 	}
 }
@@ -1759,13 +1774,18 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 		{
 			secondStop = bmapheight-1;
 		}
+		int lastX = firstStop;
+		int lastY = secondStop;
 		thirdStop = secondStop*bmapwidth+blockX;
 		secondStop = secondStop*bmapwidth+firstStop;
 		firstStop += blockY*bmapwidth;
 		finalStop = blockIndex;		
 
+		// Sections lying in empty superblocks are skipped, but blockIndex must still end up where the loop would have left it.
+
 		// Trace the first block section (along the top)
-		for (; blockIndex <= firstStop; blockIndex++)
+		if (Level->blockmap.IsRegionEmpty(blockX, blockY, lastX, blockY)) blockIndex = firstStop + 1;
+		else for (; blockIndex <= firstStop; blockIndex++)
 		{
 			if ( (target = check (mo, blockIndex, params)) )
 			{
@@ -1773,7 +1793,8 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 			}
 		}
 		// Trace the second block section (right edge)
-		for (blockIndex--; blockIndex <= secondStop; blockIndex += bmapwidth)
+		if (Level->blockmap.IsRegionEmpty(lastX, blockY, lastX, lastY)) blockIndex = secondStop + bmapwidth;
+		else for (blockIndex--; blockIndex <= secondStop; blockIndex += bmapwidth)
 		{
 			if ( (target = check (mo, blockIndex, params)) )
 			{
@@ -1781,7 +1802,8 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 			}
 		}		
 		// Trace the third block section (bottom edge)
-		for (blockIndex -= bmapwidth; blockIndex >= thirdStop; blockIndex--)
+		if (Level->blockmap.IsRegionEmpty(blockX, lastY, lastX, lastY)) blockIndex = thirdStop - 1;
+		else for (blockIndex -= bmapwidth; blockIndex >= thirdStop; blockIndex--)
 		{
 			if ( (target = check (mo, blockIndex, params)) )
 			{
@@ -1789,6 +1811,7 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 			}
 		}
 		// Trace the final block section (left edge)
+		if (!Level->blockmap.IsRegionEmpty(blockX, blockY, blockX, lastY))
 		for (blockIndex++; blockIndex > finalStop; blockIndex -= bmapwidth)
 		{
 			if ( (target = check (mo, blockIndex, params)) )
@@ -2095,3 +2118,77 @@ int BoxOnLineSide(const FBoundingBox &box, const line_t* ld)
 	return (p1 == p2) ? p1 : -1;
 }
 
+
+//==========================================================================
+//
+// blockmapbench [radius] [iterations]
+//
+// Checks the superblock counts against the block lists and times box
+// searches around every actor with and without the superblock level.
+//
+//==========================================================================
+
+CCMD(blockmapbench)
+{
+	auto Level = primaryLevel;
+	auto &bmap = Level->blockmap;
+	if (bmap.blocklinks == nullptr || bmap.superblockcounts.Size() == 0)
+	{
+		Printf("No blockmap\n");
+		return;
+	}
+	double radius = argv.argc() >= 2 ? atof(argv[1]) : 256.;
+	int iterations = argv.argc() >= 3 ? max(1, atoi(argv[2])) : 10;
+
+	TArray<int> counts(bmap.superblockcounts.Size(), true);
+	memset(counts.Data(), 0, counts.Size() * sizeof(int));
+	for (int i = 0; i < bmap.bmapwidth * bmap.bmapheight; i++)
+	{
+		for (FBlockNode *node = bmap.blocklinks[i]; node != nullptr; node = node->NextActor)
+		{
+			counts[&bmap.SuperBlockCount(i) - bmap.superblockcounts.Data()]++;
+		}
+	}
+	int mismatches = 0;
+	for (unsigned i = 0; i < counts.Size(); i++)
+	{
+		if (counts[i] != bmap.superblockcounts[i]) mismatches++;
+	}
+	if (mismatches > 0) Printf(TEXTCOLOR_RED "%d superblocks have wrong counts\n", mismatches);
+
+	TArray<DVector2> centers;
+	auto it = Level->GetThinkerIterator<AActor>();
+	AActor *mo;
+	while ((mo = it.Next()) != nullptr)
+	{
+		if (!(mo->flags & MF_NOBLOCKMAP)) centers.Push(mo->Pos().XY());
+	}
+	if (centers.Size() == 0)
+	{
+		Printf("No actors in the blockmap\n");
+		return;
+	}
+
+	uint64_t found[2] = {}, time[2] = {};
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bmap.usesuperblocks = pass == 1;
+		uint64_t start = I_nsTime();
+		for (int n = 0; n < iterations; n++)
+		{
+			for (auto &c : centers)
+			{
+				FBlockThingsIterator bit(Level, FBoundingBox(c.X, c.Y, radius));
+				while (bit.Next()) found[pass]++;
+			}
+		}
+		time[pass] = I_nsTime() - start;
+	}
+	bmap.usesuperblocks = true;
+
+	double queries = double(centers.Size()) * iterations;
+	Printf("%d x %d blocks, %u superblocks, %u queries of radius %g\n", bmap.bmapwidth, bmap.bmapheight, bmap.superblockcounts.Size(), centers.Size() * iterations, radius);
+	Printf("Block lists only: %.0f queries/s\n", queries * 1e9 / max<uint64_t>(time[0], 1));
+	Printf("With superblocks: %.0f queries/s\n", queries * 1e9 / max<uint64_t>(time[1], 1));
+	if (found[0] != found[1]) Printf(TEXTCOLOR_RED "Results differ: %llu vs %llu actors\n", (unsigned long long)found[0], (unsigned long long)found[1]);
+}
@@ -78,6 +78,8 @@
 //
 //==========================================================================
 
+std::atomic<unsigned> sector_t::LastChangeGen;
+
 CUSTOM_CVAR(Int, r_fakecontrast, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
 	if (self < 0) self = 1;
@@ -1118,6 +1120,7 @@ double GetFriction(const sector_t *self, int plane, double *pMoveFac)
 		 {
 			 line->flags &= ~(ML_BLOCKING | ML_BLOCKEVERYTHING);
 			 line->special = 0;
+			 P_InvalidateSightCache();
 			 line->sidedef[0]->SetTexture(side_t::mid, FNullTextureID());
 			 line->sidedef[1]->SetTexture(side_t::mid, FNullTextureID());
 		 }
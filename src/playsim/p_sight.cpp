@@ -33,6 +33,8 @@
 #include "b_bot.h"
 #include "p_spec.h"
 #include "vm.h"
+#include "types.h"
+#include "v_text.h"
 
 #include "g_levellocals.h"
 #include "actorinlines.h"
@@ -825,40 +827,193 @@ sightcounts[2]++;
 	return traverseres;
 }
 
-/*
-=====================
-=
-= P_CheckSight
-=
-= Returns true if a straight line between t1 and t2 is unobstructed
-= look from eyes of t1 to any part of t2
-=
-= killough 4/20/98: cleaned up, made to use new LOS struct
-=
-=====================
-*/
+//==========================================================================
+//
+// SightTraverse
+//
+// Looks from the eyes of t1 to any part of t2 through the level geometry.
+// The result only depends on the position and height of both actors and
+// on the map, which is what makes it cacheable.
+//
+//==========================================================================
 
-int P_CheckSight (AActor *t1, AActor *t2, int flags)
+static bool SightTraverse(AActor *t1, AActor *t2, int flags)
 {
-	SightCycles.Clock();
-
 	bool res;
 
-	if (t1 == nullptr || t2 == nullptr)
+	validcount++;
+	portals.Clear();
 	{
-		return false;
+		sector_t *sec;
+		double lookheight = t1->Z() + t1->Height*0.75;
+		t1->GetPortalTransition(lookheight, &sec);
+
+		double bottomslope = t2->Z() - lookheight;
+		double topslope = bottomslope + t2->Height;
+		SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
+
+
+		SightCheck s(t1->Level);
+		s.init(t1, t2, sec, &task, flags);
+		res = s.P_SightPathTraverse ();
+		if (!res)
+		{
+			double dist = t1->Distance2D(t2);
+			for (unsigned i = 0; i < portals.Size(); i++)
+			{
+				portals[i].Frac += 1 / dist;
+				s.init(t1, t2, NULL, &portals[i], flags);
+				if (s.P_SightPathTraverse())
+				{
+					res = true;
+					break;
+				}
+			}
+		}
+	}
+	return res;
+}
+
+//==========================================================================
+//
+// Sight cache
+//
+// Remembers traversal results for actor pairs. Entries are only valid
+// while the stamp is unchanged, which is bumped before every thinker
+// ticks, whenever a line special is executed, whenever native code or
+// ACS changes a line's flags, special or activation, whenever a sector
+// plane moves and at the start of each tic, so a hit can never see geometry
+// that has been changed by a mover, a polyobject or a script since the
+// result was computed. Actor movement within that window is caught by
+// comparing positions.
+//
+// Scripts can also change lines by writing their fields directly, which
+// cannot be caught this way. If any loaded script writes one of the line
+// fields that the traversal depends on, the cache is not used.
+//
+// cl_sightverify recomputes every hit and reports differences, e.g. for
+// running it over a set of demos. -benchcompare compares complete demo
+// runs with and without the cache.
+//
+//==========================================================================
+
+CVAR(Bool, cl_sightcache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, cl_sightverify, false, 0)
+
+struct FSightCacheEntry
+{
+	AActor *Looker, *Target;
+	sector_t *LookerSector, *TargetSector;
+	DVector3 LookerPos, TargetPos;
+	double LookerHeight, TargetHeight;
+	unsigned Stamp;
+	int Flags;
+	bool Result;
+};
+
+enum
+{
+	SIGHTCACHE_SIZE = 1024,		// must be a power of 2
+	SF_TRAVERSALFLAGS = SF_SEEPASTSHOOTABLELINES | SF_SEEPASTBLOCKEVERYTHING | SF_IGNOREWATERBOUNDARY,
+};
+
+static FSightCacheEntry SightCache[SIGHTCACHE_SIZE];
+static unsigned SightCacheStamp = 1;
+static int SightCacheHits, SightCacheMisses, SightCacheErrors;
+static bool SightCacheUsable = true;
+
+void P_InvalidateSightCache()
+{
+	SightCacheStamp++;
+}
+
+static bool ScriptsWriteSightLineFields()
+{
+	static const FName fields[] = { "flags", "activation", "special", "args" };
+	auto linestruct = NewStruct("Line", nullptr, true);
+	for (auto name : fields)
+	{
+		auto field = dyn_cast<PField>(linestruct->Symbols.FindSymbol(name, false));
+		if (field != nullptr && (field->Flags & VARF_ScriptWritten))
+		{
+			DPrintf(DMSG_NOTIFY, "Sight cache disabled because scripts write Line.%s\n", name.GetChars());
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool CachedSightTraverse(AActor *t1, AActor *t2, int flags)
+{
+	if (!cl_sightcache || !SightCacheUsable)
+	{
+		return SightTraverse(t1, t2, flags);
 	}
 
+	flags &= SF_TRAVERSALFLAGS;
+	size_t hash = (size_t(t1) >> 4) * 31 + (size_t(t2) >> 4) + flags;
+	auto &entry = SightCache[(hash ^ (hash >> 10)) & (SIGHTCACHE_SIZE - 1)];
+
+	if (entry.Stamp == SightCacheStamp && entry.Looker == t1 && entry.Target == t2 && entry.Flags == flags &&
+		entry.LookerSector == t1->Sector && entry.TargetSector == t2->Sector &&
+		entry.LookerPos == t1->Pos() && entry.TargetPos == t2->Pos() &&
+		entry.LookerHeight == t1->Height && entry.TargetHeight == t2->Height)
+	{
+		SightCacheHits++;
+		if (cl_sightverify && SightTraverse(t1, t2, flags) != entry.Result)
+		{
+			SightCacheErrors++;
+			Printf(TEXTCOLOR_RED "Cached sight check %s -> %s at tic %d is wrong\n",
+				t1->GetClass()->TypeName.GetChars(), t2->GetClass()->TypeName.GetChars(), t1->Level->maptime);
+		}
+		return entry.Result;
+	}
+
+	SightCacheMisses++;
+	bool res = SightTraverse(t1, t2, flags);
+	entry = { t1, t2, t1->Sector, t2->Sector, t1->Pos(), t2->Pos(), t1->Height, t2->Height, SightCacheStamp, flags, res };
+	return res;
+}
+
+//==========================================================================
+//
+// Everything about the target that does not depend on the looker, so
+// that a batch only needs to compute it once.
+//
+//==========================================================================
+
+struct FSightTarget
+{
+	AActor *Actor;
+	sector_t *Sector;
+	bool Invisible;
+	double HeightSecFloor = 0, HeightSecCeiling = 0;	// the target sector's fake planes at the target
+
+	FSightTarget(AActor *t2, int flags)
+	{
+		Actor = t2;
+		Sector = t2->Sector;
+		Invisible = (flags & SF_IGNOREVISIBILITY) == 0 && ((t2->renderflags & RF_INVISIBLE) || !t2->RenderStyle.IsVisible(t2->Alpha));
+		if (Sector->GetHeightSec())
+		{
+			HeightSecFloor = Sector->heightsec->floorplane.ZatPoint(t2);
+			HeightSecCeiling = Sector->heightsec->ceilingplane.ZatPoint(t2);
+		}
+	}
+};
+
+static bool CheckSightFrom(AActor *t1, const FSightTarget &target, int flags)
+{
+	AActor *t2 = target.Actor;
 	auto s1 = t1->Sector;
-	auto s2 = t2->Sector;
+	auto s2 = target.Sector;
 	//
 	// check for trivial rejection
 	//
 	if (!t1->Level->CheckReject(s1, s2))
 	{
 sightcounts[0]++;
-		res = false;			// can't possibly be connected
-		goto done;
+		return false;			// can't possibly be connected
 	}
 
 //
@@ -866,12 +1021,11 @@ sightcounts[0]++;
 //
 	// [RH] Andy Baker's stealth monsters:
 	// Cannot see an invisible object
-	if ((flags & SF_IGNOREVISIBILITY) == 0 && ((t2->renderflags & RF_INVISIBLE) || !t2->RenderStyle.IsVisible(t2->Alpha)))
+	if (target.Invisible)
 	{ // small chance of an attack being made anyway
 		if ((t1->Level->BotInfo.m_Thinking ? pr_botchecksight() : pr_checksight()) > 50)
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
 
@@ -886,53 +1040,81 @@ sightcounts[0]++;
 			  t2->Top() <= s1->heightsec->ceilingplane.ZatPoint(t2))))
 			||
 			(s2->GetHeightSec() &&
-			 ((t2->Top() <= s2->heightsec->floorplane.ZatPoint(t2) &&
+			 ((t2->Top() <= target.HeightSecFloor &&
 			   t1->Z() >= s2->heightsec->floorplane.ZatPoint(t1)) ||
-			  (t2->Z() >= s2->heightsec->ceilingplane.ZatPoint(t2) &&
+			  (t2->Z() >= target.HeightSecCeiling &&
 			   t1->Top() <= s2->heightsec->ceilingplane.ZatPoint(t1)))))
 		{
-			res = false;
-			goto done;
+			return false;
 		}
 	}
 
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
+	return CachedSightTraverse(t1, t2, flags);
+}
 
-	validcount++;
-	portals.Clear();
+/*
+=====================
+=
+= P_CheckSight
+=
+= Returns true if a straight line between t1 and t2 is unobstructed
+= look from eyes of t1 to any part of t2
+=
+= killough 4/20/98: cleaned up, made to use new LOS struct
+=
+=====================
+*/
+
+int P_CheckSight (AActor *t1, AActor *t2, int flags)
+{
+	if (t1 == nullptr || t2 == nullptr)
 	{
-		sector_t *sec;
-		double lookheight = t1->Z() + t1->Height*0.75;
-		t1->GetPortalTransition(lookheight, &sec);
+		return false;
+	}
 
-		double bottomslope = t2->Z() - lookheight;
-		double topslope = bottomslope + t2->Height;
-		SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
+	SightCycles.Clock();
+	bool res = CheckSightFrom(t1, FSightTarget(t2, flags), flags);
+	SightCycles.Unclock();
+	return res;
+}
 
+//==========================================================================
+//
+// P_CheckSightBatch
+//
+// Checks whether each looker can see the target. This gives the same
+// results, and makes the same random number calls, as calling P_CheckSight
+// for each looker in order, but the target is only set up once. If
+// firstonly is set, the check stops at the first looker that sees the
+// target. Returns the number of lookers that see the target.
+//
+//==========================================================================
 
-		SightCheck s(t1->Level);
-		s.init(t1, t2, sec, &task, flags);
-		res = s.P_SightPathTraverse ();
-		if (!res)
+int P_CheckSightBatch(AActor *target, AActor *const *lookers, int count, int flags, bool *results, bool firstonly)
+{
+	if (target == nullptr)
+	{
+		if (results != nullptr) memset(results, 0, count * sizeof(bool));
+		return 0;
+	}
+
+	SightCycles.Clock();
+	FSightTarget t(target, flags);
+	int seen = 0;
+	for (int i = 0; i < count; i++)
+	{
+		bool res = lookers[i] != nullptr && CheckSightFrom(lookers[i], t, flags);
+		if (results != nullptr) results[i] = res;
+		if (res)
 		{
-			double dist = t1->Distance2D(t2);
-			for (unsigned i = 0; i < portals.Size(); i++)
-			{
-				portals[i].Frac += 1 / dist;
-				s.init(t1, t2, NULL, &portals[i], flags);
-				if (s.P_SightPathTraverse())
-				{
-					res = true;
-					break;
-				}
-			}
+			seen++;
+			if (firstonly) break;
 		}
 	}
-
-done:
 	SightCycles.Unclock();
-	return res;
+	return seen;
 }
 
 ADD_STAT (sight)
@@ -941,6 +1123,9 @@ ADD_STAT (sight)
 	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
 		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5]);
+	if (!SightCacheUsable) out.AppendFormat("cache off, scripts change lines");
+	else out.AppendFormat("cache %d hits, %d misses", SightCacheHits, SightCacheMisses);
+	if (SightCacheErrors > 0) out.AppendFormat(", " TEXTCOLOR_RED "%d wrong", SightCacheErrors);
 	return out;
 }
 
@@ -949,6 +1134,7 @@ void P_ResetSightCounters (bool full)
 	if (full)
 	{
 		MaxSightCycles.Reset();
+		SightCacheUsable = !ScriptsWriteSightLineFields();
 	}
 	if (SightCycles.Time() > MaxSightCycles.Time())
 	{
@@ -956,4 +1142,6 @@ void P_ResetSightCounters (bool full)
 	}
 	SightCycles.Reset();
 	memset (sightcounts, 0, sizeof(sightcounts));
+	SightCacheHits = SightCacheMisses = 0;
+	P_InvalidateSightCache();
 }
@@ -1455,6 +1455,7 @@ void P_PredictPlayer (player_t *player)
 			block->NextActor->PrevActor = block->PrevActor;
 		}
 		*(block->PrevActor) = block->NextActor;
+		act->Level->blockmap.RemoveThingLink(block->BlockIndex);
 		block = block->NextBlock;
 	}
 	act->BlockNode = NULL;
@@ -1598,6 +1599,7 @@ void P_UnPredictPlayer ()
 			{
 				block->NextActor->PrevActor = &block->NextActor;
 			}
+			act->Level->blockmap.AddThingLink(block->BlockIndex);
 			block = block->NextBlock;
 		}
 
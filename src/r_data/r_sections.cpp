@@ -713,6 +713,7 @@ public:
 			dest.hacked = false;
 			dest.lighthead = nullptr;
 			dest.validcount = 0;
+			dest.lightlinkcount = 0;
 			dest.segments.Set(&output.allLines[numsegments], group.segments.Size());
 			dest.sides.Set(&output.allSides[numsides], group.sideMap.CountUsed());
 			dest.subsectors.Set(&output.allSubsectors[numsubsectors], group.subsectors.Size());
@@ -118,6 +118,7 @@ struct FSection
 	int						 vertexindex;		// This is relative to the start of the entire sector's vertex plane data because it needs to be used with different sources.
 	int						 vertexcount;
 	int						 validcount;
+	unsigned				 lightlinkcount;	// used by FDynamicLight::LinkLight to compare old and new link targets
 	short					 mapsection;
 	char					 hacked;			// 1: is part of a render hack
 	char					 flags;
@@ -136,6 +136,10 @@ void AddLightToList(FDynLightData &dld, int group, FDynamicLight * light, bool f
 		spotDirZ = float(-Angle.Sin() * xzLen);
 	}
 
+	// Everything stored below only depends on these for the duration of a frame.
+	dld.keys.Push(uintptr_t(light) | (forceAttenuate ? 1 : 0));
+	dld.keys.Push(uintptr_t(group));
+
 	float *data = &dld.arrays[i][dld.arrays[i].Reserve(16)];
 	data[0] = float(pos.X);
 	data[1] = float(pos.Z);
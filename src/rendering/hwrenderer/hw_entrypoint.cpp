@@ -328,6 +328,7 @@ sector_t* RenderView(player_t* player)
 		hw_ClearFakeFlat();
 
 		iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = 0;
+		upload_dlight = shared_dlight = 0;
 
 		checkBenchActive();
 
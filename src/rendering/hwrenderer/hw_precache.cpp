@@ -24,6 +24,7 @@
 **
 */
 
+#include <thread>
 #include "c_cvars.h"
 #include "filesystem.h"
 #include "r_data/r_translate.h"
@@ -40,9 +41,13 @@
 #include "modelrenderer.h"
 #include "hw_models.h"
 #include "d_main.h"
+#include "workstealing.h"
 
 EXTERN_CVAR(Bool, gl_precache)
 
+// 0 picks a count from the number of cores, 1 creates all textures on the render thread.
+CVAR(Int, gl_precache_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 //==========================================================================
 //
 // DFrameBuffer :: PrecacheTexture
@@ -89,6 +94,118 @@ static void PrecacheSprite(FGameTexture *tex, SpriteHits &hits)
 }
 
 
+//==========================================================================
+//
+// Parallel buffer creation
+//
+// Decoding, composing, translating and upscaling the images is done on a
+// thread pool before anything gets uploaded. The buffers are attached to
+// their textures and taken over by the backend's CreateTexBuffer calls when
+// the materials get precached, so only the upload is left for this thread.
+//
+// All buffers of one texture are made by the same job because creating a
+// buffer also updates the texture's translucency and hole information.
+//
+//==========================================================================
+
+static FWorkStealingPool PrecachePool;
+
+static FWorkStealingPool *GetPrecachePool()
+{
+	int count = gl_precache_threads;
+	if (count == 0)
+	{
+		count = std::min((int)std::thread::hardware_concurrency(), 8);
+	}
+	if (count <= 1) return nullptr;
+
+	PrecachePool.SetThreadCount(count - 1);
+	return &PrecachePool;
+}
+
+class FPrecacheJobs
+{
+	struct FBufferInfo
+	{
+		int Translation;
+		int Flags;
+	};
+
+	struct FJob
+	{
+		FTexture *Texture;
+		TArray<FBufferInfo> Buffers;
+	};
+
+	TArray<FJob> Jobs;
+	TMap<FTexture *, unsigned> JobForTexture;
+
+	void Add(FTexture *tex, int translation, int flags)
+	{
+		if (tex == nullptr || tex->GetImage() == nullptr || tex->isHardwareCanvas()) return;
+		if (tex->SystemTextures.GetHardwareTexture(translation, flags) != nullptr) return;
+
+		unsigned *index = JobForTexture.CheckKey(tex);
+		if (index == nullptr)
+		{
+			unsigned add = Jobs.Reserve(1);
+			Jobs[add].Texture = tex;
+			index = &JobForTexture.Insert(tex, add);
+		}
+		for (auto &buffer : Jobs[*index].Buffers)
+		{
+			if (buffer.Translation == translation && buffer.Flags == flags) return;
+		}
+		Jobs[*index].Buffers.Push({ translation, flags });
+	}
+
+public:
+	// Follows the backends' PrecacheMaterial implementations.
+	void AddMaterial(FMaterial *mat, int translation)
+	{
+		if (mat->Source()->GetUseType() == ETextureType::SWCanvas) return;
+		// Indexed materials get their palette layers from a callback and are cheap to create anyway.
+		if (mat->GetScaleFlags() & CTF_Indexed) return;
+
+		auto &layers = mat->GetLayerArray();
+		for (unsigned i = 0; i < layers.Size(); i++)
+		{
+			Add(layers[i].layerTexture, i == 0 ? translation : 0, layers[i].scaleFlags);
+		}
+	}
+
+	unsigned Size() const
+	{
+		return Jobs.Size();
+	}
+
+	void Run(FWorkStealingPool &pool)
+	{
+		fileSystem.SetConcurrentReads(true);
+		FImageSource::SetConcurrentPrecache(true);
+		pool.Run(Jobs.Size(), 1, [this](int start, int end)
+		{
+			for (int i = start; i < end; i++)
+			{
+				auto tex = Jobs[i].Texture;
+				for (auto &buffer : Jobs[i].Buffers)
+				{
+					tex->SetPreparedBuffer(buffer.Translation, buffer.Flags, tex->CreateTexBuffer(buffer.Translation, buffer.Flags | CTF_ProcessData));
+				}
+			}
+		});
+		fileSystem.SetConcurrentReads(false);
+	}
+
+	// Frees whatever the backend did not take, e.g. because the texture was already created through another material.
+	void Clear()
+	{
+		for (auto &job : Jobs) job.Texture->ClearPreparedBuffers();
+		Jobs.Clear();
+		JobForTexture.Clear();
+	}
+};
+
 //==========================================================================
 //
 // DFrameBuffer :: Precache
@@ -299,6 +416,47 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
+		// create the texture data for all used textures in parallel
+		FPrecacheJobs jobs;
+		unsigned prepared = 0;
+		cycle_t prepare;
+		prepare.Reset();
+		auto pool = GetPrecachePool();
+		if (pool != nullptr)
+		{
+			prepare.Clock();
+			for (int i = cnt - 1; i >= 0; i--)
+			{
+				auto gtex = TexMan.GameByIndex(i);
+				if (gtex == nullptr) continue;
+
+				if (texhitlist[i] & (FTextureManager::HIT_Wall | FTextureManager::HIT_Flat | FTextureManager::HIT_Sky))
+				{
+					int scaleflags = 0;
+					if (shouldUpscale(gtex, UF_Texture)) scaleflags |= CTF_Upscale;
+
+					FMaterial *mat = FMaterial::ValidateTexture(gtex, scaleflags);
+					if (mat) jobs.AddMaterial(mat, 0);
+				}
+				if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CountUsed() > 0)
+				{
+					int scaleflags = CTF_Expand;
+					if (shouldUpscale(gtex, UF_Sprite)) scaleflags |= CTF_Upscale;
+
+					FMaterial *mat = FMaterial::ValidateTexture(gtex, scaleflags);
+					if (mat)
+					{
+						SpriteHits::Iterator it(*spritehitlist[i]);
+						SpriteHits::Pair *pair;
+						while (it.NextPair(pair)) jobs.AddMaterial(mat, pair->Key);
+					}
+				}
+			}
+			jobs.Run(*pool);
+			prepared = jobs.Size();
+			prepare.Unclock();
+		}
+
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
@@ -313,7 +471,7 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
-
+		jobs.Clear();
 		FImageSource::EndPrecaching();
 
 		// cache all used models
@@ -326,7 +484,9 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 		delete renderer;
 
 		precache.Unclock();
-		DPrintf(DMSG_NOTIFY, "Textures precached in %.3f ms\n", precache.TimeMS());
+		Printf(PRINT_LOG, "Textures precached in %.3f ms", precache.TimeMS());
+		if (pool != nullptr) Printf(PRINT_LOG, ", %u textures prepared on %d threads in %.3f ms", prepared, pool->ThreadCount() + 1, prepare.TimeMS());
+		Printf(PRINT_LOG, "\n");
 	}
 
 	delete[] spritehitlist;
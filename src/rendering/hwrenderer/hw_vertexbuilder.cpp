@@ -381,6 +381,11 @@ static void CheckPlanes(FFlatVertexBuffer* fvb, sector_t* sector)
 
 void CheckUpdate(FFlatVertexBuffer* fvb, sector_t* sector)
 {
+	// Nothing attached to this sector has moved since the last check for this buffer.
+	unsigned &gen = sector->vbogen[screen->mVertexData->GetPipelinePos()];
+	if (gen == sector->ChangeGen) return;
+	gen = sector->ChangeGen;
+
 	CheckPlanes(fvb, sector);
 	sector_t* hs = sector->GetHeightSec();
 	if (hs != NULL) CheckPlanes(fvb, hs);
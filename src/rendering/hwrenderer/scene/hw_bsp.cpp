@@ -32,6 +32,7 @@
 #include "p_effect.h"
 #include "po_man.h"
 #include "m_fixed.h"
+#include <thread>
 #include "ctpl.h"
 #include "texturemanager.h"
 #include "hwrenderer/scene/hw_fakeflat.h"
@@ -40,6 +41,7 @@
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "hwrenderer/scene/hw_portal.h"
 #include "hw_clock.h"
+#include "c_dispatch.h"
 #include "flatvertices.h"
 #include "hw_vertexbuilder.h"
 
@@ -47,12 +49,20 @@
 #include <immintrin.h>
 #endif // ARCH_IA32
 
-CVAR(Bool, gl_multithread, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, gl_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, gl_multithread_workers, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// 0 means one worker per available core, leaving one for the main thread.
+{
+	if (self < 0) self = 0;
+	else if (self > MAX_RENDER_WORKERS) self = MAX_RENDER_WORKERS;
+}
 
 EXTERN_CVAR(Float, r_actorspriteshadowdist)
 
 thread_local bool isWorkerThread;
-ctpl::thread_pool renderPool(1);
+thread_local HWRenderWorker *CurrentRenderWorker;
+std::recursive_mutex RenderSharedDataMutex;
+ctpl::thread_pool renderPool;
+static HWRenderWorker renderWorkers[MAX_RENDER_WORKERS];
 bool inited = false;
 
 struct RenderJob
@@ -64,7 +74,6 @@ struct RenderJob
 		SpriteJob,
 		ParticleJob,
 		PortalJob,
-		TerminateJob	// inserted when all work is done so that the worker can return.
 	};
 	
 	int type;
@@ -72,47 +81,191 @@ struct RenderJob
 	seg_t *seg;
 };
 
+//==========================================================================
+//
+// The job queue is written by the main thread only and read by all the
+// workers. It is stored in fixed size blocks that get allocated on demand
+// and are kept for the following frames, so that readers never see storage
+// being moved around while the main thread is adding jobs.
+//
+//==========================================================================
 
 class RenderJobQueue
 {
-	RenderJob pool[300000];	// Way more than ever needed. The largest ever seen on a single viewpoint is around 40000.
+	enum
+	{
+		BLOCK_SHIFT = 12,
+		BLOCK_SIZE = 1 << BLOCK_SHIFT,
+		MAX_BLOCKS = 1024,	// 4 million jobs. The largest ever seen on a single viewpoint is around 40000.
+	};
+	RenderJob *blocks[MAX_BLOCKS] = {};
 	std::atomic<int> readindex{};
 	std::atomic<int> writeindex{};
+	std::atomic<bool> finished{};
+
 public:
+	~RenderJobQueue()
+	{
+		for (auto block : blocks) delete[] block;
+	}
+
 	void AddJob(int type, subsector_t *sub, seg_t *seg = nullptr)
 	{
-		// This does not check for array overflows. The pool should be large enough that it never hits the limit.
+		int index = writeindex.load(std::memory_order_relaxed);
+		if ((index >> BLOCK_SHIFT) >= MAX_BLOCKS) I_FatalError("Render job queue overflow");
 
-		pool[writeindex] = { type, sub, seg };
-		writeindex++;	// update index only after the value has been written.
+		auto &block = blocks[index >> BLOCK_SHIFT];
+		if (block == nullptr) block = new RenderJob[BLOCK_SIZE];
+		block[index & (BLOCK_SIZE - 1)] = { type, sub, seg };
+		writeindex.store(index + 1);	// update index only after the value has been written.
 	}
 
-	RenderJob *GetJob()
+	// Returns the index of the claimed job or -1 if there is nothing to do right now.
+	int GetJob()
 	{
-		if (readindex < writeindex) return &pool[readindex++];
-		return nullptr;
+		int index = readindex.load();
+		while (index < writeindex.load())
+		{
+			if (readindex.compare_exchange_weak(index, index + 1)) return index;
+		}
+		return -1;
+	}
+
+	RenderJob &operator[](int index)
+	{
+		return blocks[index >> BLOCK_SHIFT][index & (BLOCK_SIZE - 1)];
+	}
+
+	// Once this is set, the workers exit as soon as the queue is empty.
+	void Finish()
+	{
+		finished = true;
+	}
+
+	bool IsFinished()
+	{
+		return finished && readindex.load() >= writeindex.load();
 	}
 	
 	void ReleaseAll()
 	{
 		readindex = 0;
 		writeindex = 0;
+		finished = false;
 	}
 };
 
 static RenderJobQueue jobQueue;	// One static queue is sufficient here. This code will never be called recursively.
 
-void HWDrawInfo::WorkerThread()
+//==========================================================================
+//
+// Number of worker threads to use for the next BSP traversal. 0 disables
+// multithreaded processing. In automatic mode this only gets used when at
+// least two workers are available, since with a single one the total amount
+// of work is the same as without threads.
+//
+//==========================================================================
+
+static int GetRenderWorkerCount()
+{
+	if (!gl_multithread) return 0;
+	if (gl_multithread_workers > 0) return gl_multithread_workers;
+
+	static int autocount = -1;
+	if (autocount < 0)
+	{
+		int cores = (int)std::thread::hardware_concurrency();
+		autocount = clamp(cores - 1, 0, (int)MAX_RENDER_WORKERS);
+		if (autocount < 2) autocount = 0;
+	}
+	return autocount;
+}
+
+//==========================================================================
+//
+// Whether the workers pay off depends on the CPU and the map: with slow
+// cores or small scenes the synchronization costs more than the parallel
+// wall and flat setup saves. With the automatic worker count, the first
+// frames of every map alternate between single threaded and multithreaded
+// traversal and the faster one gets used for the rest of the map.
+//
+//==========================================================================
+
+enum
+{
+	MT_CALIBRATION_FRAMES = 64,	// frames to sample per mode
+};
+
+static struct FMTCalibration
+{
+	FLevelLocals *Level = nullptr;
+	int LastMapTime = 0;
+	int Frame = 0;
+	int Frames[2] = {};
+	double Time[2] = {};
+	bool Done = false;
+	bool UseWorkers = true;
+
+	void Reset(FLevelLocals *level)
+	{
+		Level = level;
+		LastMapTime = level->maptime;
+		Frame = 0;
+		Frames[0] = Frames[1] = 0;
+		Time[0] = Time[1] = 0;
+		Done = false;
+		UseWorkers = true;
+	}
+
+	// Returns the mode to sample (0 = single threaded, 1 = workers) or -1 if calibration is done.
+	int Begin(FLevelLocals *level, bool mainview)
+	{
+		if (level != Level || level->maptime < LastMapTime) Reset(level);
+		LastMapTime = level->maptime;
+		if (Done) return -1;
+		if (mainview) Frames[++Frame & 1]++;
+		return Frame & 1;
+	}
+
+	void End(int mode, double ms, int numworkers)
+	{
+		Time[mode] += ms;
+		if (Frames[0] < MT_CALIBRATION_FRAMES || Frames[1] < MT_CALIBRATION_FRAMES) return;
+
+		double single = Time[0] / Frames[0];
+		double multi = Time[1] / Frames[1];
+		UseWorkers = multi < single;
+		Done = true;
+		DPrintf(DMSG_NOTIFY, "BSP traversal: %.3f ms single threaded, %.3f ms with %d workers. Using %s.\n",
+			single, multi, numworkers, UseWorkers ? "workers" : "single thread");
+	}
+} MTCalibration;
+
+CCMD(gl_multithread_calibrate)
+{
+	MTCalibration.Level = nullptr;
+}
+
+void HWDrawInfo::WorkerThread(HWRenderWorker *worker)
 {
 	sector_t *front, *back;
 
-	WTTotal.Clock();
+	if (worker->index == 0) WTTotal.Clock();
 	isWorkerThread = true;	// for adding asserts in GL API code. The worker thread may never call any GL API.
+	CurrentRenderWorker = worker;
+	ThreadDataAllocator = worker->allocator;
 	while (true)
 	{
-		auto job = jobQueue.GetJob();
-		if (job == nullptr)
+		int jobindex = jobQueue.GetJob();
+		if (jobindex < 0)
 		{
+			if (jobQueue.IsFinished())
+			{
+				CurrentRenderWorker = nullptr;
+				ThreadDataAllocator = nullptr;
+				if (worker->index == 0) WTTotal.Unclock();
+				return;
+			}
 #ifdef ARCH_IA32
 			// The queue is empty. But yielding would be too costly here and possibly cause further delays down the line if the thread is halted.
 			// So instead add a few pause instructions and retry immediately.
@@ -127,19 +280,19 @@ void HWDrawInfo::WorkerThread()
 			_mm_pause();
 			_mm_pause();
 #endif // ARCH_IA32
+			continue;
 		}
+		auto job = &jobQueue[jobindex];
+		worker->currentjob = jobindex;
+
 		// Note that the main thread MUST have prepared the fake sectors that get used below!
 		// This worker thread cannot prepare them itself without costly synchronization.
-		else switch (job->type)
+		switch (job->type)
 		{
-		case RenderJob::TerminateJob:
-			WTTotal.Unclock();
-			return;
-
 		case RenderJob::WallJob:
 		{
 			HWWall wall;
-			SetupWall.Clock();
+			worker->SetupWall.Clock();
 			wall.sub = job->sub;
 
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
@@ -170,40 +323,48 @@ void HWDrawInfo::WorkerThread()
 			else back = nullptr;
 
 			wall.Process(this, job->seg, front, back);
-			rendered_lines++;
-			SetupWall.Unclock();
+			worker->rendered_lines++;
+			worker->SetupWall.Unclock();
 			break;
 		}
 
 		case RenderJob::FlatJob:
 		{
 			HWFlat flat;
-			SetupFlat.Clock();
+			worker->SetupFlat.Clock();
 			flat.section = job->sub->section;
 			front = hw_FakeFlat(job->sub->render_sector, in_area, false);
 			flat.ProcessSector(this, front);
-			SetupFlat.Unclock();
+			worker->SetupFlat.Unclock();
 			break;
 		}
 
+		// Actors are shared between subsectors and may get moved temporarily by the portal code, so these cannot run concurrently.
 		case RenderJob::SpriteJob:
+		{
+			SharedDataLock lock(this);
 			SetupSprite.Clock();
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
 			RenderThings(job->sub, front);
 			SetupSprite.Unclock();
 			break;
+		}
 
 		case RenderJob::ParticleJob:
-			SetupSprite.Clock();
+		{
+			SharedDataLock lock(this);
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
 			RenderParticles(job->sub, front);
-			SetupSprite.Unclock();
 			break;
+		}
 
 		case RenderJob::PortalJob:
+		{
+			SharedDataLock lock(this);
 			AddSubsectorToPortal((FSectorPortalGroup *)job->seg, job->sub);
 			break;
 		}
+		}
 
 	}
 }
@@ -309,7 +470,7 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 
 	uint8_t ispoly = uint8_t(seg->sidedef->Flags & WALLF_POLYOBJ);
 
-	if (!gl_multithread && IsDistanceCulled(seg))
+	if (!multithread && IsDistanceCulled(seg))
 	{
 		HWWall wall;
 		wall.sub = currentsubsector;
@@ -623,16 +784,17 @@ void HWDrawInfo::RenderThings(subsector_t * sub, sector_t * sector)
 void HWDrawInfo::RenderParticles(subsector_t *sub, sector_t *front)
 {
 	SetupSprite.Clock();
-	for (int i = Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = Level->Particles[i].snext)
+	auto &particles = Level->Particles;
+	for (uint32_t i = Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = particles.SNext[i])
 	{
 		if (mClipPortal)
 		{
-			int clipres = mClipPortal->ClipPoint(Level->Particles[i].Pos);
+			int clipres = mClipPortal->ClipPoint(particles.Pos(i));
 			if (clipres == PClip_InFront) continue;
 		}
 
 		HWSprite sprite;
-		sprite.ProcessParticle(this, &Level->Particles[i], front);
+		sprite.ProcessParticle(this, i, front);
 	}
 	SetupSprite.Unclock();
 }
@@ -860,6 +1022,47 @@ void HWDrawInfo::RenderBSPNode (void *node)
 	DoSubsector ((subsector_t *)((uint8_t *)node - 1));
 }
 
+//==========================================================================
+//
+// Moves the workers' draw items into this HWDrawInfo's lists. Each worker
+// processes its jobs in increasing order so a merge by job index restores
+// the order in which the single threaded code would have added them.
+//
+//==========================================================================
+
+void HWDrawInfo::MergeWorkerLists(int numworkers)
+{
+	for (int list = 0; list < GLDL_TYPES; list++)
+	{
+		unsigned pos[MAX_RENDER_WORKERS] = {};
+		while (true)
+		{
+			int best = -1;
+			for (int i = 0; i < numworkers; i++)
+			{
+				auto &jobs = renderWorkers[i].itemjobs[list];
+				if (pos[i] < jobs.Size() && (best < 0 || jobs[pos[i]] < renderWorkers[best].itemjobs[list][pos[best]]))
+				{
+					best = i;
+				}
+			}
+			if (best < 0) break;
+			drawlists[list].AddItem(renderWorkers[best].drawlists[list], pos[best]++);
+		}
+		for (int i = 0; i < numworkers; i++)
+		{
+			renderWorkers[i].drawlists[list].Reset();
+			renderWorkers[i].itemjobs[list].Clear();
+		}
+	}
+	for (int i = 0; i < numworkers; i++)
+	{
+		SetupWall += renderWorkers[i].SetupWall;
+		SetupFlat += renderWorkers[i].SetupFlat;
+		rendered_lines += renderWorkers[i].rendered_lines;
+	}
+}
+
 void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 {
 	Bsp.Clock();
@@ -870,26 +1073,53 @@ void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 
 	validcount++;	// used for processing sidedefs only once by the renderer.
 
-	multithread = gl_multithread;
+	int numworkers = GetRenderWorkerCount();
+	int calibrationmode = -1;
+	if (numworkers > 0 && gl_multithread_workers == 0)
+	{
+		calibrationmode = MTCalibration.Begin(Level, drawpsprites);
+		if (calibrationmode == 0 || (calibrationmode < 0 && !MTCalibration.UseWorkers)) numworkers = 0;
+	}
+	cycle_t calibrationtime;
+	calibrationtime.Reset();
+	calibrationtime.Clock();
+
+	multithread = numworkers > 0;
 	if (multithread)
 	{
+		if (renderPool.size() < numworkers) renderPool.resize(numworkers);
+
 		jobQueue.ReleaseAll();
-		auto future = renderPool.push([&](int id) {
-			WorkerThread();
-		});
+		std::future<void> futures[MAX_RENDER_WORKERS];
+		for (int i = 0; i < numworkers; i++)
+		{
+			auto worker = &renderWorkers[i];
+			if (worker->allocator == nullptr) worker->allocator = CreateThreadDataAllocator();
+			worker->index = i;
+			worker->SetupWall.Reset();
+			worker->SetupFlat.Reset();
+			worker->rendered_lines = 0;
+			futures[i] = renderPool.push([=](int id) {
+				WorkerThread(worker);
+			});
+		}
 		RenderBSPNode(node);
 
-		jobQueue.AddJob(RenderJob::TerminateJob, nullptr, nullptr);
+		jobQueue.Finish();
 		Bsp.Unclock();
 		MTWait.Clock();
-		future.wait();
+		for (int i = 0; i < numworkers; i++) futures[i].wait();
 		MTWait.Unclock();
+		MergeWorkerLists(numworkers);
 	}
 	else
 	{
 		RenderBSPNode(node);
 		Bsp.Unclock();
 	}
+	calibrationtime.Unclock();
+	if (calibrationmode >= 0) MTCalibration.End(calibrationmode, calibrationtime.TimeMS(), GetRenderWorkerCount());
+
 	// Process all the sprites on the current portal's back side which touch the portal.
 	if (mCurrentPortal != nullptr) mCurrentPortal->RenderAttached(this);
 
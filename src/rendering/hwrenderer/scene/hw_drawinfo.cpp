@@ -412,7 +412,8 @@ HWPortal * HWDrawInfo::FindPortal(const void * src)
 
 HWDecal *HWDrawInfo::AddDecal(bool onmirror)
 {
-	auto decal = (HWDecal*)RenderDataAllocator.Alloc(sizeof(HWDecal));
+	auto decal = (HWDecal*)CurrentRenderDataAllocator().Alloc(sizeof(HWDecal));
+	SharedDataLock lock(this);
 	Decals[onmirror ? 1 : 0].Push(decal);
 	return decal;
 }
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <functional>
+#include <mutex>
 #include "vectors.h"
 #include "r_defs.h"
 #include "r_utility.h"
@@ -9,6 +10,7 @@
 #include "v_video.h"
 #include "hw_weapon.h"
 #include "hw_drawlist.h"
+#include "stats.h"
 
 enum EDrawMode
 {
@@ -26,7 +28,6 @@ class HWFlat;
 class HWSprite;
 struct HWDecal;
 class IShadowMap;
-struct particle_t;
 struct FDynLightData;
 struct HUDSprite;
 class Clipper;
@@ -94,6 +95,38 @@ enum DrawListType
 	GLDL_TYPES,
 };
 
+//==========================================================================
+//
+// Per-thread output of the BSP worker threads. The lists get merged into
+// the HWDrawInfo's own lists in job order once all workers are done, so the
+// result does not depend on how the jobs were distributed.
+//
+//==========================================================================
+
+enum
+{
+	MAX_RENDER_WORKERS = 16
+};
+
+struct HWRenderWorker
+{
+	HWDrawList drawlists[GLDL_TYPES];
+	TArray<int> itemjobs[GLDL_TYPES];	// job index of each item in drawlists
+	FMemArena *allocator;
+	int index;
+	int currentjob;
+
+	// Stats are collected per worker and added to the global counters by MergeWorkerLists.
+	glcycle_t SetupWall, SetupFlat;
+	int rendered_lines;
+};
+
+extern thread_local HWRenderWorker *CurrentRenderWorker;
+
+// Serializes access to the parts of the scene data that are shared by all
+// worker threads (portals, decals, missing texture info and actors which
+// get temporarily moved for rendering through line portals.)
+extern std::recursive_mutex RenderSharedDataMutex;
 
 struct HWDrawInfo
 {
@@ -188,7 +221,8 @@ private:
 	subsector_t *currentsubsector;	// used by the line processing code.
 	sector_t *currentsector;
 
-	void WorkerThread();
+	void WorkerThread(HWRenderWorker *worker);
+	void MergeWorkerLists(int numworkers);
 
 	void UnclipSubsector(subsector_t *sub);
 	
@@ -288,7 +322,7 @@ public:
 	void AddOtherCeilingPlane(int sector, gl_subsectorrendernode * node);
 
 	void GetDynSpriteLight(AActor *self, float x, float y, float z, FLightNode *node, int portalgroup, float *out);
-	void GetDynSpriteLight(AActor *thing, particle_t *particle, float *out);
+	void GetDynSpriteLight(AActor *thing, int particle, float *out);
 
 	void PreparePlayerSprites(sector_t * viewsector, area_t in_area);
 	void PrepareTargeterSprites(double ticfrac);
@@ -304,6 +338,14 @@ public:
 	void ProcessLowerMinisegs(TArray<seg_t *> &lowersegs);
     void AddSubsectorToPortal(FSectorPortalGroup *portal, subsector_t *sub);
     
+	HWDrawList &CurrentDrawList(int list)
+	{
+		auto worker = CurrentRenderWorker;
+		if (worker == nullptr) return drawlists[list];
+		worker->itemjobs[list].Push(worker->currentjob);
+		return worker->drawlists[list];
+	}
+
     void AddWall(HWWall *w);
     void AddMirrorSurface(HWWall *w);
 	void AddFlat(HWFlat *flat, bool fog);
@@ -312,6 +354,21 @@ public:
 
     HWDecal *AddDecal(bool onmirror);
 
+	// Locks the shared scene data while the BSP is processed by more than one thread.
+	class SharedDataLock
+	{
+		bool locked;
+	public:
+		SharedDataLock(HWDrawInfo *di) : locked(di->multithread)
+		{
+			if (locked) RenderSharedDataMutex.lock();
+		}
+		~SharedDataLock()
+		{
+			if (locked) RenderSharedDataMutex.unlock();
+		}
+	};
+
 	bool isSoftwareLighting() const
 	{
 		return lightmode == ELightMode::ZDoomSoftware || lightmode == ELightMode::DoomSoftware || lightmode == ELightMode::Build;
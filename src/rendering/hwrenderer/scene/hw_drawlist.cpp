@@ -39,10 +39,27 @@
 #include "hw_fakeflat.h"
 
 FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
+thread_local FMemArena *ThreadDataAllocator;
+static TDeletingArray<FMemArena *> ThreadDataAllocators;
 
 void ResetRenderDataAllocator()
 {
 	RenderDataAllocator.FreeAll();
+	for (auto arena : ThreadDataAllocators) arena->FreeAll();
+}
+
+//==========================================================================
+//
+// Creates an arena for a BSP worker thread. The data stays valid until
+// ResetRenderDataAllocator is called, just like the main arena's.
+//
+//==========================================================================
+
+FMemArena *CreateThreadDataAllocator()
+{
+	auto arena = new FMemArena(1024*1024);
+	ThreadDataAllocators.Push(arena);
+	return arena;
 }
 
 //==========================================================================
@@ -514,7 +531,7 @@ void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * s
 	}
 	else
 	{
-		const bool drawWithXYBillboard = ((ss->particle && gl_billboard_particles) || (!(ss->actor && ss->actor->renderflags & RF_FORCEYBILLBOARD)
+		const bool drawWithXYBillboard = ((ss->particle >= 0 && gl_billboard_particles) || (!(ss->actor && ss->actor->renderflags & RF_FORCEYBILLBOARD)
 			&& (gl_billboard_mode == 1 || (ss->actor && ss->actor->renderflags & RF_FORCEXYBILLBOARD))));
 
 		const bool drawBillboardFacingCamera = gl_billboard_faces_camera;
@@ -753,7 +770,7 @@ void HWDrawList::SortFlats()
 
 HWWall *HWDrawList::NewWall()
 {
-	auto wall = (HWWall*)RenderDataAllocator.Alloc(sizeof(HWWall));
+	auto wall = (HWWall*)CurrentRenderDataAllocator().Alloc(sizeof(HWWall));
 	drawitems.Push(HWDrawItem(DrawType_WALL, walls.Push(wall)));
 	return wall;
 }
@@ -765,7 +782,7 @@ HWWall *HWDrawList::NewWall()
 //==========================================================================
 HWFlat *HWDrawList::NewFlat()
 {
-	auto flat = (HWFlat*)RenderDataAllocator.Alloc(sizeof(HWFlat));
+	auto flat = (HWFlat*)CurrentRenderDataAllocator().Alloc(sizeof(HWFlat));
 	drawitems.Push(HWDrawItem(DrawType_FLAT,flats.Push(flat)));
 	return flat;
 }
@@ -777,11 +794,35 @@ HWFlat *HWDrawList::NewFlat()
 //==========================================================================
 HWSprite *HWDrawList::NewSprite()
 {	
-	auto sprite = (HWSprite*)RenderDataAllocator.Alloc(sizeof(HWSprite));
+	auto sprite = (HWSprite*)CurrentRenderDataAllocator().Alloc(sizeof(HWSprite));
 	drawitems.Push(HWDrawItem(DrawType_SPRITE, sprites.Push(sprite)));
 	return sprite;
 }
 
+//==========================================================================
+//
+// Moves one item from another list (i.e. a worker thread's) to this one.
+//
+//==========================================================================
+void HWDrawList::AddItem(HWDrawList &src, unsigned index)
+{
+	auto &item = src.drawitems[index];
+	switch (item.rendertype)
+	{
+	case DrawType_WALL:
+		drawitems.Push(HWDrawItem(DrawType_WALL, walls.Push(src.walls[item.index])));
+		break;
+
+	case DrawType_FLAT:
+		drawitems.Push(HWDrawItem(DrawType_FLAT, flats.Push(src.flats[item.index])));
+		break;
+
+	case DrawType_SPRITE:
+		drawitems.Push(HWDrawItem(DrawType_SPRITE, sprites.Push(src.sprites[item.index])));
+		break;
+	}
+}
+
 //==========================================================================
 //
 //
@@ -3,7 +3,15 @@
 #include "memarena.h"
 
 extern FMemArena RenderDataAllocator;
+extern thread_local FMemArena *ThreadDataAllocator;
 void ResetRenderDataAllocator();
+FMemArena *CreateThreadDataAllocator();
+
+// The BSP worker threads each allocate from their own arena.
+inline FMemArena &CurrentRenderDataAllocator()
+{
+	return ThreadDataAllocator != nullptr ? *ThreadDataAllocator : RenderDataAllocator;
+}
 struct HWDrawInfo;
 class HWWall;
 class HWFlat;
@@ -91,6 +99,7 @@ public:
 	HWWall *NewWall();
 	HWFlat *NewFlat();
 	HWSprite *NewSprite();
+	void AddItem(HWDrawList &src, unsigned index);
 	void Reset();
 	void SortWalls();
 	void SortFlats();
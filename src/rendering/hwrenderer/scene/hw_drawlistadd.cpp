@@ -41,7 +41,7 @@ void HWDrawInfo::AddWall(HWWall *wall)
 {
 	if (wall->flags & HWWall::HWF_TRANSLUCENT)
 	{
-		auto newwall = drawlists[GLDL_TRANSLUCENT].NewWall();
+		auto newwall = CurrentDrawList(GLDL_TRANSLUCENT).NewWall();
 		*newwall = *wall;
 	}
 	else
@@ -57,7 +57,7 @@ void HWDrawInfo::AddWall(HWWall *wall)
 		{
 			list = masked ? GLDL_MASKEDWALLS : GLDL_PLAINWALLS;
 		}
-		auto newwall = drawlists[list].NewWall();
+		auto newwall = CurrentDrawList(list).NewWall();
 		*newwall = *wall;
 	}
 }
@@ -71,7 +71,7 @@ void HWDrawInfo::AddWall(HWWall *wall)
 void HWDrawInfo::AddMirrorSurface(HWWall *w)
 {
 	w->type = RENDERWALL_MIRRORSURFACE;
-	auto newwall = drawlists[GLDL_TRANSLUCENTBORDER].NewWall();
+	auto newwall = CurrentDrawList(GLDL_TRANSLUCENTBORDER).NewWall();
 	*newwall = *w;
 
 	// Invalidate vertices to allow setting of texture coordinates
@@ -130,7 +130,7 @@ void HWDrawInfo::AddFlat(HWFlat *flat, bool fog)
 		bool masked = flat->texture->isMasked() && ((flat->renderflags&SSRF_RENDER3DPLANES) || flat->stack);
 		list = masked ? GLDL_MASKEDFLATS : GLDL_PLAINFLATS;
 	}
-	auto newflat = drawlists[list].NewFlat();
+	auto newflat = CurrentDrawList(list).NewFlat();
 	*newflat = *flat;
 }
 
@@ -153,7 +153,7 @@ void HWDrawInfo::AddSprite(HWSprite *sprite, bool translucent)
 		list = GLDL_MODELS;
 	}
 
-	auto newsprt = drawlists[list].NewSprite();
+	auto newsprt = CurrentDrawList(list).NewSprite();
 	*newsprt = *sprite;
 }
 
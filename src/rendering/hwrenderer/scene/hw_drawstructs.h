@@ -24,7 +24,6 @@ struct FLinePortalSpan;
 struct FDynLightData;
 class VSMatrix;
 struct FSpriteModelFrame;
-struct particle_t;
 class FRenderState;
 struct HWDecal;
 struct FSection;
@@ -372,7 +371,7 @@ public:
 
 	FGameTexture *texture;
 	AActor * actor;
-	particle_t * particle;
+	int particle;	// index into the level's particle store, -1 if none
 	TArray<lightlist_t> *lightlist;
 	DRotator Angles;
 
@@ -386,7 +385,7 @@ public:
 	void CreateVertices(HWDrawInfo *di);
 	void PutSprite(HWDrawInfo *di, bool translucent);
 	void Process(HWDrawInfo *di, AActor* thing,sector_t * sector, area_t in_area, int thruportal = false, bool isSpriteShadow = false);
-	void ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *sector);//, int shade, int fakeside)
+	void ProcessParticle (HWDrawInfo *di, int particle, sector_t *sector);//, int shade, int fakeside)
 
 	void DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent);
 };
@@ -196,6 +196,8 @@ void HWDrawInfo::AddUpperMissingTexture(side_t * side, subsector_t *sub, float B
 {
 	if (!side->segs[0]->backsector) return;
 
+	SharedDataLock lock(this);
+
 	for (int i = 0; i < side->numsegs; i++)
 	{
 		seg_t *seg = side->segs[i];
@@ -248,6 +250,8 @@ void HWDrawInfo::AddLowerMissingTexture(side_t * side, subsector_t *sub, float B
 {
 	sector_t *backsec = side->segs[0]->backsector;
 	if (!backsec) return;
+
+	SharedDataLock lock(this);
 	if (backsec->transdoor)
 	{
 		// Transparent door hacks alter the backsector's floor height so we should not
@@ -130,15 +130,17 @@ void HWDrawInfo::GetDynSpriteLight(AActor *self, float x, float y, float z, FLig
 	}
 }
 
-void HWDrawInfo::GetDynSpriteLight(AActor *thing, particle_t *particle, float *out)
+void HWDrawInfo::GetDynSpriteLight(AActor *thing, int particle, float *out)
 {
 	if (thing != NULL)
 	{
 		GetDynSpriteLight(thing, (float)thing->X(), (float)thing->Y(), (float)thing->Center(), thing->section->lighthead, thing->Sector->PortalGroup, out);
 	}
-	else if (particle != NULL)
+	else if (particle >= 0)
 	{
-		GetDynSpriteLight(NULL, (float)particle->Pos.X, (float)particle->Pos.Y, (float)particle->Pos.Z, particle->subsector->section->lighthead, particle->subsector->sector->PortalGroup, out);
+		auto &particles = Level->Particles;
+		subsector_t *sub = particles.Subsector[particle];
+		GetDynSpriteLight(NULL, (float)particles.PosX[particle], (float)particles.PosY[particle], (float)particles.PosZ[particle], sub->section->lighthead, sub->sector->PortalGroup, out);
 	}
 }
 
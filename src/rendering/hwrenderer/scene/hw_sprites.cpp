@@ -169,11 +169,11 @@ void HWSprite::DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent)
 			if (dynlightindex == -1)	// only set if we got no light buffer index. This covers all cases where sprite lighting is used.
 			{
 				float out[3] = {};
-				di->GetDynSpriteLight(gl_light_sprites ? actor : nullptr, gl_light_particles ? particle : nullptr, out);
+				di->GetDynSpriteLight(gl_light_sprites ? actor : nullptr, gl_light_particles ? particle : -1, out);
 				state.SetDynLight(out[0], out[1], out[2]);
 			}
 		}
-		sector_t *cursec = actor ? actor->Sector : particle ? particle->subsector->sector : nullptr;
+		sector_t *cursec = actor ? actor->Sector : particle >= 0 ? di->Level->Particles.Subsector[particle]->sector : nullptr;
 		if (cursec != nullptr)
 		{
 			const PalEntry finalcol = fullbright
@@ -373,7 +373,7 @@ bool HWSprite::CalculateVertices(HWDrawInfo *di, FVector3 *v, DVector3 *vp)
 	}
 	
 	// [BB] Billboard stuff
-	const bool drawWithXYBillboard = ((particle && gl_billboard_particles) || (!(actor && actor->renderflags & RF_FORCEYBILLBOARD)
+	const bool drawWithXYBillboard = ((particle >= 0 && gl_billboard_particles) || (!(actor && actor->renderflags & RF_FORCEYBILLBOARD)
 		//&& di->mViewActor != nullptr
 		&& (gl_billboard_mode == 1 || (actor && actor->renderflags & RF_FORCEXYBILLBOARD))));
 
@@ -1172,7 +1172,7 @@ void HWSprite::Process(HWDrawInfo *di, AActor* thing, sector_t * sector, area_t
 		index = -1;
 	}
 
-	particle = nullptr;
+	particle = -1;
 
 	const bool drawWithXYBillboard = (!(actor->renderflags & RF_FORCEYBILLBOARD)
 		&& (actor->renderflags & RF_SPRITETYPEMASK) == RF_FACESPRITE
@@ -1217,9 +1217,10 @@ void HWSprite::Process(HWDrawInfo *di, AActor* thing, sector_t * sector, area_t
 //
 //==========================================================================
 
-void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *sector)//, int shade, int fakeside)
+void HWSprite::ProcessParticle (HWDrawInfo *di, int particle, sector_t *sector)//, int shade, int fakeside)
 {
-	if (particle->alpha==0) return;
+	auto &particles = di->Level->Particles;
+	if (particles.Alpha[particle]==0) return;
 
 	lightlevel = hw_ClampLight(sector->GetTexture(sector_t::ceiling) == skyflatnum ? 
 		sector->GetCeilingLight() : sector->GetFloorLight());
@@ -1229,7 +1230,7 @@ void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *
 	{
 		Colormap.Clear();
 	}
-	else if (!particle->bright)
+	else if (!particles.Bright[particle])
 	{
 		TArray<lightlist_t> & lightlist=sector->e->XFloor.lightlist;
 		double lightbottom;
@@ -1237,10 +1238,10 @@ void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *
 		Colormap = sector->Colormap;
 		for(unsigned int i=0;i<lightlist.Size();i++)
 		{
-			if (i<lightlist.Size()-1) lightbottom = lightlist[i+1].plane.ZatPoint(particle->Pos);
-			else lightbottom = sector->floorplane.ZatPoint(particle->Pos);
+			if (i<lightlist.Size()-1) lightbottom = lightlist[i+1].plane.ZatPoint(particles.Pos(particle));
+			else lightbottom = sector->floorplane.ZatPoint(particles.Pos(particle));
 
-			if (lightbottom < particle->Pos.Z)
+			if (lightbottom < particles.PosZ[particle])
 			{
 				lightlevel = hw_ClampLight(*lightlist[i].p_lightlevel);
 				Colormap.CopyLight(lightlist[i].extra_colormap);
@@ -1259,11 +1260,11 @@ void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *
 		Colormap.ClearColor();
 	}
 
-	trans=particle->alpha;
+	trans=particles.Alpha[particle];
 	RenderStyle = STYLE_Translucent;
 	OverrideShader = 0;
 
-	ThingColor = particle->color;
+	ThingColor = particles.Color[particle];
 	ThingColor.a = 255;
 
 	modelframe=nullptr;
@@ -1303,19 +1304,19 @@ void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *
 	double timefrac = vp.TicFrac;
 	if (paused || di->Level->isFrozen())
 		timefrac = 0.;
-	float xvf = (particle->Vel.X) * timefrac;
-	float yvf = (particle->Vel.Y) * timefrac;
-	float zvf = (particle->Vel.Z) * timefrac;
+	float xvf = (particles.VelX[particle]) * timefrac;
+	float yvf = (particles.VelY[particle]) * timefrac;
+	float zvf = (particles.VelZ[particle]) * timefrac;
 
-	x = float(particle->Pos.X) + xvf;
-	y = float(particle->Pos.Y) + yvf;
-	z = float(particle->Pos.Z) + zvf;
+	x = float(particles.PosX[particle]) + xvf;
+	y = float(particles.PosY[particle]) + yvf;
+	z = float(particles.PosZ[particle]) + zvf;
 	
 	float factor;
 	if (gl_particles_style == 1) factor = 1.3f / 7.f;
 	else if (gl_particles_style == 2) factor = 2.5f / 7.f;
 	else factor = 1 / 7.f;
-	float scalefac=particle->size * factor;
+	float scalefac=particles.Size[particle] * factor;
 
 	float viewvecX = vp.ViewVector.X;
 	float viewvecY = vp.ViewVector.Y;
@@ -1331,7 +1332,7 @@ void HWSprite::ProcessParticle (HWDrawInfo *di, particle_t *particle, sector_t *
 
 	actor=nullptr;
 	this->particle=particle;
-	fullbright = !!particle->bright;
+	fullbright = !!particles.Bright[particle];
 	
 	// [BB] Translucent particles have to be rendered without the alpha test.
 	if (gl_particles_style != 2 && trans>=1.0f-FLT_EPSILON) hw_styleflags = STYLEHW_Solid;
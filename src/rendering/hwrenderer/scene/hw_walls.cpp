@@ -566,6 +566,7 @@ void HWWall::PutWall(HWDrawInfo *di, bool translucent)
 void HWWall::PutPortal(HWDrawInfo *di, int ptype, int plane)
 {
 	HWPortal * portal = nullptr;
+	HWDrawInfo::SharedDataLock lock(di);
 
 	MakeVertices(di, false);
 	switch (ptype)
@@ -49,17 +49,10 @@
 #include "r_draw_rgba.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/scene/r_light.h"
-#ifdef NO_SSE
-#include "r_draw_wall32.h"
-#include "r_draw_sprite32.h"
-#include "r_draw_span32.h"
-#include "r_draw_sky32.h"
-#else
-#include "r_draw_wall32_sse2.h"
-#include "r_draw_sprite32_sse2.h"
-#include "r_draw_span32_sse2.h"
-#include "r_draw_sky32_sse2.h"
-#endif
+#include "r_draw_wall32_simd.h"
+#include "r_draw_sprite32_simd.h"
+#include "r_draw_span32_simd.h"
+#include "r_draw_sky32_simd.h"
 
 #include "gi.h"
 #include "stats.h"
@@ -24,6 +24,7 @@
 
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_skydrawer.h"
+#include "simd.h"
 
 namespace swrenderer
 {
@@ -32,6 +33,8 @@ namespace swrenderer
 	public:
 		static void DrawColumn(const SkyDrawerArgs& args)
 		{
+			using V = simd::native;
+
 			uint32_t *dest = (uint32_t *)args.Dest();
 			int pitch = args.Viewport()->RenderTarget->GetPitch();
 			const uint32_t *source0 = (const uint32_t *)args.FrontTexturePixels();
@@ -71,8 +74,8 @@ namespace swrenderer
 				return;
 			}
 
-			BgraColor solid_top_fill = solid_top;
-			BgraColor solid_bottom_fill = solid_bottom;
+			V::vec solid_top_fill = V::load1px(solid_top);
+			V::vec solid_bottom_fill = V::load1px(solid_bottom);
 
 			int index = 0;
 
@@ -91,14 +94,12 @@ namespace swrenderer
 				uint32_t sample_index = (((((uint32_t)frac) << 8) >> FRACBITS) * textureheight0) >> FRACBITS;
 				uint32_t fg = source0[sample_index];
 
-				uint32_t alpha = MAX(MIN(frac >> (16 - start_fade), 256), 0);
-				uint32_t inv_alpha = 256 - alpha;
+				V::vec alpha = V::set1(MAX(MIN(frac >> (16 - start_fade), 256), 0));
+				V::vec inv_alpha = V::sub(V::set1(256), alpha);
 				
-				BgraColor c = fg;
-				c.r = (c.r * alpha + solid_top_fill.r * inv_alpha) >> 8;
-				c.g = (c.g * alpha + solid_top_fill.g * inv_alpha) >> 8;
-				c.b = (c.b * alpha + solid_top_fill.b * inv_alpha) >> 8;
-				*dest = c;
+				V::vec c = V::load1px(fg);
+				c = V::srli<8>(V::add(V::mullo(c, alpha), V::mullo(solid_top_fill, inv_alpha)));
+				*dest = V::store1px(c);
 
 				frac += fracstep;
 				dest += pitch;
@@ -122,14 +123,12 @@ namespace swrenderer
 				uint32_t sample_index = (((((uint32_t)frac) << 8) >> FRACBITS) * textureheight0) >> FRACBITS;
 				uint32_t fg = source0[sample_index];
 
-				uint32_t alpha = MAX(MIN(((2 << 24) - frac) >> (16 - start_fade), 256), 0);
-				uint32_t inv_alpha = 256 - alpha;
+				V::vec alpha = V::set1(MAX(MIN(((2 << 24) - frac) >> (16 - start_fade), 256), 0));
+				V::vec inv_alpha = V::sub(V::set1(256), alpha);
 				
-				BgraColor c = fg;
-				c.r = (c.r * alpha + solid_top_fill.r * inv_alpha) >> 8;
-				c.g = (c.g * alpha + solid_top_fill.g * inv_alpha) >> 8;
-				c.b = (c.b * alpha + solid_top_fill.b * inv_alpha) >> 8;
-				*dest = c;
+				V::vec c = V::load1px(fg);
+				c = V::srli<8>(V::add(V::mullo(c, alpha), V::mullo(solid_top_fill, inv_alpha)));
+				*dest = V::store1px(c);
 
 				frac += fracstep;
 				dest += pitch;
@@ -151,6 +150,8 @@ namespace swrenderer
 	public:
 		static void DrawColumn(const SkyDrawerArgs& args)
 		{
+			using V = simd::native;
+
 			uint32_t *dest = (uint32_t *)args.Dest();
 			int pitch = args.Viewport()->RenderTarget->GetPitch();
 			const uint32_t *source0 = (const uint32_t *)args.FrontTexturePixels();
@@ -166,18 +167,6 @@ namespace swrenderer
 			uint32_t solid_top = args.SolidTopColor();
 			uint32_t solid_bottom = args.SolidBottomColor();
 			bool fadeSky = args.FadeSky();
-			
-			// Find bands for top solid color, top fade, center textured, bottom fade, bottom solid color:
-			int start_fade = 2; // How fast it should fade out
-			int fade_length = (1 << (24 - start_fade));
-			int start_fadetop_y = (-frac) / fracstep;
-			int end_fadetop_y = (fade_length - frac) / fracstep;
-			int start_fadebottom_y = ((2 << 24) - fade_length - frac) / fracstep;
-			int end_fadebottom_y = ((2 << 24) - frac) / fracstep;
-			start_fadetop_y = clamp(start_fadetop_y, 0, count);
-			end_fadetop_y = clamp(end_fadetop_y, 0, count);
-			start_fadebottom_y = clamp(start_fadebottom_y, 0, count);
-			end_fadebottom_y = clamp(end_fadebottom_y, 0, count);
 
 			if (!fadeSky)
 			{
@@ -199,8 +188,20 @@ namespace swrenderer
 				return;
 			}
 
-			BgraColor solid_top_fill = solid_top;
-			BgraColor solid_bottom_fill = solid_bottom;
+			// Find bands for top solid color, top fade, center textured, bottom fade, bottom solid color:
+			int start_fade = 2; // How fast it should fade out
+			int fade_length = (1 << (24 - start_fade));
+			int start_fadetop_y = (-frac) / fracstep;
+			int end_fadetop_y = (fade_length - frac) / fracstep;
+			int start_fadebottom_y = ((2 << 24) - fade_length - frac) / fracstep;
+			int end_fadebottom_y = ((2 << 24) - frac) / fracstep;
+			start_fadetop_y = clamp(start_fadetop_y, 0, count);
+			end_fadetop_y = clamp(end_fadetop_y, 0, count);
+			start_fadebottom_y = clamp(start_fadebottom_y, 0, count);
+			end_fadebottom_y = clamp(end_fadebottom_y, 0, count);
+
+			V::vec solid_top_fill = V::load1px(solid_top);
+			V::vec solid_bottom_fill = V::load1px(solid_bottom);
 
 			int index = 0;
 
@@ -224,12 +225,12 @@ namespace swrenderer
 					fg = source1[sample_index2];
 				}
 
-				uint32_t alpha = MAX(MIN(frac >> (16 - start_fade), 256), 0);
-				uint32_t inv_alpha = 256 - alpha;
+				V::vec alpha = V::set1(MAX(MIN(frac >> (16 - start_fade), 256), 0));
+				V::vec inv_alpha = V::sub(V::set1(256), alpha);
 				
-				BgraColor c = fg;
-				c = (c * alpha + solid_top_fill * inv_alpha) >> 8;
-				*dest = c;
+				V::vec c = V::load1px(fg);
+				c = V::srli<8>(V::add(V::mullo(c, alpha), V::mullo(solid_top_fill, inv_alpha)));
+				*dest = V::store1px(c);
 
 				frac += fracstep;
 				dest += pitch;
@@ -264,12 +265,12 @@ namespace swrenderer
 					fg = source1[sample_index2];
 				}
 
-				uint32_t alpha = MAX(MIN(((2 << 24) - frac) >> (16 - start_fade), 256), 0);
-				uint32_t inv_alpha = 256 - alpha;
+				V::vec alpha = V::set1(MAX(MIN(((2 << 24) - frac) >> (16 - start_fade), 256), 0));
+				V::vec inv_alpha = V::sub(V::set1(256), alpha);
 				
-				BgraColor c = fg;
-				c = (c * alpha + solid_top_fill * inv_alpha) >> 8;
-				*dest = c;
+				V::vec c = V::load1px(fg);
+				c = V::srli<8>(V::add(V::mullo(c, alpha), V::mullo(solid_top_fill, inv_alpha)));
+				*dest = V::store1px(c);
 
 				frac += fracstep;
 				dest += pitch;
@@ -24,6 +24,7 @@
 
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_walldrawer.h"
+#include "simd.h"
 
 namespace swrenderer
 {
@@ -56,6 +57,8 @@ namespace swrenderer
 	template<typename BlendT, typename SamplerT>
 	class DrawSprite32T
 	{
+		typedef simd::native V;
+
 	public:
 		static void DrawColumn(const SpriteDrawerArgs& args)
 		{
@@ -124,37 +127,35 @@ namespace swrenderer
 			uint32_t one = ((0x20000000 + textureheight - 1) / textureheight) * 2 + 1;
 
 			// Shade constants
-			__m128i dynlight = _mm_cvtsi32_si128(args.DynamicLight());
-			dynlight = _mm_unpacklo_epi8(dynlight, _mm_setzero_si128());
-			dynlight = _mm_shuffle_epi32(dynlight, _MM_SHUFFLE(1, 0, 1, 0));
+			uint32_t dynlightcolor = args.DynamicLight();
+			V::vec dynlight = V::set4(BPART(dynlightcolor), GPART(dynlightcolor), RPART(dynlightcolor), APART(dynlightcolor));
 			int light = 256 - (args.Light() >> (FRACBITS - 8));
-			__m128i mlight = _mm_set_epi16(256, light, light, light, 256, light, light, light);
+			V::vec mlight = V::set4(light, light, light, 256);
 
-			__m128i inv_desaturate, shade_fade, shade_light;
+			V::vec inv_desaturate, shade_fade, shade_light;
 			int desaturate;
-			__m128i lightcontrib;
+			V::vec lightcontrib;
 			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
 			{
-				__m128i inv_light = _mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light);
-				inv_desaturate = _mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate);
-				shade_fade = _mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue);
-				shade_fade = _mm_mullo_epi16(shade_fade, inv_light);
-				shade_light = _mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue);
+				V::vec inv_light = V::set4(256 - light, 256 - light, 256 - light, 0);
+				inv_desaturate = V::set4(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate);
+				shade_fade = V::set4(shade_constants.fade_blue, shade_constants.fade_green, shade_constants.fade_red, shade_constants.fade_alpha);
+				shade_fade = V::mullo(shade_fade, inv_light);
+				shade_light = V::set4(shade_constants.light_blue, shade_constants.light_green, shade_constants.light_red, shade_constants.light_alpha);
 				desaturate = shade_constants.desaturate;
 
-				lightcontrib = _mm_min_epi16(_mm_add_epi16(mlight, dynlight), _mm_set1_epi16(256));
-				lightcontrib = _mm_sub_epi16(lightcontrib, mlight);
+				lightcontrib = V::min(V::add(mlight, dynlight), V::set1(256));
+				lightcontrib = V::sub(lightcontrib, mlight);
 			}
 			else
 			{
-				inv_desaturate = _mm_setzero_si128();
-				shade_fade = _mm_setzero_si128();
-				shade_fade = _mm_setzero_si128();
-				shade_light = _mm_setzero_si128();
+				inv_desaturate = V::zero();
+				shade_fade = V::zero();
+				shade_light = V::zero();
 				desaturate = 0;
-				lightcontrib = _mm_setzero_si128();
+				lightcontrib = V::zero();
 
-				mlight = _mm_min_epi16(_mm_add_epi16(mlight, dynlight), _mm_set1_epi16(256));
+				mlight = V::min(V::add(mlight, dynlight), V::set1(256));
 			}
 
 			int count = args.Count();
@@ -164,7 +165,6 @@ namespace swrenderer
 			uint32_t frac = args.TextureVPos();
 			uint32_t texturefracx = args.TextureUPos();
 			uint32_t *dest = (uint32_t*)args.Dest();
-			int dest_y = args.DestY();
 
 			if (FilterModeT::Mode == (int)FilterModes::Linear)
 			{
@@ -185,17 +185,17 @@ namespace swrenderer
 				desttmp[0] = dest[offset];
 				desttmp[1] = dest[offset + pitch];
 
-				__m128i bgcolor;
+				V::vec bgcolor;
 				if (BlendT::Mode != (int)SpriteBlendModes::Opaque && BlendT::Mode != (int)SpriteBlendModes::Copy)
 				{
-					bgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)desttmp), _mm_setzero_si128());
+					bgcolor = V::load2px(desttmp);
 				}
 				else
 				{
-					bgcolor = _mm_setzero_si128();
+					bgcolor = V::zero();
 				}
 
-				unsigned int ifgcolor[2], ifgshade[2];
+				uint32_t ifgcolor[2], ifgshade[2];
 				ifgcolor[0] = Sample<FilterModeT>(frac, source, source2, translation, textureheight, one, texturefracx, color, srccolor);
 				ifgshade[0] = SampleShade(frac, source, colormap);
 				frac += fracstep;
@@ -204,14 +204,14 @@ namespace swrenderer
 				ifgshade[1] = SampleShade(frac, source, colormap);
 				frac += fracstep;
 
-				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
+				V::vec fgcolor = V::load2px(ifgcolor);
 
 				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lightcontrib);
-				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], ifgshade[0], ifgshade[1], srcalpha, destalpha);
+				V::vec outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], ifgshade[0], ifgshade[1], srcalpha, destalpha);
 
-				_mm_storel_epi64((__m128i*)desttmp, outcolor);
-				dest[offset] = desttmp[0];
-				dest[offset + pitch] = desttmp[1];
+				V::store2px(desttmp, outcolor);
+				dest[offset] = desttmp[0] | 0xff000000;
+				dest[offset + pitch] = desttmp[1] | 0xff000000;
 			}
 
 			if (ssecount * 2 != count)
@@ -219,28 +219,28 @@ namespace swrenderer
 				int index = ssecount * 2;
 				int offset = index * pitch;
 
-				__m128i bgcolor;
+				V::vec bgcolor;
 				if (BlendT::Mode != (int)SpriteBlendModes::Opaque && BlendT::Mode != (int)SpriteBlendModes::Copy)
 				{
-					bgcolor = _mm_unpacklo_epi8(_mm_cvtsi32_si128(dest[offset]), _mm_setzero_si128());
+					bgcolor = V::load1px(dest[offset]);
 				}
 				else
 				{
-					bgcolor = _mm_setzero_si128();
+					bgcolor = V::zero();
 				}
 
 				// Sample
-				unsigned int ifgcolor[2], ifgshade[2];
+				uint32_t ifgcolor[2], ifgshade[2];
 				ifgcolor[0] = Sample<FilterModeT>(frac, source, source2, translation, textureheight, one, texturefracx, color, srccolor);
 				ifgcolor[1] = 0;
 				ifgshade[0] = SampleShade(frac, source, colormap);
 				ifgshade[1] = 0;
-				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
+				V::vec fgcolor = V::load2px(ifgcolor);
 
 				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lightcontrib);
-				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], ifgshade[0], ifgshade[1], srcalpha, destalpha);
+				V::vec outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], ifgshade[0], ifgshade[1], srcalpha, destalpha);
 
-				dest[offset] = _mm_cvtsi128_si32(outcolor);
+				dest[offset] = V::store1px(outcolor) | 0xff000000;
 			}
 		}
 
@@ -311,7 +311,7 @@ namespace swrenderer
 		}
 
 		template<typename ShadeModeT>
-		FORCEINLINE static __m128i VECTORCALL Shade(__m128i fgcolor, __m128i mlight, unsigned int ifgcolor0, unsigned int ifgcolor1, int desaturate, __m128i inv_desaturate, __m128i shade_fade, __m128i shade_light, __m128i lightcontrib)
+		FORCEINLINE static V::vec VECTORCALL Shade(V::vec fgcolor, V::vec mlight, unsigned int ifgcolor0, unsigned int ifgcolor1, int desaturate, V::vec inv_desaturate, V::vec shade_fade, V::vec shade_light, V::vec lightcontrib)
 		{
 			using namespace DrawSprite32TModes;
 
@@ -320,12 +320,12 @@ namespace swrenderer
 
 			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
 			{
-				fgcolor = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, mlight), 8);
+				fgcolor = V::srli<8>(V::mullo(fgcolor, mlight));
 				return fgcolor;
 			}
 			else
 			{
-				__m128i lit_dynlight = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, lightcontrib), 8);
+				V::vec lit_dynlight = V::srli<8>(V::mullo(fgcolor, lightcontrib));
 
 				int blue0 = BPART(ifgcolor0);
 				int green0 = GPART(ifgcolor0);
@@ -337,51 +337,43 @@ namespace swrenderer
 				int red1 = RPART(ifgcolor1);
 				int intensity1 = ((red1 * 77 + green1 * 143 + blue1 * 37) >> 8) * desaturate;
 
-				__m128i intensity = _mm_set_epi16(0, intensity1, intensity1, intensity1, 0, intensity0, intensity0, intensity0);
+				V::vec intensity = V::set8(intensity0, intensity0, intensity0, 0, intensity1, intensity1, intensity1, 0);
 
-				fgcolor = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(fgcolor, inv_desaturate), intensity), 8);
-				fgcolor = _mm_mullo_epi16(fgcolor, mlight);
-				fgcolor = _mm_srli_epi16(_mm_add_epi16(shade_fade, fgcolor), 8);
-				fgcolor = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, shade_light), 8);
+				fgcolor = V::srli<8>(V::add(V::mullo(fgcolor, inv_desaturate), intensity));
+				fgcolor = V::mullo(fgcolor, mlight);
+				fgcolor = V::srli<8>(V::add(shade_fade, fgcolor));
+				fgcolor = V::srli<8>(V::mullo(fgcolor, shade_light));
 
-				fgcolor = _mm_add_epi16(fgcolor, lit_dynlight);
-				fgcolor = _mm_min_epi16(fgcolor, _mm_set1_epi16(255));
+				fgcolor = V::add(fgcolor, lit_dynlight);
+				fgcolor = V::min(fgcolor, V::set1(255));
 				return fgcolor;
 			}
 		}
 
-		FORCEINLINE static __m128i VECTORCALL Blend(__m128i fgcolor, __m128i bgcolor, unsigned int ifgcolor0, unsigned int ifgcolor1, unsigned int ifgshade0, unsigned int ifgshade1, uint32_t srcalpha, uint32_t destalpha)
+		// The caller sets the alpha channel of the stored pixels to 255
+		FORCEINLINE static V::vec VECTORCALL Blend(V::vec fgcolor, V::vec bgcolor, unsigned int ifgcolor0, unsigned int ifgcolor1, unsigned int ifgshade0, unsigned int ifgshade1, uint32_t srcalpha, uint32_t destalpha)
 		{
 			using namespace DrawSprite32TModes;
 
 			if (BlendT::Mode == (int)SpriteBlendModes::Opaque)
 			{
-				__m128i outcolor = fgcolor;
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				return fgcolor;
 			}
 			else if (BlendT::Mode == (int)SpriteBlendModes::Shaded)
 			{
-				__m128i alpha = _mm_set_epi16(ifgshade1, ifgshade1, ifgshade1, ifgshade1, ifgshade0, ifgshade0, ifgshade0, ifgshade0);
-				__m128i inv_alpha = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
-
-				fgcolor = _mm_mullo_epi16(fgcolor, alpha);
-				bgcolor = _mm_mullo_epi16(bgcolor, inv_alpha);
-				__m128i outcolor = _mm_srli_epi16(_mm_add_epi16(fgcolor, bgcolor), 8);
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				V::vec alpha = V::set8(ifgshade0, ifgshade0, ifgshade0, ifgshade0, ifgshade1, ifgshade1, ifgshade1, ifgshade1);
+				V::vec inv_alpha = V::sub(V::set1(256), alpha);
+
+				fgcolor = V::mullo(fgcolor, alpha);
+				bgcolor = V::mullo(bgcolor, inv_alpha);
+				return V::srli<8>(V::add(fgcolor, bgcolor));
 			}
 			else if (BlendT::Mode == (int)SpriteBlendModes::AddClampShaded)
 			{
-				__m128i alpha = _mm_set_epi16(ifgshade1, ifgshade1, ifgshade1, ifgshade1, ifgshade0, ifgshade0, ifgshade0, ifgshade0);
+				V::vec alpha = V::set8(ifgshade0, ifgshade0, ifgshade0, ifgshade0, ifgshade1, ifgshade1, ifgshade1, ifgshade1);
 
-				fgcolor = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, alpha), 8);
-				__m128i outcolor = _mm_add_epi16(fgcolor, bgcolor);
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				fgcolor = V::srli<8>(V::mullo(fgcolor, alpha));
+				return V::add(fgcolor, bgcolor);
 			}
 			else
 			{
@@ -397,40 +389,37 @@ namespace swrenderer
 				uint32_t fgalpha0 = (srcalpha * alpha0 + 128) >> 8;
 				uint32_t fgalpha1 = (srcalpha * alpha1 + 128) >> 8;
 
-				__m128i bgalpha = _mm_set_epi16(bgalpha1, bgalpha1, bgalpha1, bgalpha1, bgalpha0, bgalpha0, bgalpha0, bgalpha0);
-				__m128i fgalpha = _mm_set_epi16(fgalpha1, fgalpha1, fgalpha1, fgalpha1, fgalpha0, fgalpha0, fgalpha0, fgalpha0);
+				V::vec bgalpha = V::set8(bgalpha0, bgalpha0, bgalpha0, bgalpha0, bgalpha1, bgalpha1, bgalpha1, bgalpha1);
+				V::vec fgalpha = V::set8(fgalpha0, fgalpha0, fgalpha0, fgalpha0, fgalpha1, fgalpha1, fgalpha1, fgalpha1);
 
-				fgcolor = _mm_mullo_epi16(fgcolor, fgalpha);
-				bgcolor = _mm_mullo_epi16(bgcolor, bgalpha);
+				fgcolor = V::mullo(fgcolor, fgalpha);
+				bgcolor = V::mullo(bgcolor, bgalpha);
 
-				__m128i fg_lo = _mm_unpacklo_epi16(fgcolor, _mm_setzero_si128());
-				__m128i bg_lo = _mm_unpacklo_epi16(bgcolor, _mm_setzero_si128());
-				__m128i fg_hi = _mm_unpackhi_epi16(fgcolor, _mm_setzero_si128());
-				__m128i bg_hi = _mm_unpackhi_epi16(bgcolor, _mm_setzero_si128());
+				V::ivec fg_lo = V::widenlo(fgcolor);
+				V::ivec bg_lo = V::widenlo(bgcolor);
+				V::ivec fg_hi = V::widenhi(fgcolor);
+				V::ivec bg_hi = V::widenhi(bgcolor);
 
-				__m128i out_lo, out_hi;
+				V::ivec out_lo, out_hi;
 				if (BlendT::Mode == (int)SpriteBlendModes::AddClamp)
 				{
-					out_lo = _mm_add_epi32(fg_lo, bg_lo);
-					out_hi = _mm_add_epi32(fg_hi, bg_hi);
+					out_lo = V::addi(fg_lo, bg_lo);
+					out_hi = V::addi(fg_hi, bg_hi);
 				}
 				else if (BlendT::Mode == (int)SpriteBlendModes::SubClamp)
 				{
-					out_lo = _mm_sub_epi32(fg_lo, bg_lo);
-					out_hi = _mm_sub_epi32(fg_hi, bg_hi);
+					out_lo = V::subi(fg_lo, bg_lo);
+					out_hi = V::subi(fg_hi, bg_hi);
 				}
 				else if (BlendT::Mode == (int)SpriteBlendModes::RevSubClamp)
 				{
-					out_lo = _mm_sub_epi32(bg_lo, fg_lo);
-					out_hi = _mm_sub_epi32(bg_hi, fg_hi);
+					out_lo = V::subi(bg_lo, fg_lo);
+					out_hi = V::subi(bg_hi, fg_hi);
 				}
 
-				out_lo = _mm_srai_epi32(out_lo, 8);
-				out_hi = _mm_srai_epi32(out_hi, 8);
-				__m128i outcolor = _mm_packs_epi32(out_lo, out_hi);
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				out_lo = V::srai<8>(out_lo);
+				out_hi = V::srai<8>(out_hi);
+				return V::narrow(out_lo, out_hi);
 			}
 		}
 	};
@@ -25,6 +25,7 @@
 #include "swrenderer/drawers/r_draw_pal.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_walldrawer.h"
+#include "simd.h"
 
 namespace swrenderer
 {
@@ -49,6 +50,8 @@ namespace swrenderer
 	template<typename BlendT>
 	class DrawWall32T
 	{
+		typedef simd::native V;
+
 	public:
 		static void DrawColumn(const WallColumnDrawerArgs& args)
 		{
@@ -85,25 +88,24 @@ namespace swrenderer
 
 			// Shade constants
 			int light = 256 - (args.Light() >> (FRACBITS - 8));
-			__m128i mlight = _mm_set_epi16(256, light, light, light, 256, light, light, light);
-			__m128i inv_light = _mm_set_epi16(0, 256 - light, 256 - light, 256 - light, 0, 256 - light, 256 - light, 256 - light);
+			V::vec mlight = V::set4(light, light, light, 256);
+			V::vec inv_light = V::set4(256 - light, 256 - light, 256 - light, 0);
 
-			__m128i inv_desaturate, shade_fade, shade_light;
+			V::vec inv_desaturate, shade_fade, shade_light;
 			int desaturate;
 			if (ShadeModeT::Mode == (int)ShadeMode::Advanced)
 			{
-				inv_desaturate = _mm_setr_epi16(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate);
-				shade_fade = _mm_set_epi16(shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue, shade_constants.fade_alpha, shade_constants.fade_red, shade_constants.fade_green, shade_constants.fade_blue);
-				shade_fade = _mm_mullo_epi16(shade_fade, inv_light);
-				shade_light = _mm_set_epi16(shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue, shade_constants.light_alpha, shade_constants.light_red, shade_constants.light_green, shade_constants.light_blue);
+				inv_desaturate = V::set4(256, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate, 256 - shade_constants.desaturate);
+				shade_fade = V::set4(shade_constants.fade_blue, shade_constants.fade_green, shade_constants.fade_red, shade_constants.fade_alpha);
+				shade_fade = V::mullo(shade_fade, inv_light);
+				shade_light = V::set4(shade_constants.light_blue, shade_constants.light_green, shade_constants.light_red, shade_constants.light_alpha);
 				desaturate = shade_constants.desaturate;
 			}
 			else
 			{
-				inv_desaturate = _mm_setzero_si128();
-				shade_fade = _mm_setzero_si128();
-				shade_fade = _mm_setzero_si128();
-				shade_light = _mm_setzero_si128();
+				inv_desaturate = V::zero();
+				shade_fade = V::zero();
+				shade_light = V::zero();
 				desaturate = 0;
 			}
 
@@ -115,14 +117,13 @@ namespace swrenderer
 			uint32_t frac = args.TextureVPos();
 			uint32_t texturefracx = args.TextureUPos();
 			uint32_t *dest = (uint32_t*)args.Dest();
-			int dest_y = args.DestY();
 
 			auto lights = args.dc_lights;
 			auto num_lights = args.dc_num_lights;
 			float vpz = args.dc_viewpos.Z;
 			float stepvpz = args.dc_viewpos_step.Z;
-			__m128 viewpos_z = _mm_setr_ps(vpz, vpz + stepvpz, 0.0f, 0.0f);
-			__m128 step_viewpos_z = _mm_set1_ps(stepvpz * 2.0f);
+			V::fvec viewpos_z = V::setrf(vpz, vpz + stepvpz, 0.0f, 0.0f);
+			V::fvec step_viewpos_z = V::set1f(stepvpz * 2.0f);
 
 			if (FilterModeT::Mode == (int)FilterModes::Linear)
 			{
@@ -140,32 +141,32 @@ namespace swrenderer
 				desttmp[0] = dest[offset];
 				desttmp[1] = dest[offset + pitch];
 
-				__m128i bgcolor;
+				V::vec bgcolor;
 				if (BlendT::Mode != (int)WallBlendModes::Opaque)
 				{
-					bgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)desttmp), _mm_setzero_si128());
+					bgcolor = V::load2px(desttmp);
 				}
 				else
 				{
-					bgcolor = _mm_setzero_si128();
+					bgcolor = V::zero();
 				}
 
-				unsigned int ifgcolor[2];
+				uint32_t ifgcolor[2];
 				ifgcolor[0] = Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
 				frac += fracstep;
 
 				ifgcolor[1] = Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
 				frac += fracstep;
 
-				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
+				V::vec fgcolor = V::load2px(ifgcolor);
 
 				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
-				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
+				V::vec outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
 
-				_mm_storel_epi64((__m128i*)desttmp, outcolor);
-				dest[offset] = desttmp[0];
-				dest[offset + pitch] = desttmp[1];
-				viewpos_z = _mm_add_ps(viewpos_z, step_viewpos_z);
+				V::store2px(desttmp, outcolor);
+				dest[offset] = desttmp[0] | 0xff000000;
+				dest[offset + pitch] = desttmp[1] | 0xff000000;
+				viewpos_z = V::addf(viewpos_z, step_viewpos_z);
 			}
 
 			if (ssecount * 2 != count)
@@ -173,25 +174,25 @@ namespace swrenderer
 				int index = ssecount * 2;
 				int offset = index * pitch;
 
-				__m128i bgcolor;
+				V::vec bgcolor;
 				if (BlendT::Mode != (int)WallBlendModes::Opaque)
 				{
-					bgcolor = _mm_unpacklo_epi8(_mm_cvtsi32_si128(dest[offset]), _mm_setzero_si128());
+					bgcolor = V::load1px(dest[offset]);
 				}
 				else
 				{
-					bgcolor = _mm_setzero_si128();
+					bgcolor = V::zero();
 				}
 
-				unsigned int ifgcolor[2];
+				uint32_t ifgcolor[2];
 				ifgcolor[0] = Sample<FilterModeT>(frac, source, source2, textureheight, one, texturefracx);
 				ifgcolor[1] = 0;
-				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
+				V::vec fgcolor = V::load2px(ifgcolor);
 
 				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
-				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
+				V::vec outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
 
-				dest[offset] = _mm_cvtsi128_si32(outcolor);
+				dest[offset] = V::store1px(outcolor) | 0xff000000;
 			}
 		}
 
@@ -232,14 +233,14 @@ namespace swrenderer
 		}
 
 		template<typename ShadeModeT>
-		FORCEINLINE static __m128i VECTORCALL Shade(__m128i fgcolor, __m128i mlight, unsigned int ifgcolor0, unsigned int ifgcolor1, int desaturate, __m128i inv_desaturate, __m128i shade_fade, __m128i shade_light, const DrawerLight *lights, int num_lights, __m128 viewpos_z)
+		FORCEINLINE static V::vec VECTORCALL Shade(V::vec fgcolor, V::vec mlight, unsigned int ifgcolor0, unsigned int ifgcolor1, int desaturate, V::vec inv_desaturate, V::vec shade_fade, V::vec shade_light, const DrawerLight *lights, int num_lights, V::fvec viewpos_z)
 		{
 			using namespace DrawWall32TModes;
 
-			__m128i material = fgcolor;
+			V::vec material = fgcolor;
 			if (ShadeModeT::Mode == (int)ShadeMode::Simple)
 			{
-				fgcolor = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, mlight), 8);
+				fgcolor = V::srli<8>(V::mullo(fgcolor, mlight));
 			}
 			else
 			{
@@ -253,99 +254,76 @@ namespace swrenderer
 				int red1 = RPART(ifgcolor1);
 				int intensity1 = ((red1 * 77 + green1 * 143 + blue1 * 37) >> 8) * desaturate;
 
-				__m128i intensity = _mm_set_epi16(0, intensity1, intensity1, intensity1, 0, intensity0, intensity0, intensity0);
+				V::vec intensity = V::set8(intensity0, intensity0, intensity0, 0, intensity1, intensity1, intensity1, 0);
 
-				fgcolor = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(fgcolor, inv_desaturate), intensity), 8);
-				fgcolor = _mm_mullo_epi16(fgcolor, mlight);
-				fgcolor = _mm_srli_epi16(_mm_add_epi16(shade_fade, fgcolor), 8);
-				fgcolor = _mm_srli_epi16(_mm_mullo_epi16(fgcolor, shade_light), 8);
+				fgcolor = V::srli<8>(V::add(V::mullo(fgcolor, inv_desaturate), intensity));
+				fgcolor = V::mullo(fgcolor, mlight);
+				fgcolor = V::srli<8>(V::add(shade_fade, fgcolor));
+				fgcolor = V::srli<8>(V::mullo(fgcolor, shade_light));
 			}
 
 			return AddLights(material, fgcolor, lights, num_lights, viewpos_z);
 		}
 
-		FORCEINLINE static __m128i VECTORCALL AddLights(__m128i material, __m128i fgcolor, const DrawerLight *lights, int num_lights, __m128 viewpos_z)
+		FORCEINLINE static V::vec VECTORCALL AddLights(V::vec material, V::vec fgcolor, const DrawerLight *lights, int num_lights, V::fvec viewpos_z)
 		{
 			using namespace DrawWall32TModes;
 
-			__m128i lit = _mm_setzero_si128();
+			V::vec lit = V::zero();
 
 			for (int i = 0; i != num_lights; i++)
 			{
-				__m128 light_x = _mm_set1_ps(lights[i].x);
-				__m128 light_y = _mm_set1_ps(lights[i].y);
-				__m128 light_z = _mm_set1_ps(lights[i].z);
-				__m128 light_radius = _mm_set1_ps(lights[i].radius);
-				__m128 m256 = _mm_set1_ps(256.0f);
+				V::fvec light_x = V::set1f(lights[i].x);
+				V::fvec light_y = V::set1f(lights[i].y);
+				V::fvec light_z = V::set1f(lights[i].z);
+				V::fvec light_radius = V::set1f(lights[i].radius);
+				V::fvec m256 = V::set1f(256.0f);
 
 				// L = light-pos
 				// dist = sqrt(dot(L, L))
 				// distance_attenuation = 1 - MIN(dist * (1/radius), 1)
-				__m128 Lxy2 = light_x; // L.x*L.x + L.y*L.y
-				__m128 Lz = _mm_sub_ps(light_z, viewpos_z);
-				__m128 dist2 = _mm_add_ps(Lxy2, _mm_mul_ps(Lz, Lz));
-				__m128 rcp_dist = _mm_rsqrt_ps(dist2);
-				__m128 dist = _mm_mul_ps(dist2, rcp_dist);
-				__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
+				V::fvec Lxy2 = light_x; // L.x*L.x + L.y*L.y
+				V::fvec Lz = V::subf(light_z, viewpos_z);
+				V::fvec dist2 = V::addf(Lxy2, V::mulf(Lz, Lz));
+				V::fvec rcp_dist = V::rsqrtf(dist2);
+				V::fvec dist = V::mulf(dist2, rcp_dist);
+				V::fvec distance_attenuation = V::subf(m256, V::minf(V::mulf(dist, light_radius), m256));
 
 				// The simple light type
-				__m128 simple_attenuation = distance_attenuation;
+				V::fvec simple_attenuation = distance_attenuation;
 
 				// The point light type
 				// diffuse = dot(N,L) * attenuation
-				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_y, rcp_dist), distance_attenuation);
+				V::fvec point_attenuation = V::mulf(V::mulf(light_y, rcp_dist), distance_attenuation);
 
-				__m128 is_attenuated = _mm_cmpeq_ps(light_y, _mm_setzero_ps());
-				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
-				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
+				V::fvec is_attenuated = V::cmpeqf(light_y, V::zerof());
+				V::vec attenuation = V::narrowsplat(V::roundi(V::selectf(is_attenuated, simple_attenuation, point_attenuation)));
 
-				__m128i light_color = _mm_cvtsi32_si128(lights[i].color);
-				light_color = _mm_unpacklo_epi8(light_color, _mm_setzero_si128());
-				light_color = _mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0));
+				uint32_t color = lights[i].color;
+				V::vec light_color = V::set4(BPART(color), GPART(color), RPART(color), APART(color));
 
-				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(light_color, attenuation), 8));
+				lit = V::add(lit, V::srli<8>(V::mullo(light_color, attenuation)));
 			}
 
-			lit = _mm_min_epi16(lit, _mm_set1_epi16(256));
+			lit = V::min(lit, V::set1(256));
 
-			fgcolor = _mm_add_epi16(fgcolor, _mm_srli_epi16(_mm_mullo_epi16(material, lit), 8));
-			fgcolor = _mm_min_epi16(fgcolor, _mm_set1_epi16(255));
+			fgcolor = V::add(fgcolor, V::srli<8>(V::mullo(material, lit)));
+			fgcolor = V::min(fgcolor, V::set1(255));
 			return fgcolor;
 		}
 
-		FORCEINLINE static __m128i VECTORCALL Blend(__m128i fgcolor, __m128i bgcolor, unsigned int ifgcolor0, unsigned int ifgcolor1, uint32_t srcalpha, uint32_t destalpha)
+		// The caller sets the alpha channel of the stored pixels to 255
+		FORCEINLINE static V::vec VECTORCALL Blend(V::vec fgcolor, V::vec bgcolor, unsigned int ifgcolor0, unsigned int ifgcolor1, uint32_t srcalpha, uint32_t destalpha)
 		{
 			using namespace DrawWall32TModes;
 
 			if (BlendT::Mode == (int)WallBlendModes::Opaque)
 			{
-				__m128i outcolor = fgcolor;
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				return fgcolor;
 			}
 			else if (BlendT::Mode == (int)WallBlendModes::Masked)
 			{
-#if 0 // leaving this in for alpha texture support (todo: fix in texture manager later?)
-				__m128i alpha = _mm_shufflelo_epi16(fgcolor, _MM_SHUFFLE(3, 3, 3, 3));
-				alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
-				alpha = _mm_add_epi16(alpha, _mm_srli_epi16(alpha, 7)); // 255 -> 256
-
-				__m128i inv_alpha = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
-
-				fgcolor = _mm_mullo_epi16(fgcolor, alpha);
-				bgcolor = _mm_mullo_epi16(bgcolor, inv_alpha);
-				__m128i outcolor = _mm_srli_epi16(_mm_add_epi16(fgcolor, bgcolor), 8);
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
-#endif
-				__m128i mask = _mm_cmpeq_epi32(_mm_packus_epi16(fgcolor, _mm_setzero_si128()), _mm_setzero_si128());
-				mask = _mm_unpacklo_epi8(mask, _mm_setzero_si128());
-				__m128i outcolor = _mm_or_si128(_mm_and_si128(mask, bgcolor), _mm_andnot_si128(mask, fgcolor));
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				return V::select(V::pixeliszero(fgcolor), bgcolor, fgcolor);
 			}
 			else
 			{
@@ -361,40 +339,37 @@ namespace swrenderer
 				uint32_t fgalpha0 = (srcalpha * alpha0 + 128) >> 8;
 				uint32_t fgalpha1 = (srcalpha * alpha1 + 128) >> 8;
 
-				__m128i bgalpha = _mm_set_epi16(bgalpha1, bgalpha1, bgalpha1, bgalpha1, bgalpha0, bgalpha0, bgalpha0, bgalpha0);
-				__m128i fgalpha = _mm_set_epi16(fgalpha1, fgalpha1, fgalpha1, fgalpha1, fgalpha0, fgalpha0, fgalpha0, fgalpha0);
+				V::vec bgalpha = V::set8(bgalpha0, bgalpha0, bgalpha0, bgalpha0, bgalpha1, bgalpha1, bgalpha1, bgalpha1);
+				V::vec fgalpha = V::set8(fgalpha0, fgalpha0, fgalpha0, fgalpha0, fgalpha1, fgalpha1, fgalpha1, fgalpha1);
 
-				fgcolor = _mm_mullo_epi16(fgcolor, fgalpha);
-				bgcolor = _mm_mullo_epi16(bgcolor, bgalpha);
+				fgcolor = V::mullo(fgcolor, fgalpha);
+				bgcolor = V::mullo(bgcolor, bgalpha);
 
-				__m128i fg_lo = _mm_unpacklo_epi16(fgcolor, _mm_setzero_si128());
-				__m128i bg_lo = _mm_unpacklo_epi16(bgcolor, _mm_setzero_si128());
-				__m128i fg_hi = _mm_unpackhi_epi16(fgcolor, _mm_setzero_si128());
-				__m128i bg_hi = _mm_unpackhi_epi16(bgcolor, _mm_setzero_si128());
+				V::ivec fg_lo = V::widenlo(fgcolor);
+				V::ivec bg_lo = V::widenlo(bgcolor);
+				V::ivec fg_hi = V::widenhi(fgcolor);
+				V::ivec bg_hi = V::widenhi(bgcolor);
 
-				__m128i out_lo, out_hi;
+				V::ivec out_lo, out_hi;
 				if (BlendT::Mode == (int)WallBlendModes::AddClamp)
 				{
-					out_lo = _mm_add_epi32(fg_lo, bg_lo);
-					out_hi = _mm_add_epi32(fg_hi, bg_hi);
+					out_lo = V::addi(fg_lo, bg_lo);
+					out_hi = V::addi(fg_hi, bg_hi);
 				}
 				else if (BlendT::Mode == (int)WallBlendModes::SubClamp)
 				{
-					out_lo = _mm_sub_epi32(fg_lo, bg_lo);
-					out_hi = _mm_sub_epi32(fg_hi, bg_hi);
+					out_lo = V::subi(fg_lo, bg_lo);
+					out_hi = V::subi(fg_hi, bg_hi);
 				}
 				else if (BlendT::Mode == (int)WallBlendModes::RevSubClamp)
 				{
-					out_lo = _mm_sub_epi32(bg_lo, fg_lo);
-					out_hi = _mm_sub_epi32(bg_hi, fg_hi);
+					out_lo = V::subi(bg_lo, fg_lo);
+					out_hi = V::subi(bg_hi, fg_hi);
 				}
 
-				out_lo = _mm_srai_epi32(out_lo, 8);
-				out_hi = _mm_srai_epi32(out_hi, 8);
-				__m128i outcolor = _mm_packs_epi32(out_lo, out_hi);
-				outcolor = _mm_packus_epi16(outcolor, _mm_setzero_si128());
-				outcolor = _mm_or_si128(outcolor, _mm_set1_epi32(0xff000000));
-				return outcolor;
+				out_lo = V::srai<8>(out_lo);
+				out_hi = V::srai<8>(out_hi);
+				return V::narrow(out_lo, out_hi);
 			}
 		}
 	};
@@ -62,6 +62,7 @@ namespace swrenderer
 		int X1 = 0;
 		int X2 = MAXWIDTH;
 		bool MainThread = false;
+		uint64_t SliceTime = 0; // Nanoseconds spent rendering the last slice
 
 		std::unique_ptr<RenderMemory> FrameMemory;
 		std::unique_ptr<RenderOpaquePass> OpaquePass;
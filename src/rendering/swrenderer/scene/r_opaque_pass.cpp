@@ -619,9 +619,10 @@ namespace swrenderer
 		if ((unsigned int)(sub->Index()) < Level->subsectors.Size())
 		{ // Only do it for the main BSP.
 			int lightlevel = (floorlightlevel + ceilinglightlevel) / 2;
-			for (int i = frontsector->Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = frontsector->Level->Particles[i].snext)
+			auto &particles = frontsector->Level->Particles;
+			for (uint32_t i = frontsector->Level->ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = particles.SNext[i])
 			{
-				RenderParticle::Project(Thread, &frontsector->Level->Particles[i], sub->sector, lightlevel, FakeSide, foggy);
+				RenderParticle::Project(Thread, i, sub->sector, lightlevel, FakeSide, foggy);
 			}
 		}
 
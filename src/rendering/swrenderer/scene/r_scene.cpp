@@ -57,6 +57,7 @@
 #include "r_memory.h"
 #include "swrenderer/r_renderthread.h"
 #include "swrenderer/things/r_playersprite.h"
+#include "i_time.h"
 #include <chrono>
 
 #ifdef WIN32
@@ -67,6 +68,7 @@ EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
 
 CVAR(Int, r_scene_multithreaded, 1, 0);
+CVAR(Bool, r_scene_balanceslices, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 bool r_modelscene = false;
@@ -74,6 +76,13 @@ bool r_modelscene = false;
 namespace swrenderer
 {
 	cycle_t WallCycles, PlaneCycles, MaskedCycles;
+
+	struct FSliceStats
+	{
+		int X1, X2;
+		uint64_t Time;
+	};
+	static TArray<FSliceStats> SliceStats;
 	
 	RenderScene::RenderScene()
 	{
@@ -215,9 +224,8 @@ namespace swrenderer
 		{
 			*Threads[i]->Viewport = *MainThread()->Viewport;
 			*Threads[i]->Light = *MainThread()->Light;
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
 		}
+		PartitionSlices(numThreads);
 		run_id++;
 		FSoftwareTexture::CurrentUpdate = run_id;
 		start_lock.unlock();
@@ -249,13 +257,93 @@ namespace swrenderer
 			finished_threads = 0;
 		}
 
+		UpdateColumnCosts(numThreads);
+
 		// Change main thread back to covering the whole screen for player sprites
 		MainThread()->X1 = 0;
 		MainThread()->X2 = viewwidth;
 	}
 
+	// Slices get equal widths unless there are timings for the current view.
+	// With timings, each slice gets the same share of the estimated cost, so a
+	// cluttered part of the screen is split between more threads than the sky.
+	void RenderScene::PartitionSlices(int numThreads)
+	{
+		bool balance = r_scene_balanceslices && numThreads > 1 && viewwidth >= numThreads * 8 && !MainThread()->Viewport->RenderingToCanvas;
+		if (!balance || !ColumnCostsValid || (int)ColumnCosts.size() != viewwidth)
+		{
+			for (int i = 0; i < numThreads; i++)
+			{
+				Threads[i]->X1 = viewwidth * i / numThreads;
+				Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			}
+			return;
+		}
+
+		double total = 0.0;
+		for (double cost : ColumnCosts)
+			total += cost;
+
+		// Keep every slice wide enough that its clipping and setup overhead stays small
+		int minwidth = MAX(viewwidth / (numThreads * 8), 1);
+
+		int x = 0;
+		double accumulated = 0.0;
+		for (int i = 0; i < numThreads; i++)
+		{
+			Threads[i]->X1 = x;
+			if (i == numThreads - 1)
+			{
+				x = viewwidth;
+			}
+			else
+			{
+				double target = total * (i + 1) / numThreads;
+				int maxx = viewwidth - minwidth * (numThreads - 1 - i);
+				int end = MIN(x + minwidth, maxx);
+				for (int j = x; j < end; j++)
+					accumulated += ColumnCosts[j];
+				while (end < maxx && accumulated + ColumnCosts[end] * 0.5 < target)
+					accumulated += ColumnCosts[end++];
+				x = end;
+			}
+			Threads[i]->X2 = x;
+		}
+	}
+
+	// Spreads the time of each slice evenly over its columns and blends it
+	// into the estimate, so that a single slow frame does not move the
+	// boundaries too far.
+	void RenderScene::UpdateColumnCosts(int numThreads)
+	{
+		SliceStats.Resize(numThreads);
+		for (int i = 0; i < numThreads; i++)
+		{
+			SliceStats[i] = { Threads[i]->X1, Threads[i]->X2, Threads[i]->SliceTime };
+		}
+
+		if (!r_scene_balanceslices || numThreads == 1 || MainThread()->Viewport->RenderingToCanvas)
+			return;
+
+		bool blend = ColumnCostsValid && (int)ColumnCosts.size() == viewwidth;
+		ColumnCosts.resize(viewwidth);
+		for (int i = 0; i < numThreads; i++)
+		{
+			int x1 = Threads[i]->X1;
+			int x2 = Threads[i]->X2;
+			if (x2 <= x1)
+				continue;
+			double cost = (double)Threads[i]->SliceTime / (x2 - x1);
+			for (int x = x1; x < x2; x++)
+				ColumnCosts[x] = blend ? (ColumnCosts[x] + cost) * 0.5 : cost;
+		}
+		ColumnCostsValid = true;
+	}
+
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		uint64_t start = I_nsTime();
+
 		thread->FrameMemory->Clear();
 		thread->Clip3D->Cleanup();
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
@@ -294,6 +382,8 @@ namespace swrenderer
 			thread->TranslucentPass->Render();
 		}
 
+		thread->SliceTime = I_nsTime() - start;
+
 #if 0 // shows the render slice edges
 		if (thread->Viewport->RenderTarget->IsBgra())
 		{
@@ -455,6 +545,24 @@ namespace swrenderer
 		return out;
 	}
 
+	// Busy time per slice of the last frame. Idle is the time a thread had
+	// to wait for the slowest slice to finish.
+	ADD_STAT(swthreads)
+	{
+		FString out;
+		uint64_t slowest = 0;
+		for (auto &stats : SliceStats)
+			slowest = MAX(slowest, stats.Time);
+
+		for (unsigned i = 0; i < SliceStats.Size(); i++)
+		{
+			auto &stats = SliceStats[i];
+			out.AppendFormat("thread %2u: x=%4d-%4d  busy=%5.2f ms  idle=%5.2f ms\n", i, stats.X1, stats.X2,
+				stats.Time / 1e6, (slowest - stats.Time) / 1e6);
+		}
+		return out;
+	}
+
 	static double bestwallcycles = HUGE_VAL;
 
 	ADD_STAT(wallcycles)
@@ -61,6 +61,8 @@ namespace swrenderer
 		void RenderActorView(AActor *actor,bool renderplayersprite, bool dontmaplines);
 		void RenderThreadSlices();
 		void RenderThreadSlice(RenderThread *thread);
+		void PartitionSlices(int numThreads);
+		void UpdateColumnCosts(int numThreads);
 		void RenderPSprites();
 
 		void StartThreads(size_t numThreads);
@@ -78,5 +80,8 @@ namespace swrenderer
 		std::mutex end_mutex;
 		std::condition_variable end_condition;
 		size_t finished_threads = 0;
+
+		std::vector<double> ColumnCosts; // Estimated render time per column, from previous frames
+		bool ColumnCostsValid = false;
 	};
 }
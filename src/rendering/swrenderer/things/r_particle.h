@@ -3,14 +3,13 @@
 #include "r_visiblesprite.h"
 #include "swrenderer/scene/r_opaque_pass.h"
 
-struct particle_t;
 
 namespace swrenderer
 {
 	class RenderParticle : public VisibleSprite
 	{
 	public:
-		static void Project(RenderThread *thread, particle_t *, const sector_t *sector, int shade, WaterFakeSide fakeside, bool foggy);
+		static void Project(RenderThread *thread, int particle, const sector_t *sector, int shade, WaterFakeSide fakeside, bool foggy);
 
 	protected:
 		bool IsParticle() const override { return true; }
@@ -954,6 +954,129 @@ DEFINE_ACTION_FUNCTION_NATIVE(DObject, BuiltinNewDoom, BuiltinNewDoom)
 }
 
 
+//==========================================================================
+//
+// Bytecode cache support
+//
+// State constants are stored as owning class and index, the state label
+// table gets the part appended by the code generator replayed.
+//
+//==========================================================================
+
+static bool CacheWriteState(FBytecodeWriter &w, FState *state)
+{
+	if (state == nullptr)
+	{
+		w.WriteString("");
+		return true;
+	}
+	for (auto cls : PClass::AllClasses)
+	{
+		if (cls->IsDescendantOf(RUNTIME_CLASS(AActor)) && static_cast<PClassActor *>(cls)->OwnsState(state))
+		{
+			auto info = static_cast<PClassActor *>(cls)->ActorInfo();
+			w.WriteString(cls->TypeName.GetChars());
+			w.WriteInt(int(state - info->OwnedStates));
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool CacheReadState(FBytecodeReader &r, FState *&state)
+{
+	state = nullptr;
+	FString clsname = r.ReadString();
+	if (r.Failed()) return false;
+	if (clsname.IsEmpty()) return true;
+	uint32_t index = r.ReadInt();
+	auto cls = PClass::FindActor(clsname);
+	if (r.Failed() || cls == nullptr || index >= (uint32_t)cls->ActorInfo()->NumOwnedStates) return false;
+	state = cls->ActorInfo()->OwnedStates + index;
+	return true;
+}
+
+static bool CacheWritePointer(FBytecodeWriter &w, void *ptr)
+{
+	return ptr != nullptr && CacheWriteState(w, (FState *)ptr);
+}
+
+static bool CacheReadPointer(FBytecodeReader &r, void *&ptr)
+{
+	FState *state;
+	if (!CacheReadState(r, state) || state == nullptr) return false;
+	ptr = state;
+	return true;
+}
+
+static unsigned StateLabelsAtStart;
+
+static void CacheBeginTables(FBytecodeWriter &key)
+{
+	StateLabelsAtStart = StateLabels.Storage.Size();
+	key.WriteInt(StateLabelsAtStart);
+}
+
+static bool CacheWriteTables(FBytecodeWriter &w)
+{
+	auto &storage = StateLabels.Storage;
+	unsigned pos = StateLabelsAtStart;
+	w.WriteInt(storage.Size() - pos);
+	while (pos < storage.Size())
+	{
+		int count;
+		memcpy(&count, &storage[pos], sizeof(int));
+		pos += sizeof(int);
+		w.WriteInt(count);
+		if (count == 0)
+		{
+			FState *state;
+			memcpy(&state, &storage[pos], sizeof(state));
+			pos += sizeof(state);
+			if (!CacheWriteState(w, state)) return false;
+		}
+		else
+		{
+			// Name indices are stable because the cache replays all names the code generator created.
+			w.Write(&storage[pos], count * sizeof(FName));
+			pos += count * sizeof(FName);
+		}
+	}
+	return pos == storage.Size();
+}
+
+static bool CacheReadTables(FBytecodeReader &r)
+{
+	auto &storage = StateLabels.Storage;
+	if (storage.Size() != StateLabelsAtStart) return false;
+
+	uint32_t size = r.ReadInt();
+	if (r.Failed()) return false;
+	TArray<uint8_t> tail;
+	while (tail.Size() < size)
+	{
+		uint32_t count = r.ReadInt();
+		if (r.Failed() || count > 0xffff) return false;
+		unsigned pos = tail.Reserve(sizeof(int));
+		memcpy(&tail[pos], &count, sizeof(int));
+		if (count == 0)
+		{
+			FState *state;
+			if (!CacheReadState(r, state)) return false;
+			pos = tail.Reserve(sizeof(state));
+			memcpy(&tail[pos], &state, sizeof(state));
+		}
+		else
+		{
+			pos = tail.Reserve(count * sizeof(FName));
+			if (!r.Read(&tail[pos], count * sizeof(FName))) return false;
+		}
+	}
+	if (tail.Size() != size) return false;
+	storage.Append(tail);
+	return true;
+}
+
 void SetDoomCompileEnvironment()
 {
 	compileEnvironment.SpecialTypeCast = CustomTypeCast;
@@ -965,4 +1088,9 @@ void SetDoomCompileEnvironment()
 	compileEnvironment.ResolveSpecialFunction = AJumpProcessing;
 	compileEnvironment.CheckCustomGlobalFunctions = ResolveGlobalCustomFunction;
 	compileEnvironment.CustomBuiltinNew = "BuiltinNewDoom";
+	compileEnvironment.CacheWritePointer = CacheWritePointer;
+	compileEnvironment.CacheReadPointer = CacheReadPointer;
+	compileEnvironment.CacheBeginTables = CacheBeginTables;
+	compileEnvironment.CacheWriteTables = CacheWriteTables;
+	compileEnvironment.CacheReadTables = CacheReadTables;
 }
@@ -1272,6 +1272,8 @@ static void ParseDamageDefinition(FScanner &sc)
 
 void ParseDecorate (FScanner &sc, PNamespace *ns)
 {
+	FunctionBuildList.AddSourceLump(sc.LumpNum);
+
 	// Get actor class name.
 	for(;;)
 	{
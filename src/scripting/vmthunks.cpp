@@ -1708,6 +1708,7 @@ DEFINE_ACTION_FUNCTION_NATIVE(_Secplane, isEqual, isPlaneEqual)
 
 static void ChangeHeight(secplane_t *self, double hdiff)
 {
+	P_InvalidateSightCache();
 	self->ChangeHeight(hdiff);
 }
 
@@ -1715,7 +1716,7 @@ DEFINE_ACTION_FUNCTION_NATIVE(_Secplane, ChangeHeight, ChangeHeight)
 {
 	PARAM_SELF_STRUCT_PROLOGUE(secplane_t);
 	PARAM_FLOAT(hdiff);
-	self->ChangeHeight(hdiff);
+	ChangeHeight(self, hdiff);
 	return 0;
 }
 
@@ -41,24 +41,66 @@
 #include <string.h>
 #include <math.h>
 
+#include <thread>
+
 #include "doomdata.h"
 #include "nodebuild.h"
+#include "c_cvars.h"
+#include "workstealing.h"
 
 const int MaxSegs = 64;
 const int SplitCost = 8;
 const int AAPreference = 16;
 
+// Splitter selection is only spread over threads when scoring all candidates
+// tests at least this many segs. Only the topmost splits of large maps get there.
+const unsigned int MinParallelWork = 65536;
+const int CandidateGrain = 4;
+
 #if 0
 #define D(x) x
 #else
 #define D(x) do{}while(0)
 #endif
 
+// 0 means one thread per core (up to 8), 1 builds on the calling thread only.
+CUSTOM_CVAR(Int, gl_nodebuilder_threads, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else if (self > 16) self = 16;
+}
+
+static FWorkStealingPool NodeBuilderPool;
+
+//==========================================================================
+//
+// GetNodeBuilderPool
+//
+// The pool only evaluates splitter candidates, the choice between them is
+// still made in set order. The built nodes are therefore the same no matter
+// how many threads are used, which keeps cached nodes valid.
+//
+//==========================================================================
+
+static FWorkStealingPool *GetNodeBuilderPool()
+{
+	int count = gl_nodebuilder_threads;
+	if (count == 0)
+	{
+		count = std::min((int)std::thread::hardware_concurrency(), 8);
+	}
+	if (count <= 1) return NULL;
+
+	NodeBuilderPool.SetThreadCount(count - 1);
+	return &NodeBuilderPool;
+}
+
 FNodeBuilder::FNodeBuilder(FLevel &lev)
 : Level(lev), GLNodes(false), SegsStuffed(0)
 {
 	VertexMap = NULL;
 	OldVertexTable = NULL;
+	Pool = NULL;	// Polyobject mini BSPs are far too small to benefit.
 }
 
 FNodeBuilder::FNodeBuilder (FLevel &lev,
@@ -66,6 +108,7 @@ FNodeBuilder::FNodeBuilder (FLevel &lev,
 							bool makeGLNodes)
 	: Level(lev), GLNodes(makeGLNodes), SegsStuffed(0)
 {
+	Pool = GetNodeBuilderPool();
 	VertexMap = new FVertexMap (*this, Level.MinX, Level.MinY, Level.MaxX, Level.MaxY);
 	FindUsedVertices (Level.Vertices, Level.NumVertices);
 	MakeSegsFromSides ();
@@ -107,6 +150,8 @@ void FNodeBuilder::Clear()
 	Touched.Clear();
 	Colinear.Clear();
 	SplitSharers.Clear();
+	Candidates.Clear();
+	Scores.Clear();
 	if (VertexMap == NULL)
 	{
 		VertexMap = new FVertexMapSimple(*this);
@@ -444,6 +489,7 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	int bestvalue;
 	uint32_t bestseg;
 	uint32_t seg;
+	unsigned int setsize;
 	bool nosplitters = false;
 
 	bestvalue = 0;
@@ -451,8 +497,10 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 
 	seg = set;
 	stepleft = 0;
+	setsize = 0;
 
 	memset (&PlaneChecked[0], 0, PlaneChecked.Size());
+	Candidates.Clear ();
 
 	D(Printf (PRINT_LOG, "Processing set %d\n", set));
 
@@ -473,28 +521,36 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 				}
 
 				stepleft = step;
-				SetNodeFromSeg (node, pseg);
-
-				int value = Heuristic (node, set, nosplit);
-
-				D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
-					(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
-
-				if (value > bestvalue)
-				{
-					bestvalue = value;
-					bestseg = seg;
-				}
-				else if (value < 0)
-				{
-					nosplitters = true;
-				}
+				Candidates.Push (seg);
 			}
 		}
 
+		setsize++;
 		seg = pseg->next;
 	}
 
+	ScoreCandidates (set, nosplit, setsize);
+
+	for (unsigned int i = 0; i < Candidates.Size(); ++i)
+	{
+		int value = Scores[i];
+
+		seg = Candidates[i];
+		D(SetNodeFromSeg (node, &Segs[seg]));
+		D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
+			(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
+
+		if (value > bestvalue)
+		{
+			bestvalue = value;
+			bestseg = seg;
+		}
+		else if (value < 0)
+		{
+			nosplitters = true;
+		}
+	}
+
 	if (bestseg == UINT_MAX)
 	{ // No lines split any others into two sets, so this is a convex region.
 	D(Printf (PRINT_LOG, "set %d, step %d, nosplit %d has no good splitter (%d)\n", set, step, nosplit, nosplitters));
@@ -508,13 +564,50 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	return 1;
 }
 
+// Fills Scores with the heuristic value of every splitter in Candidates.
+// Scoring only reads the segs and vertices, so when the set is big enough
+// the candidates are handed to the thread pool, each chunk with its own
+// scratch lists.
+
+void FNodeBuilder::ScoreCandidates (uint32_t set, bool nosplit, unsigned int setsize)
+{
+	unsigned int count = Candidates.Size();
+
+	Scores.Resize (count);
+
+	if (Pool != NULL && count > 1 && (uint64_t)count * setsize >= MinParallelWork)
+	{
+		Pool->Run (count, CandidateGrain, [&](int start, int end)
+		{
+			TArray<int> touched, colinear;
+			node_t node;
+
+			for (int i = start; i < end; ++i)
+			{
+				SetNodeFromSeg (node, &Segs[Candidates[i]]);
+				Scores[i] = Heuristic (node, set, nosplit, touched, colinear);
+			}
+		});
+	}
+	else
+	{
+		node_t node;
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			SetNodeFromSeg (node, &Segs[Candidates[i]]);
+			Scores[i] = Heuristic (node, set, nosplit);
+		}
+	}
+}
+
 // Given a splitter (node), returns a score based on how "good" the resulting
 // split in a set of segs is. Higher scores are better. -1 means this splitter
 // splits something it shouldn't and will only be returned if honorNoSplit is
 // true. A score of 0 means that the splitter does not split any of the segs
 // in the set.
 
-int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
+int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit, TArray<int> &touched, TArray<int> &colinear)
 {
 	// Set the initial score above 0 so that near vertex anti-weighting is less likely to produce a negative score.
 	int score = 1000000;
@@ -529,8 +622,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	unsigned int max, m2, p, q;
 	double frac;
 
-	Touched.Clear ();
-	Colinear.Clear ();
+	touched.Clear ();
+	colinear.Clear ();
 
 	while (i != UINT_MAX)
 	{
@@ -556,32 +649,32 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 			{
 				if ((sidev[0] | sidev[1]) != 0)
 				{
-					max = Touched.Size();
+					max = touched.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Touched[p] == test->loopnum)
+						if (touched[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Touched.Push (test->loopnum);
+						touched.Push (test->loopnum);
 					}
 				}
 				else
 				{
-					max = Colinear.Size();
+					max = colinear.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Colinear[p] == test->loopnum)
+						if (colinear[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Colinear.Push (test->loopnum);
+						colinear.Push (test->loopnum);
 					}
 				}
 			}
@@ -698,8 +791,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	// seg of that sector must be crossing the container's corner and does not
 	// actually split the container.
 
-	max = Touched.Size ();
-	m2 = Colinear.Size ();
+	max = touched.Size ();
+	m2 = colinear.Size ();
 
 	// If honorNoSplit is false, then both these lists will be empty.
 
@@ -712,10 +805,10 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 	for (p = 0; p < max; ++p)
 	{
-		int look = Touched[p];
+		int look = touched[p];
 		for (q = 0; q < m2; ++q)
 		{
-			if (look == Colinear[q])
+			if (look == colinear[q])
 			{
 				break;
 			}